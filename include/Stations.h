@@ -0,0 +1,109 @@
+/*
+ * Station geofences, generated by tools/gen_geofences.py from tools/stations.csv.
+ * Do not edit; regenerate after changing the station list.
+ *
+ * 14 fences, 4 polygon vertices, 27x16 grid, at most 3 fences per cell.
+ * Defines tables, include from one source file only.
+ */
+
+#ifndef Stations_h
+#define Stations_h
+
+#include "Geofence.h"
+
+#define STATION_COUNT 14
+
+static const GeoFence STATION_FENCES[STATION_COUNT] = {
+    {1, 4, 0, 69337500, 798506500, 0, {69318000, 798487000, 69357000, 798526000}}, // Colombo Fort
+    {2, 0, 0, 69290000, 798650000, 25000, {69267516, 798627350, 69312484, 798672650}}, // Maradana
+    {3, 0, 0, 69381000, 798770000, 20000, {69363013, 798751880, 69398987, 798788120}}, // Dematagoda
+    {4, 0, 0, 69550000, 799190000, 20000, {69532013, 799171879, 69567987, 799208121}}, // Kelaniya
+    {5, 0, 0, 70290000, 799230000, 25000, {70267516, 799207345, 70312484, 799252655}}, // Ragama
+    {6, 0, 0, 70920000, 799940000, 25000, {70897516, 799917342, 70942484, 799962658}}, // Gampaha
+    {7, 0, 0, 71560000, 800960000, 20000, {71542013, 800941871, 71577987, 800978129}}, // Veyangoda
+    {8, 0, 0, 73350000, 803000000, 30000, {73323020, 802972797, 73376980, 803027203}}, // Polgahawela
+    {9, 0, 0, 72600000, 805930000, 25000, {72577516, 805907334, 72622484, 805952666}}, // Peradeniya Junction
+    {10, 0, 0, 72906000, 806337000, 30000, {72879020, 806309800, 72932980, 806364200}}, // Kandy
+    {11, 0, 0, 68330000, 798640000, 20000, {68312013, 798621884, 68347987, 798658116}}, // Mount Lavinia
+    {12, 0, 0, 67130000, 799040000, 25000, {67107516, 799017360, 67152484, 799062640}}, // Panadura
+    {13, 0, 0, 65850000, 799620000, 25000, {65827516, 799597366, 65872484, 799642634}}, // Kalutara South
+    {14, 0, 0, 60330000, 802140000, 30000, {60303020, 802112869, 60356980, 802167131}}, // Galle
+};
+
+static const GeoVertex STATION_VERTICES[] = {
+    {69357000, 798487000},
+    {69357000, 798526000},
+    {69318000, 798526000},
+    {69318000, 798487000},
+};
+
+static const char *const STATION_NAMES[STATION_COUNT] = {
+    "Colombo Fort",
+    "Maradana",
+    "Dematagoda",
+    "Kelaniya",
+    "Ragama",
+    "Gampaha",
+    "Veyangoda",
+    "Polgahawela",
+    "Peradeniya Junction",
+    "Kandy",
+    "Mount Lavinia",
+    "Panadura",
+    "Kalutara South",
+    "Galle",
+};
+
+static const uint16_t STATION_CELL_START[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+    9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 10,
+    10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11,
+    11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+    11, 11, 11, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 13, 13, 13,
+    13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+    13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+    13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+    13, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+    14, 14, 14, 14, 14, 14, 14, 14, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 16, 17, 17, 17, 17, 17, 17,
+    17,
+};
+
+static const uint16_t STATION_CELL_FENCES[] = {
+    13, 12, 11, 10, 1, 0, 1, 2, 3, 4, 4, 5,
+    6, 8, 9, 7, 7,
+};
+
+static const GeofenceTable STATION_TABLE = {
+    STATION_FENCES, STATION_COUNT, STATION_VERTICES,
+    STATION_CELL_START, STATION_CELL_FENCES,
+    60303020, 798487000, // grid origin
+    500000, 500000, // cell size
+    27, 16};
+
+#endif
@@ -0,0 +1,342 @@
+#include "ATEngine.h"
+
+ATEngine::ATEngine(Stream &stream) : _stream(stream)
+{
+  _queue = NULL;
+  _pollTask = NULL;
+  _busy = false;
+  _dataSent = false;
+  _skipSpace = false;
+  _held = false;
+  _sentAt = 0;
+  _guarding = false;
+  _timedOutAt = 0;
+  _lineLen = 0;
+  _urcCount = 0;
+  _statsCount = 0;
+  _droppedLines = 0;
+  memset(_stats, 0, sizeof(_stats));
+}
+
+bool ATEngine::begin()
+{
+  if (_queue == NULL)
+  {
+    _queue = xQueueCreate(AT_QUEUE_LENGTH, sizeof(Request));
+  }
+  return _queue != NULL;
+}
+
+bool ATEngine::send(const char *command, uint32_t timeoutMs, ATCompletion onDone, void *context, ATLineHandler onLine)
+{
+  return _enqueue(command, timeoutMs, onDone, context, onLine, NULL, 0, false);
+}
+
+bool ATEngine::sendData(const char *command, const uint8_t *data, uint16_t length, uint32_t timeoutMs,
+                        ATCompletion onDone, void *context)
+{
+  return _enqueue(command, timeoutMs, onDone, context, NULL, data, length, false);
+}
+
+bool ATEngine::sendForLine(const char *command, uint32_t timeoutMs, ATCompletion onDone, void *context)
+{
+  return _enqueue(command, timeoutMs, onDone, context, NULL, NULL, 0, true);
+}
+
+bool ATEngine::_enqueue(const char *command, uint32_t timeoutMs, ATCompletion onDone, void *context,
+                        ATLineHandler onLine, const uint8_t *data, uint16_t dataLength, bool lineIsFinal)
+{
+  if (_queue == NULL || strlen(command) >= AT_COMMAND_MAX)
+  {
+    return false;
+  }
+  Request request;
+  strcpy(request.command, command);
+  request.timeoutMs = timeoutMs;
+  request.onDone = onDone;
+  request.onLine = onLine;
+  request.context = context;
+  request.data = data;
+  request.dataLength = dataLength;
+  request.lineIsFinal = lineIsFinal;
+  return xQueueSend(_queue, &request, 0) == pdTRUE;
+}
+
+// Completion used by sendAndWait() to wake the waiting task
+struct ATWaiter
+{
+  TaskHandle_t task;
+  volatile bool done;
+  ATResult result;
+  ATLineHandler onLine;
+  void *context;
+};
+
+static void atWaiterLine(const char *line, void *context)
+{
+  ATWaiter *waiter = (ATWaiter *)context;
+  waiter->onLine(line, waiter->context);
+}
+
+static void atWaiterDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  ATWaiter *waiter = (ATWaiter *)context;
+  // The waiter lives on the waiting task's stack and may be gone as soon as
+  // done is set, so nothing of it is touched afterwards
+  TaskHandle_t task = waiter->task;
+  waiter->result = result;
+  waiter->done = true;
+  if (task != NULL)
+  {
+    xTaskNotifyGive(task);
+  }
+}
+
+ATResult ATEngine::sendAndWait(const char *command, uint32_t timeoutMs, ATLineHandler onLine, void *context)
+{
+  bool onPollTask = _pollTask != NULL && _pollTask == xTaskGetCurrentTaskHandle();
+  ATWaiter waiter;
+  waiter.task = onPollTask ? NULL : xTaskGetCurrentTaskHandle();
+  waiter.done = false;
+  waiter.result = AT_TIMEOUT;
+  waiter.onLine = onLine;
+  waiter.context = context;
+
+  if (!send(command, timeoutMs, atWaiterDone, &waiter, onLine != NULL ? atWaiterLine : NULL))
+  {
+    return AT_QUEUE_FULL;
+  }
+
+  while (!waiter.done)
+  {
+    if (onPollTask)
+    {
+      poll();
+      vTaskDelay(1);
+    }
+    else
+    {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+  }
+  return waiter.result;
+}
+
+bool ATEngine::onURC(const char *prefix, ATLineHandler handler, void *context)
+{
+  if (_urcCount >= AT_MAX_URC_HANDLERS)
+  {
+    return false;
+  }
+  _urc[_urcCount].prefix = prefix;
+  _urc[_urcCount].prefixLen = strlen(prefix);
+  _urc[_urcCount].handler = handler;
+  _urc[_urcCount].context = context;
+  _urcCount++;
+  return true;
+}
+
+void ATEngine::poll()
+{
+  _pollTask = xTaskGetCurrentTaskHandle();
+
+  // Dispatch everything that has arrived so far
+  while (_stream.available())
+  {
+    char c = (char)_stream.read();
+    if (_skipSpace)
+    {
+      _skipSpace = false;
+      if (c == ' ')
+        continue;
+    }
+    if (c == '>' && _lineLen == 0 && _busy && _current.data != NULL && !_dataSent)
+    {
+      // The prompt has no line ending: the payload goes out as soon as it is seen
+      _stream.write(_current.data, _current.dataLength);
+      _dataSent = true;
+      _skipSpace = true;
+      continue;
+    }
+    if (c == '\n')
+    {
+      _line[_lineLen] = '\0';
+      if (_lineLen > 0)
+      {
+        _handleLine();
+      }
+      _lineLen = 0;
+    }
+    else if (c != '\r' && _lineLen < AT_LINE_MAX - 1)
+    {
+      _line[_lineLen++] = c;
+    }
+  }
+
+  if (_busy && millis() - _sentAt >= _current.timeoutMs)
+  {
+    _finish(AT_TIMEOUT, NULL);
+    _timedOutAt = millis();
+    _guarding = true;
+  }
+
+  // A late OK or ERROR of a timed-out command must not complete the next one:
+  // everything that arrives during the guard is read above as unclaimed
+  if (_guarding && millis() - _timedOutAt < AT_TIMEOUT_GUARD)
+  {
+    return;
+  }
+  _guarding = false;
+
+  if (!_busy && !_held && _queue != NULL && xQueueReceive(_queue, &_current, 0) == pdTRUE)
+  {
+    _start();
+  }
+}
+
+void ATEngine::_start()
+{
+  _busy = true;
+  _dataSent = false;
+  _stream.print(_current.command);
+  _stream.print("\r\n");
+  _sentAt = millis();
+}
+
+bool ATEngine::_dispatchURC(const char *line)
+{
+  for (uint8_t i = 0; i < _urcCount; i++)
+  {
+    if (strncmp(line, _urc[i].prefix, _urc[i].prefixLen) == 0)
+    {
+      _urc[i].handler(line, _urc[i].context);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Classifies one complete response line.
+ */
+void ATEngine::_handleLine()
+{
+  if (_dispatchURC(_line))
+  {
+    return;
+  }
+  if (!_busy)
+  {
+    _droppedLines++; // unsolicited line nobody registered for
+    return;
+  }
+
+  if (strcmp(_line, "OK") == 0 || strcmp(_line, "SEND OK") == 0 || strcmp(_line, "SHUT OK") == 0 ||
+      strcmp(_line, "CLOSE OK") == 0)
+  {
+    _finish(AT_OK, _line);
+  }
+  else if (strcmp(_line, "ERROR") == 0 || strcmp(_line, "SEND FAIL") == 0)
+  {
+    _finish(AT_ERROR, _line);
+  }
+  else if (strncmp(_line, "+CME ERROR:", 11) == 0)
+  {
+    _finish(AT_CME_ERROR, _line);
+  }
+  else if (strncmp(_line, "+CMS ERROR:", 11) == 0)
+  {
+    _finish(AT_CMS_ERROR, _line);
+  }
+  else if (strcmp(_line, _current.command) == 0)
+  {
+    // command echo (ATE1), nothing to report
+  }
+  else if (_current.lineIsFinal)
+  {
+    _finish(AT_OK, _line);
+  }
+  else if (_current.onLine != NULL)
+  {
+    _current.onLine(_line, _current.context);
+  }
+}
+
+void ATEngine::_finish(ATResult result, const char *finalLine)
+{
+  uint32_t latencyMs = millis() - _sentAt;
+  _busy = false;
+  _record(result, latencyMs);
+  if (_current.onDone != NULL)
+  {
+    _current.onDone(result, finalLine, latencyMs, _current.context);
+  }
+}
+
+/**
+ * Adds one completed command to the latency table, keyed by the command
+ * name without its arguments.
+ */
+void ATEngine::_record(ATResult result, uint32_t latencyMs)
+{
+  char name[AT_STATS_NAME_MAX];
+  uint8_t len = 0;
+  while (len < AT_STATS_NAME_MAX - 1 && _current.command[len] != '\0' &&
+         _current.command[len] != '=' && _current.command[len] != '?')
+  {
+    name[len] = _current.command[len];
+    len++;
+  }
+  name[len] = '\0';
+
+  ATCommandStats *entry = NULL;
+  for (uint8_t i = 0; i < _statsCount; i++)
+  {
+    if (strcmp(_stats[i].name, name) == 0)
+    {
+      entry = &_stats[i];
+      break;
+    }
+  }
+  if (entry == NULL)
+  {
+    if (_statsCount < AT_STATS_SLOTS)
+    {
+      entry = &_stats[_statsCount++];
+      strcpy(entry->name, name);
+    }
+    else
+    {
+      entry = &_stats[AT_STATS_SLOTS - 1]; // table full, fold into the last entry
+      strcpy(entry->name, "(other)");
+    }
+    if (entry->count == 0)
+    {
+      entry->minMs = latencyMs;
+      entry->maxMs = latencyMs;
+    }
+  }
+
+  entry->count++;
+  entry->totalMs += latencyMs;
+  if (latencyMs < entry->minMs)
+    entry->minMs = latencyMs;
+  if (latencyMs > entry->maxMs)
+    entry->maxMs = latencyMs;
+  if (result == AT_TIMEOUT)
+    entry->timeouts++;
+  else if (result != AT_OK)
+    entry->errors++;
+}
+
+void ATEngine::printStats(Print &out) const
+{
+  out.println("AT command      count  err  t/o  min  avg  max (ms)");
+  for (uint8_t i = 0; i < _statsCount; i++)
+  {
+    const ATCommandStats &s = _stats[i];
+    out.printf("%-15s %5u %4u %4u %4u %4u %4u\n", s.name, (unsigned)s.count, (unsigned)s.errors,
+               (unsigned)s.timeouts, (unsigned)s.minMs, (unsigned)(s.totalMs / s.count), (unsigned)s.maxMs);
+  }
+  out.printf("Unclaimed lines: %u\n", (unsigned)_droppedLines);
+}
@@ -0,0 +1,171 @@
+/*
+ * Asynchronous AT command engine for the SIM808.
+ *
+ * Commands are queued from any task and executed one at a time by the task
+ * that calls poll(). Response lines are matched against the final result
+ * codes (OK / ERROR / +CME ERROR / +CMS ERROR), intermediate lines are handed
+ * to the command's line handler and unsolicited result codes (URCs) are
+ * routed to the handlers registered with onURC(). Nothing in poll() blocks.
+ * The SIM808 TCP/IP replies SEND OK, SHUT OK and CLOSE OK count as OK and
+ * SEND FAIL as ERROR.
+ * After a timeout the next command waits AT_TIMEOUT_GUARD, so a late final
+ * result of the old one is read and dropped instead of completing it.
+ */
+
+#ifndef ATEngine_h
+#define ATEngine_h
+
+#include "Arduino.h"
+
+#define AT_QUEUE_LENGTH 8      // Commands waiting to be sent
+#define AT_COMMAND_MAX 64      // Longest command, including the terminator
+#define AT_LINE_MAX 128        // Longest response line kept, longer lines are truncated
+#define AT_MAX_URC_HANDLERS 6  // Registered URC prefixes
+#define AT_STATS_SLOTS 12      // Distinct commands tracked in the latency table
+#define AT_STATS_NAME_MAX 16   // Command name length kept in the latency table
+#define AT_DEFAULT_TIMEOUT 1000
+#define AT_TIMEOUT_GUARD 500   // ms after a timeout before the next command is sent
+
+enum ATResult
+{
+  AT_OK,
+  AT_ERROR,
+  AT_CME_ERROR,
+  AT_CMS_ERROR,
+  AT_TIMEOUT,
+  AT_QUEUE_FULL
+};
+
+// Called for every intermediate response line or URC (without CR/LF)
+typedef void (*ATLineHandler)(const char *line, void *context);
+// Called once when a command completes. finalLine is NULL on timeout.
+typedef void (*ATCompletion)(ATResult result, const char *finalLine, uint32_t latencyMs, void *context);
+
+// Latency statistics of one command name (the text before '=' or '?')
+struct ATCommandStats
+{
+  char name[AT_STATS_NAME_MAX];
+  uint32_t count;
+  uint32_t errors;
+  uint32_t timeouts;
+  uint32_t totalMs;
+  uint32_t minMs;
+  uint32_t maxMs;
+};
+
+class ATEngine
+{
+public:
+  ATEngine(Stream &stream);
+
+  // Create the command queue. Call once before any other method.
+  bool begin();
+
+  /*
+   * Queue a command. Safe to call from any task.
+   * @param command, AT command without the trailing CR/LF
+   * @param timeoutMs, time allowed for the final result code
+   * @param onDone, completion callback, runs on the polling task (may be NULL)
+   * @param context, passed back to both callbacks
+   * @param onLine, receives the intermediate response lines (may be NULL)
+   * @return false if the queue is full
+   */
+  bool send(const char *command, uint32_t timeoutMs, ATCompletion onDone, void *context, ATLineHandler onLine = NULL);
+
+  /*
+   * Queue a command that takes a payload after the modem's "> " prompt,
+   * e.g. AT+CIPSEND=<length>. The payload is not copied: it must stay
+   * unchanged until onDone runs.
+   */
+  bool sendData(const char *command, const uint8_t *data, uint16_t length, uint32_t timeoutMs, ATCompletion onDone,
+                void *context);
+
+  /*
+   * Queue a command that answers with a single line and no result code,
+   * e.g. AT+CIFSR. The first reply line completes it as AT_OK and is passed
+   * to onDone as finalLine.
+   */
+  bool sendForLine(const char *command, uint32_t timeoutMs, ATCompletion onDone, void *context);
+
+  /*
+   * Queue a command and block the calling task until it completes.
+   * Meant for bring-up code running in its own task. When called from the
+   * polling task it drives poll() itself instead of deadlocking.
+   */
+  ATResult sendAndWait(const char *command, uint32_t timeoutMs, ATLineHandler onLine = NULL, void *context = NULL);
+
+  // Route lines starting with prefix to handler whenever they arrive
+  bool onURC(const char *prefix, ATLineHandler handler, void *context);
+
+  // Read pending bytes, dispatch lines, expire and start commands
+  void poll();
+
+  // True when no command is in flight
+  bool isIdle() const { return !_busy; }
+
+  // While held, queued commands wait and nothing is written to the modem,
+  // e.g. while it sleeps with DTR high. Lines that arrive are still read.
+  void hold(bool on) { _held = on; }
+
+  // Commands waiting to be sent
+  uint32_t queued() const { return _queue == NULL ? 0 : uxQueueMessagesWaiting(_queue); }
+
+  const ATCommandStats *stats() const { return _stats; }
+  uint8_t statsCount() const { return _statsCount; }
+  uint32_t droppedLines() const { return _droppedLines; }
+  void printStats(Print &out) const;
+
+private:
+  struct Request
+  {
+    char command[AT_COMMAND_MAX];
+    uint32_t timeoutMs;
+    ATCompletion onDone;
+    ATLineHandler onLine;
+    void *context;
+    const uint8_t *data;  // payload sent at the prompt, NULL for none
+    uint16_t dataLength;
+    bool lineIsFinal;     // the first reply line completes the command
+  };
+
+  struct URCHandler
+  {
+    const char *prefix;
+    uint8_t prefixLen;
+    ATLineHandler handler;
+    void *context;
+  };
+
+  bool _enqueue(const char *command, uint32_t timeoutMs, ATCompletion onDone, void *context, ATLineHandler onLine,
+                const uint8_t *data, uint16_t dataLength, bool lineIsFinal);
+  void _start();
+  void _handleLine();
+  void _finish(ATResult result, const char *finalLine);
+  bool _dispatchURC(const char *line);
+  void _record(ATResult result, uint32_t latencyMs);
+
+  Stream &_stream;
+  QueueHandle_t _queue;
+  TaskHandle_t _pollTask;
+
+  Request _current;
+  bool _busy;
+  bool _dataSent;             // the payload of the current command went out
+  bool _skipSpace;            // drop the space that follows the prompt
+  volatile bool _held;
+  unsigned long _sentAt;
+  bool _guarding;             // a command timed out, the next one waits
+  unsigned long _timedOutAt;
+
+  char _line[AT_LINE_MAX];
+  uint8_t _lineLen;
+
+  URCHandler _urc[AT_MAX_URC_HANDLERS];
+  uint8_t _urcCount;
+
+  ATCommandStats _stats[AT_STATS_SLOTS];
+  uint8_t _statsCount;
+  uint32_t _droppedLines;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "BatteryMonitor.h"
+
+BatteryMonitor::BatteryMonitor(Pangodream_18650_CL &cell, float dividerRatio) : _cell(cell)
+{
+  _dividerRatio = dividerRatio;
+  memset(&_adcChars, 0, sizeof(_adcChars));
+  _taskHandle = NULL;
+  _emaScaled = 0;
+  memset(_trend, 0, sizeof(_trend));
+  _trendCount = 0;
+  _trendNext = 0;
+  _trendAt = 0;
+  _samples = 0;
+  memset(&_published, 0, sizeof(_published));
+}
+
+bool BatteryMonitor::begin(UBaseType_t priority, BaseType_t core)
+{
+  if (_taskHandle != NULL)
+  {
+    return true;
+  }
+  analogReadResolution(12);
+  analogSetPinAttenuation(_cell.getAnalogPin(), ADC_11db);
+  esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                                        BATTERY_DEFAULT_VREF, &_adcChars);
+  Serial.printf("Battery ADC calibration: %s\n",
+                source == ESP_ADC_CAL_VAL_EFUSE_TP ? "two point" : source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref" : "default Vref");
+
+  sample(); // publish a first value before anyone asks
+  return xTaskCreatePinnedToCore(_task, "BatterySampler", BATTERY_TASK_STACK, this, priority, &_taskHandle, core) == pdPASS;
+}
+
+void BatteryMonitor::_task(void *monitor)
+{
+  BatteryMonitor *self = (BatteryMonitor *)monitor;
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
+  {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(BATTERY_SAMPLE_INTERVAL));
+    self->sample();
+  }
+}
+
+/**
+ * Median of a short burst of calibrated reads, in millivolts at the
+ * battery.
+ */
+uint16_t BatteryMonitor::_readMillivolts()
+{
+  uint32_t reads[BATTERY_BURST];
+  for (uint8_t i = 0; i < BATTERY_BURST; i++)
+  {
+    uint32_t value = esp_adc_cal_raw_to_voltage(analogRead(_cell.getAnalogPin()), &_adcChars);
+    // Insertion sort, the burst is tiny
+    uint8_t j = i;
+    while (j > 0 && reads[j - 1] > value)
+    {
+      reads[j] = reads[j - 1];
+      j--;
+    }
+    reads[j] = value;
+  }
+  return (uint16_t)(reads[BATTERY_BURST / 2] * _dividerRatio + 0.5f);
+}
+
+void BatteryMonitor::sample()
+{
+  uint16_t millivolts = _readMillivolts();
+  unsigned long now = millis();
+
+  if (_samples == 0)
+    _emaScaled = (uint32_t)millivolts << BATTERY_EMA_SHIFT;
+  else
+    _emaScaled += millivolts - (_emaScaled >> BATTERY_EMA_SHIFT);
+  _samples++;
+  uint16_t filtered = (uint16_t)(_emaScaled >> BATTERY_EMA_SHIFT);
+
+  // One point per minute; the slope runs from the oldest kept point
+  if (_trendCount == 0 || now - _trendAt >= BATTERY_TREND_INTERVAL)
+  {
+    _trend[_trendNext] = filtered;
+    _trendNext = (_trendNext + 1) % BATTERY_TREND_SLOTS;
+    if (_trendCount < BATTERY_TREND_SLOTS)
+      _trendCount++;
+    _trendAt = now;
+  }
+  int16_t trend = 0;
+  if (_trendCount > 1)
+  {
+    uint8_t oldest = (_trendNext + BATTERY_TREND_SLOTS - _trendCount) % BATTERY_TREND_SLOTS;
+    uint8_t newest = (_trendNext + BATTERY_TREND_SLOTS - 1) % BATTERY_TREND_SLOTS;
+    int32_t minutes = (_trendCount - 1) * (BATTERY_TREND_INTERVAL / 60000);
+    trend = (int16_t)(((int32_t)_trend[newest] - _trend[oldest]) * 60 / minutes);
+  }
+
+  BatterySnapshot next;
+  next.millivolts = filtered;
+  next.percent = (uint8_t)(_cell.getChargeTenthsForMillivolts(filtered) / 10);
+  next.trendMvPerHour = trend;
+  next.sampledAt = now;
+  next.samples = _samples;
+  _publish(next);
+}
+
+// Single writer: the sampler task (or begin() before the task exists)
+void BatteryMonitor::_publish(const BatterySnapshot &next)
+{
+  // A critical section, not a retry loop: a reader that preempted the
+  // sampler on the same core could otherwise spin on a half-done write
+  portENTER_CRITICAL(&_lock);
+  _published = next;
+  portEXIT_CRITICAL(&_lock);
+}
+
+BatterySnapshot BatteryMonitor::snapshot() const
+{
+  portENTER_CRITICAL(&_lock);
+  BatterySnapshot copy = _published;
+  portEXIT_CRITICAL(&_lock);
+  return copy;
+}
@@ -0,0 +1,81 @@
+/*
+ * Background battery sampler.
+ *
+ * A low-priority task reads the battery ADC on a fixed cadence, converts
+ * the reading with the eFuse calibration (esp_adc_cal), takes the median
+ * of a short burst to drop ADC spikes and smooths it with an EMA. The
+ * result is published as one snapshot under a spinlock held only for the
+ * copy, so any task on either core reads volts, percent and trend in O(1)
+ * without touching the ADC, never waits on the sampler's progress and
+ * never sees volts and percent from two different samples.
+ */
+
+#ifndef BatteryMonitor_h
+#define BatteryMonitor_h
+
+#include "Arduino.h"
+#include <esp_adc_cal.h>
+#include "Pangodream_18650_CL.h"
+
+#define BATTERY_SAMPLE_INTERVAL 1000 // ms between bursts
+#define BATTERY_BURST 5              // ADC reads per burst, median taken (odd)
+#define BATTERY_EMA_SHIFT 3          // EMA weight of a new burst is 1/8
+#define BATTERY_TREND_SLOTS 10       // one EMA value per minute for the trend
+#define BATTERY_TREND_INTERVAL 60000
+#define BATTERY_DEFAULT_VREF 1100    // mV, used when the eFuse has no calibration
+#define BATTERY_TASK_STACK 2048      // bytes
+
+struct BatterySnapshot
+{
+  uint16_t millivolts;     // filtered battery voltage
+  uint8_t percent;         // state of charge from the cell curve
+  int16_t trendMvPerHour;  // voltage slope over the last minutes, negative while discharging
+  uint32_t sampledAt;      // millis() of the last burst, 0 before the first one
+  uint32_t samples;        // bursts taken
+};
+
+class BatteryMonitor
+{
+public:
+  /*
+   * @param cell, supplies the ADC pin and the voltage to charge curve
+   * @param dividerRatio, battery voltage / ADC pin voltage
+   */
+  BatteryMonitor(Pangodream_18650_CL &cell, float dividerRatio);
+
+  // Calibrate the ADC and start the sampler task
+  bool begin(UBaseType_t priority = 1, BaseType_t core = 1);
+
+  // Latest published state, safe from any task
+  BatterySnapshot snapshot() const;
+
+  // Take one burst now; the task does this on its own
+  void sample();
+
+  // Sampler task, NULL before begin()
+  TaskHandle_t taskHandle() const { return _taskHandle; }
+
+private:
+  static void _task(void *monitor);
+  uint16_t _readMillivolts();
+  void _publish(const BatterySnapshot &next);
+
+  Pangodream_18650_CL &_cell;
+  float _dividerRatio;
+  esp_adc_cal_characteristics_t _adcChars;
+  TaskHandle_t _taskHandle;
+
+  // Sampler task state
+  uint32_t _emaScaled;  // millivolts << BATTERY_EMA_SHIFT
+  uint16_t _trend[BATTERY_TREND_SLOTS];
+  uint8_t _trendCount;
+  uint8_t _trendNext;
+  unsigned long _trendAt;
+  uint32_t _samples;
+
+  // Published snapshot, copied in and out under _lock
+  mutable portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+  BatterySnapshot _published;
+};
+
+#endif
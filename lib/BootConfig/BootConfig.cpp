@@ -0,0 +1,71 @@
+#include "BootConfig.h"
+
+BootConfig::BootConfig()
+{
+  _open = false;
+  _mode = BOOT_MODE_NONE;
+  _displayAddress = 0;
+  _modemBaud = 0;
+}
+
+bool BootConfig::begin()
+{
+  if (!_open)
+  {
+    _open = _prefs.begin(BOOT_NVS_NAMESPACE, false);
+  }
+  if (!_open)
+  {
+    Serial.println("Boot settings: NVS could not be opened.");
+    return false;
+  }
+  _mode = _prefs.getUChar("mode", BOOT_MODE_NONE);
+  if (_mode > BOOT_MODE_TRACK)
+  {
+    _mode = BOOT_MODE_NONE; // written by another firmware, ask again
+  }
+  _displayAddress = _prefs.getUChar("oled", 0);
+  _modemBaud = _prefs.getUInt("baud", 0);
+  return true;
+}
+
+void BootConfig::saveMode(BootMode mode)
+{
+  if (!_open || _mode == mode)
+  {
+    return;
+  }
+  _mode = mode;
+  _prefs.putUChar("mode", _mode);
+}
+
+void BootConfig::saveDisplayAddress(uint8_t address)
+{
+  if (!_open || _displayAddress == address)
+  {
+    return;
+  }
+  _displayAddress = address;
+  _prefs.putUChar("oled", _displayAddress);
+}
+
+void BootConfig::saveModemBaud(uint32_t baud)
+{
+  if (!_open || _modemBaud == baud)
+  {
+    return;
+  }
+  _modemBaud = baud;
+  _prefs.putUInt("baud", _modemBaud);
+}
+
+void BootConfig::clear()
+{
+  _mode = BOOT_MODE_NONE;
+  _displayAddress = 0;
+  _modemBaud = 0;
+  if (_open)
+  {
+    _prefs.clear();
+  }
+}
@@ -0,0 +1,62 @@
+/*
+ * Boot settings kept in NVS across power cycles.
+ *
+ * A normal boot stores the operating mode confirmed on the selection
+ * screen and the I2C address the display answered on. The next power-on
+ * reads them back and can take the fast path: no I2C scan, no splash or
+ * test screens and no mode question. The modem UART rate negotiated by
+ * ModemLink is kept too, so the link comes up at the first probe. Values
+ * are only written when they change, so NVS sees a write per mode or rate
+ * change, not per boot.
+ */
+
+#ifndef BootConfig_h
+#define BootConfig_h
+
+#include "Arduino.h"
+#include <Preferences.h>
+
+#define BOOT_NVS_NAMESPACE "boot"
+
+enum BootMode
+{
+  BOOT_MODE_NONE = 0, // never selected
+  BOOT_MODE_REGISTER = 1,
+  BOOT_MODE_TRACK = 2
+};
+
+class BootConfig
+{
+public:
+  BootConfig();
+
+  // Load the stored values, false when NVS can not be opened
+  bool begin();
+
+  BootMode mode() const { return (BootMode)_mode; }
+
+  // -1 until a display has been found once
+  int displayAddress() const { return _displayAddress == 0 ? -1 : _displayAddress; }
+
+  // Both the mode and the display address are known
+  bool canFastBoot() const { return _mode != BOOT_MODE_NONE && _displayAddress != 0; }
+
+  // 0 until a modem rate has been negotiated once
+  uint32_t modemBaud() const { return _modemBaud; }
+
+  void saveMode(BootMode mode);
+  void saveDisplayAddress(uint8_t address);
+  void saveModemBaud(uint32_t baud);
+
+  // Forget everything, the next boot asks again
+  void clear();
+
+private:
+  Preferences _prefs;
+  bool _open;
+  uint8_t _mode;
+  uint8_t _displayAddress;
+  uint32_t _modemBaud;
+};
+
+#endif
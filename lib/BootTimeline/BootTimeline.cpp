@@ -0,0 +1,53 @@
+#include "BootTimeline.h"
+
+BootTimeline::BootTimeline()
+{
+  memset(_marks, 0, sizeof(_marks));
+  _count = 0;
+}
+
+void BootTimeline::mark(const char *phase)
+{
+  uint32_t now = millis();
+  uint8_t slot = __sync_fetch_and_add(&_count, 1);
+  if (slot >= BOOT_TIMELINE_MARKS)
+  {
+    _count = BOOT_TIMELINE_MARKS; // keep the counter from wrapping
+    return;
+  }
+  _marks[slot].at = now;
+  __sync_synchronize();
+  _marks[slot].phase = phase; // readers skip the slot until this is set
+}
+
+uint32_t BootTimeline::at(const char *phase) const
+{
+  for (uint8_t i = 0; i < BOOT_TIMELINE_MARKS; i++)
+  {
+    if (_marks[i].phase != NULL && strcmp(_marks[i].phase, phase) == 0)
+    {
+      return _marks[i].at;
+    }
+  }
+  return 0;
+}
+
+void BootTimeline::print(Print &out) const
+{
+  out.printf("Boot timeline (ms since power-on):\n");
+  uint32_t previous = 0;
+  for (uint8_t i = 0; i < BOOT_TIMELINE_MARKS; i++)
+  {
+    if (_marks[i].phase == NULL)
+    {
+      continue;
+    }
+    // Tasks can mark a little out of order, never print a negative step
+    uint32_t step = _marks[i].at > previous ? _marks[i].at - previous : 0;
+    out.printf("  %6u  +%5u  %s\n", (unsigned)_marks[i].at, (unsigned)step, _marks[i].phase);
+    if (_marks[i].at > previous)
+    {
+      previous = _marks[i].at;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+/*
+ * Boot phase timestamps.
+ *
+ * Any task calls mark() when a phase of the start-up is done; the time is
+ * millis() since power-on. print() lists the phases with the time each
+ * one added, which makes it easy to see where the seconds between
+ * power-on and the first GPS fix go. Slots are claimed with an atomic
+ * increment, so marking never blocks and needs no lock.
+ */
+
+#ifndef BootTimeline_h
+#define BootTimeline_h
+
+#include "Arduino.h"
+
+#define BOOT_TIMELINE_MARKS 16
+
+class BootTimeline
+{
+public:
+  BootTimeline();
+
+  // Record that a phase finished now, phase must be a string literal
+  void mark(const char *phase);
+
+  // millis() at the first mark of phase, 0 when it has not happened
+  uint32_t at(const char *phase) const;
+
+  void print(Print &out) const;
+
+private:
+  struct Mark
+  {
+    const char *phase;
+    uint32_t at;
+  };
+
+  Mark _marks[BOOT_TIMELINE_MARKS];
+  volatile uint8_t _count; // slots claimed, may run past BOOT_TIMELINE_MARKS
+};
+
+#endif
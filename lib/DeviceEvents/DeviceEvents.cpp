@@ -0,0 +1,106 @@
+#include "DeviceEvents.h"
+
+DeviceEventQueue::DeviceEventQueue()
+{
+  _queue = NULL;
+  _dropped = 0;
+}
+
+bool DeviceEventQueue::begin()
+{
+  if (_queue == NULL)
+  {
+    _queue = xQueueCreate(DEVICE_QUEUE_LENGTH, sizeof(DeviceEvent));
+  }
+  return _queue != NULL;
+}
+
+bool IRAM_ATTR DeviceEventQueue::postFromISR(DeviceEventType type)
+{
+  DeviceEvent event;
+  event.type = type;
+  event.at = millis();
+  BaseType_t woken = pdFALSE;
+  if (_queue == NULL || xQueueSendFromISR(_queue, &event, &woken) != pdTRUE)
+  {
+    _dropped++;
+    return false;
+  }
+  if (woken)
+  {
+    portYIELD_FROM_ISR();
+  }
+  return true;
+}
+
+bool DeviceEventQueue::post(DeviceEventType type)
+{
+  DeviceEvent event;
+  event.type = type;
+  event.at = millis();
+  if (_queue == NULL || xQueueSend(_queue, &event, 0) != pdTRUE)
+  {
+    _dropped++;
+    return false;
+  }
+  return true;
+}
+
+bool DeviceEventQueue::receive(DeviceEvent &event, TickType_t ticks)
+{
+  return _queue != NULL && xQueueReceive(_queue, &event, ticks) == pdTRUE;
+}
+
+SubsystemStatus::SubsystemStatus()
+{
+  _group = NULL;
+}
+
+bool SubsystemStatus::begin()
+{
+  if (_group == NULL)
+  {
+    _group = xEventGroupCreate();
+  }
+  return _group != NULL;
+}
+
+void SubsystemStatus::setReady(EventBits_t subsystems)
+{
+  xEventGroupSetBits(_group, subsystems & SUBSYSTEM_ALL);
+}
+
+void SubsystemStatus::setFailed(EventBits_t subsystems)
+{
+  xEventGroupSetBits(_group, (subsystems & SUBSYSTEM_ALL) << SUBSYSTEM_FAILED_SHIFT);
+}
+
+EventBits_t SubsystemStatus::waitFor(EventBits_t subsystems, TickType_t ticks)
+{
+  EventBits_t pending = subsystems & SUBSYSTEM_ALL;
+  TickType_t start = xTaskGetTickCount();
+  EventBits_t bits = xEventGroupGetBits(_group);
+  // Ready and failed are different bits, wake on either and check whether all are settled
+  while ((((bits | (bits >> SUBSYSTEM_FAILED_SHIFT)) & pending) != pending))
+  {
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (ticks != portMAX_DELAY && waited >= ticks)
+    {
+      break;
+    }
+    EventBits_t unsettled = pending & ~(bits | (bits >> SUBSYSTEM_FAILED_SHIFT));
+    bits = xEventGroupWaitBits(_group, unsettled | (unsettled << SUBSYSTEM_FAILED_SHIFT), pdFALSE, pdFALSE,
+                               ticks == portMAX_DELAY ? portMAX_DELAY : ticks - waited);
+  }
+  return bits & pending;
+}
+
+bool SubsystemStatus::isReady(EventBits_t subsystems) const
+{
+  return _group != NULL && (xEventGroupGetBits(_group) & subsystems) == subsystems;
+}
+
+EventBits_t SubsystemStatus::failed() const
+{
+  return _group == NULL ? 0 : (xEventGroupGetBits(_group) >> SUBSYSTEM_FAILED_SHIFT) & SUBSYSTEM_ALL;
+}
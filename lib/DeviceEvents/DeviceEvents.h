@@ -0,0 +1,74 @@
+/*
+ * FreeRTOS side of the device state machine.
+ *
+ * DeviceEventQueue carries timestamped DeviceEvents from the button ISRs
+ * and the init tasks to the one task that runs the DeviceStateMachine;
+ * the ISRs only stamp and queue, all decisions (debounce included) are
+ * made by the machine. SubsystemStatus keeps one ready and one failed bit
+ * per subsystem in an event group, so a task that needs the modem blocks
+ * until it is up instead of polling a flag, and a failure names the
+ * subsystem that failed.
+ */
+
+#ifndef DeviceEvents_h
+#define DeviceEvents_h
+
+#include "Arduino.h"
+#include "DeviceState.h"
+
+#define DEVICE_QUEUE_LENGTH 8
+
+#define SUBSYSTEM_MODEM (1 << 0)
+#define SUBSYSTEM_GPS (1 << 1)
+#define SUBSYSTEM_GPRS (1 << 2)
+#define SUBSYSTEM_RFID (1 << 3)
+#define SUBSYSTEM_ALL 0xFF
+#define SUBSYSTEM_FAILED_SHIFT 8 // failed bit of a subsystem is its ready bit shifted up
+
+class DeviceEventQueue
+{
+public:
+  DeviceEventQueue();
+
+  bool begin();
+
+  // From an ISR, stamped with millis()
+  bool postFromISR(DeviceEventType type);
+
+  // From a task, never blocks
+  bool post(DeviceEventType type);
+
+  // Wait up to ticks for the next event, state machine task only
+  bool receive(DeviceEvent &event, TickType_t ticks);
+
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  QueueHandle_t _queue;
+  volatile uint32_t _dropped;
+};
+
+class SubsystemStatus
+{
+public:
+  SubsystemStatus();
+
+  bool begin();
+
+  void setReady(EventBits_t subsystems);
+  void setFailed(EventBits_t subsystems);
+
+  /*
+   * Block until each of the subsystems is ready or failed.
+   * @return the subsystems that are ready, the rest failed or timed out
+   */
+  EventBits_t waitFor(EventBits_t subsystems, TickType_t ticks = portMAX_DELAY);
+
+  bool isReady(EventBits_t subsystems) const;
+  EventBits_t failed() const;
+
+private:
+  EventGroupHandle_t _group;
+};
+
+#endif
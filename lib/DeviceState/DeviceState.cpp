@@ -0,0 +1,94 @@
+#include "DeviceState.h"
+
+const DeviceTransition DeviceStateMachine::TABLE[] = {
+    {DEVICE_BOOT, EVENT_BOOT_SCREENS_DONE, DEVICE_WELCOME, ACTION_NONE},
+    {DEVICE_BOOT, EVENT_FAST_BOOT, DEVICE_INITIALIZING, ACTION_START_INIT},
+    {DEVICE_WELCOME, EVENT_START_BUTTON, DEVICE_SELECT_MODE, ACTION_SHOW_MODES},
+    {DEVICE_SELECT_MODE, EVENT_MODE_BUTTON, DEVICE_SELECT_MODE, ACTION_TOGGLE_MODE},
+    {DEVICE_SELECT_MODE, EVENT_START_BUTTON, DEVICE_INITIALIZING, ACTION_START_INIT},
+    {DEVICE_INITIALIZING, EVENT_INIT_DONE, DEVICE_RUNNING, ACTION_NONE},
+    {DEVICE_INITIALIZING, EVENT_INIT_FAILED, DEVICE_FAILED, ACTION_NONE},
+};
+
+const size_t DeviceStateMachine::TABLE_SIZE = sizeof(TABLE) / sizeof(TABLE[0]);
+
+DeviceStateMachine::DeviceStateMachine()
+{
+  _state = DEVICE_BOOT;
+  _mode = MODE_REGISTER;
+  _lastButtonAt = 0;
+  _buttonSeen = false;
+  _bounces = 0;
+  _ignored = 0;
+}
+
+DeviceAction DeviceStateMachine::handle(const DeviceEvent &event)
+{
+  // Both buttons share one debounce window, like the contacts share one board
+  if (event.type == EVENT_START_BUTTON || event.type == EVENT_MODE_BUTTON)
+  {
+    if (_buttonSeen && event.at - _lastButtonAt <= DEVICE_DEBOUNCE_MS)
+    {
+      _bounces++;
+      return ACTION_NONE;
+    }
+    _buttonSeen = true;
+    _lastButtonAt = event.at;
+  }
+
+  for (size_t i = 0; i < TABLE_SIZE; i++)
+  {
+    const DeviceTransition &row = TABLE[i];
+    if (row.from == _state && row.event == event.type)
+    {
+      _state = row.to;
+      if (row.action == ACTION_TOGGLE_MODE)
+      {
+        _mode = _mode == MODE_REGISTER ? MODE_TRACK : MODE_REGISTER;
+      }
+      return row.action;
+    }
+  }
+  _ignored++;
+  return ACTION_NONE;
+}
+
+const char *DeviceStateMachine::stateName(DeviceStateId state)
+{
+  switch (state)
+  {
+  case DEVICE_BOOT:
+    return "boot";
+  case DEVICE_WELCOME:
+    return "welcome";
+  case DEVICE_SELECT_MODE:
+    return "select mode";
+  case DEVICE_INITIALIZING:
+    return "initializing";
+  case DEVICE_RUNNING:
+    return "running";
+  case DEVICE_FAILED:
+    return "failed";
+  }
+  return "?";
+}
+
+const char *DeviceStateMachine::eventName(DeviceEventType type)
+{
+  switch (type)
+  {
+  case EVENT_START_BUTTON:
+    return "START";
+  case EVENT_MODE_BUTTON:
+    return "MODE";
+  case EVENT_BOOT_SCREENS_DONE:
+    return "boot screens done";
+  case EVENT_FAST_BOOT:
+    return "fast boot";
+  case EVENT_INIT_DONE:
+    return "init done";
+  case EVENT_INIT_FAILED:
+    return "init failed";
+  }
+  return "?";
+}
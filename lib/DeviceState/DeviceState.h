@@ -0,0 +1,105 @@
+/*
+ * Device state machine.
+ *
+ * The boot and mode selection flow as one table of (state, event) ->
+ * (next state, action) rows. Button presses and init results arrive as
+ * timestamped DeviceEvents; handle() looks the pair up, moves to the next
+ * state and tells the caller what to do. Pairs that are not in the table
+ * are ignored, so a button pressed while the device runs does nothing.
+ *
+ * This file only depends on the C headers, so the table can be compiled
+ * and exercised on the host. The FreeRTOS side (the ISR queue and the
+ * readiness bits) is in DeviceEvents.
+ */
+
+#ifndef DeviceState_h
+#define DeviceState_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DEVICE_DEBOUNCE_MS 250 // button events closer than this to the last one are bounces
+
+enum DeviceStateId
+{
+  DEVICE_BOOT,         // splash screens, buttons not armed yet
+  DEVICE_WELCOME,      // waiting for START
+  DEVICE_SELECT_MODE,  // MODE toggles the option, START confirms
+  DEVICE_INITIALIZING, // init task bringing the subsystems up
+  DEVICE_RUNNING,
+  DEVICE_FAILED        // a subsystem the mode needs did not come up
+};
+
+enum DeviceEventType
+{
+  EVENT_START_BUTTON,
+  EVENT_MODE_BUTTON,
+  EVENT_BOOT_SCREENS_DONE,
+  EVENT_FAST_BOOT, // mode known from the last boot
+  EVENT_INIT_DONE,
+  EVENT_INIT_FAILED
+};
+
+enum DeviceAction
+{
+  ACTION_NONE,
+  ACTION_SHOW_MODES,  // draw the mode selection screen
+  ACTION_TOGGLE_MODE, // selection changed, redraw it
+  ACTION_START_INIT   // mode confirmed, start its init task
+};
+
+enum DeviceMode
+{
+  MODE_REGISTER,
+  MODE_TRACK
+};
+
+struct DeviceEvent
+{
+  DeviceEventType type;
+  uint32_t at; // millis() when it happened
+};
+
+struct DeviceTransition
+{
+  DeviceStateId from;
+  DeviceEventType event;
+  DeviceStateId to;
+  DeviceAction action;
+};
+
+class DeviceStateMachine
+{
+public:
+  DeviceStateMachine();
+
+  // Run one event through the table
+  DeviceAction handle(const DeviceEvent &event);
+
+  DeviceStateId state() const { return _state; }
+
+  // Selected mode, fixed once the machine leaves DEVICE_SELECT_MODE
+  DeviceMode mode() const { return _mode; }
+
+  // Preselect the mode, before EVENT_FAST_BOOT or to restore the last choice
+  void selectMode(DeviceMode mode) { _mode = mode; }
+
+  uint32_t bounces() const { return _bounces; }
+  uint32_t ignored() const { return _ignored; }
+
+  static const char *stateName(DeviceStateId state);
+  static const char *eventName(DeviceEventType type);
+
+  static const DeviceTransition TABLE[];
+  static const size_t TABLE_SIZE;
+
+private:
+  DeviceStateId _state;
+  DeviceMode _mode;
+  uint32_t _lastButtonAt;
+  bool _buttonSeen;
+  uint32_t _bounces; // button events dropped by the debounce
+  uint32_t _ignored; // events with no row for the current state
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "DischargeEstimator.h"
+
+DischargeEstimator::DischargeEstimator(const Pangodream_18650_CL &cell) : _cell(cell)
+{
+  memset(_samples, 0, sizeof(_samples));
+  reset();
+}
+
+void DischargeEstimator::reset()
+{
+  _count = 0;
+  _next = 0;
+  _ratePerHour = 0;
+  _sagMv = 0;
+  _minutes = ESTIMATOR_UNKNOWN;
+}
+
+void DischargeEstimator::add(uint16_t millivolts, uint8_t load, unsigned long now)
+{
+  Sample &slot = _samples[_next];
+  slot.time = now;
+  slot.millivolts = millivolts;
+  slot.load = load;
+  _next = (_next + 1) % ESTIMATOR_SLOTS;
+  if (_count < ESTIMATOR_SLOTS)
+    _count++;
+  _fit();
+}
+
+const DischargeEstimator::Sample &DischargeEstimator::_at(uint8_t i) const
+{
+  return _samples[(_next + ESTIMATOR_SLOTS - _count + i) % ESTIMATOR_SLOTS];
+}
+
+// Hours relative to the newest sample, so floats keep their precision however long the device is up
+float DischargeEstimator::_hours(const Sample &sample) const
+{
+  return -((_at(_count - 1).time - sample.time) / 3600000.0f);
+}
+
+/**
+ * Both fits work on centered sums. With a single load level in the window
+ * the sag cannot be told apart from the level and is left at its last
+ * value.
+ */
+void DischargeEstimator::_fit()
+{
+  if (_count < ESTIMATOR_MIN_SAMPLES)
+  {
+    _minutes = ESTIMATOR_UNKNOWN;
+    return;
+  }
+
+  float mt = 0, ml = 0, mv = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Sample &s = _at(i);
+    mt += _hours(s);
+    ml += s.load;
+    mv += s.millivolts;
+  }
+  mt /= _count;
+  ml /= _count;
+  mv /= _count;
+
+  float stt = 0, stl = 0, sll = 0, stv = 0, slv = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Sample &s = _at(i);
+    float t = _hours(s) - mt;
+    float l = s.load - ml;
+    float v = s.millivolts - mv;
+    stt += t * t;
+    stl += t * l;
+    sll += l * l;
+    stv += t * v;
+    slv += l * v;
+  }
+  float det = stt * sll - stl * stl;
+  if (sll > 0.5f && det > 1e-3f * stt * sll)
+  {
+    float sag = (slv * stt - stv * stl) / det;
+    _sagMv = sag < 0.0f ? sag : 0.0f; // a load never raises the voltage
+  }
+  if (stt <= 0.0f)
+  {
+    _minutes = ESTIMATOR_UNKNOWN;
+    return;
+  }
+
+  // State of charge with the load taken out, against time
+  float my = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Sample &s = _at(i);
+    float rested = s.millivolts - _sagMv * s.load;
+    my += _cell.getChargeTenthsForMillivolts(rested > 65535.0f ? 65535 : (uint16_t)rested);
+  }
+  my /= _count;
+  float sty = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Sample &s = _at(i);
+    float rested = s.millivolts - _sagMv * s.load;
+    sty += (_hours(s) - mt) * (_cell.getChargeTenthsForMillivolts(rested > 65535.0f ? 65535 : (uint16_t)rested) - my);
+  }
+  float rate = sty / stt;
+  _ratePerHour = -rate;
+
+  float level = my - rate * mt; // fitted at the newest sample
+  if (level <= 0.0f)
+  {
+    _minutes = 0;
+    return;
+  }
+  if (_ratePerHour <= 0.0f)
+  {
+    _minutes = ESTIMATOR_UNKNOWN;
+    return;
+  }
+  float minutes = level / _ratePerHour * 60.0f;
+  _minutes = minutes >= ESTIMATOR_UNKNOWN - 1 ? ESTIMATOR_UNKNOWN - 1 : (uint16_t)minutes;
+}
+
+void DischargeEstimator::format(char *out, size_t size) const
+{
+  uint16_t minutes = _minutes;
+  if (minutes == ESTIMATOR_UNKNOWN)
+    snprintf(out, size, "--");
+  else if (minutes >= 6000)
+    snprintf(out, size, "99h+");
+  else if (minutes >= 60)
+    snprintf(out, size, "%uh", (unsigned)(minutes / 60));
+  else
+    snprintf(out, size, "%um", (unsigned)minutes);
+}
+
+void DischargeEstimator::printStats(Print &out) const
+{
+  if (_minutes == ESTIMATOR_UNKNOWN)
+  {
+    out.printf("Battery estimate: learning, %u of %u samples\n", (unsigned)_count, (unsigned)ESTIMATOR_SLOTS);
+    return;
+  }
+  out.printf("Battery estimate: %.1f%%/h, %d mV sag per load, %u h %02u min to empty\n",
+             _ratePerHour / 10.0f, (int)_sagMv, (unsigned)(_minutes / 60), (unsigned)(_minutes % 60));
+}
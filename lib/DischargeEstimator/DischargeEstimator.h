@@ -0,0 +1,75 @@
+/*
+ * Time-to-empty estimator.
+ *
+ * Keeps the last ESTIMATOR_SLOTS battery voltages with the load the
+ * device was under when each was taken. Two least squares fits run over
+ * that window:
+ *   millivolts = a + b * t + sag * load    gives the sag per load
+ *   soc(millivolts - sag * load) = c + rate * t
+ * The first takes out the voltage drop while the GNSS engine runs or the
+ * modem holds a session; the second reads the discharge rate off the
+ * corrected state of charge, which is linear in the charge drawn where
+ * the voltage is not. The level now divided by the rate gives the time to
+ * empty. Memory is the fixed window, nothing grows.
+ */
+
+#ifndef DischargeEstimator_h
+#define DischargeEstimator_h
+
+#include "Arduino.h"
+#include "Pangodream_18650_CL.h"
+
+#define ESTIMATOR_SLOTS 90               // samples in the regression window
+#define ESTIMATOR_SAMPLE_INTERVAL 120000 // ms, so the window spans three hours
+#define ESTIMATOR_MIN_SAMPLES 15         // before an estimate is published
+#define ESTIMATOR_UNKNOWN 0xFFFF         // minutesToEmpty() without an estimate
+
+class DischargeEstimator
+{
+public:
+  // @param cell, supplies the voltage to charge curve
+  DischargeEstimator(const Pangodream_18650_CL &cell);
+
+  /*
+   * Add one sample.
+   * @param millivolts, filtered battery voltage
+   * @param load, number of heavy loads running (GNSS on, modem session open)
+   */
+  void add(uint16_t millivolts, uint8_t load, unsigned long now);
+
+  // Forget the window, e.g. when the charger is connected
+  void reset();
+
+  // Minutes until empty, ESTIMATOR_UNKNOWN while charging or still learning
+  uint16_t minutesToEmpty() const { return _minutes; }
+
+  // Discharge rate in tenths of a percent per hour, positive while discharging
+  float ratePerHour() const { return _ratePerHour; }
+
+  // Short text for the status bar: "37h", "45m" or "--"
+  void format(char *out, size_t size) const;
+
+  void printStats(Print &out) const;
+
+private:
+  struct Sample
+  {
+    unsigned long time;
+    uint16_t millivolts;
+    uint8_t load;
+  };
+
+  const Sample &_at(uint8_t i) const; // oldest first
+  float _hours(const Sample &sample) const;
+  void _fit();
+
+  const Pangodream_18650_CL &_cell;
+  Sample _samples[ESTIMATOR_SLOTS];
+  uint8_t _count;
+  uint8_t _next;
+  float _ratePerHour;
+  float _sagMv;               // voltage change per load, negative
+  volatile uint16_t _minutes; // read by the display task
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include <math.h>
+#include <string.h>
+#include "FixFilter.h"
+#include "GeoMath.h"
+
+void FixFilter::Axis::start(float z, float v, float r, float rv)
+{
+  position = z;
+  velocity = v;
+  p00 = r;
+  p01 = 0.0f;
+  p11 = rv;
+}
+
+// Constant velocity with white acceleration noise of variance q
+void FixFilter::Axis::predict(float dt, float q)
+{
+  float dt2 = dt * dt;
+  position += velocity * dt;
+  p00 += dt * (2.0f * p01 + dt * p11) + q * dt2 * dt2 * 0.25f;
+  p01 += dt * p11 + q * dt2 * dt * 0.5f;
+  p11 += q * dt2;
+}
+
+void FixFilter::Axis::updatePosition(float z, float r)
+{
+  float s = p00 + r;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+  float y = z - position;
+  position += k0 * y;
+  velocity += k1 * y;
+  p11 -= k1 * p01;
+  p01 -= k0 * p01;
+  p00 -= k0 * p00;
+}
+
+void FixFilter::Axis::updateVelocity(float z, float r)
+{
+  float s = p11 + r;
+  float k0 = p01 / s;
+  float k1 = p11 / s;
+  float y = z - velocity;
+  position += k0 * y;
+  velocity += k1 * y;
+  p00 -= k0 * p01;
+  p01 -= k0 * p11;
+  p11 -= k1 * p11;
+}
+
+FixFilter::FixFilter()
+{
+  _initialized = false;
+  _refLatitude = 0;
+  _refLongitude = 0;
+  memset(&_east, 0, sizeof(_east));
+  memset(&_north, 0, sizeof(_north));
+  _lastTime = 0;
+  _rejects = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void FixFilter::_start(const GPSFix &raw, unsigned long now, float r, float rv, float ve, float vn)
+{
+  _refLatitude = raw.latitude;
+  _refLongitude = raw.longitude;
+  _east.start(0.0f, ve, r, rv);
+  _north.start(0.0f, vn, r, rv);
+  _lastTime = now;
+  _rejects = 0;
+  _initialized = true;
+  _stats.restarts++;
+}
+
+FixVerdict FixFilter::update(const GPSFix &raw, unsigned long now, GPSFix &smoothed)
+{
+  smoothed = raw;
+  if (raw.fixStatus != 1)
+  {
+    _stats.noFix++;
+    return FIX_NO_FIX;
+  }
+  // The parsers leave 0 when the receiver sent an empty DOP field, which is no geometry at all
+  if (raw.hdop <= 0 || raw.pdop <= 0 || raw.hdop > FILTER_MAX_HDOP || raw.pdop > FILTER_MAX_PDOP)
+  {
+    _stats.poorGeometry++;
+    return FIX_POOR_GEOMETRY;
+  }
+  if (raw.satellitesUsed < FILTER_MIN_SATELLITES)
+  {
+    _stats.fewSatellites++;
+    return FIX_FEW_SATELLITES;
+  }
+
+  float hdop = raw.hdop < FILTER_MIN_HDOP ? FILTER_MIN_HDOP : raw.hdop;
+  float sigma = hdop * FILTER_UERE;
+  float r = sigma * sigma;
+  float rv = FILTER_SPEED_NOISE * FILTER_SPEED_NOISE;
+  float speed = raw.speed / 3.6f;
+  float course = raw.course * (float)(M_PI / 180.0);
+  float ve = speed * sinf(course);
+  float vn = speed * cosf(course);
+
+  int32_t eastCm, northCm;
+  geoOffsetCm(_refLatitude, _refLongitude, raw.latitude, raw.longitude, &eastCm, &northCm);
+  if (_initialized && (eastCm > FILTER_REFERENCE_RANGE || eastCm < -FILTER_REFERENCE_RANGE ||
+                       northCm > FILTER_REFERENCE_RANGE || northCm < -FILTER_REFERENCE_RANGE))
+  {
+    // Move the local plane under the current estimate to keep the flat
+    // earth error and float rounding small
+    geoMoveCm(_refLatitude, _refLongitude, (int32_t)lroundf(_east.position * 100.0f),
+              (int32_t)lroundf(_north.position * 100.0f), &_refLatitude, &_refLongitude);
+    _east.position = 0.0f;
+    _north.position = 0.0f;
+    geoOffsetCm(_refLatitude, _refLongitude, raw.latitude, raw.longitude, &eastCm, &northCm);
+  }
+
+  if (!_initialized || now - _lastTime >= FILTER_RESET_GAP)
+  {
+    _start(raw, now, r, rv, ve, vn);
+  }
+  else
+  {
+    float dt = (now - _lastTime) * 0.001f;
+    float q = FILTER_ACCEL_NOISE * FILTER_ACCEL_NOISE;
+    Axis east = _east;
+    Axis north = _north;
+    east.predict(dt, q);
+    north.predict(dt, q);
+
+    // Normalized innovation of the position against the prediction
+    float ye = eastCm * 0.01f - east.position;
+    float yn = northCm * 0.01f - north.position;
+    float d2 = ye * ye / (east.p00 + r) + yn * yn / (north.p00 + r);
+    if (d2 > FILTER_GATE)
+    {
+      if (++_rejects < FILTER_MAX_REJECTS)
+      {
+        _stats.outliers++;
+        return FIX_OUTLIER;
+      }
+      _start(raw, now, r, rv, ve, vn); // the receiver kept insisting, follow it
+    }
+    else
+    {
+      east.updatePosition(eastCm * 0.01f, r);
+      north.updatePosition(northCm * 0.01f, r);
+      east.updateVelocity(ve, rv);
+      north.updateVelocity(vn, rv);
+      _east = east;
+      _north = north;
+      _lastTime = now;
+      _rejects = 0;
+    }
+  }
+  _stats.accepted++;
+
+  geoMoveCm(_refLatitude, _refLongitude, (int32_t)lroundf(_east.position * 100.0f),
+            (int32_t)lroundf(_north.position * 100.0f), &smoothed.latitude, &smoothed.longitude);
+  float filteredSpeed = sqrtf(_east.velocity * _east.velocity + _north.velocity * _north.velocity);
+  smoothed.speed = filteredSpeed * 3.6f;
+  if (filteredSpeed >= FILTER_SPEED_NOISE) // below that the heading is noise, keep the receiver's
+  {
+    smoothed.course = geoBearingOfCdeg((int32_t)lroundf(_east.velocity * 100.0f),
+                                       (int32_t)lroundf(_north.velocity * 100.0f)) * 0.01f;
+  }
+  return FIX_ACCEPTED;
+}
+
+void FixFilter::printStats(Print &out) const
+{
+  out.printf("Fix filter: %u accepted, %u outliers, %u poor geometry, %u too few satellites, %u restarts\n",
+             (unsigned)_stats.accepted, (unsigned)_stats.outliers, (unsigned)_stats.poorGeometry,
+             (unsigned)_stats.fewSatellites, (unsigned)_stats.restarts);
+}
+
+const char *FixFilter::verdictName(FixVerdict verdict)
+{
+  switch (verdict)
+  {
+  case FIX_ACCEPTED:
+    return "accepted";
+  case FIX_NO_FIX:
+    return "no fix";
+  case FIX_POOR_GEOMETRY:
+    return "poor satellite geometry";
+  case FIX_FEW_SATELLITES:
+    return "too few satellites";
+  case FIX_OUTLIER:
+    return "outlier";
+  }
+  return "?";
+}
@@ -0,0 +1,99 @@
+/*
+ * Fix quality gate and constant-velocity Kalman smoother.
+ *
+ * A fix first has to pass the geometry checks (DOP limits, satellites
+ * used). It is then run through two independent constant-velocity Kalman
+ * filters, east and north, in meters on a local plane around a reference
+ * point. The GNSS position is fused with an error of HDOP * FILTER_UERE,
+ * and speed/course are fused as a velocity measurement. A position whose
+ * innovation falls outside the chi-square gate is rejected as an outlier
+ * (multipath near buildings and platforms); after FILTER_MAX_REJECTS in a
+ * row the filter trusts the receiver again and restarts from it.
+ *
+ * Single precision throughout, about a hundred float operations per fix.
+ */
+
+#ifndef FixFilter_h
+#define FixFilter_h
+
+#include "Arduino.h"
+#include "GPSFix.h"
+
+#define FILTER_MAX_HDOP 5.0f         // worse horizontal geometry is rejected
+#define FILTER_MAX_PDOP 8.0f
+#define FILTER_MIN_SATELLITES 4      // satellites used in the solution
+#define FILTER_UERE 4.0f             // m of position error per unit of HDOP
+#define FILTER_MIN_HDOP 0.7f         // receivers report optimistic HDOP in open sky
+#define FILTER_SPEED_NOISE 0.5f      // m/s, error of the reported speed
+#define FILTER_ACCEL_NOISE 0.8f      // m/s^2, how fast a train changes velocity
+#define FILTER_GATE 13.8f            // chi-square, 2 degrees of freedom, 99.9%
+#define FILTER_MAX_REJECTS 3         // outliers in a row before restarting
+#define FILTER_RESET_GAP 60000       // ms without a fix before restarting
+#define FILTER_REFERENCE_RANGE 2000000 // cm from the reference before re-centering
+
+enum FixVerdict
+{
+  FIX_ACCEPTED,
+  FIX_NO_FIX,          // receiver reported no fix
+  FIX_POOR_GEOMETRY,   // DOP over the limits
+  FIX_FEW_SATELLITES,
+  FIX_OUTLIER          // position far outside the filter prediction
+};
+
+struct FixFilterStats
+{
+  uint32_t accepted;
+  uint32_t noFix;
+  uint32_t poorGeometry;
+  uint32_t fewSatellites;
+  uint32_t outliers;
+  uint32_t restarts;
+};
+
+class FixFilter
+{
+public:
+  FixFilter();
+
+  /*
+   * Gate and smooth one fix.
+   * @param smoothed, receives the raw fix with position, speed and course
+   *        replaced by the filter estimate when the fix is accepted
+   */
+  FixVerdict update(const GPSFix &raw, unsigned long now, GPSFix &smoothed);
+
+  // Forget the track, the next good fix starts a new one
+  void reset() { _initialized = false; }
+
+  const FixFilterStats &stats() const { return _stats; }
+  void printStats(Print &out) const;
+
+  static const char *verdictName(FixVerdict verdict);
+
+private:
+  // One axis: position (m), velocity (m/s) and their covariance
+  struct Axis
+  {
+    float position;
+    float velocity;
+    float p00, p01, p11;
+
+    void start(float z, float v, float r, float rv);
+    void predict(float dt, float q);
+    void updatePosition(float z, float r);
+    void updateVelocity(float z, float r);
+  };
+
+  void _start(const GPSFix &raw, unsigned long now, float r, float rv, float ve, float vn);
+
+  bool _initialized;
+  int32_t _refLatitude;
+  int32_t _refLongitude;
+  Axis _east;
+  Axis _north;
+  unsigned long _lastTime;
+  uint8_t _rejects;
+  FixFilterStats _stats;
+};
+
+#endif
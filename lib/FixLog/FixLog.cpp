@@ -0,0 +1,376 @@
+#include <math.h>
+#include <string.h>
+#include "FixLog.h"
+
+#define FIXLOG_MAGIC 0x474C5846UL // "FXLG"
+#define FIXLOG_VERSION 1
+
+static_assert(sizeof(StoredFix) == 24, "StoredFix must stay 24 bytes");
+
+/**
+ * CRC-32 (IEEE 802.3) with a 16-entry table, small enough for IRAM-less use.
+ */
+static uint32_t crc32(const void *data, uint32_t length)
+{
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  while (length--)
+  {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+void packFix(const GPSFix &fix, StoredFix &stored)
+{
+  float hdop = fix.hdop * 10.0f + 0.5f;
+  stored.timestamp = fix.timestamp;
+  stored.latitude = fix.latitude;
+  stored.longitude = fix.longitude;
+  stored.altitude = (int16_t)lroundf(fix.altitude);
+  stored.speed = (uint16_t)(fix.speed * 10.0f + 0.5f);
+  stored.course = (uint16_t)(fix.course * 100.0f + 0.5f) % 36000;
+  stored.hdop = hdop > 255.0f ? 255 : (uint8_t)hdop;
+  stored.satellitesUsed = fix.satellitesUsed;
+  stored.satellitesInView = fix.satellitesInView;
+  stored.flags = fix.fixStatus == 1 ? FIXLOG_FLAG_VALID : 0;
+  stored.reserved = 0;
+}
+
+FixLog::FixLog(FlashDevice &flash) : _flash(flash)
+{
+  _sectorSize = 0;
+  _dataSectors = 0;
+  _recordsPerSector = 0;
+  _headSeq = 0;
+  _oldestSeq = 0;
+  _cursor = 0;
+  _cursorSector = 0;
+  _cursorSlot = 0;
+  _batchCount = 0;
+  _sectorsErased = 0;
+  _crcErrors = 0;
+  _dropped = 0;
+}
+
+uint32_t FixLog::_sectorOf(uint32_t generation) const
+{
+  return FIXLOG_CURSOR_SECTORS + generation % _dataSectors;
+}
+
+uint32_t FixLog::_recordOffset(uint32_t seq) const
+{
+  uint32_t generation = seq / _recordsPerSector;
+  uint32_t slot = seq % _recordsPerSector + 1; // slot 0 is the header
+  return _sectorOf(generation) * _sectorSize + slot * FIXLOG_RECORD_SIZE;
+}
+
+bool FixLog::_readHeader(uint32_t sector, uint32_t *generation)
+{
+  SectorHeader header;
+  if (!_flash.read(sector * _sectorSize, &header, sizeof(header)))
+  {
+    return false;
+  }
+  if (header.magic != FIXLOG_MAGIC || header.version != FIXLOG_VERSION ||
+      header.recordSize != FIXLOG_RECORD_SIZE || header.crc != crc32(&header, 12))
+  {
+    return false;
+  }
+  if (_sectorOf(header.generation) != sector)
+  {
+    return false;
+  }
+  *generation = header.generation;
+  return true;
+}
+
+bool FixLog::_slotErased(uint32_t sector, uint32_t slot)
+{
+  uint32_t words[FIXLOG_RECORD_SIZE / 4];
+  _flash.read(sector * _sectorSize + slot * FIXLOG_RECORD_SIZE, words, sizeof(words));
+  for (uint8_t i = 0; i < FIXLOG_RECORD_SIZE / 4; i++)
+  {
+    if (words[i] != 0xFFFFFFFF)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FixLog::begin()
+{
+  _sectorSize = _flash.sectorSize();
+  if (_flash.sectorCount() < FIXLOG_CURSOR_SECTORS + 2 || _sectorSize < 2 * FIXLOG_RECORD_SIZE)
+  {
+    return false;
+  }
+  _dataSectors = _flash.sectorCount() - FIXLOG_CURSOR_SECTORS;
+  _recordsPerSector = _sectorSize / FIXLOG_RECORD_SIZE - 1;
+  _batchCount = 0;
+
+  // Find the newest and oldest sector generations
+  bool found = false;
+  uint32_t newest = 0;
+  uint32_t oldest = 0;
+  for (uint32_t i = 0; i < _dataSectors; i++)
+  {
+    uint32_t generation;
+    if (_readHeader(FIXLOG_CURSOR_SECTORS + i, &generation))
+    {
+      if (!found || generation > newest)
+        newest = generation;
+      if (!found || generation < oldest)
+        oldest = generation;
+      found = true;
+    }
+  }
+
+  if (!found)
+  {
+    _headSeq = 0;
+    _oldestSeq = 0;
+  }
+  else
+  {
+    // Erased slots only ever form the tail of a sector: binary search it
+    uint32_t sector = _sectorOf(newest);
+    uint32_t low = 1;
+    uint32_t high = _recordsPerSector + 1;
+    while (low < high)
+    {
+      uint32_t mid = (low + high) / 2;
+      if (_slotErased(sector, mid))
+        high = mid;
+      else
+        low = mid + 1;
+    }
+    _headSeq = newest * _recordsPerSector + (low - 1);
+    _oldestSeq = oldest * _recordsPerSector;
+  }
+
+  _loadCursor();
+  if (_cursor < _oldestSeq)
+  {
+    _cursor = _oldestSeq;
+  }
+  if (_cursor > _headSeq)
+  {
+    _cursor = _headSeq;
+  }
+  return true;
+}
+
+/**
+ * Finds the newest valid entry of the cursor journal and the slot where the
+ * next one goes.
+ */
+void FixLog::_loadCursor()
+{
+  uint32_t entriesPerSector = _sectorSize / sizeof(CursorEntry);
+  bool found = false;
+  _cursor = 0;
+  _cursorSector = 1;
+  _cursorSlot = entriesPerSector; // forces the first commit to start a fresh sector
+
+  for (uint32_t sector = 0; sector < FIXLOG_CURSOR_SECTORS; sector++)
+  {
+    for (uint32_t slot = 0; slot < entriesPerSector; slot++)
+    {
+      CursorEntry entry;
+      _flash.read(sector * _sectorSize + slot * sizeof(entry), &entry, sizeof(entry));
+      if (entry.seq == 0xFFFFFFFF && entry.check == 0xFFFFFFFF)
+      {
+        break; // rest of the sector is erased
+      }
+      if (entry.check == ~entry.seq && (!found || entry.seq >= _cursor))
+      {
+        found = true;
+        _cursor = entry.seq;
+        _cursorSector = sector;
+        _cursorSlot = slot + 1;
+      }
+    }
+  }
+
+  // An entry torn by a reset after the newest one is neither valid nor
+  // erased, and programming over it would corrupt the next commit
+  while (found && _cursorSlot < entriesPerSector)
+  {
+    CursorEntry entry;
+    _flash.read(_cursorSector * _sectorSize + _cursorSlot * sizeof(entry), &entry, sizeof(entry));
+    if (entry.seq == 0xFFFFFFFF && entry.check == 0xFFFFFFFF)
+    {
+      break;
+    }
+    _cursorSlot++;
+  }
+}
+
+bool FixLog::commitCursor(uint32_t seq)
+{
+  if (seq > headSeq())
+  {
+    seq = headSeq();
+  }
+  uint32_t entriesPerSector = _sectorSize / sizeof(CursorEntry);
+  if (_cursorSlot >= entriesPerSector)
+  {
+    // The newest entry stays in the old sector until the new one is written
+    uint32_t next = (_cursorSector + 1) % FIXLOG_CURSOR_SECTORS;
+    if (!_flash.eraseSector(next))
+    {
+      return false;
+    }
+    _sectorsErased++;
+    _cursorSector = next;
+    _cursorSlot = 0;
+  }
+
+  CursorEntry entry;
+  entry.seq = seq;
+  entry.check = ~seq;
+  bool ok = _flash.write(_cursorSector * _sectorSize + _cursorSlot * sizeof(entry), &entry, sizeof(entry));
+  _cursorSlot++;
+  if (ok)
+  {
+    _cursor = seq;
+  }
+  return ok;
+}
+
+/**
+ * Erases the sector for a new generation and writes its header. The
+ * generation that lived there before is lost.
+ */
+bool FixLog::_openSector(uint32_t generation)
+{
+  uint32_t sector = _sectorOf(generation);
+  if (!_flash.eraseSector(sector))
+  {
+    return false;
+  }
+  _sectorsErased++;
+
+  SectorHeader header;
+  memset(&header, 0xFF, sizeof(header));
+  header.magic = FIXLOG_MAGIC;
+  header.generation = generation;
+  header.recordSize = FIXLOG_RECORD_SIZE;
+  header.version = FIXLOG_VERSION;
+  header.crc = crc32(&header, 12);
+  if (!_flash.write(sector * _sectorSize, &header, sizeof(header)))
+  {
+    return false;
+  }
+
+  if (generation >= _dataSectors)
+  {
+    uint32_t oldest = (generation - _dataSectors + 1) * _recordsPerSector;
+    if (_oldestSeq < oldest)
+    {
+      _oldestSeq = oldest;
+    }
+    if (_cursor < _oldestSeq)
+    {
+      _dropped += _oldestSeq - _cursor;
+      _cursor = _oldestSeq;
+    }
+  }
+  return true;
+}
+
+bool FixLog::append(const StoredFix &fix)
+{
+  if (_dataSectors == 0)
+  {
+    return false;
+  }
+  Record &record = _batch[_batchCount];
+  record.seq = headSeq();
+  record.fix = fix;
+  record.crc = crc32(&record, sizeof(record) - sizeof(record.crc));
+  _batchCount++;
+
+  // A batch never spans two sectors
+  bool sectorFull = (record.seq + 1) % _recordsPerSector == 0;
+  if (_batchCount == FIXLOG_WRITE_BATCH || sectorFull)
+  {
+    return flush();
+  }
+  return true;
+}
+
+bool FixLog::flush()
+{
+  if (_batchCount == 0)
+  {
+    return true;
+  }
+  if (_headSeq % _recordsPerSector == 0 && !_openSector(_headSeq / _recordsPerSector))
+  {
+    return false;
+  }
+  if (!_flash.write(_recordOffset(_headSeq), _batch, _batchCount * FIXLOG_RECORD_SIZE))
+  {
+    return false;
+  }
+  _headSeq += _batchCount;
+  _batchCount = 0;
+  return true;
+}
+
+uint32_t FixLog::read(uint32_t fromSeq, StoredFix *out, uint32_t maxRecords, uint32_t *nextSeq)
+{
+  uint32_t seq = fromSeq < _oldestSeq ? _oldestSeq : fromSeq;
+  uint32_t count = 0;
+
+  // Records already in flash, read in runs that stay inside one sector
+  while (count < maxRecords && seq < _headSeq)
+  {
+    Record chunk[FIXLOG_READ_CHUNK];
+    uint32_t run = _recordsPerSector - seq % _recordsPerSector;
+    if (run > _headSeq - seq)
+      run = _headSeq - seq;
+    if (run > maxRecords - count)
+      run = maxRecords - count;
+    if (run > FIXLOG_READ_CHUNK)
+      run = FIXLOG_READ_CHUNK;
+
+    if (!_flash.read(_recordOffset(seq), chunk, run * FIXLOG_RECORD_SIZE))
+    {
+      break;
+    }
+    for (uint32_t i = 0; i < run; i++)
+    {
+      if (chunk[i].seq == seq + i && chunk[i].crc == crc32(&chunk[i], sizeof(Record) - sizeof(uint32_t)))
+      {
+        out[count++] = chunk[i].fix;
+      }
+      else
+      {
+        _crcErrors++; // torn or corrupted record, skip it
+      }
+    }
+    seq += run;
+  }
+
+  // Records still waiting in the write batch
+  while (count < maxRecords && seq < headSeq() && seq >= _headSeq)
+  {
+    out[count++] = _batch[seq - _headSeq].fix;
+    seq++;
+  }
+
+  if (nextSeq != NULL)
+  {
+    *nextSeq = seq;
+  }
+  return count;
+}
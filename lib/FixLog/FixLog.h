@@ -0,0 +1,149 @@
+/*
+ * Store-and-forward ring log of GPS fixes on raw flash.
+ *
+ * Layout of the flash area:
+ *   sectors 0-1   upload cursor journal (ping-pong, 8-byte entries)
+ *   sectors 2..N  data ring; slot 0 of every sector is a header carrying the
+ *                 sector generation, the other slots hold 32-byte records
+ *
+ * Sector generations only grow, and generation g always lives in data
+ * sector g % dataSectors, so the ring wears every sector evenly and a
+ * record's sequence number is simply g * recordsPerSector + slot - 1.
+ * Every record carries its sequence number and a CRC32; a record torn by a
+ * reset fails its CRC and is skipped. On mount the newest sector is found
+ * from the headers and the write position by a binary search for the first
+ * erased slot.
+ *
+ * Appends are buffered in RAM and programmed FIXLOG_WRITE_BATCH records
+ * at a time. Slot 0 of a sector is its header, so a batch of 256 bytes
+ * starts 32 bytes into a flash page and the driver programs it as two
+ * page writes. When the ring is full the oldest sector is erased, even if
+ * it was not uploaded yet (counted by droppedRecords()).
+ *
+ * Not thread safe: use one FixLog from a single task.
+ */
+
+#ifndef FixLog_h
+#define FixLog_h
+
+#include <stdint.h>
+#include "FlashDevice.h"
+#include "GPSFix.h"
+
+#define FIXLOG_RECORD_SIZE 32
+#define FIXLOG_CURSOR_SECTORS 2
+#define FIXLOG_WRITE_BATCH 8 // records per flash write, 256 bytes over two pages
+#define FIXLOG_READ_CHUNK 8  // records per flash read while draining
+
+#define FIXLOG_FLAG_VALID 0x01 // fix status was 1
+
+// Compact, fixed-point copy of a GPSFix as stored in flash
+struct StoredFix
+{
+  uint32_t timestamp;       // UTC, seconds since 1970-01-01
+  int32_t latitude;         // 1e-7 degrees
+  int32_t longitude;        // 1e-7 degrees
+  int16_t altitude;         // meters
+  uint16_t speed;           // 0.1 km/h
+  uint16_t course;          // 0.01 degrees
+  uint8_t hdop;             // 0.1 units, saturates at 25.5
+  uint8_t satellitesUsed;
+  uint8_t satellitesInView;
+  uint8_t flags;            // FIXLOG_FLAG_*
+  uint16_t reserved;
+};
+
+// Convert a parsed fix to its stored form
+void packFix(const GPSFix &fix, StoredFix &stored);
+
+class FixLog
+{
+public:
+  FixLog(FlashDevice &flash);
+
+  // Recover the write position and upload cursor from flash
+  bool begin();
+
+  // Queue one fix; it reaches flash when the batch fills or flush() runs
+  bool append(const StoredFix &fix);
+
+  // Program the buffered records
+  bool flush();
+
+  /*
+   * Read stored fixes starting at a sequence number.
+   * @param fromSeq, first sequence number wanted (clamped to oldestSeq())
+   * @param out, destination for up to maxRecords fixes
+   * @param nextSeq, receives the sequence number following the last one read
+   * @return number of fixes copied to out
+   */
+  uint32_t read(uint32_t fromSeq, StoredFix *out, uint32_t maxRecords, uint32_t *nextSeq);
+
+  // Next sequence number to upload, survives reboot once committed
+  uint32_t uploadCursor() const { return _cursor; }
+
+  // Persist the upload cursor; everything before seq has been delivered
+  bool commitCursor(uint32_t seq);
+
+  uint32_t headSeq() const { return _headSeq + _batchCount; } // next sequence number to be written
+  uint32_t oldestSeq() const { return _oldestSeq; }           // oldest sequence number still stored
+  uint32_t pending() const { return headSeq() - _cursor; }    // stored but not yet uploaded
+  uint32_t buffered() const { return _batchCount; }           // appended but not yet in flash
+  uint32_t capacity() const { return _dataSectors * _recordsPerSector; }
+
+  uint32_t sectorsErased() const { return _sectorsErased; }
+  uint32_t crcErrors() const { return _crcErrors; }
+  uint32_t droppedRecords() const { return _dropped; }
+
+private:
+  struct Record
+  {
+    uint32_t seq;
+    StoredFix fix;
+    uint32_t crc;
+  };
+
+  struct SectorHeader
+  {
+    uint32_t magic;
+    uint32_t generation;
+    uint16_t recordSize;
+    uint16_t version;
+    uint32_t crc;
+    uint8_t padding[FIXLOG_RECORD_SIZE - 16];
+  };
+
+  struct CursorEntry
+  {
+    uint32_t seq;
+    uint32_t check; // ~seq
+  };
+
+  uint32_t _sectorOf(uint32_t generation) const;
+  uint32_t _recordOffset(uint32_t seq) const;
+  bool _readHeader(uint32_t sector, uint32_t *generation);
+  bool _slotErased(uint32_t sector, uint32_t slot);
+  bool _openSector(uint32_t generation);
+  void _loadCursor();
+
+  FlashDevice &_flash;
+  uint32_t _sectorSize;
+  uint32_t _dataSectors;
+  uint32_t _recordsPerSector;
+
+  uint32_t _headSeq;   // next sequence number to program
+  uint32_t _oldestSeq;
+  uint32_t _cursor;
+
+  uint32_t _cursorSector; // active journal sector (0 or 1)
+  uint32_t _cursorSlot;   // next free journal entry
+
+  Record _batch[FIXLOG_WRITE_BATCH];
+  uint32_t _batchCount;
+
+  uint32_t _sectorsErased;
+  uint32_t _crcErrors;
+  uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Minimal NOR flash interface used by FixLog.
+ *
+ * Writes may only clear bits, so a region has to be erased (all 0xFF)
+ * before it is written. Keeping the log on this interface lets it run on a
+ * RAM-backed implementation on a Linux host.
+ */
+
+#ifndef FlashDevice_h
+#define FlashDevice_h
+
+#include <stdint.h>
+
+class FlashDevice
+{
+public:
+  virtual ~FlashDevice() {}
+
+  virtual uint32_t sectorSize() const = 0;
+  virtual uint32_t sectorCount() const = 0;
+  virtual bool read(uint32_t offset, void *data, uint32_t length) = 0;
+  virtual bool write(uint32_t offset, const void *data, uint32_t length) = 0;
+  virtual bool eraseSector(uint32_t sector) = 0;
+};
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_partition.h>
+
+#define FIXLOG_PARTITION_SUBTYPE ((esp_partition_subtype_t)0x40) // custom data subtype in partitions.csv
+
+// Raw data partition from the partition table
+class PartitionFlash : public FlashDevice
+{
+public:
+  PartitionFlash(const char *label) : _label(label), _partition(NULL) {}
+
+  bool begin()
+  {
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, FIXLOG_PARTITION_SUBTYPE, _label);
+    return _partition != NULL;
+  }
+
+  uint32_t sectorSize() const { return SPI_FLASH_SEC_SIZE; }
+  uint32_t sectorCount() const { return _partition != NULL ? _partition->size / SPI_FLASH_SEC_SIZE : 0; }
+
+  bool read(uint32_t offset, void *data, uint32_t length)
+  {
+    return esp_partition_read(_partition, offset, data, length) == ESP_OK;
+  }
+
+  bool write(uint32_t offset, const void *data, uint32_t length)
+  {
+    return esp_partition_write(_partition, offset, data, length) == ESP_OK;
+  }
+
+  bool eraseSector(uint32_t sector)
+  {
+    return esp_partition_erase_range(_partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+  }
+
+private:
+  const char *_label;
+  const esp_partition_t *_partition;
+};
+#endif
+
+#endif
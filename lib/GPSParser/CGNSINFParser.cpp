@@ -0,0 +1,262 @@
+#include "CGNSINFParser.h"
+
+static const char CGNSINF_PREFIX[] = "+CGNSINF:";
+static const uint8_t CGNSINF_PREFIX_LEN = sizeof(CGNSINF_PREFIX) - 1;
+static const uint8_t MAX_MANTISSA_DIGITS = 9; // keeps the mantissa inside int32_t
+static const uint8_t COORDINATE_DECIMALS = 7;  // GPSFix keeps 1e-7 degree
+static const int32_t COORDINATE_MAX_DEGREES = 180;
+
+static const float POW10[] = {1.0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f};
+static const int32_t POW10_INT[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+CGNSINFParser::CGNSINFParser()
+{
+  _records = 0;
+  _errors = 0;
+  clearGPSFix(_fix);
+  reset();
+}
+
+void CGNSINFParser::reset()
+{
+  _state = LINE_START;
+  _prefixPos = 0;
+  _fieldIndex = 0;
+  _bad = false;
+  _beginField();
+}
+
+void CGNSINFParser::_beginField()
+{
+  _mantissa = 0;
+  _fracDigits = 0;
+  _digits = 0;
+  _negative = false;
+  _seenDot = false;
+}
+
+/**
+ * Stores the number accumulated for the current field into the working fix.
+ * Empty fields leave the default value (zero) in place, and a field that
+ * made the record bad is not converted: its value may be out of range.
+ */
+void CGNSINFParser::_endField()
+{
+  if (_digits == 0 || _bad)
+  {
+    return;
+  }
+
+  int32_t whole = _negative ? -_mantissa : _mantissa;
+  float value = (float)whole / POW10[_fracDigits];
+
+  switch (_fieldIndex)
+  {
+  case CGNSINF_RUN_STATUS:
+    _work.runStatus = (uint8_t)whole;
+    break;
+  case CGNSINF_FIX_STATUS:
+    _work.fixStatus = (uint8_t)whole;
+    break;
+  case CGNSINF_UTC:
+    if (_digits == sizeof(_utc))
+    {
+      uint16_t year = _utc[0] * 1000 + _utc[1] * 100 + _utc[2] * 10 + _utc[3];
+      _work.timestamp = gpsEpochSeconds(year,
+                                        _utc[4] * 10 + _utc[5],
+                                        _utc[6] * 10 + _utc[7],
+                                        _utc[8] * 10 + _utc[9],
+                                        _utc[10] * 10 + _utc[11],
+                                        _utc[12] * 10 + _utc[13]);
+    }
+    break;
+  case CGNSINF_LATITUDE:
+    _work.latitude = whole * POW10_INT[_fracDigits > COORDINATE_DECIMALS ? 0 : COORDINATE_DECIMALS - _fracDigits];
+    break;
+  case CGNSINF_LONGITUDE:
+    _work.longitude = whole * POW10_INT[_fracDigits > COORDINATE_DECIMALS ? 0 : COORDINATE_DECIMALS - _fracDigits];
+    break;
+  case CGNSINF_ALTITUDE:
+    _work.altitude = value;
+    break;
+  case CGNSINF_SPEED:
+    _work.speed = value;
+    break;
+  case CGNSINF_COURSE:
+    _work.course = value;
+    break;
+  case CGNSINF_FIX_MODE:
+    _work.fixMode = (uint8_t)whole;
+    break;
+  case CGNSINF_HDOP:
+    _work.hdop = value;
+    break;
+  case CGNSINF_PDOP:
+    _work.pdop = value;
+    break;
+  case CGNSINF_VDOP:
+    _work.vdop = value;
+    break;
+  case CGNSINF_SATS_IN_VIEW:
+    _work.satellitesInView = (uint8_t)whole;
+    break;
+  case CGNSINF_SATS_USED:
+    _work.satellitesUsed = (uint8_t)whole;
+    break;
+  }
+}
+
+/**
+ * Publishes the working fix if the record was well formed.
+ */
+bool CGNSINFParser::_endRecord()
+{
+  _endField();
+  bool ok = !_bad && _fieldIndex + 1 >= CGNSINF_MIN_FIELDS;
+  if (ok)
+  {
+    _fix = _work;
+    _records++;
+  }
+  else
+  {
+    _errors++;
+  }
+  reset();
+  return ok;
+}
+
+bool CGNSINFParser::feed(char c)
+{
+  if (c == '\r' || c == '\n')
+  {
+    if (_state == FIELDS)
+    {
+      return _endRecord();
+    }
+    reset();
+    return false;
+  }
+
+  switch (_state)
+  {
+  case LINE_START:
+  case MATCH_PREFIX:
+    if (c == CGNSINF_PREFIX[_prefixPos])
+    {
+      _state = MATCH_PREFIX;
+      if (++_prefixPos == CGNSINF_PREFIX_LEN)
+      {
+        clearGPSFix(_work);
+        _state = SKIP_SPACE;
+      }
+    }
+    else
+    {
+      _state = SKIP_LINE;
+    }
+    return false;
+
+  case SKIP_SPACE:
+    if (c == ' ')
+    {
+      return false;
+    }
+    _state = FIELDS;
+    break; // the byte belongs to the first field
+
+  case FIELDS:
+    break;
+
+  case SKIP_LINE:
+    return false;
+  }
+
+  // FIELDS: one byte of a field value
+  if (_bad)
+  {
+    return false;
+  }
+  if (c == ',')
+  {
+    _endField();
+    if (++_fieldIndex >= CGNSINF_MAX_FIELDS)
+    {
+      _bad = true; // also keeps the uint8_t index from wrapping
+    }
+    _beginField();
+  }
+  else if (c >= '0' && c <= '9')
+  {
+    uint8_t d = c - '0';
+    if (_fieldIndex == CGNSINF_UTC)
+    {
+      // yyyyMMddhhmmss.sss - keep the whole-second digits only, _digits counts
+      // them alone so a short date padded with decimals is not taken as complete
+      if (!_seenDot)
+      {
+        if (_digits < sizeof(_utc))
+        {
+          _utc[_digits++] = d;
+        }
+        else
+        {
+          _bad = true; // more digits than a date and time
+        }
+      }
+    }
+    else if (_fieldIndex == CGNSINF_LATITUDE || _fieldIndex == CGNSINF_LONGITUDE)
+    {
+      // Straight to 1e-7 degree: up to 180 whole degrees and 7 decimals
+      // (at most 1.8e9, inside int32_t). The eighth decimal rounds the
+      // seventh, away from zero like the sign; further ones are dropped.
+      if (!_seenDot)
+      {
+        _mantissa = _mantissa * 10 + d;
+        _digits++;
+        if (_mantissa > COORDINATE_MAX_DEGREES)
+        {
+          _bad = true;
+        }
+      }
+      else if (_fracDigits < COORDINATE_DECIMALS)
+      {
+        _mantissa = _mantissa * 10 + d;
+        _digits++;
+        _fracDigits++;
+      }
+      else if (_fracDigits == COORDINATE_DECIMALS)
+      {
+        _mantissa += d >= 5;
+        _fracDigits++;
+      }
+    }
+    else if (_digits < MAX_MANTISSA_DIGITS)
+    {
+      _mantissa = _mantissa * 10 + d;
+      _digits++;
+      if (_seenDot)
+      {
+        _fracDigits++;
+      }
+    }
+    else if (!_seenDot)
+    {
+      _bad = true; // integer part too long to be a real value
+    }
+    // surplus fractional digits are below the resolution we keep
+  }
+  else if (c == '.' && !_seenDot)
+  {
+    _seenDot = true;
+  }
+  else if (c == '-' && _digits == 0 && !_negative)
+  {
+    _negative = true;
+  }
+  else if (c != ' ')
+  {
+    _bad = true;
+  }
+  return false;
+}
@@ -0,0 +1,89 @@
+/*
+ * Streaming parser for SIM808 AT+CGNSINF responses.
+ *
+ * Bytes are fed one at a time straight from the modem UART. Every field is
+ * converted while it streams in, so the parser needs no line buffer, never
+ * touches the heap and keeps the real field position when the modem leaves
+ * a field empty ("1,1,,,").
+ */
+
+#ifndef CGNSINFParser_h
+#define CGNSINFParser_h
+
+#include <stdint.h>
+#include "GPSFix.h"
+
+// Field positions of the +CGNSINF response (SIM808 AT command manual)
+#define CGNSINF_RUN_STATUS 0
+#define CGNSINF_FIX_STATUS 1
+#define CGNSINF_UTC 2
+#define CGNSINF_LATITUDE 3
+#define CGNSINF_LONGITUDE 4
+#define CGNSINF_ALTITUDE 5
+#define CGNSINF_SPEED 6
+#define CGNSINF_COURSE 7
+#define CGNSINF_FIX_MODE 8
+#define CGNSINF_HDOP 10
+#define CGNSINF_PDOP 11
+#define CGNSINF_VDOP 12
+#define CGNSINF_SATS_IN_VIEW 14
+#define CGNSINF_SATS_USED 15
+#define CGNSINF_MIN_FIELDS 16 // Records shorter than this are rejected
+#define CGNSINF_MAX_FIELDS 32 // and longer than this (the SIM808 sends 21)
+
+class CGNSINFParser
+{
+public:
+  CGNSINFParser();
+
+  /*
+   * Feed one byte received from the modem.
+   * @return true when a complete +CGNSINF record has just been parsed into fix()
+   */
+  bool feed(char c);
+
+  // Drop any partially parsed line
+  void reset();
+
+  // Last complete record. Only valid after feed() returned true.
+  const GPSFix &fix() const { return _fix; }
+
+  uint32_t recordCount() const { return _records; } // Records parsed successfully
+  uint32_t errorCount() const { return _errors; }   // Malformed records dropped
+
+private:
+  enum State
+  {
+    LINE_START,   // Waiting for the first byte of a line
+    MATCH_PREFIX, // Inside "+CGNSINF:"
+    SKIP_SPACE,   // Between the colon and the first field
+    FIELDS,       // Parsing comma separated fields
+    SKIP_LINE     // Ignoring the rest of a line we do not care about
+  };
+
+  void _beginField();
+  void _endField();
+  bool _endRecord();
+
+  State _state;
+  uint8_t _prefixPos;
+  uint8_t _fieldIndex;
+  bool _bad;
+
+  // Number being accumulated for the current field
+  int32_t _mantissa;
+  uint8_t _fracDigits;
+  uint8_t _digits;
+  bool _negative;
+  bool _seenDot;
+
+  // UTC field digits (yyyyMMddhhmmss)
+  uint8_t _utc[14];
+
+  GPSFix _work;
+  GPSFix _fix;
+  uint32_t _records;
+  uint32_t _errors;
+};
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * GPS fix record shared by the SIM808 GNSS parsers.
+ */
+
+#ifndef GPSFix_h
+#define GPSFix_h
+
+#include <stdint.h>
+
+// Plain-old-data fix filled in place by the parsers. No constructors or
+// pointers so it can be copied with memcpy and kept in static storage.
+struct GPSFix
+{
+  uint32_t timestamp;       // UTC time of the fix, seconds since 1970-01-01 (0 if unknown)
+  int32_t latitude;         // 1e-7 degrees, negative south
+  int32_t longitude;        // 1e-7 degrees, negative west
+  float altitude;           // meters above MSL
+  float speed;              // speed over ground, km/h
+  float course;             // course over ground, degrees
+  float hdop;               // horizontal dilution of precision
+  float pdop;               // position dilution of precision
+  float vdop;               // vertical dilution of precision
+  uint8_t runStatus;        // 1 when the GNSS engine is running
+  uint8_t fixStatus;        // 1 when the fix is valid
+  uint8_t fixMode;          // 1 = no fix, 2 = 2D, 3 = 3D (0 if not reported)
+  uint8_t satellitesInView; // GNSS satellites in view
+  uint8_t satellitesUsed;   // GNSS satellites used in the solution
+};
+
+// Clear every field of a fix.
+inline void clearGPSFix(GPSFix &fix)
+{
+  fix.timestamp = 0;
+  fix.latitude = fix.longitude = 0;
+  fix.altitude = 0.0f;
+  fix.speed = fix.course = 0.0f;
+  fix.hdop = fix.pdop = fix.vdop = 0.0f;
+  fix.runStatus = fix.fixStatus = fix.fixMode = 0;
+  fix.satellitesInView = fix.satellitesUsed = 0;
+}
+
+// Convert a civil UTC date/time to seconds since 1970-01-01.
+inline uint32_t gpsEpochSeconds(uint16_t year, uint8_t month, uint8_t day,
+                                uint8_t hour, uint8_t minute, uint8_t second)
+{
+  // Days-from-civil with March as the first month of the year
+  int32_t y = (int32_t)year - (month <= 2 ? 1 : 0);
+  int32_t era = y / 400;
+  int32_t yoe = y - era * 400;
+  int32_t mp = (month + 9) % 12;
+  int32_t doy = (153 * mp + 2) / 5 + day - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int32_t days = era * 146097 + doe - 719468;
+  return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+#endif
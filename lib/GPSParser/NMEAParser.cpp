@@ -0,0 +1,386 @@
+#include <string.h>
+#include "NMEAParser.h"
+
+static const uint8_t MAX_MANTISSA_DIGITS = 9; // keeps the mantissa inside int32_t
+static const float KNOTS_TO_KMH = 1.852f;
+
+static const float POW10[] = {1.0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f};
+static const int32_t POW10_INT[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// Field positions, counted after the address field
+#define RMC_TIME 0
+#define RMC_STATUS 1
+#define RMC_LATITUDE 2
+#define RMC_NORTH_SOUTH 3
+#define RMC_LONGITUDE 4
+#define RMC_EAST_WEST 5
+#define RMC_SPEED 6
+#define RMC_COURSE 7
+#define RMC_DATE 8
+#define GGA_QUALITY 5
+#define GGA_SATELLITES 6
+#define GGA_HDOP 7
+#define GGA_ALTITUDE 8
+#define GSA_MODE 1
+#define GSA_PDOP 14
+#define GSA_VDOP 16
+#define GSV_MESSAGE 1
+#define GSV_IN_VIEW 2
+
+static uint8_t hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return 0xFF;
+}
+
+NMEAParser::NMEAParser()
+{
+  _sentences = 0;
+  _checksumErrors = 0;
+  _fixes = 0;
+  _inViewSum = 0;
+  clearGPSFix(_work);
+  clearGPSFix(_fix);
+  reset();
+}
+
+void NMEAParser::reset()
+{
+  _state = WAIT_START;
+  _sentence = OTHER;
+  _addressLen = 0;
+  _fieldIndex = 0;
+  _checksum = 0;
+  _received = 0;
+  _checksumDigits = 0;
+  _bad = false;
+  memset(&_pending, 0, sizeof(_pending));
+  _beginField();
+}
+
+void NMEAParser::_beginField()
+{
+  _mantissa = 0;
+  _fracDigits = 0;
+  _digits = 0;
+  _negative = false;
+  _seenDot = false;
+  _firstChar = 0;
+}
+
+float NMEAParser::_value() const
+{
+  return (float)(_negative ? -_mantissa : _mantissa) / POW10[_fracDigits];
+}
+
+/**
+ * (d)ddmm.mmmm to 1e-7 degrees without going through float.
+ */
+int32_t NMEAParser::_coordinate() const
+{
+  int32_t whole = _mantissa / POW10_INT[_fracDigits];
+  int32_t fraction = _mantissa % POW10_INT[_fracDigits];
+  int32_t degrees = whole / 100;
+  int64_t minutesE6 = (int64_t)(whole % 100) * 1000000;
+  if (_fracDigits <= 6)
+    minutesE6 += (int64_t)fraction * POW10_INT[6 - _fracDigits];
+  else
+    minutesE6 += fraction / POW10_INT[_fracDigits - 6];
+  // minutes / 60 * 1e7 = minutesE6 / 6
+  return degrees * 10000000 + (int32_t)((minutesE6 + 3) / 6);
+}
+
+/**
+ * Stores the field that just ended into the pending sentence values.
+ * Empty fields leave zero in place, a sentence already marked bad is
+ * dropped at its end anyway.
+ */
+void NMEAParser::_endField()
+{
+  if ((_digits == 0 && _firstChar == 0) || _bad)
+  {
+    return;
+  }
+
+  switch (_sentence)
+  {
+  case RMC:
+    switch (_fieldIndex)
+    {
+    case RMC_TIME:
+      _pending.time = _mantissa / POW10_INT[_fracDigits];
+      break;
+    case RMC_STATUS:
+      _pending.valid = _firstChar == 'A';
+      break;
+    case RMC_LATITUDE:
+      _pending.latitude = _coordinate();
+      break;
+    case RMC_NORTH_SOUTH:
+      if (_firstChar == 'S')
+        _pending.latitude = -_pending.latitude;
+      break;
+    case RMC_LONGITUDE:
+      _pending.longitude = _coordinate();
+      break;
+    case RMC_EAST_WEST:
+      if (_firstChar == 'W')
+        _pending.longitude = -_pending.longitude;
+      break;
+    case RMC_SPEED:
+      _pending.speed = _value() * KNOTS_TO_KMH;
+      break;
+    case RMC_COURSE:
+      _pending.course = _value();
+      break;
+    case RMC_DATE:
+      _pending.date = _mantissa;
+      break;
+    }
+    break;
+
+  case GGA:
+    switch (_fieldIndex)
+    {
+    case GGA_QUALITY:
+      _pending.quality = (uint8_t)_mantissa;
+      break;
+    case GGA_SATELLITES:
+      _pending.satellitesUsed = (uint8_t)_mantissa;
+      break;
+    case GGA_HDOP:
+      _pending.hdop = _value();
+      break;
+    case GGA_ALTITUDE:
+      _pending.altitude = _value();
+      break;
+    }
+    break;
+
+  case GSA:
+    switch (_fieldIndex)
+    {
+    case GSA_MODE:
+      _pending.mode = (uint8_t)_mantissa;
+      break;
+    case GSA_PDOP:
+      _pending.pdop = _value();
+      break;
+    case GSA_VDOP:
+      _pending.vdop = _value();
+      break;
+    }
+    break;
+
+  case GSV:
+    switch (_fieldIndex)
+    {
+    case GSV_MESSAGE:
+      _pending.messageNumber = (uint8_t)_mantissa;
+      break;
+    case GSV_IN_VIEW:
+      _pending.satellitesInView = (uint8_t)_mantissa;
+      break;
+    }
+    break;
+
+  case OTHER:
+    break;
+  }
+}
+
+/**
+ * Applies a sentence with a matching checksum to the working fix.
+ * @return true when the sentence was RMC and the fix was published
+ */
+bool NMEAParser::_endSentence()
+{
+  bool complete = _state == WAIT_END && _checksumDigits == 2;
+  if (!complete || _bad || _received != _checksum)
+  {
+    _checksumErrors++;
+    reset();
+    return false;
+  }
+  _sentences++;
+
+  bool published = false;
+  const Pending &p = _pending;
+  switch (_sentence)
+  {
+  case RMC:
+    _work.timestamp = p.date == 0 ? 0
+                                  : gpsEpochSeconds(2000 + p.date % 100, (p.date / 100) % 100, p.date / 10000,
+                                                    p.time / 10000, (p.time / 100) % 100, p.time % 100);
+    _work.runStatus = 1;
+    _work.fixStatus = p.valid ? 1 : 0;
+    _work.latitude = p.latitude;
+    _work.longitude = p.longitude;
+    _work.speed = p.speed;
+    _work.course = p.course;
+    _work.satellitesInView = _inViewSum;
+    _fix = _work;
+    _fixes++;
+    // The next epoch starts unknown, so a GGA or GSA lost to a checksum
+    // error leaves zero DOP rather than the last epoch's geometry
+    clearGPSFix(_work);
+    _inViewSum = 0;
+    published = true;
+    break;
+  case GGA:
+    _work.satellitesUsed = p.satellitesUsed;
+    _work.hdop = p.hdop;
+    _work.altitude = p.altitude;
+    break;
+  case GSA:
+    _work.fixMode = p.mode;
+    _work.pdop = p.pdop;
+    _work.vdop = p.vdop;
+    break;
+  case GSV:
+    if (p.messageNumber == 1)
+    {
+      _inViewSum += p.satellitesInView; // one count per talker
+    }
+    break;
+  case OTHER:
+    break;
+  }
+  reset();
+  return published;
+}
+
+bool NMEAParser::feed(char c)
+{
+  if (c == '\r' || c == '\n')
+  {
+    if (_state == WAIT_START)
+    {
+      return false;
+    }
+    return _endSentence();
+  }
+  if (c == '$')
+  {
+    if (_state != WAIT_START)
+    {
+      _checksumErrors++; // previous sentence was cut off
+    }
+    reset();
+    _state = ADDRESS;
+    return false;
+  }
+
+  switch (_state)
+  {
+  case WAIT_START:
+    return false;
+
+  case ADDRESS:
+    _checksum ^= c;
+    if (c == ',')
+    {
+      if (_addressLen == 5)
+      {
+        if (memcmp(_address + 2, "RMC", 3) == 0)
+          _sentence = RMC;
+        else if (memcmp(_address + 2, "GGA", 3) == 0)
+          _sentence = GGA;
+        else if (memcmp(_address + 2, "GSA", 3) == 0)
+          _sentence = GSA;
+        else if (memcmp(_address + 2, "GSV", 3) == 0)
+          _sentence = GSV;
+      }
+      _state = FIELDS;
+    }
+    else if (_addressLen < sizeof(_address))
+    {
+      _address[_addressLen++] = c;
+    }
+    else
+    {
+      _bad = true;
+    }
+    return false;
+
+  case FIELDS:
+    break;
+
+  case CHECKSUM:
+  {
+    uint8_t v = hexValue(c);
+    if (v == 0xFF)
+    {
+      _bad = true;
+      return false;
+    }
+    _received = (_received << 4) | v;
+    if (++_checksumDigits == 2)
+    {
+      _state = WAIT_END;
+    }
+    return false;
+  }
+
+  case WAIT_END:
+    _bad = true; // junk after the checksum
+    return false;
+  }
+
+  // FIELDS
+  if (c == '*')
+  {
+    _endField();
+    _state = CHECKSUM;
+    return false;
+  }
+  _checksum ^= c;
+  if (_bad)
+  {
+    return false;
+  }
+  if (c == ',')
+  {
+    _endField();
+    if (_fieldIndex < NMEA_MAX_FIELDS)
+    {
+      _fieldIndex++;
+    }
+    _beginField();
+  }
+  else if (c >= '0' && c <= '9')
+  {
+    if (_digits < MAX_MANTISSA_DIGITS)
+    {
+      _mantissa = _mantissa * 10 + (c - '0');
+      _digits++;
+      if (_seenDot)
+      {
+        _fracDigits++;
+      }
+    }
+    else if (!_seenDot)
+    {
+      _bad = true; // integer part too long to be a real value
+    }
+    // surplus fractional digits are below the resolution we keep
+  }
+  else if (c == '.' && !_seenDot)
+  {
+    _seenDot = true;
+  }
+  else if (c == '-' && _digits == 0 && !_negative)
+  {
+    _negative = true;
+  }
+  else if (_firstChar == 0 && _digits == 0)
+  {
+    _firstChar = c; // status, hemisphere or mode letter
+  }
+  return false;
+}
@@ -0,0 +1,115 @@
+/*
+ * Streaming parser for the SIM808 NMEA output (AT+CGNSTST=1).
+ *
+ * Bytes are fed one at a time. Fields are converted while they stream in
+ * and the checksum is accumulated on the fly; a sentence only touches the
+ * fix once its checksum has matched. RMC, GGA, GSA and GSV are used, from
+ * any talker (GP, GL, GN). The fix is published when the RMC sentence
+ * arrives, which AT+CGNSSEQ="RMC" makes the last one of every burst.
+ * Every burst starts from a cleared fix: a field whose sentence was lost
+ * reads as unknown (zero), never as the value of the burst before.
+ */
+
+#ifndef NMEAParser_h
+#define NMEAParser_h
+
+#include <stdint.h>
+#include "GPSFix.h"
+
+#define NMEA_MAX_FIELDS 20
+
+class NMEAParser
+{
+public:
+  NMEAParser();
+
+  /*
+   * Feed one byte received from the modem.
+   * @return true when an RMC sentence completed a fix in fix()
+   */
+  bool feed(char c);
+
+  // Drop any partially parsed sentence
+  void reset();
+
+  // Last complete fix. Only valid after feed() returned true.
+  const GPSFix &fix() const { return _fix; }
+
+  uint32_t sentenceCount() const { return _sentences; } // Sentences with a good checksum
+  uint32_t checksumErrors() const { return _checksumErrors; }
+  uint32_t fixCount() const { return _fixes; }
+
+private:
+  enum State
+  {
+    WAIT_START,  // Waiting for '$'
+    ADDRESS,     // Talker and sentence type ("GPRMC")
+    FIELDS,      // Comma separated fields
+    CHECKSUM,    // Two hex digits after '*'
+    WAIT_END     // Checksum read, waiting for the line end
+  };
+
+  enum Sentence
+  {
+    OTHER,
+    RMC,
+    GGA,
+    GSA,
+    GSV
+  };
+
+  // Values of the sentence being parsed, applied once the checksum matches
+  struct Pending
+  {
+    uint32_t time;     // hhmmss
+    uint32_t date;     // ddmmyy
+    bool valid;        // RMC status 'A'
+    int32_t latitude;  // 1e-7 degrees, sign from the hemisphere field
+    int32_t longitude;
+    float speed;       // km/h
+    float course;
+    uint8_t quality;   // GGA fix quality
+    uint8_t satellitesUsed;
+    float hdop;
+    float altitude;
+    uint8_t mode;      // GSA 1/2/3
+    float pdop;
+    float vdop;
+    uint8_t messageNumber; // GSV
+    uint8_t satellitesInView;
+  };
+
+  void _beginField();
+  void _endField();
+  bool _endSentence();
+  int32_t _coordinate() const;
+  float _value() const;
+
+  State _state;
+  Sentence _sentence;
+  char _address[5];
+  uint8_t _addressLen;
+  uint8_t _fieldIndex;
+  uint8_t _checksum;     // running XOR
+  uint8_t _received;     // checksum from the sentence
+  uint8_t _checksumDigits;
+  bool _bad;
+
+  // Number being accumulated for the current field
+  int32_t _mantissa;
+  uint8_t _fracDigits;
+  uint8_t _digits;
+  bool _negative;
+  bool _seenDot;
+  char _firstChar;
+
+  Pending _pending;
+  GPSFix _work;
+  uint8_t _inViewSum;    // GSV satellites in view over all talkers
+  GPSFix _fix;
+  uint32_t _sentences;
+  uint32_t _checksumErrors;
+  uint32_t _fixes;
+};
+
+#endif
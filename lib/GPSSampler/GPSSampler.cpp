@@ -0,0 +1,215 @@
+#include "GPSSampler.h"
+#include "GeoMath.h"
+
+GPSSampler::GPSSampler()
+{
+  _started = false;
+  _state = SEARCHING;
+  _nextDue = 0;
+  _interval = SAMPLER_SEARCH_INTERVAL;
+  _idleInterval = 0;
+  _searchPolls = 0;
+  _minInterval = SAMPLER_MIN_INTERVAL;
+  _warmup = SAMPLER_WARMUP;
+  _haveLast = false;
+  _lastLatitude = 0;
+  _lastLongitude = 0;
+  _lastCourse = 0;
+  _lastCourseValid = false;
+  _lastTime = 0;
+  _anchorLatitude = 0;
+  _anchorLongitude = 0;
+  _stillFixes = 0;
+  _powered = false;
+  _poweredSince = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void GPSSampler::begin(unsigned long now)
+{
+  _state = SEARCHING;
+  _searchPolls = 0;
+  _haveLast = false;
+  _stillFixes = 0;
+  _powered = true;
+  _poweredSince = now;
+  _nextDue = now;
+  _interval = SAMPLER_SEARCH_INTERVAL;
+  _started = true;
+}
+
+bool GPSSampler::fixDue(unsigned long now) const
+{
+  return _started && _powered && (long)(now - _nextDue) >= 0;
+}
+
+bool GPSSampler::wantsPower(unsigned long now) const
+{
+  if (!_started || _interval < SAMPLER_POWER_OFF_INTERVAL)
+  {
+    return true;
+  }
+  return (long)(_nextDue - now) <= (long)_warmup;
+}
+
+void GPSSampler::setPowered(bool on, unsigned long now)
+{
+  if (on == _powered)
+  {
+    return;
+  }
+  if (on)
+  {
+    _stats.powerCycles++;
+    _poweredSince = now;
+  }
+  else
+  {
+    _stats.gnssOnMs += now - _poweredSince;
+  }
+  _powered = on;
+}
+
+void GPSSampler::_schedule(uint32_t interval, unsigned long now)
+{
+  if (interval < _minInterval)
+    interval = _minInterval;
+  _interval = interval;
+  _nextDue = now + interval;
+}
+
+// Next step of the stationary/search backoff
+uint32_t GPSSampler::_backOff()
+{
+  if (_idleInterval < SAMPLER_STATIONARY_INTERVAL)
+    _idleInterval = SAMPLER_STATIONARY_INTERVAL;
+  else if (_idleInterval < SAMPLER_MAX_INTERVAL / 2)
+    _idleInterval *= 2;
+  else
+    _idleInterval = SAMPLER_MAX_INTERVAL;
+  return _idleInterval;
+}
+
+/**
+ * No valid fix: poll quickly for a while, then back off so a parcel in a
+ * warehouse without sky view does not keep the receiver on for hours.
+ */
+void GPSSampler::_onNoFix(unsigned long now)
+{
+  if (_state != SEARCHING)
+  {
+    _state = SEARCHING;
+    _searchPolls = 0;
+    _idleInterval = 0;
+  }
+  _searchPolls++;
+  if ((uint32_t)_searchPolls * SAMPLER_SEARCH_INTERVAL >= SAMPLER_SEARCH_TIMEOUT)
+  {
+    _searchPolls = 0;
+    _schedule(_backOff(), now);
+  }
+  else
+  {
+    _schedule(SAMPLER_SEARCH_INTERVAL, now);
+  }
+}
+
+void GPSSampler::onPollFailed(unsigned long now)
+{
+  _schedule(SAMPLER_SEARCH_INTERVAL, now);
+}
+
+void GPSSampler::onFix(const GPSFix &fix, unsigned long now)
+{
+  _stats.polls++;
+  if (fix.fixStatus != 1)
+  {
+    _onNoFix(now);
+    return;
+  }
+  _stats.fixes++;
+
+  uint32_t speed = fix.speed > 0.0f ? (uint32_t)(fix.speed * 10.0f + 0.5f) : 0; // 0.1 km/h
+  uint16_t course = (uint16_t)((uint32_t)(fix.course * 100.0f + 0.5f) % GEO_FULL_TURN_CDEG);
+  bool turning = false;
+
+  if (_haveLast)
+  {
+    // The reported speed lags behind on short hops, trust the distance too
+    uint32_t dt = now - _lastTime;
+    if (dt > 0)
+    {
+      uint32_t movedCm = geoDistanceCm(_lastLatitude, _lastLongitude, fix.latitude, fix.longitude);
+      uint32_t measured = (uint32_t)((uint64_t)movedCm * 360 / dt); // cm/ms to 0.1 km/h
+      if (measured > speed && _stillFixes == 0)
+      {
+        speed = measured;
+      }
+    }
+    if (_lastCourseValid && speed >= SAMPLER_STATIONARY_SPEED)
+    {
+      int32_t turn = geoTurnCdeg(_lastCourse, course);
+      turning = turn >= SAMPLER_TURN_CDEG || turn <= -SAMPLER_TURN_CDEG;
+    }
+  }
+
+  // Stationary detection against an anchor, not the previous fix, so slow
+  // GNSS drift cannot add up to "movement"
+  uint32_t fromAnchor = _haveLast ? geoDistanceCm(_anchorLatitude, _anchorLongitude, fix.latitude, fix.longitude) : UINT32_MAX;
+  if (fix.speed * 10.0f < SAMPLER_STATIONARY_SPEED && fromAnchor < SAMPLER_STATIONARY_RADIUS_CM)
+  {
+    if (_stillFixes < 255)
+      _stillFixes++;
+  }
+  else
+  {
+    _stillFixes = 0;
+    _anchorLatitude = fix.latitude;
+    _anchorLongitude = fix.longitude;
+  }
+
+  if (_stillFixes >= SAMPLER_STATIONARY_FIXES)
+  {
+    if (_state != STATIONARY)
+    {
+      _idleInterval = 0;
+      _state = STATIONARY;
+    }
+    _schedule(_backOff(), now);
+  }
+  else
+  {
+    _state = MOVING;
+    uint32_t interval = SAMPLER_MOVING_MAX_INTERVAL;
+    if (turning)
+    {
+      interval = SAMPLER_MIN_INTERVAL;
+    }
+    else if (speed > 0)
+    {
+      interval = (uint32_t)SAMPLER_TARGET_SPACING_CM * 360 / speed;
+    }
+    if (interval < SAMPLER_MIN_INTERVAL)
+      interval = SAMPLER_MIN_INTERVAL;
+    if (interval > SAMPLER_MOVING_MAX_INTERVAL)
+      interval = SAMPLER_MOVING_MAX_INTERVAL;
+    _schedule(interval, now);
+  }
+
+  _haveLast = true;
+  _lastLatitude = fix.latitude;
+  _lastLongitude = fix.longitude;
+  _lastCourse = course;
+  _lastCourseValid = fix.speed * 10.0f >= SAMPLER_STATIONARY_SPEED; // course is noise when still
+  _lastTime = now;
+}
+
+void GPSSampler::printStats(Print &out, unsigned long now) const
+{
+  static const char *STATE_NAMES[] = {"searching", "moving", "stationary"};
+  uint32_t onMs = _stats.gnssOnMs + (_powered ? now - _poweredSince : 0);
+  out.printf("GPS sampler: %s, %u ms interval, %u/%u valid fixes\n",
+             STATE_NAMES[_state], (unsigned)_interval, (unsigned)_stats.fixes, (unsigned)_stats.polls);
+  out.printf("GPS sampler: GNSS on for %u s, %u power cycles\n",
+             (unsigned)(onMs / 1000), (unsigned)_stats.powerCycles);
+}
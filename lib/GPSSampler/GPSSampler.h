@@ -0,0 +1,121 @@
+/*
+ * Adaptive GPS sampling: decides when the next +CGNSINF poll is due and
+ * whether the GNSS engine needs to be powered.
+ *
+ * While moving, the poll interval keeps roughly SAMPLER_TARGET_SPACING_CM
+ * between fixes, so a train at 100 km/h is sampled every second and a
+ * hand cart every half minute. A course change of SAMPLER_TURN_CDEG or
+ * more drops straight to the fastest rate to catch the corner. Once the
+ * parcel has stayed within SAMPLER_STATIONARY_RADIUS_CM for a few fixes
+ * the interval doubles on every fix up to SAMPLER_MAX_INTERVAL, and the
+ * GNSS engine is switched off between fixes that are far enough apart.
+ *
+ * The sampler only keeps time; the caller sends the AT commands and
+ * reports back with onFix(), onPollFailed() and setPowered().
+ */
+
+#ifndef GPSSampler_h
+#define GPSSampler_h
+
+#include "Arduino.h"
+#include "GPSFix.h"
+
+#define SAMPLER_MIN_INTERVAL 1000              // fastest poll rate, ms
+#define SAMPLER_MOVING_MAX_INTERVAL 30000      // slowest poll rate while moving
+#define SAMPLER_MAX_INTERVAL 300000            // slowest poll rate while stationary
+#define SAMPLER_STATIONARY_INTERVAL 30000      // first interval once stationary
+#define SAMPLER_SEARCH_INTERVAL 5000           // poll rate while waiting for a valid fix
+#define SAMPLER_SEARCH_TIMEOUT 120000          // then back off like a stationary parcel
+#define SAMPLER_TARGET_SPACING_CM 3000         // distance between fixes while moving
+#define SAMPLER_STATIONARY_SPEED 20            // 0.1 km/h, slower than this counts as still
+#define SAMPLER_STATIONARY_RADIUS_CM 2500      // GNSS wander of a parcel standing still
+#define SAMPLER_STATIONARY_FIXES 3             // still fixes in a row before backing off
+#define SAMPLER_TURN_CDEG 1500                 // course change that forces the fastest rate
+#define SAMPLER_POWER_OFF_INTERVAL 60000       // power GNSS down between fixes this far apart
+#define SAMPLER_WARMUP 15000                   // default lead for powering GNSS up before a fix is due
+
+struct GPSSamplerStats
+{
+  uint32_t polls;       // +CGNSINF replies handled
+  uint32_t fixes;       // valid fixes among them
+  uint32_t powerCycles; // GNSS power-ups after a power-down
+  uint32_t gnssOnMs;    // time the GNSS engine was powered
+};
+
+class GPSSampler
+{
+public:
+  enum State
+  {
+    SEARCHING,  // no valid fix yet
+    MOVING,
+    STATIONARY
+  };
+
+  GPSSampler();
+
+  // Start sampling, the GNSS engine is expected to be on
+  void begin(unsigned long now);
+
+  // A +CGNSINF poll should be sent now
+  bool fixDue(unsigned long now) const;
+
+  // The GNSS engine should be powered at this moment
+  bool wantsPower(unsigned long now) const;
+
+  // Result of a poll, valid or not
+  void onFix(const GPSFix &fix, unsigned long now);
+
+  // The poll itself failed (modem error or timeout)
+  void onPollFailed(unsigned long now);
+
+  // The GNSS engine was switched on or off
+  void setPowered(bool on, unsigned long now);
+
+  // Never poll faster than this, e.g. to save battery. Applies from the next fix.
+  void setMinInterval(uint32_t ms) { _minInterval = ms < SAMPLER_MIN_INTERVAL ? SAMPLER_MIN_INTERVAL : ms; }
+
+  // Power GNSS up this long before a fix is due, e.g. the measured re-acquisition time
+  void setWarmup(uint32_t ms) { _warmup = ms; }
+  uint32_t warmup() const { return _warmup; }
+
+  bool isStarted() const { return _started; }
+  bool isPowered() const { return _powered; }
+  State state() const { return _state; }
+  uint32_t interval() const { return _interval; }
+  unsigned long nextDue() const { return _nextDue; }
+
+  const GPSSamplerStats &stats() const { return _stats; }
+  void printStats(Print &out, unsigned long now) const;
+
+private:
+  void _onNoFix(unsigned long now);
+  void _schedule(uint32_t interval, unsigned long now);
+  uint32_t _backOff();
+
+  bool _started;
+  State _state;
+  unsigned long _nextDue;
+  uint32_t _interval;
+  uint32_t _idleInterval;   // current stationary/search backoff
+  uint16_t _searchPolls;
+  volatile uint32_t _minInterval; // set from the power governor
+  uint32_t _warmup;
+
+  bool _haveLast;
+  int32_t _lastLatitude;    // previous valid fix
+  int32_t _lastLongitude;
+  uint16_t _lastCourse;     // 0.01 degree
+  bool _lastCourseValid;
+  unsigned long _lastTime;
+
+  int32_t _anchorLatitude;  // where the parcel was last seen moving
+  int32_t _anchorLongitude;
+  uint8_t _stillFixes;
+
+  bool _powered;
+  unsigned long _poweredSince;
+  GPSSamplerStats _stats;
+};
+
+#endif
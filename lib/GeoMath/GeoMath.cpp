@@ -0,0 +1,214 @@
+#include "GeoMath.h"
+
+// Meridian arc length of 1e-7 degree on a 6371 km sphere: 1.11195 cm
+#define GEO_CM_PER_UNIT_NUM 111195LL
+#define GEO_CM_PER_UNIT_DEN 100000LL
+
+// cos(d) in Q15 for d = 0..90 degrees
+static const uint16_t COS_Q15[91] = {
+    32768, 32763, 32748, 32723, 32688, 32643, 32588, 32524, 32449, 32365, 32270, 32166, 32052, 31928,
+    31795, 31651, 31499, 31336, 31164, 30983, 30792, 30592, 30382, 30163, 29935, 29698, 29452, 29197,
+    28932, 28660, 28378, 28088, 27789, 27482, 27166, 26842, 26510, 26170, 25822, 25466, 25102, 24730,
+    24351, 23965, 23571, 23170, 22763, 22348, 21926, 21498, 21063, 20622, 20174, 19720, 19261, 18795,
+    18324, 17847, 17364, 16877, 16384, 15886, 15384, 14876, 14365, 13848, 13328, 12803, 12275, 11743,
+    11207, 10668, 10126, 9580, 9032, 8481, 7927, 7371, 6813, 6252, 5690, 5126, 4560, 3993,
+    3425, 2856, 2286, 1715, 1144, 572, 0};
+
+// atan(i / 64) in 0.01 degree for i = 0..64
+static const uint16_t ATAN_CDEG[65] = {
+    0, 90, 179, 268, 358, 447, 536, 624, 713, 800, 888, 975, 1062, 1148, 1234, 1319, 1404,
+    1488, 1571, 1653, 1735, 1817, 1897, 1977, 2056, 2134, 2211, 2287, 2363, 2438, 2511, 2584,
+    2657, 2728, 2798, 2867, 2936, 3003, 3070, 3136, 3201, 3264, 3327, 3390, 3451, 3511, 3571,
+    3629, 3687, 3744, 3800, 3855, 3909, 3963, 4016, 4067, 4119, 4169, 4218, 4267, 4315, 4363,
+    4409, 4455, 4500};
+
+int32_t geoCosQ15(int32_t latitude)
+{
+  uint32_t a = latitude < 0 ? -(uint32_t)latitude : (uint32_t)latitude;
+  uint32_t degree = a / GEO_SCALE;
+  if (degree >= 90)
+  {
+    return 0;
+  }
+  uint32_t fraction = a % GEO_SCALE;
+  int32_t c0 = COS_Q15[degree];
+  int32_t c1 = COS_Q15[degree + 1];
+  return c0 - (int32_t)(((int64_t)(c0 - c1) * fraction) / GEO_SCALE);
+}
+
+void geoOffsetCm(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude,
+                 int32_t *eastCm, int32_t *northCm)
+{
+  int64_t dLatitude = (int64_t)toLatitude - fromLatitude;
+  int64_t dLongitude = (int64_t)toLongitude - fromLongitude;
+  // Take the short way across the antimeridian
+  if (dLongitude > 180 * GEO_SCALE)
+    dLongitude -= GEO_FULL_TURN_UNITS;
+  else if (dLongitude < -180 * GEO_SCALE)
+    dLongitude += GEO_FULL_TURN_UNITS;
+
+  int32_t meanLatitude = (int32_t)(((int64_t)fromLatitude + toLatitude) / 2);
+  int64_t east = (dLongitude * geoCosQ15(meanLatitude)) >> 15;
+  *eastCm = (int32_t)(east * GEO_CM_PER_UNIT_NUM / GEO_CM_PER_UNIT_DEN);
+  *northCm = (int32_t)(dLatitude * GEO_CM_PER_UNIT_NUM / GEO_CM_PER_UNIT_DEN);
+}
+
+void geoMoveCm(int32_t latitude, int32_t longitude, int32_t eastCm, int32_t northCm,
+               int32_t *toLatitude, int32_t *toLongitude)
+{
+  int64_t dLatitude = (int64_t)northCm * GEO_CM_PER_UNIT_DEN / GEO_CM_PER_UNIT_NUM;
+  int32_t cosQ15 = geoCosQ15((int32_t)(latitude + dLatitude / 2));
+  int64_t dLongitude = cosQ15 > 0 ? (int64_t)eastCm * GEO_CM_PER_UNIT_DEN * 32768 / GEO_CM_PER_UNIT_NUM / cosQ15 : 0;
+
+  int64_t lat = latitude + dLatitude;
+  if (lat > 90 * GEO_SCALE)
+    lat = 90 * GEO_SCALE;
+  else if (lat < -90 * GEO_SCALE)
+    lat = -90 * GEO_SCALE;
+  int64_t lon = longitude + dLongitude;
+  if (lon > 180 * GEO_SCALE)
+    lon -= GEO_FULL_TURN_UNITS;
+  else if (lon < -180 * GEO_SCALE)
+    lon += GEO_FULL_TURN_UNITS;
+  *toLatitude = (int32_t)lat;
+  *toLongitude = (int32_t)lon;
+}
+
+uint32_t geoSqrt64(uint64_t value)
+{
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (value >= result + bit)
+    {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else
+    {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+uint32_t geoDistanceCm(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude)
+{
+  int32_t east, north;
+  geoOffsetCm(fromLatitude, fromLongitude, toLatitude, toLongitude, &east, &north);
+  return geoSqrt64((uint64_t)((int64_t)east * east) + (uint64_t)((int64_t)north * north));
+}
+
+/**
+ * atan(small / large) in 0.01 degree for 0 <= small <= large, by linear
+ * interpolation of the 65-entry table (error below 0.01 degree).
+ */
+static uint32_t atanRatioCdeg(uint32_t small, uint32_t large)
+{
+  if (large == 0)
+  {
+    return 0;
+  }
+  uint32_t ratio = (uint32_t)(((uint64_t)small << 16) / large); // Q16, 0..65536
+  uint32_t index = ratio >> 10;
+  uint32_t fraction = ratio & 0x3FF;
+  if (index >= 64)
+  {
+    return ATAN_CDEG[64];
+  }
+  return ATAN_CDEG[index] + (((ATAN_CDEG[index + 1] - ATAN_CDEG[index]) * fraction + 512) >> 10);
+}
+
+uint16_t geoBearingOfCdeg(int32_t east, int32_t north)
+{
+  uint32_t ax = east < 0 ? -(uint32_t)east : (uint32_t)east;
+  uint32_t ay = north < 0 ? -(uint32_t)north : (uint32_t)north;
+
+  // Angle from the north/south axis towards the east/west axis
+  uint32_t angle = ax <= ay ? atanRatioCdeg(ax, ay) : 9000 - atanRatioCdeg(ay, ax);
+
+  uint32_t bearing;
+  if (east >= 0)
+    bearing = north >= 0 ? angle : 18000 - angle;
+  else
+    bearing = north >= 0 ? GEO_FULL_TURN_CDEG - angle : 18000 + angle;
+  return (uint16_t)(bearing % GEO_FULL_TURN_CDEG);
+}
+
+uint16_t geoBearingCdeg(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude)
+{
+  int32_t east, north;
+  geoOffsetCm(fromLatitude, fromLongitude, toLatitude, toLongitude, &east, &north);
+  return geoBearingOfCdeg(east, north);
+}
+
+int32_t geoTurnCdeg(uint16_t fromBearing, uint16_t toBearing)
+{
+  int32_t turn = (int32_t)toBearing - fromBearing;
+  if (turn >= GEO_FULL_TURN_CDEG / 2)
+    turn -= GEO_FULL_TURN_CDEG;
+  else if (turn < -GEO_FULL_TURN_CDEG / 2)
+    turn += GEO_FULL_TURN_CDEG;
+  return turn;
+}
+
+GeoBox geoBoxAround(int32_t latitude, int32_t longitude, uint32_t radiusCm)
+{
+  int64_t dLatitude = (int64_t)radiusCm * GEO_CM_PER_UNIT_DEN / GEO_CM_PER_UNIT_NUM + 1;
+  int32_t cosQ15 = geoCosQ15(latitude);
+  // Near the poles the box spans every longitude
+  int64_t dLongitude = cosQ15 > 0 ? (dLatitude << 15) / cosQ15 + 1 : 180 * GEO_SCALE;
+  if (dLongitude > 180 * GEO_SCALE)
+    dLongitude = 180 * GEO_SCALE;
+
+  GeoBox box;
+  box.minLatitude = (int32_t)(latitude - dLatitude < -90 * GEO_SCALE ? -90 * GEO_SCALE : latitude - dLatitude);
+  box.maxLatitude = (int32_t)(latitude + dLatitude > 90 * GEO_SCALE ? 90 * GEO_SCALE : latitude + dLatitude);
+  box.minLongitude = (int32_t)(longitude - dLongitude < -180 * GEO_SCALE ? -180 * GEO_SCALE : longitude - dLongitude);
+  box.maxLongitude = (int32_t)(longitude + dLongitude > 180 * GEO_SCALE ? 180 * GEO_SCALE : longitude + dLongitude);
+  return box;
+}
+
+void geoBoxExtend(GeoBox &box, int32_t latitude, int32_t longitude)
+{
+  if (latitude < box.minLatitude)
+    box.minLatitude = latitude;
+  if (latitude > box.maxLatitude)
+    box.maxLatitude = latitude;
+  if (longitude < box.minLongitude)
+    box.minLongitude = longitude;
+  if (longitude > box.maxLongitude)
+    box.maxLongitude = longitude;
+}
+
+void geoFormatCoordinate(int32_t value, char *out)
+{
+  uint32_t a = value < 0 ? -(uint32_t)value : (uint32_t)value;
+  uint32_t whole = a / GEO_SCALE;
+  uint32_t fraction = a % GEO_SCALE;
+  char digits[10];
+  uint8_t n = 0;
+  do
+  {
+    digits[n++] = '0' + whole % 10;
+    whole /= 10;
+  } while (whole > 0);
+
+  if (value < 0)
+    *out++ = '-';
+  while (n > 0)
+    *out++ = digits[--n];
+  *out++ = '.';
+  for (int8_t i = 6; i >= 0; i--)
+  {
+    out[i] = '0' + fraction % 10;
+    fraction /= 10;
+  }
+  out[7] = '\0';
+}
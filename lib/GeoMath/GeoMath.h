@@ -0,0 +1,71 @@
+/*
+ * Integer geodesy on 1e-7 degree fixed-point coordinates.
+ *
+ * Coordinates stay int32 from the parser to the uplink; none of these
+ * functions use floating point. Distances use an equirectangular
+ * projection around the mean latitude, which stays within 0.2% for
+ * the short hops between fixes (tens of kilometers), and come out in
+ * centimeters.
+ */
+
+#ifndef GeoMath_h
+#define GeoMath_h
+
+#include <stdint.h>
+
+#define GEO_SCALE 10000000L             // fixed-point units per degree
+#define GEO_FULL_TURN_UNITS (360LL * GEO_SCALE) // does not fit a 32-bit long
+#define GEO_FULL_TURN_CDEG 36000        // bearings are in 0.01 degree
+#define GEO_COORDINATE_CHARS 13         // "-179.1234567" plus terminator
+
+// Axis aligned box in fixed-point degrees, inclusive bounds
+struct GeoBox
+{
+  int32_t minLatitude;
+  int32_t minLongitude;
+  int32_t maxLatitude;
+  int32_t maxLongitude;
+};
+
+// cos(latitude) in Q15 (32768 = 1.0)
+int32_t geoCosQ15(int32_t latitude);
+
+// East and north offset in centimeters from one point to another
+void geoOffsetCm(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude,
+                 int32_t *eastCm, int32_t *northCm);
+
+// Point at an east and north offset in centimeters, inverse of geoOffsetCm
+void geoMoveCm(int32_t latitude, int32_t longitude, int32_t eastCm, int32_t northCm,
+               int32_t *toLatitude, int32_t *toLongitude);
+
+// Ground distance in centimeters
+uint32_t geoDistanceCm(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude);
+
+// Bearing of a local east/north vector, 0.01 degree clockwise from north
+uint16_t geoBearingOfCdeg(int32_t east, int32_t north);
+
+// Initial bearing from one point to another, 0.01 degree clockwise from north
+uint16_t geoBearingCdeg(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude);
+
+// Signed shortest turn from one bearing to another, -18000..17999
+int32_t geoTurnCdeg(uint16_t fromBearing, uint16_t toBearing);
+
+// Integer square root
+uint32_t geoSqrt64(uint64_t value);
+
+// Box covering every point within radiusCm of a center
+GeoBox geoBoxAround(int32_t latitude, int32_t longitude, uint32_t radiusCm);
+
+// Grow a box to include a point
+void geoBoxExtend(GeoBox &box, int32_t latitude, int32_t longitude);
+
+inline bool geoBoxContains(const GeoBox &box, int32_t latitude, int32_t longitude)
+{
+  return latitude >= box.minLatitude && latitude <= box.maxLatitude &&
+         longitude >= box.minLongitude && longitude <= box.maxLongitude;
+}
+
+// Format a fixed-point coordinate as decimal degrees ("6.9344120")
+void geoFormatCoordinate(int32_t value, char *out);
+
+#endif
@@ -0,0 +1,171 @@
+#include <string.h>
+#include "Geofence.h"
+
+GeofenceMonitor::GeofenceMonitor(const GeofenceTable &table) : _table(table)
+{
+  _trackedCount = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * Ray casting in coordinates relative to the tested point. Station
+ * polygons are small, so plain degree differences are fine as long as the
+ * polygon does not straddle the antimeridian.
+ */
+bool GeofenceMonitor::_insidePolygon(const GeoFence &fence, int32_t latitude, int32_t longitude) const
+{
+  const GeoVertex *v = _table.vertices + fence.firstVertex;
+  bool inside = false;
+  for (uint8_t i = 0, j = fence.vertexCount - 1; i < fence.vertexCount; j = i++)
+  {
+    int64_t yi = (int64_t)v[i].latitude - latitude;
+    int64_t yj = (int64_t)v[j].latitude - latitude;
+    if ((yi > 0) == (yj > 0))
+    {
+      continue; // edge does not cross the point's parallel
+    }
+    int64_t xi = (int64_t)v[i].longitude - longitude;
+    int64_t xj = (int64_t)v[j].longitude - longitude;
+    // Crossing strictly east of the point: xi + (xj - xi) * (0 - yi) / (yj - yi) > 0.
+    // A crossing at the point itself never counts, whichever way the edge
+    // runs, so a point on an edge shared by two fences is in exactly one
+    int64_t numerator = xi * (yj - yi) - (xj - xi) * yi;
+    if (numerator != 0 && (numerator > 0) == (yj - yi > 0))
+    {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+bool GeofenceMonitor::contains(const GeoFence &fence, int32_t latitude, int32_t longitude) const
+{
+  if (!geoBoxContains(fence.box, latitude, longitude))
+  {
+    return false;
+  }
+  if (fence.vertexCount == 0)
+  {
+    return geoDistanceCm(fence.latitude, fence.longitude, latitude, longitude) <= fence.radiusCm;
+  }
+  return _insidePolygon(fence, latitude, longitude);
+}
+
+// Indexes of the fences containing a point
+uint8_t GeofenceMonitor::_lookup(int32_t latitude, int32_t longitude, uint16_t *found, uint8_t maxFound)
+{
+  _stats.lookups++;
+  int64_t dy = (int64_t)latitude - _table.originLatitude;
+  int64_t dx = (int64_t)longitude - _table.originLongitude;
+  if (dy < 0 || dx < 0)
+  {
+    return 0;
+  }
+  int64_t row = dy / _table.cellLatitude;
+  int64_t col = dx / _table.cellLongitude;
+  if (row >= _table.rows || col >= _table.cols)
+  {
+    return 0;
+  }
+
+  uint32_t cell = (uint32_t)row * _table.cols + (uint32_t)col;
+  uint8_t count = 0;
+  for (uint16_t k = _table.cellStart[cell]; k < _table.cellStart[cell + 1] && count < maxFound; k++)
+  {
+    uint16_t index = _table.cellFences[k];
+    _stats.fencesTested++;
+    if (contains(_table.fences[index], latitude, longitude))
+    {
+      found[count++] = index;
+    }
+  }
+  return count;
+}
+
+uint8_t GeofenceMonitor::update(int32_t latitude, int32_t longitude, uint32_t timestamp,
+                                GeofenceEvent *events, uint8_t maxEvents)
+{
+  uint16_t found[GEOFENCE_MAX_TRACKED];
+  uint8_t foundCount = _lookup(latitude, longitude, found, GEOFENCE_MAX_TRACKED);
+
+  // Start tracking fences we were not near before
+  for (uint8_t f = 0; f < foundCount; f++)
+  {
+    bool known = false;
+    for (uint8_t t = 0; t < _trackedCount; t++)
+    {
+      if (_tracked[t].fence == found[f])
+      {
+        known = true;
+        break;
+      }
+    }
+    if (!known && _trackedCount < GEOFENCE_MAX_TRACKED)
+    {
+      Tracked &added = _tracked[_trackedCount++];
+      added.fence = found[f];
+      added.inside = false;
+      added.streak = 0;
+    }
+  }
+
+  uint8_t eventCount = 0;
+  uint8_t t = 0;
+  while (t < _trackedCount)
+  {
+    Tracked &tracked = _tracked[t];
+    bool present = false;
+    for (uint8_t f = 0; f < foundCount; f++)
+    {
+      if (found[f] == tracked.fence)
+      {
+        present = true;
+        break;
+      }
+    }
+
+    uint8_t type = 0;
+    if (present == tracked.inside)
+    {
+      tracked.streak = 0;
+    }
+    else if (++tracked.streak >= (tracked.inside ? GEOFENCE_EXIT_FIXES : GEOFENCE_ENTER_FIXES))
+    {
+      type = tracked.inside ? GEOFENCE_EXIT : GEOFENCE_ENTER;
+      tracked.inside = present;
+      tracked.streak = 0;
+    }
+
+    if (type != 0 && eventCount < maxEvents)
+    {
+      GeofenceEvent &event = events[eventCount++];
+      event.type = type;
+      event.fenceId = _table.fences[tracked.fence].id;
+      event.timestamp = timestamp;
+      event.latitude = latitude;
+      event.longitude = longitude;
+      _stats.events++;
+    }
+
+    // Forget fences we are clearly outside of
+    if (!tracked.inside && !present)
+    {
+      _tracked[t] = _tracked[--_trackedCount];
+      continue;
+    }
+    t++;
+  }
+  return eventCount;
+}
+
+int32_t GeofenceMonitor::currentFenceId() const
+{
+  for (uint8_t t = 0; t < _trackedCount; t++)
+  {
+    if (_tracked[t].inside)
+    {
+      return _table.fences[_tracked[t].fence].id;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,114 @@
+/*
+ * Station geofences: arrival and departure detection on the device.
+ *
+ * Fences are circles or small polygons kept in flash (const tables
+ * generated by tools/gen_geofences.py into include/Stations.h). A uniform
+ * grid over the fence area lists, per cell, the fences whose bounding box
+ * touches the cell, so a fix is only tested against the handful of fences
+ * near it no matter how many are loaded.
+ *
+ * Enter and exit are debounced over consecutive fixes so one multipath
+ * jump near a platform does not produce an arrival.
+ */
+
+#ifndef Geofence_h
+#define Geofence_h
+
+#include <stdint.h>
+#include "GeoMath.h"
+
+#define GEOFENCE_MAX_TRACKED 8   // fences the parcel can be inside or near at once
+#define GEOFENCE_ENTER_FIXES 2   // consecutive fixes inside before an arrival
+#define GEOFENCE_EXIT_FIXES 2    // consecutive fixes outside before a departure
+
+#define GEOFENCE_ENTER 1
+#define GEOFENCE_EXIT 2
+
+struct GeoVertex
+{
+  int32_t latitude;  // 1e-7 degrees
+  int32_t longitude;
+};
+
+struct GeoFence
+{
+  uint16_t id;           // station id reported with events
+  uint8_t vertexCount;   // 0 for a circle
+  uint16_t firstVertex;  // polygon vertices in the vertex table
+  int32_t latitude;      // circle center
+  int32_t longitude;
+  uint32_t radiusCm;     // circle radius
+  GeoBox box;            // bounding box, also used to build the grid
+};
+
+// Flash-resident fence set and its grid index
+struct GeofenceTable
+{
+  const GeoFence *fences;
+  uint16_t fenceCount;
+  const GeoVertex *vertices;
+  const uint16_t *cellStart;  // rows * cols + 1 offsets into cellFences
+  const uint16_t *cellFences; // fence indexes, grouped by cell
+  int32_t originLatitude;     // south-west corner of the grid
+  int32_t originLongitude;
+  int32_t cellLatitude;       // cell size in 1e-7 degrees
+  int32_t cellLongitude;
+  uint16_t rows;
+  uint16_t cols;
+};
+
+struct GeofenceEvent
+{
+  uint8_t type;        // GEOFENCE_ENTER or GEOFENCE_EXIT
+  uint16_t fenceId;
+  uint32_t timestamp;
+  int32_t latitude;
+  int32_t longitude;
+};
+
+struct GeofenceStats
+{
+  uint32_t lookups;
+  uint32_t fencesTested; // exact containment tests after the grid lookup
+  uint32_t events;
+};
+
+class GeofenceMonitor
+{
+public:
+  GeofenceMonitor(const GeofenceTable &table);
+
+  /*
+   * Check one fix against the fences.
+   * @param events, receives the arrivals and departures this fix completed
+   * @return number of events written (at most maxEvents)
+   */
+  uint8_t update(int32_t latitude, int32_t longitude, uint32_t timestamp,
+                 GeofenceEvent *events, uint8_t maxEvents);
+
+  // Exact test of one fence
+  bool contains(const GeoFence &fence, int32_t latitude, int32_t longitude) const;
+
+  // Fence the parcel is currently at, or -1
+  int32_t currentFenceId() const;
+
+  const GeofenceStats &stats() const { return _stats; }
+
+private:
+  struct Tracked
+  {
+    uint16_t fence;  // index in the table
+    bool inside;
+    uint8_t streak;  // consecutive fixes disagreeing with inside
+  };
+
+  uint8_t _lookup(int32_t latitude, int32_t longitude, uint16_t *found, uint8_t maxFound);
+  bool _insidePolygon(const GeoFence &fence, int32_t latitude, int32_t longitude) const;
+
+  const GeofenceTable &_table;
+  Tracked _tracked[GEOFENCE_MAX_TRACKED];
+  uint8_t _trackedCount;
+  GeofenceStats _stats;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "ModemLink.h"
+
+#define MODEM_LINK_LINE 96
+
+ModemLink::ModemLink(ModemUart &uart) : _uart(uart)
+{
+  memset(_rates, 0, sizeof(_rates));
+  _rateCount = 0;
+}
+
+// Next non-empty line without CR/LF, false at the deadline
+bool ModemLink::_readLine(char *line, size_t size, unsigned long deadline)
+{
+  size_t length = 0;
+  while ((long)(deadline - millis()) > 0)
+  {
+    int c = _uart.read();
+    if (c < 0)
+    {
+      delay(1);
+      continue;
+    }
+    if (c == '\n')
+    {
+      if (length > 0)
+      {
+        line[length] = '\0';
+        return true;
+      }
+    }
+    else if (c != '\r' && length < size - 1)
+    {
+      line[length++] = (char)c;
+    }
+  }
+  return false;
+}
+
+// Send a command and wait for its final result, true for OK
+bool ModemLink::_command(const char *command, uint32_t timeoutMs)
+{
+  _uart.discardInput();
+  _uart.print(command);
+  _uart.write('\r');
+  unsigned long deadline = millis() + timeoutMs;
+  char line[MODEM_LINK_LINE];
+  while (_readLine(line, sizeof(line), deadline))
+  {
+    if (strcmp(line, "OK") == 0)
+    {
+      return true;
+    }
+    if (strcmp(line, "ERROR") == 0 || strncmp(line, "+CME ERROR", 10) == 0)
+    {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool ModemLink::_probe()
+{
+  for (int i = 0; i < MODEM_LINK_PROBES; i++)
+  {
+    if (_command("AT", MODEM_LINK_PROBE_TIMEOUT))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ModemLink::autobaud(uint32_t storedBaud)
+{
+  if (storedBaud != 0)
+  {
+    _uart.setBaud(storedBaud);
+    if (_probe())
+    {
+      return true;
+    }
+  }
+  for (size_t i = 0; i < sizeof(MODEM_LINK_SCAN) / sizeof(MODEM_LINK_SCAN[0]); i++)
+  {
+    if (MODEM_LINK_SCAN[i] == storedBaud)
+    {
+      continue;
+    }
+    _uart.setBaud(MODEM_LINK_SCAN[i]);
+    if (_probe())
+    {
+      Serial.printf("Modem link: modem answers at %u baud.\n", (unsigned)MODEM_LINK_SCAN[i]);
+      return true;
+    }
+  }
+  Serial.println("Modem link: no answer at any rate.");
+  return false;
+}
+
+// Round trips of "AT" and echo rounds of a long command at the current rate
+bool ModemLink::_measure(uint32_t baud)
+{
+  ModemLinkRate rate;
+  memset(&rate, 0, sizeof(rate));
+  rate.baud = baud;
+  uint32_t lineErrors = _uart.lineErrors();
+  uint32_t overflows = _uart.driverOverflows() + _uart.overflowBytes();
+
+  bool ok = _command("ATE1", MODEM_LINK_TIMEOUT); // the echo test needs the modem to echo
+  uint64_t rttTotal = 0;
+  for (int i = 0; ok && i < MODEM_LINK_RTT_ROUNDS; i++)
+  {
+    unsigned long started = micros();
+    ok = _command("AT", MODEM_LINK_TIMEOUT);
+    uint32_t rtt = micros() - started;
+    rttTotal += rtt;
+    if (rtt > rate.rttMaxUs)
+    {
+      rate.rttMaxUs = rtt;
+    }
+  }
+  rate.rttMeanUs = (uint32_t)(rttTotal / MODEM_LINK_RTT_ROUNDS);
+
+  char echo[3 + 2 * MODEM_LINK_ECHO_PAIRS];
+  strcpy(echo, "AT");
+  for (int i = 0; i < MODEM_LINK_ECHO_PAIRS; i++)
+  {
+    strcat(echo, "E1");
+  }
+  uint64_t moved = 0;
+  unsigned long started = micros();
+  for (int i = 0; ok && i < MODEM_LINK_ECHO_ROUNDS; i++)
+  {
+    _uart.discardInput();
+    uint32_t before = _uart.received();
+    _uart.print(echo);
+    _uart.write('\r');
+    unsigned long deadline = millis() + MODEM_LINK_TIMEOUT;
+    char line[MODEM_LINK_LINE];
+    bool echoed = false;
+    ok = false;
+    while (_readLine(line, sizeof(line), deadline))
+    {
+      if (strcmp(line, echo) == 0)
+      {
+        echoed = true;
+      }
+      else if (strcmp(line, "OK") == 0)
+      {
+        ok = echoed; // OK without an intact echo means bytes were garbled on the way
+        break;
+      }
+      else if (strcmp(line, "ERROR") == 0)
+      {
+        break;
+      }
+    }
+    moved += strlen(echo) + 1 + (_uart.received() - before);
+  }
+  uint32_t elapsed = micros() - started;
+  rate.bytesPerSecond = elapsed == 0 ? 0 : (uint32_t)(moved * 1000000 / elapsed);
+
+  rate.ok = ok && _uart.lineErrors() == lineErrors &&
+            _uart.driverOverflows() + _uart.overflowBytes() == overflows;
+  if (_rateCount < MODEM_LINK_REPORTS)
+  {
+    _rates[_rateCount++] = rate;
+  }
+  return rate.ok;
+}
+
+// Ask the modem for a new rate and follow it, false when it refused
+bool ModemLink::_switchTo(uint32_t baud)
+{
+  char command[24];
+  snprintf(command, sizeof(command), "AT+IPR=%u", (unsigned)baud);
+  if (!_command(command, MODEM_LINK_TIMEOUT)) // the OK still comes at the old rate
+  {
+    Serial.printf("Modem link: %u baud refused.\n", (unsigned)baud);
+    return false;
+  }
+  _uart.setBaud(baud);
+  delay(MODEM_LINK_SETTLE_MS);
+  return true;
+}
+
+// Put the modem back on a rate after the current one failed its test
+bool ModemLink::_moveBack(uint32_t baud)
+{
+  char command[24];
+  snprintf(command, sizeof(command), "AT+IPR=%u", (unsigned)baud);
+  // The link is unreliable, so the reply is not trusted; the probe at the old rate decides
+  _command(command, MODEM_LINK_TIMEOUT);
+  _uart.setBaud(baud);
+  delay(MODEM_LINK_SETTLE_MS);
+  if (_probe())
+  {
+    return true;
+  }
+  return autobaud(baud);
+}
+
+uint32_t ModemLink::negotiate(uint32_t maxBaud)
+{
+  uint32_t initial = baud();
+  bool ok = _measure(initial);
+  for (size_t i = 0; i < sizeof(MODEM_LINK_RATES) / sizeof(MODEM_LINK_RATES[0]); i++)
+  {
+    uint32_t rate = MODEM_LINK_RATES[i];
+    uint32_t current = baud();
+    if (rate > maxBaud || rate == current)
+    {
+      continue;
+    }
+    if (ok && rate < current)
+    {
+      break; // nothing faster left
+    }
+    if (!_switchTo(rate))
+    {
+      continue;
+    }
+    if (_measure(rate))
+    {
+      ok = true;
+      break;
+    }
+    Serial.printf("Modem link: %u baud failed the echo test, back to %u.\n", (unsigned)rate, (unsigned)current);
+    if (!_moveBack(current))
+    {
+      break;
+    }
+  }
+  if (baud() != initial && !_command("AT&W", MODEM_LINK_TIMEOUT))
+  {
+    Serial.println("Modem link: rate could not be saved in the modem.");
+  }
+  return baud();
+}
+
+void ModemLink::printReport(Print &out) const
+{
+  out.printf("Modem link: %u baud\n", (unsigned)baud());
+  out.printf("  %7s  %15s  %16s\n", "baud", "AT rtt mean/max", "echo throughput");
+  for (uint8_t i = 0; i < _rateCount; i++)
+  {
+    const ModemLinkRate &rate = _rates[i];
+    // 10 bits per byte on an 8N1 line
+    unsigned load = (unsigned)((uint64_t)rate.bytesPerSecond * 10 * 100 / rate.baud);
+    out.printf("  %7u  %5u.%u/%u.%u ms  %7u B/s %3u%%  %s\n", (unsigned)rate.baud, (unsigned)(rate.rttMeanUs / 1000),
+               (unsigned)(rate.rttMeanUs / 100 % 10), (unsigned)(rate.rttMaxUs / 1000),
+               (unsigned)(rate.rttMaxUs / 100 % 10), (unsigned)rate.bytesPerSecond, load,
+               rate.ok ? "ok" : "failed");
+  }
+}
@@ -0,0 +1,82 @@
+/*
+ * Link setup between the ESP32 and the SIM808 UART.
+ *
+ * Runs on the bring-up task before the AT engine owns the port:
+ *
+ * 1. autobaud() finds the rate the modem answers "AT" on, the stored rate
+ *    first. A SIM808 left in autobaud mode locks onto the first rate it
+ *    sees, a fixed one is found by the scan.
+ * 2. negotiate() measures the current rate, then switches the modem with
+ *    AT+IPR to each faster rate of MODEM_LINK_RATES, fastest first. A rate
+ *    is kept only when every echo round comes back byte for byte with no
+ *    framing error or overflow; otherwise the modem is put back on the
+ *    previous rate and the next lower one is tried. When the current rate
+ *    fails its own test, the lower rates down to the factory one are
+ *    tried too. A new rate is stored in the modem with AT&W, the caller
+ *    keeps it in NVS.
+ *
+ * Every measured rate is kept for printReport(): AT round trip (mean and
+ * worst) and the throughput of the echo rounds, bytes sent plus bytes
+ * received per second. Replies are polled once a millisecond, so round
+ * trips are good to about 1 ms.
+ */
+
+#ifndef ModemLink_h
+#define ModemLink_h
+
+#include "Arduino.h"
+#include "ModemUart.h"
+
+#define MODEM_LINK_DEFAULT_BAUD 9600 // factory setting of the SIM808, autobaud
+#define MODEM_LINK_PROBES 3          // "AT" sent per rate while scanning
+#define MODEM_LINK_PROBE_TIMEOUT 150 // ms for the OK of one probe
+#define MODEM_LINK_TIMEOUT 500       // ms for any other command
+#define MODEM_LINK_SETTLE_MS 50      // after the modem switched its rate
+#define MODEM_LINK_RTT_ROUNDS 8
+#define MODEM_LINK_ECHO_ROUNDS 8
+#define MODEM_LINK_ECHO_PAIRS 30     // "E1" repeated in the echo command, 62 characters
+#define MODEM_LINK_REPORTS 8
+
+// Rates tried by negotiate(), fastest first, the last one is the fallback
+const uint32_t MODEM_LINK_RATES[] = {460800, 230400, 115200, MODEM_LINK_DEFAULT_BAUD};
+// Rates scanned by autobaud() after the stored one
+const uint32_t MODEM_LINK_SCAN[] = {MODEM_LINK_DEFAULT_BAUD, 115200, 460800, 230400, 57600, 38400, 19200};
+
+struct ModemLinkRate
+{
+  uint32_t baud;
+  bool ok;
+  uint32_t rttMeanUs;
+  uint32_t rttMaxUs;
+  uint32_t bytesPerSecond; // both directions
+};
+
+class ModemLink
+{
+public:
+  ModemLink(ModemUart &uart);
+
+  // Find the modem, at storedBaud first (0 for none). False when no rate answers.
+  bool autobaud(uint32_t storedBaud);
+
+  // Move to the fastest rate up to maxBaud that passes the echo test, returns the rate in use
+  uint32_t negotiate(uint32_t maxBaud);
+
+  uint32_t baud() const { return _uart.baud(); }
+
+  void printReport(Print &out) const;
+
+private:
+  bool _probe();
+  bool _command(const char *command, uint32_t timeoutMs);
+  bool _readLine(char *line, size_t size, unsigned long deadline);
+  bool _measure(uint32_t baud);
+  bool _switchTo(uint32_t baud);
+  bool _moveBack(uint32_t baud);
+
+  ModemUart &_uart;
+  ModemLinkRate _rates[MODEM_LINK_REPORTS];
+  uint8_t _rateCount;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "ModemPower.h"
+
+static const char *STATE_NAMES[] = {"awake", "waking", "asleep"};
+static const char *START_NAMES[] = {"hot", "warm", "cold"};
+static const uint32_t DEFAULT_WARMUP[] = {GNSS_HOT_WARMUP, GNSS_WARM_WARMUP, GNSS_COLD_WARMUP};
+
+ModemPower::ModemPower()
+{
+  _started = false;
+  _enabled = false;
+  _wakeRequested = false;
+  _state = MODEM_AWAKE;
+  _since = 0;
+  _workSeen = 0;
+  _gnssOn = false;
+  _gnssSince = 0;
+  _haveFix = false;
+  _lastFix = 0;
+  _acquiring = false;
+  _start = GNSS_COLD;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void ModemPower::begin(unsigned long now)
+{
+  _state = MODEM_AWAKE;
+  _since = now;
+  _workSeen = now;
+  _gnssSince = now;
+  _started = true;
+}
+
+void ModemPower::_enter(ModemPowerState state, unsigned long now)
+{
+  _stats.msIn[_state] += now - _since;
+  _state = state;
+  _since = now;
+}
+
+ModemPowerAction ModemPower::update(unsigned long now, uint32_t msUntilWork)
+{
+  if (!_started)
+  {
+    return MODEM_POWER_NONE;
+  }
+  bool wake = _wakeRequested;
+  if (msUntilWork == 0)
+  {
+    _workSeen = now;
+  }
+
+  switch (_state)
+  {
+  case MODEM_AWAKE:
+    if (wake)
+    {
+      _wakeRequested = false;
+      _workSeen = now; // an event while awake counts as work
+      return MODEM_POWER_NONE;
+    }
+    if (_enabled && now - _workSeen >= MODEM_SLEEP_IDLE && msUntilWork >= MODEM_SLEEP_MIN)
+    {
+      _stats.sleeps++;
+      _enter(MODEM_ASLEEP, now);
+      return MODEM_POWER_SLEEP;
+    }
+    return MODEM_POWER_NONE;
+
+  case MODEM_ASLEEP:
+    if (wake || !_enabled || msUntilWork <= MODEM_WAKE_LEAD)
+    {
+      if (wake)
+      {
+        _stats.eventWakes++;
+      }
+      else
+      {
+        _stats.scheduledWakes++;
+      }
+      _wakeRequested = false;
+      _enter(MODEM_WAKING, now);
+      return MODEM_POWER_WAKE;
+    }
+    return MODEM_POWER_NONE;
+
+  case MODEM_WAKING:
+    if (now - _since >= MODEM_DTR_WAKE_MS)
+    {
+      _stats.wakeMs += now - _since;
+      _enter(MODEM_AWAKE, now);
+      _workSeen = now; // give the work that woke it time to start
+      return MODEM_POWER_READY;
+    }
+    return MODEM_POWER_NONE;
+
+  default:
+    return MODEM_POWER_NONE;
+  }
+}
+
+void ModemPower::onGNSSPower(bool on, unsigned long now)
+{
+  if (on == _gnssOn)
+  {
+    return;
+  }
+  if (_gnssOn)
+  {
+    _stats.gnssOnMs += now - _gnssSince;
+  }
+  else
+  {
+    _stats.gnssOffMs += now - _gnssSince;
+  }
+  _gnssOn = on;
+  _gnssSince = now;
+  _acquiring = on;
+  if (on)
+  {
+    _stats.gnssStarts++;
+    _start = startAt(now);
+  }
+}
+
+void ModemPower::onGNSSFix(bool valid, unsigned long now)
+{
+  if (!valid)
+  {
+    return;
+  }
+  if (_acquiring)
+  {
+    _acquiring = false;
+    uint32_t ms = now - _gnssSince;
+    GNSSStartStats &start = _stats.starts[_start];
+    start.count++;
+    start.totalMs += ms;
+    if (ms > start.maxMs)
+    {
+      start.maxMs = ms;
+    }
+    // Rise at once, fall slowly: a late fix costs more than a few seconds of GNSS current
+    if (start.learnedMs == 0 || ms > start.learnedMs)
+    {
+      start.learnedMs = ms;
+    }
+    else
+    {
+      start.learnedMs -= (start.learnedMs - ms) / 4;
+    }
+  }
+  _haveFix = true;
+  _lastFix = now;
+}
+
+// Lead for a measured re-acquisition time
+static uint32_t leadFor(uint32_t learnedMs)
+{
+  uint32_t lead = learnedMs + GNSS_WARMUP_MARGIN;
+  if (lead < GNSS_WARMUP_MIN)
+    lead = GNSS_WARMUP_MIN;
+  if (lead > GNSS_WARMUP_MAX)
+    lead = GNSS_WARMUP_MAX;
+  return lead;
+}
+
+GNSSStart ModemPower::startAt(unsigned long at) const
+{
+  if (!_haveFix)
+  {
+    return GNSS_COLD;
+  }
+  return at - _lastFix <= GNSS_HOT_WINDOW ? GNSS_HOT : GNSS_WARM;
+}
+
+uint32_t ModemPower::warmup(unsigned long at) const
+{
+  GNSSStart start = startAt(at);
+  uint32_t learned = _stats.starts[start].learnedMs;
+  if (learned == 0)
+  {
+    return DEFAULT_WARMUP[start];
+  }
+  return leadFor(learned);
+}
+
+void ModemPower::printStats(Print &out, unsigned long now) const
+{
+  uint32_t ms[MODEM_POWER_STATE_COUNT];
+  uint32_t total = 0;
+  for (uint8_t s = 0; s < MODEM_POWER_STATE_COUNT; s++)
+  {
+    ms[s] = _stats.msIn[s] + (_started && s == _state ? now - _since : 0);
+    total += ms[s];
+  }
+  uint32_t wakes = _stats.scheduledWakes + _stats.eventWakes;
+  out.printf("Modem power: %s, sleep %s, %u sleeps, %u scheduled and %u event wakes, %u ms mean wake\n",
+             STATE_NAMES[_state], _enabled ? "on" : "off", (unsigned)_stats.sleeps,
+             (unsigned)_stats.scheduledWakes, (unsigned)_stats.eventWakes,
+             (unsigned)(wakes == 0 ? 0 : _stats.wakeMs / wakes));
+  for (uint8_t s = 0; s < MODEM_POWER_STATE_COUNT; s++)
+  {
+    unsigned permille = total == 0 ? 0 : (unsigned)((uint64_t)ms[s] * 1000 / total);
+    out.printf("Modem power: %-6s %u s (%u.%u%%)\n", STATE_NAMES[s], (unsigned)(ms[s] / 1000), permille / 10,
+               permille % 10);
+  }
+
+  uint32_t onMs = _stats.gnssOnMs + (_started && _gnssOn ? now - _gnssSince : 0);
+  uint32_t offMs = _stats.gnssOffMs + (_started && !_gnssOn ? now - _gnssSince : 0);
+  out.printf("GNSS power: on %u s, off %u s, %u power-ups\n", (unsigned)(onMs / 1000), (unsigned)(offMs / 1000),
+             (unsigned)_stats.gnssStarts);
+  for (uint8_t s = 0; s < GNSS_START_COUNT; s++)
+  {
+    const GNSSStartStats &start = _stats.starts[s];
+    if (start.count == 0)
+    {
+      continue;
+    }
+    out.printf("GNSS %s start: %u re-acquired, %u ms mean, %u ms max, %u ms lead\n", START_NAMES[s],
+               (unsigned)start.count, (unsigned)(start.totalMs / start.count), (unsigned)start.maxMs,
+               (unsigned)leadFor(start.learnedMs));
+  }
+}
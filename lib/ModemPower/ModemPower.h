@@ -0,0 +1,149 @@
+/*
+ * SIM808 sleep and GNSS re-acquisition manager.
+ *
+ * Modem: with AT+CSCLK=1 the SIM808 sleeps while DTR is high and its UART
+ * is idle, and is ready again MODEM_DTR_WAKE_MS after DTR goes low. The
+ * manager lets it sleep once the link has been quiet for MODEM_SLEEP_IDLE
+ * and the caller's next piece of work is at least MODEM_SLEEP_MIN away.
+ * It wakes it MODEM_WAKE_LEAD ahead of that work, or at once on
+ * requestWake(), e.g. from the RI line or when a command is queued.
+ * Nothing is sent while the modem sleeps, so every byte reaches an awake
+ * UART.
+ *
+ * GNSS: each power-up is classified by the age of the last valid fix:
+ * hot within GNSS_HOT_WINDOW (ephemeris still valid), warm after that and
+ * cold when there has been no fix since boot. The time from power-up to
+ * the first valid fix is measured per class, and warmup() gives the lead
+ * a power-up needs to have a fix ready when it is due. The lead starts at
+ * a datasheet-based default. Every measurement raises it at once if the
+ * start was slow, and lowers it a quarter of the way towards a fast one.
+ *
+ * Like PowerGovernor, the manager only decides and keeps time; the caller
+ * drives DTR, holds the AT engine and sends the AT commands.
+ */
+
+#ifndef ModemPower_h
+#define ModemPower_h
+
+#include "Arduino.h"
+
+#define MODEM_SLEEP_IDLE 2000        // ms without work before the modem may sleep
+#define MODEM_SLEEP_MIN 10000        // shorter gaps are not worth a sleep
+#define MODEM_WAKE_LEAD 500          // wake this long before scheduled work
+#define MODEM_DTR_WAKE_MS 60         // DTR low to UART ready, 50 ms in the SIM808 manual
+#define GNSS_HOT_WINDOW 7200000UL    // ms after a fix a restart counts as hot
+#define GNSS_HOT_WARMUP 15000        // leads before the first measurement
+#define GNSS_WARM_WARMUP 35000
+#define GNSS_COLD_WARMUP 45000
+#define GNSS_WARMUP_MARGIN 2000      // added to the measured re-acquisition time
+#define GNSS_WARMUP_MIN 3000
+#define GNSS_WARMUP_MAX 90000
+
+enum ModemPowerState
+{
+  MODEM_AWAKE,
+  MODEM_WAKING,  // DTR low, waiting for the UART
+  MODEM_ASLEEP,
+  MODEM_POWER_STATE_COUNT
+};
+
+// What the caller has to do after update()
+enum ModemPowerAction
+{
+  MODEM_POWER_NONE,
+  MODEM_POWER_SLEEP, // hold the AT engine, then DTR high
+  MODEM_POWER_WAKE,  // DTR low
+  MODEM_POWER_READY  // release the AT engine
+};
+
+enum GNSSStart
+{
+  GNSS_HOT,
+  GNSS_WARM,
+  GNSS_COLD,
+  GNSS_START_COUNT
+};
+
+struct GNSSStartStats
+{
+  uint32_t count;   // re-acquisitions measured
+  uint32_t totalMs;
+  uint32_t maxMs;
+  uint32_t learnedMs; // 0 until the first measurement
+};
+
+struct ModemPowerStats
+{
+  uint32_t msIn[MODEM_POWER_STATE_COUNT];
+  uint32_t sleeps;
+  uint32_t scheduledWakes;
+  uint32_t eventWakes;
+  uint32_t wakeMs;       // total DTR-low to ready time
+  uint32_t gnssOnMs;
+  uint32_t gnssOffMs;
+  uint32_t gnssStarts;   // power-ups, measured or not
+  GNSSStartStats starts[GNSS_START_COUNT];
+};
+
+class ModemPower
+{
+public:
+  ModemPower();
+
+  void begin(unsigned long now);
+
+  // AT+CSCLK=1 is in force; while false the modem is kept awake
+  void setEnabled(bool on) { _enabled = on; }
+  bool isEnabled() const { return _enabled; }
+
+  /*
+   * Advance the modem state, called every few ms by the task owning the UART.
+   * @param msUntilWork, time until the next scheduled exchange with the modem, 0 for now
+   */
+  ModemPowerAction update(unsigned long now, uint32_t msUntilWork);
+
+  // Wake the modem on the next update(), safe from an ISR
+  void requestWake() { _wakeRequested = true; }
+
+  ModemPowerState state() const { return _state; }
+  bool isAwake() const { return _state == MODEM_AWAKE; }
+
+  // The GNSS engine was switched on or off
+  void onGNSSPower(bool on, unsigned long now);
+
+  // A sentence or +CGNSINF record arrived, valid or not. Feed it at least once a
+  // second while isAcquiring(), a sample taken later only ever raises the lead.
+  void onGNSSFix(bool valid, unsigned long now);
+
+  // Powered up, no valid fix yet
+  bool isAcquiring() const { return _acquiring; }
+
+  // Kind of start a power-up at the given time would be
+  GNSSStart startAt(unsigned long at) const;
+
+  // Lead a power-up at the given time needs so a fix is ready when due
+  uint32_t warmup(unsigned long at) const;
+
+  const ModemPowerStats &stats() const { return _stats; }
+  void printStats(Print &out, unsigned long now) const;
+
+private:
+  void _enter(ModemPowerState state, unsigned long now);
+
+  bool _started;
+  bool _enabled;
+  volatile bool _wakeRequested;
+  ModemPowerState _state;
+  unsigned long _since;       // entered _state
+  unsigned long _workSeen;    // last time work was due now
+
+  bool _gnssOn;
+  unsigned long _gnssSince;
+  bool _haveFix;
+  unsigned long _lastFix;     // last valid fix
+  bool _acquiring;            // powered up, no valid fix yet
+  GNSSStart _start;           // class of the power-up being measured
+  ModemPowerStats _stats;
+};
+
+#endif
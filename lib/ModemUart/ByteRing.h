@@ -0,0 +1,138 @@
+/*
+ * Lock-free single-producer / single-consumer byte ring.
+ *
+ * One task writes, one task reads, nothing is locked and nothing is
+ * copied twice: the producer fills the contiguous free span in place
+ * (writeSpan/commit) and the consumer parses the contiguous filled span in
+ * place (readSpan/consume). Head and tail are free-running 32-bit
+ * counters, published with release stores and read with acquire loads;
+ * each sits on its own cache line so the two sides never share one.
+ *
+ * Bytes that do not fit are dropped and counted, never overwritten, so
+ * the consumer always sees a prefix of what arrived. This header only
+ * needs the compiler, so the ring can be stress tested on the host.
+ */
+
+#ifndef ByteRing_h
+#define ByteRing_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BYTE_RING_ALIGN 64 // cache line of the host, more than the ESP32 needs
+
+template <size_t CAPACITY>
+class ByteRing
+{
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "ByteRing capacity must be a power of two");
+
+public:
+  ByteRing() : _head(0), _highWater(0), _overflow(0), _tail(0) {}
+
+  // Producer side
+
+  // Contiguous free space, length 0 when the ring is full
+  uint8_t *writeSpan(size_t &length)
+  {
+    uint32_t head = _head; // only the producer writes it
+    uint32_t free = CAPACITY - (head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE));
+    uint32_t offset = head & (CAPACITY - 1);
+    length = free < CAPACITY - offset ? free : CAPACITY - offset;
+    return _data + offset;
+  }
+
+  // Publish length bytes written into the last writeSpan()
+  void commit(size_t length)
+  {
+    uint32_t head = _head + (uint32_t)length;
+    __atomic_store_n(&_head, head, __ATOMIC_RELEASE);
+    uint32_t used = head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    if (used > _highWater)
+    {
+      _highWater = used;
+    }
+  }
+
+  // Copy in as much as fits, the rest is counted as overflow
+  size_t push(const uint8_t *data, size_t length)
+  {
+    size_t stored = 0;
+    while (stored < length)
+    {
+      size_t span;
+      uint8_t *to = writeSpan(span);
+      if (span == 0)
+      {
+        break;
+      }
+      if (span > length - stored)
+      {
+        span = length - stored;
+      }
+      memcpy(to, data + stored, span);
+      commit(span);
+      stored += span;
+    }
+    _overflow += (uint32_t)(length - stored);
+    return stored;
+  }
+
+  // Count bytes the producer had to throw away before they reached the ring
+  void dropped(size_t length) { _overflow += (uint32_t)length; }
+
+  // Consumer side
+
+  size_t size() const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - _tail; }
+
+  // Contiguous filled space, length 0 when the ring is empty
+  const uint8_t *readSpan(size_t &length) const
+  {
+    uint32_t tail = _tail; // only the consumer writes it
+    uint32_t used = __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - tail;
+    uint32_t offset = tail & (CAPACITY - 1);
+    length = used < CAPACITY - offset ? used : CAPACITY - offset;
+    return _data + offset;
+  }
+
+  // Release length bytes of the last readSpan() to the producer
+  void consume(size_t length) { __atomic_store_n(&_tail, _tail + (uint32_t)length, __ATOMIC_RELEASE); }
+
+  // One byte, -1 when empty
+  int pop()
+  {
+    size_t length;
+    const uint8_t *from = readSpan(length);
+    if (length == 0)
+    {
+      return -1;
+    }
+    uint8_t c = *from;
+    consume(1);
+    return c;
+  }
+
+  int peek() const
+  {
+    size_t length;
+    const uint8_t *from = readSpan(length);
+    return length == 0 ? -1 : *from;
+  }
+
+  // Statistics, written by the producer
+
+  size_t capacity() const { return CAPACITY; }
+  size_t highWater() const { return _highWater; }
+  uint32_t overflow() const { return _overflow; }
+
+private:
+  // Producer line
+  alignas(BYTE_RING_ALIGN) volatile uint32_t _head;
+  uint32_t _highWater;
+  uint32_t _overflow;
+  // Consumer line
+  alignas(BYTE_RING_ALIGN) volatile uint32_t _tail;
+  alignas(BYTE_RING_ALIGN) uint8_t _data[CAPACITY];
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "ModemUart.h"
+
+ModemUart::ModemUart(uart_port_t port)
+{
+  _port = port;
+  _baud = 0;
+  _events = NULL;
+  _taskHandle = NULL;
+  _received = 0;
+  _driverOverflows = 0;
+  _lineErrors = 0;
+}
+
+bool ModemUart::begin(uint32_t baud, int8_t rxPin, int8_t txPin, UBaseType_t priority, BaseType_t core)
+{
+  if (_taskHandle != NULL)
+  {
+    setBaud(baud);
+    return true;
+  }
+  uart_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.baud_rate = baud;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_1;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  config.source_clk = UART_SCLK_APB;
+  if (uart_param_config(_port, &config) != ESP_OK ||
+      uart_set_pin(_port, txPin, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK ||
+      uart_driver_install(_port, MODEM_UART_DRIVER_RX, MODEM_UART_DRIVER_TX, MODEM_UART_EVENTS, &_events, 0) != ESP_OK)
+  {
+    Serial.println("Modem UART: driver could not be installed.");
+    return false;
+  }
+  _baud = baud;
+  return xTaskCreatePinnedToCore(_task, "ModemRx", MODEM_UART_TASK_STACK, this, priority, &_taskHandle, core) == pdPASS;
+}
+
+void ModemUart::setBaud(uint32_t baud)
+{
+  uart_wait_tx_done(_port, pdMS_TO_TICKS(100)); // do not garble the command still going out
+  uart_set_baudrate(_port, baud);
+  _baud = baud;
+}
+
+void ModemUart::_task(void *uart)
+{
+  ModemUart *self = (ModemUart *)uart;
+  bool backlog = false;
+  for (;;)
+  {
+    uart_event_t event;
+    if (xQueueReceive(self->_events, &event, backlog ? pdMS_TO_TICKS(MODEM_UART_RETRY_MS) : portMAX_DELAY) == pdTRUE)
+    {
+      switch (event.type)
+      {
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        self->_driverOverflows = self->_driverOverflows + 1;
+        break;
+      case UART_FRAME_ERR:
+      case UART_PARITY_ERR:
+      case UART_BREAK:
+        self->_lineErrors = self->_lineErrors + 1;
+        break;
+      default:
+        break;
+      }
+    }
+    // Whatever the event was, move everything the driver holds
+    backlog = !self->_drain();
+  }
+}
+
+// Moves the driver's buffered bytes into the ring, false when the ring filled up first
+bool ModemUart::_drain()
+{
+  size_t pending = 0;
+  if (uart_get_buffered_data_len(_port, &pending) != ESP_OK)
+  {
+    return true;
+  }
+  while (pending > 0)
+  {
+    size_t span;
+    uint8_t *to = _ring.writeSpan(span);
+    if (span == 0)
+    {
+      return false;
+    }
+    int got = uart_read_bytes(_port, to, span < pending ? span : pending, 0);
+    if (got <= 0)
+    {
+      break;
+    }
+    _ring.commit(got);
+    _received = _received + got;
+    pending -= got;
+  }
+  return true;
+}
+
+int ModemUart::available()
+{
+  return (int)_ring.size();
+}
+
+int ModemUart::read()
+{
+  return _ring.pop();
+}
+
+int ModemUart::peek()
+{
+  return _ring.peek();
+}
+
+size_t ModemUart::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t ModemUart::write(const uint8_t *data, size_t length)
+{
+  int sent = uart_write_bytes(_port, (const char *)data, length);
+  return sent < 0 ? 0 : (size_t)sent;
+}
+
+void ModemUart::flush()
+{
+  uart_wait_tx_done(_port, portMAX_DELAY);
+}
+
+void ModemUart::discardInput()
+{
+  size_t length;
+  while (readSpan(length), length > 0)
+  {
+    consume(length);
+  }
+}
+
+void ModemUart::printStats(Print &out) const
+{
+  out.printf("Modem UART: %u baud, %u bytes in, ring high water %u/%u, %u bytes dropped, %u driver overflows, "
+             "%u line errors\n",
+             (unsigned)_baud, (unsigned)_received, (unsigned)_ring.highWater(), (unsigned)_ring.capacity(),
+             (unsigned)_ring.overflow(), (unsigned)_driverOverflows, (unsigned)_lineErrors);
+}
@@ -0,0 +1,83 @@
+/*
+ * SIM808 UART on the ESP-IDF driver.
+ *
+ * A dedicated task blocks on the driver's event queue and moves received
+ * bytes straight from the driver into a ByteRing. The modem task is the
+ * only reader: the link setup and the AT engine read it through the Stream
+ * interface, which never waits on the UART, and parsers that can work on
+ * a buffer take the bytes in place with readSpan()/consume().
+ *
+ * When the reader falls behind and the ring is full, bytes stay in the
+ * driver buffer and the RX task retries every MODEM_UART_RETRY_MS, so the
+ * driver buffer adds to the ring before anything is lost. Losses in the
+ * driver, in the ring and on the line are counted separately.
+ */
+
+#ifndef ModemUart_h
+#define ModemUart_h
+
+#include "Arduino.h"
+#include <driver/uart.h>
+#include "ByteRing.h"
+
+#define MODEM_UART_RING 2048       // bytes between the RX task and the modem task
+#define MODEM_UART_DRIVER_RX 1024  // IDF driver buffer between the ISR and the RX task
+#define MODEM_UART_DRIVER_TX 512
+#define MODEM_UART_EVENTS 16
+#define MODEM_UART_RETRY_MS 5      // ring full, try again this soon
+#define MODEM_UART_TASK_STACK 2560 // bytes
+
+class ModemUart : public Stream
+{
+public:
+  ModemUart(uart_port_t port);
+
+  // Install the driver and start the RX task
+  bool begin(uint32_t baud, int8_t rxPin, int8_t txPin, UBaseType_t priority, BaseType_t core);
+
+  void setBaud(uint32_t baud);
+  uint32_t baud() const { return _baud; }
+
+  // RX task, NULL before begin()
+  TaskHandle_t taskHandle() const { return _taskHandle; }
+
+  // Stream, reader side only from the modem task
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *data, size_t length) override;
+  using Print::write;
+  void flush() override; // waits until the TX FIFO is empty
+
+  // In-place access for parsers, see ByteRing
+  const uint8_t *readSpan(size_t &length) const { return _ring.readSpan(length); }
+  void consume(size_t length) { _ring.consume(length); }
+
+  // Drop everything received so far, reader side
+  void discardInput();
+
+  uint32_t received() const { return _received; }
+  uint32_t overflowBytes() const { return _ring.overflow(); }
+  uint32_t driverOverflows() const { return _driverOverflows; }
+  uint32_t lineErrors() const { return _lineErrors; }
+  size_t highWater() const { return _ring.highWater(); }
+  void printStats(Print &out) const;
+
+private:
+  static void _task(void *uart);
+  bool _drain();
+
+  uart_port_t _port;
+  uint32_t _baud;
+  QueueHandle_t _events;
+  TaskHandle_t _taskHandle;
+  ByteRing<MODEM_UART_RING> _ring;
+
+  // Written by the RX task
+  volatile uint32_t _received;
+  volatile uint32_t _driverOverflows; // FIFO or driver buffer overflowed, bytes were lost before the ring
+  volatile uint32_t _lineErrors;      // framing, parity and break conditions
+};
+
+#endif
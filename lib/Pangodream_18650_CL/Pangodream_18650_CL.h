@@ -35,6 +35,38 @@
 #define DEF_CONV_FACTOR 1.7
 #define DEF_READS 20
 
+/*
+ * Charge curve of a cell: MILLIVOLTS[i] is the open circuit voltage at
+ * i * 100 / (POINTS - 1) percent, strictly rising. A curve for another
+ * chemistry or vendor is a struct with the same two members, plus an
+ * out-of-line definition of MILLIVOLTS in one .cpp file. The table is
+ * constexpr, so it stays in flash.
+ */
+struct Pangodream_18650_Curve {
+    static constexpr uint8_t POINTS = 101;
+    static constexpr uint16_t MILLIVOLTS[POINTS] = {
+        3200,
+        3250, 3300, 3350, 3400, 3450, 3500, 3550, 3600, 3650, 3700,
+        3703, 3706, 3710, 3713, 3716, 3719, 3723, 3726, 3729, 3732,
+        3735, 3739, 3742, 3745, 3748, 3752, 3755, 3758, 3761, 3765,
+        3768, 3771, 3774, 3777, 3781, 3784, 3787, 3790, 3794, 3797,
+        3800, 3805, 3811, 3816, 3821, 3826, 3832, 3837, 3842, 3847,
+        3853, 3858, 3863, 3868, 3874, 3879, 3884, 3889, 3895, 3900,
+        3906, 3911, 3917, 3922, 3928, 3933, 3939, 3944, 3950, 3956,
+        3961, 3967, 3972, 3978, 3983, 3989, 3994, 4000, 4008, 4015,
+        4023, 4031, 4038, 4046, 4054, 4062, 4069, 4077, 4085, 4092,
+        4100, 4111, 4122, 4133, 4144, 4156, 4167, 4178, 4189, 4200};
+};
+
+/*
+ * True when every point of the curve is above the previous one
+ */
+template <class Curve>
+constexpr bool curveRises(uint8_t i = 1)
+{
+    return i >= Curve::POINTS || (Curve::MILLIVOLTS[i] > Curve::MILLIVOLTS[i - 1] && curveRises<Curve>(i + 1));
+}
+
 /*
  * 18650 Ion-Li battery charge
  * Calculates charge level of an 18650 Ion-Li battery
@@ -72,23 +104,51 @@ class Pangodream_18650_CL {
      * @return The calculated battery charge level
      */
     int getBatteryChargeLevel();
+    /*
+     * Get the charge level (0-100) for a voltage measured elsewhere
+     * @param volts, Battery voltage
+     */
+    int getChargeLevelForVolts(double volts);
+    /*
+     * Get the charge level in tenths of a percent (0-1000), interpolated
+     * between the points of the curve
+     * @param millivolts, Battery voltage
+     */
+    int getChargeTenthsForMillivolts(uint16_t millivolts) const;
     double getBatteryVolts();
     int getAnalogPin();
     int pinRead();
     double getConvFactor();
+
+  protected:
+    Pangodream_18650_CL(int addressPin, double convFactor, int reads, const uint16_t *curve, uint8_t points);
        
   private:
 
     int    _addressPin;               //!< ADC pin used, default is GPIO34 - ADC1_6
     int    _reads;                    //Number of reads of ADC pin to calculate an average value
     double _convFactor;               //!< Convertion factor to translate analog units to volts
-    double _vs[101];                 //Array with voltage - charge definitions
+    const uint16_t *_curve;           //Charge curve in flash, millivolts per step
+    uint8_t _points;
     
-    void   _initVoltsArray();
     int    _getChargeLevel(double volts);
     int    _analogRead(int pinNumber);
     double _analogReadToVolts(int readValue);
     
 };
 
-#endif
\ No newline at end of file
+/*
+ * Same battery with the charge curve picked at compile time, e.g.
+ * Pangodream_18650_CL_T<MyCellCurve> BL(34, 1.8, 20);
+ */
+template <class Curve>
+class Pangodream_18650_CL_T : public Pangodream_18650_CL {
+    static_assert(Curve::POINTS >= 2, "a charge curve needs two points");
+    static_assert(curveRises<Curve>(), "charge curve voltages must rise strictly");
+
+  public:
+    Pangodream_18650_CL_T(int addressPin = DEF_PIN, double convFactor = DEF_CONV_FACTOR, int reads = DEF_READS)
+        : Pangodream_18650_CL(addressPin, convFactor, reads, Curve::MILLIVOLTS, Curve::POINTS) {}
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "PartialSSD1306.h"
+#include <Wire.h>
+
+// Largest I2C write the Wire buffer takes, the address byte not counted
+#if defined(I2C_BUFFER_LENGTH)
+#define PARTIAL_WIRE_MAX (I2C_BUFFER_LENGTH < 256 ? I2C_BUFFER_LENGTH : 256)
+#else
+#define PARTIAL_WIRE_MAX 32
+#endif
+
+static const uint8_t CONTROL_COMMANDS = 0x00; // control byte ahead of a command list
+static const uint8_t CONTROL_DATA = 0x40;     // control byte ahead of display data
+
+PartialSSD1306::PartialSSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin)
+    : Adafruit_SSD1306(w, h, twi, rst_pin)
+{
+  _shadow = NULL;
+  _shadowValid = false;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+PartialSSD1306::~PartialSSD1306()
+{
+  free(_shadow);
+}
+
+bool PartialSSD1306::begin(uint8_t switchvcc, uint8_t i2caddr, bool reset, bool periphBegin)
+{
+  if (!Adafruit_SSD1306::begin(switchvcc, i2caddr, reset, periphBegin))
+  {
+    return false;
+  }
+  if (_shadow == NULL)
+  {
+    _shadow = (uint8_t *)malloc(WIDTH * ((HEIGHT + 7) / 8)); // without it every frame is sent whole
+  }
+  _shadowValid = false;
+  return true;
+}
+
+uint16_t PartialSSD1306::_sendCommands(const uint8_t *commands, uint8_t count)
+{
+  wire->beginTransmission(i2caddr);
+  wire->write(CONTROL_COMMANDS);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    wire->write(commands[i]);
+  }
+  wire->endTransmission();
+  return 2 + count;
+}
+
+uint16_t PartialSSD1306::_sendData(const uint8_t *data, uint16_t count)
+{
+  uint16_t sent = 0;
+  while (count > 0)
+  {
+    uint16_t chunk = count < PARTIAL_WIRE_MAX - 1 ? count : PARTIAL_WIRE_MAX - 1;
+    wire->beginTransmission(i2caddr);
+    wire->write(CONTROL_DATA);
+    wire->write(data, chunk);
+    wire->endTransmission();
+    sent += 2 + chunk;
+    data += chunk;
+    count -= chunk;
+  }
+  return sent;
+}
+
+/**
+ * One page address / column address pair and one data run per changed
+ * page. Two separate changes on the same page are sent as one run with
+ * the unchanged bytes between them; a second addressing round would cost
+ * about as much as the gap on a status bar.
+ */
+void PartialSSD1306::display()
+{
+  if (wire == NULL)
+  {
+    Adafruit_SSD1306::display(); // SPI panels keep the full refresh
+    return;
+  }
+  unsigned long start = micros();
+  uint16_t bytes = 0;
+  uint8_t pages = (HEIGHT + 7) / 8;
+  bool full = !_shadowValid || _shadow == NULL;
+
+  wire->setClock(wireClk);
+  for (uint8_t page = 0; page < pages; page++)
+  {
+    const uint8_t *row = buffer + page * WIDTH;
+    int16_t first = 0;
+    int16_t last = WIDTH - 1;
+    if (!full)
+    {
+      const uint8_t *shown = _shadow + page * WIDTH;
+      while (first < WIDTH && row[first] == shown[first])
+        first++;
+      if (first == WIDTH)
+        continue;
+      while (row[last] == shown[last])
+        last--;
+    }
+    const uint8_t addressing[] = {SSD1306_PAGEADDR, page, page, SSD1306_COLUMNADDR, (uint8_t)first, (uint8_t)last};
+    bytes += _sendCommands(addressing, sizeof(addressing));
+    bytes += _sendData(row + first, last - first + 1);
+    _stats.pagesSent++;
+  }
+  wire->setClock(restoreClk);
+
+  if (_shadow != NULL)
+  {
+    memcpy(_shadow, buffer, WIDTH * pages);
+    _shadowValid = true;
+  }
+  uint32_t elapsed = micros() - start;
+  _stats.frames++;
+  if (full)
+    _stats.fullFrames++;
+  _stats.bytes += bytes;
+  _stats.busMicros += elapsed;
+  _stats.lastBytes = bytes;
+  _stats.lastMicros = elapsed;
+}
+
+void PartialSSD1306::printStats(Print &out) const
+{
+  out.printf("Display: %u frames (%u full), %u pages, %u bytes on I2C, %u us sending\n",
+             (unsigned)_stats.frames, (unsigned)_stats.fullFrames, (unsigned)_stats.pagesSent,
+             (unsigned)_stats.bytes, (unsigned)_stats.busMicros);
+  if (_stats.frames > 0)
+  {
+    out.printf("Display: last frame %u bytes in %u us, %u bytes per frame on average\n",
+               (unsigned)_stats.lastBytes, (unsigned)_stats.lastMicros,
+               (unsigned)(_stats.bytes / _stats.frames));
+  }
+}
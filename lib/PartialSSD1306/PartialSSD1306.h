@@ -0,0 +1,57 @@
+/*
+ * SSD1306 driver that only sends what changed.
+ *
+ * Keeps a shadow copy of the panel's RAM. display() compares the frame
+ * buffer with it page by page and, for every page that differs, sends
+ * only the columns between the first and the last changed byte using the
+ * page and column address commands. A status bar update that touches the
+ * top page costs a few dozen bytes on I2C instead of the full 1 KB.
+ *
+ * The counters report the bytes put on the bus (address, control and
+ * command bytes included) and the time spent per frame.
+ */
+
+#ifndef PartialSSD1306_h
+#define PartialSSD1306_h
+
+#include <Adafruit_SSD1306.h>
+
+struct PartialSSD1306Stats
+{
+  uint32_t frames;       // display() calls
+  uint32_t fullFrames;   // frames sent whole (first frame, no shadow)
+  uint32_t pagesSent;
+  uint32_t bytes;        // I2C bytes over all frames
+  uint32_t busMicros;    // time spent sending
+  uint16_t lastBytes;    // I2C bytes of the last frame
+  uint32_t lastMicros;
+};
+
+class PartialSSD1306 : public Adafruit_SSD1306
+{
+public:
+  PartialSSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin = -1);
+  ~PartialSSD1306();
+
+  // Same as Adafruit_SSD1306::begin, plus the shadow buffer
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0, bool reset = true, bool periphBegin = true);
+
+  // Send the changed parts of the frame buffer
+  void display();
+
+  // Resend the whole frame on the next display(), e.g. after the panel was reset
+  void invalidate() { _shadowValid = false; }
+
+  const PartialSSD1306Stats &stats() const { return _stats; }
+  void printStats(Print &out) const;
+
+private:
+  uint16_t _sendCommands(const uint8_t *commands, uint8_t count);
+  uint16_t _sendData(const uint8_t *data, uint16_t count);
+
+  uint8_t *_shadow;     // what the panel shows
+  bool _shadowValid;
+  PartialSSD1306Stats _stats;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "PowerGovernor.h"
+
+// Draw figures are estimates for the whole device from the SIM808 and
+// SSD1306 datasheets: GPRS open, GNSS duty cycle following the GPS
+// interval, OLED at the given contrast. Replace them with bench numbers
+// when a board is measured.
+static const PowerSettings PROFILES[POWER_PROFILE_COUNT] = {
+    {"full", POWER_BALANCED_BELOW, 1000, 10, true, 0xCF, false, 180},
+    {"balanced", POWER_SAVER_BELOW, 5000, 20, true, 0x40, false, 125},
+    {"saver", POWER_CRITICAL_BELOW, 30000, 32, true, 0x01, true, 70},
+    {"critical", 0, 120000, 32, false, 0x01, true, 40}};
+
+PowerGovernor::PowerGovernor()
+{
+  _started = false;
+  _profile = POWER_FULL;
+  _since = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+const PowerSettings &PowerGovernor::settingsFor(PowerProfile profile)
+{
+  return PROFILES[profile];
+}
+
+PowerProfile PowerGovernor::_pick(uint8_t percent, bool charging) const
+{
+  if (charging)
+  {
+    return POWER_FULL;
+  }
+  uint8_t target = POWER_FULL;
+  while (percent < PROFILES[target].floorPercent)
+  {
+    target++; // the critical floor is 0, so this stops there
+  }
+  // Stepping up needs headroom; the thresholds are further apart than
+  // POWER_HYSTERESIS, so one step back down is enough
+  if (_started && target < _profile && percent < PROFILES[target].floorPercent + POWER_HYSTERESIS)
+  {
+    target++;
+  }
+  return (PowerProfile)target;
+}
+
+bool PowerGovernor::update(uint8_t percent, bool charging, unsigned long now)
+{
+  PowerProfile next = _pick(percent, charging);
+  if (_started && next == _profile)
+  {
+    return false;
+  }
+  if (_started)
+  {
+    _stats.msIn[_profile] += now - _since;
+    _stats.switches++;
+  }
+  _profile = next;
+  _since = now;
+  _started = true;
+  return true;
+}
+
+uint32_t PowerGovernor::projectedMinutes(uint8_t percent)
+{
+  uint32_t minutes = 0;
+  uint8_t top = percent > 100 ? 100 : percent;
+  for (uint8_t p = POWER_FULL; p < POWER_PROFILE_COUNT; p++)
+  {
+    uint8_t floor = PROFILES[p].floorPercent;
+    if (top <= floor)
+    {
+      continue;
+    }
+    // mAh in this band / mA * 60
+    minutes += (uint32_t)(top - floor) * POWER_BATTERY_CAPACITY_MAH * 60 / 100 / PROFILES[p].averageMa;
+    top = floor;
+  }
+  return minutes;
+}
+
+void PowerGovernor::printStats(Print &out, unsigned long now) const
+{
+  out.printf("Power: %s profile, %u switches\n", PROFILES[_profile].name, (unsigned)_stats.switches);
+  for (uint8_t p = POWER_FULL; p < POWER_PROFILE_COUNT; p++)
+  {
+    uint32_t ms = _stats.msIn[p] + (_started && p == _profile ? now - _since : 0);
+    out.printf("Power: %-8s %u s\n", PROFILES[p].name, (unsigned)(ms / 1000));
+  }
+}
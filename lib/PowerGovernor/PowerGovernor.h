@@ -0,0 +1,85 @@
+/*
+ * Battery-aware power governor.
+ *
+ * Picks a power profile from the state of charge and the charger: full
+ * power while charging or above POWER_BALANCED_BELOW percent, then
+ * progressively longer GPS intervals, bigger uplink batches, a dimmer or
+ * dark display and modem sleep as the cell runs down. Moving back to a
+ * better profile needs POWER_HYSTERESIS percent of headroom so a cell
+ * sagging under a transmit burst does not flip profiles back and forth.
+ *
+ * The governor only decides; the caller applies the settings.
+ */
+
+#ifndef PowerGovernor_h
+#define PowerGovernor_h
+
+#include "Arduino.h"
+
+#define POWER_BALANCED_BELOW 60     // percent
+#define POWER_SAVER_BELOW 30
+#define POWER_CRITICAL_BELOW 10
+#define POWER_HYSTERESIS 5          // percent above a threshold before stepping back up
+#define POWER_BATTERY_CAPACITY_MAH 2600
+
+enum PowerProfile
+{
+  POWER_FULL,
+  POWER_BALANCED,
+  POWER_SAVER,
+  POWER_CRITICAL,
+  POWER_PROFILE_COUNT
+};
+
+struct PowerSettings
+{
+  const char *name;
+  uint8_t floorPercent;    // lowest state of charge this profile is used at
+  uint32_t gpsMinInterval; // ms, floor for the GPS sampler
+  uint8_t uplinkBatch;     // fixes per uplink batch
+  bool displayOn;
+  uint8_t contrast;        // SSD1306 contrast while on
+  bool modemSleep;         // let the SIM808 sleep while its UART is idle
+  uint16_t averageMa;      // estimated draw of the whole device in this profile
+};
+
+struct PowerGovernorStats
+{
+  uint32_t switches;
+  uint32_t msIn[POWER_PROFILE_COUNT];
+};
+
+class PowerGovernor
+{
+public:
+  PowerGovernor();
+
+  /*
+   * Feed the current battery state.
+   * @return true when the profile changed, including the first call
+   */
+  bool update(uint8_t percent, bool charging, unsigned long now);
+
+  PowerProfile profile() const { return _profile; }
+  const PowerSettings &settings() const { return settingsFor(_profile); }
+  static const PowerSettings &settingsFor(PowerProfile profile);
+
+  /*
+   * Minutes until empty from this state of charge, stepping down through
+   * the profiles as the governor would.
+   */
+  static uint32_t projectedMinutes(uint8_t percent);
+
+  const PowerGovernorStats &stats() const { return _stats; }
+  void printStats(Print &out, unsigned long now) const;
+
+private:
+  PowerProfile _pick(uint8_t percent, bool charging) const;
+
+  bool _started;
+  volatile PowerProfile _profile; // read by the display task
+  unsigned long _since;
+  PowerGovernorStats _stats;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "Scheduler.h"
+#include <string.h>
+
+#ifdef ARDUINO
+static uint32_t deviceMicros()
+{
+  return (uint32_t)micros();
+}
+#endif
+
+Scheduler::Scheduler(SchedulerClock clock)
+{
+#ifdef ARDUINO
+  _clock = clock != NULL ? clock : deviceMicros;
+#else
+  _clock = clock;
+#endif
+  memset(_jobs, 0, sizeof(_jobs));
+  _count = 0;
+}
+
+int Scheduler::add(const char *name, uint32_t periodMs, uint32_t budgetUs, SchedulerJob job, void *context,
+                   uint32_t firstDelayMs)
+{
+  if (_count >= SCHEDULER_MAX_JOBS || job == NULL || periodMs == 0)
+  {
+    return -1;
+  }
+  Job &entry = _jobs[_count];
+  memset(&entry, 0, sizeof(entry));
+  entry.name = name;
+  entry.job = job;
+  entry.context = context;
+  entry.periodUs = periodMs * 1000;
+  entry.budgetUs = budgetUs;
+  entry.deadline = _clock() + firstDelayMs * 1000;
+  return _count++;
+}
+
+void Scheduler::setPeriod(int id, uint32_t periodMs)
+{
+  if (id >= 0 && id < _count && periodMs > 0)
+  {
+    _jobs[id].periodUs = periodMs * 1000;
+  }
+}
+
+int Scheduler::_earliest() const
+{
+  int earliest = -1;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (earliest < 0 || (int32_t)(_jobs[i].deadline - _jobs[earliest].deadline) < 0)
+    {
+      earliest = i;
+    }
+  }
+  return earliest;
+}
+
+void Scheduler::_record(uint32_t *histogram, uint32_t us)
+{
+  uint8_t bucket = 0;
+  while (bucket < SCHEDULER_BUCKETS - 1 && us >= ((uint32_t)SCHEDULER_BUCKET_US << bucket))
+  {
+    bucket++;
+  }
+  histogram[bucket]++; // 32 bits last 49 days at a 1 ms job
+}
+
+uint32_t Scheduler::runDue()
+{
+  // Bounded so an overloaded task still gets back to its caller
+  for (uint8_t ran = 0; ran < _count; ran++)
+  {
+    Job &job = _jobs[_earliest()];
+    uint32_t start = _clock();
+    if ((int32_t)(job.deadline - start) > 0)
+    {
+      break;
+    }
+    job.job(job.context);
+    uint32_t end = _clock();
+
+    uint32_t late = start - job.deadline;
+    uint32_t run = end - start;
+    job.stats.runs++;
+    if (late > job.stats.maxLateUs)
+      job.stats.maxLateUs = late;
+    if (run > job.stats.maxRunUs)
+      job.stats.maxRunUs = run;
+    if (job.budgetUs > 0 && run > job.budgetUs)
+      job.stats.overruns++;
+    _record(job.stats.late, late);
+    _record(job.stats.run, run);
+
+    // Next period boundary after now, on the original grid so the job does not drift
+    job.deadline += job.periodUs;
+    if ((int32_t)(job.deadline - end) <= 0)
+    {
+      uint32_t missed = (end - job.deadline) / job.periodUs + 1;
+      job.stats.skipped += missed;
+      job.deadline += missed * job.periodUs;
+    }
+  }
+
+  if (_count == 0)
+  {
+    return SCHEDULER_IDLE_MS;
+  }
+  int32_t wait = (int32_t)(_jobs[_earliest()].deadline - _clock());
+  return wait <= 0 ? 0 : ((uint32_t)wait + 999) / 1000;
+}
+
+uint32_t Scheduler::percentileUs(const uint32_t *histogram, uint8_t percent)
+{
+  uint64_t total = 0;
+  for (uint8_t i = 0; i < SCHEDULER_BUCKETS; i++)
+  {
+    total += histogram[i];
+  }
+  uint64_t seen = 0;
+  for (uint8_t i = 0; i < SCHEDULER_BUCKETS; i++)
+  {
+    seen += histogram[i];
+    if (total > 0 && seen * 100 >= total * percent)
+    {
+      return (uint32_t)SCHEDULER_BUCKET_US << i;
+    }
+  }
+  return 0;
+}
+
+#ifdef ARDUINO
+void Scheduler::printStats(Print &out) const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Job &job = _jobs[i];
+    const SchedulerJobStats &s = job.stats;
+    out.printf("Job %-12s every %u ms: %u runs, late p50<%u p99<%u max %u us, run p50<%u p99<%u max %u us, "
+               "%u over budget, %u skipped\n",
+               job.name, (unsigned)(job.periodUs / 1000), (unsigned)s.runs, (unsigned)percentileUs(s.late, 50),
+               (unsigned)percentileUs(s.late, 99), (unsigned)s.maxLateUs, (unsigned)percentileUs(s.run, 50),
+               (unsigned)percentileUs(s.run, 99), (unsigned)s.maxRunUs, (unsigned)s.overruns, (unsigned)s.skipped);
+  }
+}
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Cooperative scheduler for the periodic jobs of one task.
+ *
+ * Each job has a period and a run-time budget. runDue() runs the jobs
+ * whose deadline has passed, earliest deadline first, moves each deadline
+ * on by whole periods (a job that fell behind skips the missed runs
+ * instead of bursting) and returns how long the task may sleep. Nothing
+ * in a job may block for long, since the other jobs of the task wait for
+ * it; the lateness and run-time histograms show when one does.
+ *
+ * Time comes from a clock function in microseconds, micros() on the
+ * device. A host build passes a virtual clock instead, so the timing can
+ * be checked without hardware; only printStats() needs Arduino.
+ */
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef ARDUINO
+#include "Arduino.h"
+#endif
+
+#define SCHEDULER_MAX_JOBS 8
+#define SCHEDULER_BUCKETS 16           // histogram bucket i holds values below SCHEDULER_BUCKET_US << i
+#define SCHEDULER_BUCKET_US 64         // upper bound of bucket 0, the last bucket is open ended
+#define SCHEDULER_IDLE_MS 1000         // sleep returned when no job is registered
+
+typedef void (*SchedulerJob)(void *context);
+typedef uint32_t (*SchedulerClock)();
+
+struct SchedulerJobStats
+{
+  uint32_t runs;
+  uint32_t overruns; // runs longer than the budget
+  uint32_t skipped;  // periods missed because the job ran late
+  uint32_t maxLateUs;
+  uint32_t maxRunUs;
+  uint32_t late[SCHEDULER_BUCKETS]; // start time minus deadline
+  uint32_t run[SCHEDULER_BUCKETS];  // time spent in the job
+};
+
+class Scheduler
+{
+public:
+  // @param clock, microseconds; NULL uses micros() on the device
+  Scheduler(SchedulerClock clock = NULL);
+
+  /*
+   * Register a periodic job, the first run is firstDelayMs from now.
+   * @return job id, -1 when SCHEDULER_MAX_JOBS are registered
+   */
+  int add(const char *name, uint32_t periodMs, uint32_t budgetUs, SchedulerJob job, void *context = NULL,
+          uint32_t firstDelayMs = 0);
+
+  // Change the period, takes effect after the next run
+  void setPeriod(int id, uint32_t periodMs);
+
+  /*
+   * Run the jobs that are due, each at most once per call.
+   * @return ms until the next deadline, 0 when a job is already due again
+   */
+  uint32_t runDue();
+
+  uint8_t jobCount() const { return _count; }
+  const char *name(int id) const { return _jobs[id].name; }
+  const SchedulerJobStats &stats(int id) const { return _jobs[id].stats; }
+
+  // Upper bound of the bucket holding the given percentile of a histogram
+  static uint32_t percentileUs(const uint32_t *histogram, uint8_t percent);
+
+#ifdef ARDUINO
+  // Reads the counters without a lock, a line can mix two runs of a job
+  void printStats(Print &out) const;
+#endif
+
+private:
+  struct Job
+  {
+    const char *name;
+    SchedulerJob job;
+    void *context;
+    uint32_t periodUs;
+    uint32_t budgetUs;
+    uint32_t deadline; // clock value the next run is due at
+    SchedulerJobStats stats;
+  };
+
+  static void _record(uint32_t *histogram, uint32_t us);
+  int _earliest() const;
+
+  SchedulerClock _clock;
+  Job _jobs[SCHEDULER_MAX_JOBS];
+  uint8_t _count;
+};
+
+#endif
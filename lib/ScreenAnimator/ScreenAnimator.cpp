@@ -0,0 +1,88 @@
+#include "ScreenAnimator.h"
+
+ScreenAnimator::ScreenAnimator(uint8_t width, uint8_t height)
+{
+  _buffer = NULL;
+  _width = width;
+  _pages = (height + 7) / 8;
+  _animation = NULL;
+  _step = 0;
+  _nextAt = 0;
+}
+
+void ScreenAnimator::show(const uint8_t *frame)
+{
+  _animation = NULL;
+  if (_buffer != NULL)
+  {
+    memcpy_P(_buffer, frame, (size_t)_width * _pages);
+  }
+}
+
+// Copies a region from the final frame, or blanks it
+void ScreenAnimator::_copy(const AnimationStep &step, bool reveal)
+{
+  size_t offset = (size_t)step.page * _width + step.column;
+  if (reveal)
+    memcpy_P(_buffer + offset, _animation->frame + offset, step.width);
+  else
+    memset(_buffer + offset, 0, step.width);
+}
+
+void ScreenAnimator::start(const Animation &animation, unsigned long now)
+{
+  show(animation.frame);
+  _animation = &animation;
+  if (_buffer == NULL)
+  {
+    return;
+  }
+  for (uint8_t i = 0; i < animation.stepCount; i++)
+  {
+    _copy(animation.steps[i], false);
+  }
+  _step = 0;
+  _nextAt = now + animation.tickMs;
+}
+
+bool ScreenAnimator::tick(unsigned long now)
+{
+  if (_animation == NULL || _buffer == NULL)
+  {
+    return false;
+  }
+  bool changed = false;
+  while ((long)(now - _nextAt) >= 0)
+  {
+    if (_step >= _animation->stepCount)
+    {
+      // Hold is over, blank the regions and type again
+      for (uint8_t i = 0; i < _animation->stepCount; i++)
+      {
+        _copy(_animation->steps[i], false);
+      }
+      _step = 0;
+      _nextAt += _animation->tickMs;
+      changed = true;
+      continue;
+    }
+    const AnimationStep &step = _animation->steps[_step++];
+    if (step.width > 0)
+    {
+      _copy(step, true);
+      changed = true;
+    }
+    _nextAt += _step >= _animation->stepCount ? _animation->holdMs : _animation->tickMs;
+  }
+  return changed;
+}
+
+uint32_t ScreenAnimator::msUntilNext(unsigned long now) const
+{
+  if (_animation == NULL)
+  {
+    return UINT32_MAX;
+  }
+  long wait = (long)(_nextAt - now);
+  return wait > 0 ? (uint32_t)wait : 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Tick-scheduled animations over pre-rendered SSD1306 frames.
+ *
+ * Frames are whole screen images in the controller's page layout (one
+ * byte is eight pixels of one column), produced at build time by
+ * tools/gen_screens.py and kept in flash. An animation is a final frame
+ * plus a list of regions revealed one per tick; start() copies the frame
+ * with every region blanked and each tick copies one region back. Nothing
+ * is drawn or measured at run time and nothing touches the heap.
+ */
+
+#ifndef ScreenAnimator_h
+#define ScreenAnimator_h
+
+#include "Arduino.h"
+
+// Region of one page revealed by an animation tick, width 0 only keeps time
+struct AnimationStep
+{
+  uint8_t page;
+  uint8_t column;
+  uint8_t width;
+};
+
+struct Animation
+{
+  const uint8_t *frame;       // final image
+  const AnimationStep *steps; // in reveal order
+  uint8_t stepCount;
+  uint16_t tickMs;            // time between steps
+  uint16_t holdMs;            // the full image stays up this long, then the animation restarts
+};
+
+class ScreenAnimator
+{
+public:
+  ScreenAnimator(uint8_t width, uint8_t height);
+
+  // Frame buffer to draw into, e.g. Adafruit_SSD1306::getBuffer()
+  void begin(uint8_t *buffer) { _buffer = buffer; }
+
+  // Copy a still frame into the buffer
+  void show(const uint8_t *frame);
+
+  void start(const Animation &animation, unsigned long now);
+
+  /*
+   * Apply the steps that are due.
+   * @return true when the buffer changed and should be sent to the panel
+   */
+  bool tick(unsigned long now);
+
+  // Time until tick() has something to do
+  uint32_t msUntilNext(unsigned long now) const;
+
+private:
+  void _copy(const AnimationStep &step, bool reveal);
+
+  uint8_t *_buffer;
+  uint8_t _width;
+  uint8_t _pages;
+  const Animation *_animation;
+  uint8_t _step;           // next step to reveal, stepCount while holding
+  unsigned long _nextAt;
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "TaskMonitor.h"
+#include <esp_heap_caps.h>
+
+TaskMonitor *TaskMonitor::_instance = NULL;
+
+TaskMonitor::TaskMonitor()
+{
+  memset(_slots, 0, sizeof(_slots));
+  _count = 0;
+  memset(_cores, 0, sizeof(_cores));
+  _timer = NULL;
+  _reportedAt = 0;
+}
+
+bool TaskMonitor::begin()
+{
+  if (_timer != NULL)
+  {
+    return true;
+  }
+  _instance = this;
+  _reportedAt = millis();
+  _timer = timerBegin(TASK_MONITOR_TIMER, 80, true); // 80 MHz APB / 80 = 1 MHz
+  if (_timer == NULL)
+  {
+    Serial.println("Task monitor: sampling timer not available.");
+    return false;
+  }
+  timerAttachInterrupt(_timer, _onTimer, true);
+  timerAlarmWrite(_timer, 1000000 / TASK_MONITOR_SAMPLE_HZ, true);
+  timerAlarmEnable(_timer);
+  return true;
+}
+
+bool TaskMonitor::start(const TaskSpec &spec, TaskFunction_t task, void *parameter, TaskHandle_t *handle)
+{
+  TaskHandle_t created = NULL;
+  if (xTaskCreatePinnedToCore(task, spec.name, spec.stackBytes, parameter, spec.priority, &created, spec.core) != pdPASS)
+  {
+    Serial.printf("Task %s could not be created.\n", spec.name);
+    return false;
+  }
+  watch(created, spec.name, spec.stackBytes, spec.core);
+  if (handle != NULL)
+  {
+    *handle = created;
+  }
+  return true;
+}
+
+void TaskMonitor::watch(TaskHandle_t handle, const char *name, uint32_t stackBytes, BaseType_t core)
+{
+  if (handle == NULL)
+  {
+    return;
+  }
+  portENTER_CRITICAL(&_lock);
+  if (_count >= TASK_MONITOR_SLOTS)
+  {
+    portEXIT_CRITICAL(&_lock);
+    return;
+  }
+  Slot &slot = _slots[_count];
+  slot.name = name;
+  slot.stackBytes = stackBytes;
+  slot.core = core == tskNO_AFFINITY ? -1 : (int8_t)core;
+  slot.minFree = 0;
+  slot.samples = 0;
+  slot.reported = 0;
+  slot.handle = handle;
+  __sync_synchronize();
+  _count = _count + 1; // the sampler only looks at slots below _count
+  portEXIT_CRITICAL(&_lock);
+}
+
+TaskMonitor::Slot *TaskMonitor::_find(TaskHandle_t handle)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_slots[i].handle == handle)
+    {
+      return &_slots[i];
+    }
+  }
+  return NULL;
+}
+
+void TaskMonitor::exitTask()
+{
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  Slot *slot = _find(self);
+  if (slot != NULL)
+  {
+    slot->minFree = uxTaskGetStackHighWaterMark(self);
+    slot->handle = NULL; // the TCB can be reused by the next task
+  }
+  vTaskDelete(NULL);
+}
+
+void IRAM_ATTR TaskMonitor::_onTimer()
+{
+  if (_instance != NULL)
+  {
+    _instance->_sample();
+  }
+}
+
+void IRAM_ATTR TaskMonitor::_sample()
+{
+  uint8_t count = _count;
+  for (uint8_t core = 0; core < TASK_MONITOR_CORES; core++)
+  {
+    CoreCounters &counters = _cores[core];
+    TaskHandle_t running = xTaskGetCurrentTaskHandleForCPU(core);
+    counters.total++;
+    if (running != counters.last)
+    {
+      counters.switches++;
+      counters.last = running;
+    }
+    if (running == xTaskGetIdleTaskHandleForCPU(core))
+    {
+      counters.idle++;
+      continue;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (_slots[i].handle == running)
+      {
+        _slots[i].samples++;
+        break;
+      }
+    }
+  }
+}
+
+// Share of one core in tenths of a percent
+static unsigned tenths(uint32_t part, uint32_t whole)
+{
+  return whole == 0 ? 0 : (unsigned)((uint64_t)part * 1000 / whole);
+}
+
+void TaskMonitor::report(Print &out)
+{
+  unsigned long now = millis();
+  uint32_t window[TASK_MONITOR_CORES];
+  uint32_t all = 0;
+  for (uint8_t core = 0; core < TASK_MONITOR_CORES; core++)
+  {
+    window[core] = _cores[core].total - _cores[core].reportedTotal;
+    all += window[core];
+  }
+  out.printf("Tasks over the last %u ms (%u running):\n", (unsigned)(now - _reportedAt),
+             (unsigned)uxTaskGetNumberOfTasks());
+  out.printf("  %-16s core prio   cpu%%  stack free/size\n", "task");
+
+  uint32_t known[TASK_MONITOR_CORES] = {0};
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    Slot &slot = _slots[i];
+    uint32_t samples = slot.samples;
+    uint32_t delta = samples - slot.reported;
+    slot.reported = samples;
+    // Share of the core the task is pinned to, of both cores when it floats
+    uint32_t whole = slot.core >= 0 ? window[slot.core] : all;
+    if (slot.core >= 0)
+    {
+      known[slot.core] += delta;
+    }
+    TaskHandle_t handle = slot.handle;
+    if (handle == NULL)
+    {
+      out.printf("  %-16s %4s %4s %6s  %5u/%u exited\n", slot.name, "-", "-", "-", (unsigned)slot.minFree,
+                 (unsigned)slot.stackBytes);
+      continue;
+    }
+    char core[4];
+    snprintf(core, sizeof(core), "%d", slot.core);
+    out.printf("  %-16s %4s %4u %4u.%u  %5u/%u\n", slot.name, slot.core >= 0 ? core : "any",
+               (unsigned)uxTaskPriorityGet(handle), tenths(delta, whole) / 10, tenths(delta, whole) % 10,
+               (unsigned)uxTaskGetStackHighWaterMark(handle), (unsigned)slot.stackBytes);
+  }
+
+  for (uint8_t core = 0; core < TASK_MONITOR_CORES; core++)
+  {
+    CoreCounters &counters = _cores[core];
+    uint32_t idle = counters.idle - counters.reportedIdle;
+    uint32_t switches = counters.switches - counters.reportedSwitches;
+    uint32_t seconds = window[core] / TASK_MONITOR_SAMPLE_HZ;
+    // Time on this core not in idle and not in a pinned task (system tasks, floating tasks, ISRs)
+    uint32_t rest = window[core] > idle + known[core] ? window[core] - idle - known[core] : 0;
+    out.printf("  core %u: idle %u.%u%%, unpinned and system %u.%u%%, %u switches/s\n", (unsigned)core,
+               tenths(idle, window[core]) / 10, tenths(idle, window[core]) % 10, tenths(rest, window[core]) / 10,
+               tenths(rest, window[core]) % 10, (unsigned)(seconds == 0 ? switches : switches / seconds));
+    counters.reportedTotal = counters.total;
+    counters.reportedIdle = counters.idle;
+    counters.reportedSwitches = counters.switches;
+  }
+
+  out.printf("  heap: %u free, %u lowest, %u largest block\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  _reportedAt = now;
+}
@@ -0,0 +1,96 @@
+/*
+ * Task topology and run-time profiler.
+ *
+ * Tasks are started from a TaskSpec (name, stack, priority, core), so the
+ * layout of the firmware is one table instead of numbers spread over the
+ * xTaskCreate calls. Every started or watched task is then profiled:
+ *
+ * - CPU share per task and per core. The Arduino core is built without
+ *   configGENERATE_RUN_TIME_STATS, so a hardware timer samples the task
+ *   running on each core TASK_MONITOR_SAMPLE_HZ times a second; shares
+ *   are over the window since the previous report.
+ * - Stack headroom from uxTaskGetStackHighWaterMark (bytes on the ESP32).
+ * - Free, smallest-ever free and largest free heap block.
+ * - Task switches, counted when two samples in a row see different tasks
+ *   on a core, so this is a lower bound.
+ *
+ * A task that ends calls exitTask() instead of vTaskDelete(NULL), which
+ * keeps its last stack reading and stops the profiler from touching a
+ * freed handle.
+ */
+
+#ifndef TaskMonitor_h
+#define TaskMonitor_h
+
+#include "Arduino.h"
+
+#define TASK_MONITOR_SLOTS 12
+#define TASK_MONITOR_SAMPLE_HZ 997  // prime, so samples drift across the 1 ms FreeRTOS tick
+#define TASK_MONITOR_TIMER 1        // hardware timer used by the sampler
+#define TASK_MONITOR_CORES 2
+
+struct TaskSpec
+{
+  const char *name;
+  uint32_t stackBytes;
+  UBaseType_t priority;
+  BaseType_t core;
+};
+
+class TaskMonitor
+{
+public:
+  TaskMonitor();
+
+  // Start the sampling timer, on the core that should take its interrupt
+  bool begin();
+
+  // Create a task from its spec and watch it
+  bool start(const TaskSpec &spec, TaskFunction_t task, void *parameter = NULL, TaskHandle_t *handle = NULL);
+
+  // Watch a task created elsewhere, e.g. the Arduino loop task
+  void watch(TaskHandle_t handle, const char *name, uint32_t stackBytes, BaseType_t core);
+
+  // End the calling task, use instead of vTaskDelete(NULL)
+  void exitTask();
+
+  // Print the window since the previous report and start a new one
+  void report(Print &out);
+
+private:
+  struct Slot
+  {
+    const char *name;
+    TaskHandle_t handle; // NULL once the task has exited
+    uint32_t stackBytes;
+    int8_t core;         // -1 for no affinity
+    uint32_t minFree;    // stack headroom when the task exited
+    volatile uint32_t samples;
+    uint32_t reported;   // samples at the previous report
+  };
+
+  struct CoreCounters
+  {
+    volatile uint32_t total;
+    volatile uint32_t idle;
+    volatile uint32_t switches;
+    TaskHandle_t last;
+    uint32_t reportedTotal;
+    uint32_t reportedIdle;
+    uint32_t reportedSwitches;
+  };
+
+  static void IRAM_ATTR _onTimer();
+  void IRAM_ATTR _sample();
+  Slot *_find(TaskHandle_t handle);
+
+  static TaskMonitor *_instance;
+  Slot _slots[TASK_MONITOR_SLOTS];
+  volatile uint8_t _count;
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED; // registration, tasks on both cores call start()
+  CoreCounters _cores[TASK_MONITOR_CORES];
+  hw_timer_t *_timer;
+  unsigned long _reportedAt;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include <string.h>
+#include "TelemetryCodec.h"
+
+// Writes bytes into a bounded buffer, remembers if anything did not fit
+struct TelemetryWriter
+{
+  uint8_t *out;
+  size_t capacity;
+  size_t length;
+  bool overflow;
+
+  void put(uint8_t b)
+  {
+    if (length < capacity)
+      out[length++] = b;
+    else
+      overflow = true;
+  }
+
+  void putU32(uint32_t v)
+  {
+    put(v & 0xFF);
+    put((v >> 8) & 0xFF);
+    put((v >> 16) & 0xFF);
+    put(v >> 24);
+  }
+
+  void putVarint(uint32_t v)
+  {
+    while (v >= 0x80)
+    {
+      put((uint8_t)(v | 0x80));
+      v >>= 7;
+    }
+    put((uint8_t)v);
+  }
+
+  void putZigzag(int32_t v)
+  {
+    putVarint(((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+  }
+};
+
+// Reads from a bounded buffer, remembers if it ran past the end
+struct TelemetryReader
+{
+  const uint8_t *data;
+  size_t length;
+  size_t pos;
+  bool truncated;
+
+  uint8_t get()
+  {
+    if (pos < length)
+      return data[pos++];
+    truncated = true;
+    return 0;
+  }
+
+  uint32_t getU32()
+  {
+    uint32_t v = get();
+    v |= (uint32_t)get() << 8;
+    v |= (uint32_t)get() << 16;
+    v |= (uint32_t)get() << 24;
+    return v;
+  }
+
+  uint32_t getVarint()
+  {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+      uint8_t b = get();
+      v |= (uint32_t)(b & 0x7F) << shift;
+      if (!(b & 0x80))
+        return v;
+    }
+    truncated = true; // more than 5 bytes is never valid
+    return 0;
+  }
+
+  int32_t getZigzag()
+  {
+    uint32_t v = getVarint();
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+  }
+};
+
+// Course in 0.1 degree steps, 0..3599
+static int32_t courseTenths(uint16_t course)
+{
+  return (course / 10) % 3600;
+}
+
+size_t encodeTelemetryBatch(const StoredFix *fixes, uint16_t count, uint8_t fieldMask,
+                            uint8_t *out, size_t capacity)
+{
+  TelemetryWriter w = {out, capacity, 0, false};
+  fieldMask &= TELEMETRY_ALL_FIELDS;
+
+  w.put(TELEMETRY_VERSION);
+  w.put(fieldMask);
+  w.putVarint(count);
+  uint32_t baseTime = count > 0 ? fixes[0].timestamp : 0;
+  int32_t baseLatitude = count > 0 ? fixes[0].latitude : 0;
+  int32_t baseLongitude = count > 0 ? fixes[0].longitude : 0;
+  w.putU32(baseTime);
+  w.putU32((uint32_t)baseLatitude);
+  w.putU32((uint32_t)baseLongitude);
+
+  // Previous values, the decoder starts from the same state
+  uint32_t time = baseTime;
+  int32_t latitude = baseLatitude;
+  int32_t longitude = baseLongitude;
+  int32_t altitude = 0;
+  int32_t speed = 0;
+  int32_t course = 0;
+  uint8_t hdop = 0;
+  uint8_t satellites = 0;
+  uint8_t flags = FIXLOG_FLAG_VALID;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    const StoredFix &fix = fixes[i];
+    int32_t fixCourse = courseTenths(fix.course);
+
+    uint8_t presence = 0;
+    if ((fieldMask & TELEMETRY_HAS_COURSE) && fixCourse != course)
+      presence |= TELEMETRY_HAS_COURSE;
+    if ((fieldMask & TELEMETRY_HAS_HDOP) && fix.hdop != hdop)
+      presence |= TELEMETRY_HAS_HDOP;
+    if ((fieldMask & TELEMETRY_HAS_SATELLITES) && fix.satellitesUsed != satellites)
+      presence |= TELEMETRY_HAS_SATELLITES;
+    if ((fieldMask & TELEMETRY_HAS_FLAGS) && fix.flags != flags)
+      presence |= TELEMETRY_HAS_FLAGS;
+
+    w.put(presence);
+    w.putZigzag((int32_t)(fix.timestamp - time));
+    w.putZigzag((int32_t)((uint32_t)fix.latitude - (uint32_t)latitude));
+    w.putZigzag((int32_t)((uint32_t)fix.longitude - (uint32_t)longitude));
+    w.putZigzag(fix.altitude - altitude);
+    w.putZigzag(fix.speed - speed);
+    if (presence & TELEMETRY_HAS_COURSE)
+    {
+      int32_t turn = fixCourse - course;
+      if (turn >= 1800)
+        turn -= 3600;
+      else if (turn < -1800)
+        turn += 3600;
+      w.putZigzag(turn);
+      course = fixCourse;
+    }
+    if (presence & TELEMETRY_HAS_HDOP)
+    {
+      w.put(fix.hdop);
+      hdop = fix.hdop;
+    }
+    if (presence & TELEMETRY_HAS_SATELLITES)
+    {
+      w.put(fix.satellitesUsed);
+      satellites = fix.satellitesUsed;
+    }
+    if (presence & TELEMETRY_HAS_FLAGS)
+    {
+      w.put(fix.flags);
+      flags = fix.flags;
+    }
+
+    time = fix.timestamp;
+    latitude = fix.latitude;
+    longitude = fix.longitude;
+    altitude = fix.altitude;
+    speed = fix.speed;
+  }
+
+  return w.overflow ? 0 : w.length;
+}
+
+int decodeTelemetryBatch(const uint8_t *data, size_t length, StoredFix *out, uint16_t maxFixes)
+{
+  TelemetryReader r = {data, length, 0, false};
+
+  if (r.get() != TELEMETRY_VERSION)
+  {
+    return -1;
+  }
+  uint8_t fieldMask = r.get();
+  uint32_t count = r.getVarint();
+  uint32_t time = r.getU32();
+  int32_t latitude = (int32_t)r.getU32();
+  int32_t longitude = (int32_t)r.getU32();
+  if (r.truncated || count > maxFixes || (fieldMask & ~TELEMETRY_ALL_FIELDS))
+  {
+    return -1;
+  }
+
+  // 64 bits, so a corrupt delta is caught by the range checks instead of wrapping
+  int64_t altitude = 0;
+  int64_t speed = 0;
+  int64_t course = 0;
+  uint8_t hdop = 0;
+  uint8_t satellites = 0;
+  uint8_t flags = FIXLOG_FLAG_VALID;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint8_t presence = r.get();
+    if (presence & ~fieldMask)
+    {
+      return -1;
+    }
+    time += (uint32_t)r.getZigzag();
+    latitude = (int32_t)((uint32_t)latitude + (uint32_t)r.getZigzag());
+    longitude = (int32_t)((uint32_t)longitude + (uint32_t)r.getZigzag());
+    altitude += r.getZigzag();
+    speed += r.getZigzag();
+    if (altitude < INT16_MIN || altitude > INT16_MAX || speed < 0 || speed > UINT16_MAX)
+    {
+      return -1; // the encoder never produces a value StoredFix cannot hold
+    }
+    if (presence & TELEMETRY_HAS_COURSE)
+    {
+      int32_t turn = r.getZigzag();
+      if (turn < -1800 || turn >= 1800)
+      {
+        return -1; // always the shortest turn
+      }
+      course = (course + turn + 3600) % 3600;
+    }
+    if (presence & TELEMETRY_HAS_HDOP)
+      hdop = r.get();
+    if (presence & TELEMETRY_HAS_SATELLITES)
+      satellites = r.get();
+    if (presence & TELEMETRY_HAS_FLAGS)
+      flags = r.get();
+    if (r.truncated)
+    {
+      return -1;
+    }
+
+    StoredFix &fix = out[i];
+    memset(&fix, 0, sizeof(fix));
+    fix.timestamp = time;
+    fix.latitude = latitude;
+    fix.longitude = longitude;
+    fix.altitude = (int16_t)altitude;
+    fix.speed = (uint16_t)speed;
+    fix.course = (uint16_t)(course * 10);
+    fix.hdop = hdop;
+    fix.satellitesUsed = satellites;
+    fix.flags = flags;
+  }
+  return (int)count;
+}
@@ -0,0 +1,67 @@
+/*
+ * Compact binary encoding of a batch of stored fixes for the GPRS uplink.
+ *
+ * Batch layout:
+ *   version(1) fieldMask(1) count(varint)
+ *   baseTime(4, LE) baseLatitude(4, LE) baseLongitude(4, LE)
+ *   count x fix record
+ *
+ * Fix record:
+ *   presence(1)                 TELEMETRY_HAS_* bits of the fields below
+ *   dTime(zigzag varint)        seconds since the previous fix (base for the first)
+ *   dLatitude(zigzag varint)    1e-7 degrees since the previous fix
+ *   dLongitude(zigzag varint)   1e-7 degrees since the previous fix
+ *   dAltitude(zigzag varint)    meters since the previous fix
+ *   dSpeed(zigzag varint)       0.1 km/h since the previous fix
+ *   [dCourse(zigzag varint)]    0.1 degrees, shortest turn, when TELEMETRY_HAS_COURSE
+ *   [hdop(1)]                   0.1 units, when TELEMETRY_HAS_HDOP
+ *   [satellites(1)]             satellites used, when TELEMETRY_HAS_SATELLITES
+ *   [flags(1)]                  StoredFix flags, when TELEMETRY_HAS_FLAGS
+ *
+ * Optional fields are only sent when enabled in the batch fieldMask and
+ * different from the previous fix; the decoder carries the last value
+ * forward otherwise. Fields start from zero at the beginning of a batch
+ * (flags from FIXLOG_FLAG_VALID), so every batch decodes on its own.
+ *
+ * Course is sent at 0.1 degree resolution and satellitesInView is not
+ * sent; everything else is lossless with respect to StoredFix. The codec
+ * has no Arduino dependency so the decoder can be used on the server or a
+ * Linux host.
+ */
+
+#ifndef TelemetryCodec_h
+#define TelemetryCodec_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FixLog.h"
+
+#define TELEMETRY_VERSION 1
+
+#define TELEMETRY_HAS_HDOP 0x01
+#define TELEMETRY_HAS_SATELLITES 0x02
+#define TELEMETRY_HAS_COURSE 0x04
+#define TELEMETRY_HAS_FLAGS 0x08
+#define TELEMETRY_ALL_FIELDS (TELEMETRY_HAS_HDOP | TELEMETRY_HAS_SATELLITES | TELEMETRY_HAS_COURSE | TELEMETRY_HAS_FLAGS)
+
+#define TELEMETRY_HEADER_MAX 17 // version, mask, count varint (up to 3), 3 x 4-byte base
+#define TELEMETRY_FIX_MAX 27    // presence + 3 x 5 + 3 + 3 + 2 + 3 x 1
+#define TELEMETRY_BATCH_MAX(fixes) (TELEMETRY_HEADER_MAX + (fixes) * TELEMETRY_FIX_MAX)
+
+/*
+ * Encode a batch of fixes.
+ * @param fieldMask, TELEMETRY_HAS_* optional fields to include
+ * @param out, destination of at least TELEMETRY_BATCH_MAX(count) bytes
+ * @return encoded length, 0 if the batch does not fit in capacity
+ */
+size_t encodeTelemetryBatch(const StoredFix *fixes, uint16_t count, uint8_t fieldMask,
+                            uint8_t *out, size_t capacity);
+
+/*
+ * Decode a batch produced by encodeTelemetryBatch().
+ * @param out, destination for up to maxFixes fixes
+ * @return number of fixes decoded, -1 if the batch is malformed or truncated
+ */
+int decodeTelemetryBatch(const uint8_t *data, size_t length, StoredFix *out, uint16_t maxFixes);
+
+#endif
@@ -0,0 +1,126 @@
+#include "TrackSimplifier.h"
+#include "GeoMath.h"
+
+/**
+ * Distance in cm from point (px, py) to the segment from the origin to
+ * (bx, by).
+ */
+static uint32_t segmentDistanceCm(int32_t bx, int32_t by, int32_t px, int32_t py)
+{
+  int64_t dot = (int64_t)px * bx + (int64_t)py * by;
+  int64_t lengthSq = (int64_t)bx * bx + (int64_t)by * by;
+  if (dot <= 0 || lengthSq == 0)
+  {
+    return geoSqrt64((uint64_t)((int64_t)px * px + (int64_t)py * py));
+  }
+  if (dot >= lengthSq)
+  {
+    int64_t dx = (int64_t)px - bx;
+    int64_t dy = (int64_t)py - by;
+    return geoSqrt64((uint64_t)(dx * dx + dy * dy));
+  }
+  int64_t cross = (int64_t)bx * py - (int64_t)by * px;
+  if (cross < 0)
+    cross = -cross;
+  return (uint32_t)((uint64_t)cross / geoSqrt64((uint64_t)lengthSq));
+}
+
+TrackSimplifier::TrackSimplifier(uint32_t toleranceCm)
+{
+  _tolerance = toleranceCm;
+  _haveAnchor = false;
+  memset(&_anchor, 0, sizeof(_anchor));
+  _count = 0;
+  _windowError = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+// Emit a fix and restart the window from it
+void TrackSimplifier::_keep(const StoredFix &fix, StoredFix &out)
+{
+  out = fix;
+  _anchor = fix;
+  _haveAnchor = true;
+  _count = 0;
+  if (_windowError > _stats.maxErrorCm)
+  {
+    _stats.maxErrorCm = _windowError;
+  }
+  _windowError = 0;
+  _stats.pointsOut++;
+}
+
+void TrackSimplifier::_hold(const StoredFix &fix)
+{
+  Held &held = _window[_count++];
+  held.fix = fix;
+  geoOffsetCm(_anchor.latitude, _anchor.longitude, fix.latitude, fix.longitude, &held.east, &held.north);
+}
+
+bool TrackSimplifier::add(const StoredFix &fix, StoredFix &out)
+{
+  _stats.pointsIn++;
+  if (!_haveAnchor)
+  {
+    _keep(fix, out);
+    return true;
+  }
+
+  bool close = _count == SIMPLIFIER_WINDOW || fix.timestamp - _anchor.timestamp >= SIMPLIFIER_MAX_GAP;
+  if (!close && _count > 0)
+  {
+    int32_t east, north;
+    geoOffsetCm(_anchor.latitude, _anchor.longitude, fix.latitude, fix.longitude, &east, &north);
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      uint32_t error = segmentDistanceCm(east, north, _window[i].east, _window[i].north);
+      if (error > worst)
+      {
+        worst = error;
+        if (worst > _tolerance)
+        {
+          break;
+        }
+      }
+    }
+    if (worst > _tolerance)
+      close = true;
+    else
+      _windowError = worst;
+  }
+
+  if (!close)
+  {
+    _hold(fix);
+    return false;
+  }
+  if (_count == 0)
+  {
+    _keep(fix, out); // anchor too old and nothing held
+    return true;
+  }
+
+  // Keep the last fix that still fitted, the new one opens the next window
+  StoredFix last = _window[_count - 1].fix;
+  _keep(last, out);
+  _hold(fix);
+  return true;
+}
+
+bool TrackSimplifier::flush(StoredFix &out)
+{
+  if (_count == 0)
+  {
+    return false;
+  }
+  StoredFix last = _window[_count - 1].fix;
+  _keep(last, out);
+  return true;
+}
+
+void TrackSimplifier::printStats(Print &out) const
+{
+  out.printf("Track simplifier: kept %u of %u fixes, max error %u cm\n",
+             (unsigned)_stats.pointsOut, (unsigned)_stats.pointsIn, (unsigned)_stats.maxErrorCm);
+}
@@ -0,0 +1,77 @@
+/*
+ * Online track simplification before fixes reach the log.
+ *
+ * Opening-window variant of Douglas-Peucker: starting from the last kept
+ * fix (the anchor), incoming fixes are held in a small window as long as
+ * every held fix stays within the tolerance of the straight segment from
+ * the anchor to the newest fix. When a fix breaks that corridor, the fix
+ * before it is kept and becomes the new anchor. On straight rail the
+ * window spans many fixes; through curves it closes quickly.
+ *
+ * A fix is also kept when the window is full or the anchor is older than
+ * SIMPLIFIER_MAX_GAP, so memory is bounded and a stationary parcel still
+ * reports in. Every dropped fix is within the tolerance of the kept track.
+ */
+
+#ifndef TrackSimplifier_h
+#define TrackSimplifier_h
+
+#include "Arduino.h"
+#include "FixLog.h"
+
+#define SIMPLIFIER_WINDOW 32            // fixes held between two kept fixes
+#define SIMPLIFIER_TOLERANCE_CM 1000    // cross-track error allowed for a dropped fix
+#define SIMPLIFIER_MAX_GAP 300          // seconds, keep a fix at least this often
+
+struct TrackSimplifierStats
+{
+  uint32_t pointsIn;
+  uint32_t pointsOut;
+  uint32_t maxErrorCm; // largest cross-track error of a dropped fix
+};
+
+class TrackSimplifier
+{
+public:
+  TrackSimplifier(uint32_t toleranceCm = SIMPLIFIER_TOLERANCE_CM);
+
+  void setTolerance(uint32_t toleranceCm) { _tolerance = toleranceCm; }
+  uint32_t tolerance() const { return _tolerance; }
+
+  /*
+   * Offer the next fix of the track.
+   * @param out, receives a fix to keep when the function returns true
+   * @return true when out holds a fix that must be logged
+   */
+  bool add(const StoredFix &fix, StoredFix &out);
+
+  // Give up the window and keep the newest held fix, if any
+  bool flush(StoredFix &out);
+
+  // Fixes waiting in the window
+  uint8_t held() const { return _count; }
+
+  const TrackSimplifierStats &stats() const { return _stats; }
+  void printStats(Print &out) const;
+
+private:
+  struct Held
+  {
+    StoredFix fix;
+    int32_t east;  // cm from the anchor
+    int32_t north;
+  };
+
+  void _keep(const StoredFix &fix, StoredFix &out);
+  void _hold(const StoredFix &fix);
+
+  uint32_t _tolerance;
+  bool _haveAnchor;
+  StoredFix _anchor;
+  Held _window[SIMPLIFIER_WINDOW];
+  uint8_t _count;
+  uint32_t _windowError; // worst error in the window against the current segment
+  TrackSimplifierStats _stats;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#include "UIEvents.h"
+
+UIQueue::UIQueue()
+{
+  _queue = NULL;
+  _posted = 0;
+  _dropped = 0;
+}
+
+bool UIQueue::begin()
+{
+  if (_queue == NULL)
+  {
+    _queue = xQueueCreate(UI_QUEUE_LENGTH, sizeof(UIEvent));
+  }
+  return _queue != NULL;
+}
+
+bool UIQueue::post(UIEventType type, const char *text)
+{
+  UIEvent event;
+  event.type = type;
+  event.text[0] = '\0';
+  if (text != NULL)
+  {
+    strncpy(event.text, text, UI_TEXT_MAX - 1);
+    event.text[UI_TEXT_MAX - 1] = '\0';
+  }
+  if (_queue == NULL || xQueueSend(_queue, &event, 0) != pdTRUE)
+  {
+    _dropped++;
+    return false;
+  }
+  _posted++;
+  return true;
+}
+
+bool UIQueue::receive(UIEvent &event, TickType_t ticks)
+{
+  return _queue != NULL && xQueueReceive(_queue, &event, ticks) == pdTRUE;
+}
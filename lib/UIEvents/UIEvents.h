@@ -0,0 +1,55 @@
+/*
+ * Events for the UI task.
+ *
+ * Only the UI task draws on the display. Other tasks describe what
+ * happened with a UIEvent and post it here; post() copies the event into
+ * a FreeRTOS queue and never blocks, so a slow display can not stall the
+ * modem or the init sequence. The UI task sleeps in receive() until an
+ * event arrives or its next frame is due.
+ */
+
+#ifndef UIEvents_h
+#define UIEvents_h
+
+#include "Arduino.h"
+
+#define UI_QUEUE_LENGTH 8
+#define UI_TEXT_MAX 24
+
+enum UIEventType
+{
+  UI_PROGRESS, // a step started, text names it
+  UI_ERROR,    // a step failed, text names the component
+  UI_READY,    // init finished
+  UI_STATUS    // status bar inputs changed, redraw now
+};
+
+struct UIEvent
+{
+  UIEventType type;
+  char text[UI_TEXT_MAX];
+};
+
+class UIQueue
+{
+public:
+  UIQueue();
+
+  bool begin();
+
+  // Queue an event from any task, false when the queue is full
+  bool post(UIEventType type, const char *text = NULL);
+
+  // Wait up to ticks for the next event, UI task only
+  bool receive(UIEvent &event, TickType_t ticks);
+
+  uint32_t posted() const { return _posted; }
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  QueueHandle_t _queue;
+  volatile uint32_t _posted;
+  volatile uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,579 @@
+#include "Uplink.h"
+
+#define UPLINK_ATTACH_STEPS 7 // AT+CIPSHUT to AT+CIFSR, see _attachStep()
+
+Uplink::Uplink(ATEngine &at, FixLog &log) : _at(at), _log(log)
+{
+  _apn = "";
+  _user = "";
+  _pass = "";
+  _host = "";
+  _port = 0;
+  _state = IDLE;
+  _stateSince = 0;
+  _lastCheck = 0;
+  _backoff = UPLINK_BACKOFF_MIN;
+  _step = 0;
+  _commandPending = false;
+  _commandDone = false;
+  _commandResult = AT_OK;
+  _registered = false;
+  _connectReply = CONNECT_WAITING;
+  _closed = false;
+  _dataWaiting = false;
+  _gprsAttached = false;
+  _started = false;
+  _flushRequested = false;
+  _batchSize = UPLINK_DEFAULT_BATCH;
+  _fieldMask = TELEMETRY_ALL_FIELDS;
+  _nextSeq = 0;
+  _pendingSince = 0;
+  _nextId = 0;
+  _inFlightCount = 0;
+  _ackLength = 0;
+  _eventCount = 0;
+  _eventsInFlight = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void Uplink::configure(const char *apn, const char *user, const char *pass, const char *host, uint16_t port)
+{
+  _apn = apn;
+  _user = user;
+  _pass = pass;
+  _host = host;
+  _port = port;
+}
+
+bool Uplink::begin()
+{
+  if (!_started)
+  {
+    // CONNECT covers CONNECT OK and CONNECT FAIL
+    if (!_at.onURC("CONNECT", _onURC, this) || !_at.onURC("CLOSED", _onURC, this) ||
+        !_at.onURC("+PDP: DEACT", _onURC, this) || !_at.onURC("+CIPRXGET: 1", _onURC, this))
+    {
+      return false;
+    }
+  }
+  _started = true;
+  return true;
+}
+
+void Uplink::setBatchSize(uint8_t fixes)
+{
+  if (fixes < 1)
+    fixes = 1;
+  if (fixes > UPLINK_MAX_BATCH)
+    fixes = UPLINK_MAX_BATCH;
+  _batchSize = fixes;
+}
+
+uint32_t Uplink::msUntilWork(unsigned long now) const
+{
+  if (!_started)
+  {
+    return UINT32_MAX;
+  }
+  if (_state == BACKOFF)
+  {
+    uint32_t waited = now - _stateSince;
+    return waited >= _backoff ? 0 : _backoff - waited;
+  }
+  // Bring-up, received data, unacknowledged batches and events all need the modem now
+  if (_state != ONLINE || _dataWaiting || _inFlightCount > 0 || _eventCount > 0 || _flushRequested)
+  {
+    return 0;
+  }
+  uint32_t pending = _log.headSeq() - _nextSeq;
+  if (pending == 0)
+  {
+    return UINT32_MAX;
+  }
+  if (pending >= _batchSize || _pendingSince == 0)
+  {
+    return 0;
+  }
+  uint32_t age = now - _pendingSince;
+  return age >= UPLINK_BATCH_AGE ? 0 : UPLINK_BATCH_AGE - age;
+}
+
+void Uplink::_enter(State state)
+{
+  if (_state == ONLINE)
+  {
+    _stats.onlineMs += millis() - _stateSince;
+  }
+  _state = state;
+  _stateSince = millis();
+}
+
+/**
+ * Drops the session and waits before the next attempt. The delay doubles
+ * on every consecutive failure up to UPLINK_BACKOFF_MAX.
+ */
+void Uplink::_fail(const char *reason)
+{
+  Serial.printf("Uplink: %s, retrying in %u s\n", reason, (unsigned)(_backoff / 1000));
+  _stats.failures++;
+  if (_state == CONNECTING || _state == ONLINE)
+  {
+    _at.send("AT+CIPCLOSE=1", AT_DEFAULT_TIMEOUT, NULL, NULL); // nothing waits for the reply
+  }
+  _inFlightCount = 0;
+  _eventsInFlight = 0; // unacknowledged events go out again
+  _dataWaiting = false;
+  _enter(BACKOFF);
+}
+
+void Uplink::_onCommandDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  Uplink *uplink = (Uplink *)context;
+  uplink->_commandPending = false;
+  uplink->_commandDone = true;
+  uplink->_commandResult = result;
+}
+
+// +CREG: <n>,<stat>, registered when stat is 1 (home) or 5 (roaming)
+void Uplink::_onRegistration(const char *line, void *context)
+{
+  Uplink *uplink = (Uplink *)context;
+  const char *stat = strchr(line, ',');
+  if (strncmp(line, "+CREG:", 6) == 0 && stat != NULL)
+  {
+    int value = atoi(stat + 1);
+    uplink->_registered = value == 1 || value == 5;
+  }
+}
+
+// +CIPRXGET: 3,<length>,<left> then the bytes as one line of hex digits
+void Uplink::_onReceived(const char *line, void *context)
+{
+  Uplink *uplink = (Uplink *)context;
+  if (strncmp(line, "+CIPRXGET:", 10) == 0)
+  {
+    const char *left = strrchr(line, ',');
+    uplink->_dataWaiting = left != NULL && atoi(left + 1) > 0;
+    return;
+  }
+  for (const char *p = line; p[0] != '\0' && p[1] != '\0'; p += 2)
+  {
+    char pair[3] = {p[0], p[1], '\0'};
+    uplink->_receive((uint8_t)strtoul(pair, NULL, 16));
+  }
+}
+
+void Uplink::_onURC(const char *line, void *context)
+{
+  Uplink *uplink = (Uplink *)context;
+  if (strcmp(line, "CONNECT OK") == 0)
+    uplink->_connectReply = CONNECT_DONE;
+  else if (strncmp(line, "CONNECT FAIL", 12) == 0)
+    uplink->_connectReply = CONNECT_FAILED;
+  else if (strncmp(line, "+CIPRXGET: 1", 12) == 0)
+    uplink->_dataWaiting = true;
+  else if (strcmp(line, "CLOSED") == 0 || strncmp(line, "+PDP: DEACT", 11) == 0)
+    uplink->_closed = true;
+}
+
+// Queue one AT command, its result is picked up by a later poll()
+bool Uplink::_command(const char *command, uint32_t timeoutMs, ATLineHandler onLine)
+{
+  if (!_at.send(command, timeoutMs, _onCommandDone, this, onLine))
+  {
+    return false; // AT queue full, retried on the next poll
+  }
+  _commandPending = true;
+  return true;
+}
+
+/**
+ * Queues command number step of the GPRS attach. Returns false when it
+ * could not be queued; the step is then retried on the next poll.
+ */
+bool Uplink::_attachStep(uint8_t step)
+{
+  char command[AT_COMMAND_MAX];
+  switch (step)
+  {
+  case 0:
+    return _command("AT+CIPSHUT", UPLINK_ATTACH_TIMEOUT); // drop what a previous session left, SHUT OK
+  case 1:
+    return _command("AT+CGATT=1", UPLINK_ATTACH_TIMEOUT);
+  case 2:
+    return _command("AT+CIPMUX=0", AT_DEFAULT_TIMEOUT);
+  case 3:
+    return _command("AT+CIPRXGET=1", AT_DEFAULT_TIMEOUT); // received data waits in the modem until read
+  case 4:
+    snprintf(command, sizeof(command), "AT+CSTT=\"%s\",\"%s\",\"%s\"", _apn, _user, _pass);
+    return _command(command, AT_DEFAULT_TIMEOUT);
+  case 5:
+    return _command("AT+CIICR", UPLINK_ATTACH_TIMEOUT);
+  default:
+    // Answers with the IP address alone, and the TCP commands need it asked once
+    if (!_at.sendForLine("AT+CIFSR", AT_DEFAULT_TIMEOUT, _onCommandDone, this))
+    {
+      return false;
+    }
+    _commandPending = true;
+    return true;
+  }
+}
+
+void Uplink::poll()
+{
+  if (_commandPending)
+  {
+    return; // the AT engine reports back through _onCommandDone()
+  }
+  unsigned long now = millis();
+  bool failed = _commandDone && _commandResult != AT_OK;
+  _commandDone = false;
+  char command[AT_COMMAND_MAX];
+
+  switch (_state)
+  {
+  case IDLE:
+    if (_started)
+    {
+      _registered = false;
+      _enter(REGISTERING);
+    }
+    break;
+
+  case REGISTERING:
+    if (_registered)
+    {
+      _step = 0;
+      _enter(ATTACHING);
+    }
+    else if (now - _stateSince >= UPLINK_REGISTER_TIMEOUT)
+    {
+      _gprsAttached = false;
+      _fail("no network registration");
+    }
+    else if (now - _lastCheck >= UPLINK_REGISTER_CHECK && _command("AT+CREG?", AT_DEFAULT_TIMEOUT, _onRegistration))
+    {
+      _lastCheck = now;
+    }
+    break;
+
+  case ATTACHING:
+    if (failed)
+    {
+      _gprsAttached = false;
+      _fail("GPRS attach failed");
+    }
+    else if (_step < UPLINK_ATTACH_STEPS)
+    {
+      if (_attachStep(_step))
+        _step++;
+    }
+    else
+    {
+      _gprsAttached = true;
+      _step = 0;
+      _enter(CONNECTING);
+    }
+    break;
+
+  case CONNECTING:
+    if (_step == 0)
+    {
+      snprintf(command, sizeof(command), "AT+CIPSTART=\"TCP\",\"%s\",%u", _host, (unsigned)_port);
+      _connectReply = CONNECT_WAITING;
+      _closed = false;
+      if (_command(command, AT_DEFAULT_TIMEOUT))
+        _step++;
+    }
+    else if (failed || _connectReply == CONNECT_FAILED || now - _stateSince >= UPLINK_CONNECT_TIMEOUT)
+    {
+      _fail("server connection failed");
+    }
+    else if (_connectReply == CONNECT_DONE)
+    {
+      Serial.printf("Uplink: connected to %s:%u\n", _host, _port);
+      _stats.connects++;
+      _backoff = UPLINK_BACKOFF_MIN;
+      _nextSeq = _log.uploadCursor();
+      _inFlightCount = 0;
+      _eventsInFlight = 0;
+      _ackLength = 0;
+      _enter(ONLINE);
+    }
+    break;
+
+  case ONLINE:
+    if (_closed)
+    {
+      _fail("server closed the connection");
+      break;
+    }
+    if (failed)
+    {
+      _fail("modem error on the session");
+      break;
+    }
+    if (_inFlightCount > 0 && now - _inFlight[0].sentAt >= UPLINK_ACK_TIMEOUT)
+    {
+      _fail("ack timeout");
+      break;
+    }
+    if (_dataWaiting)
+    {
+      snprintf(command, sizeof(command), "AT+CIPRXGET=3,%u", (unsigned)UPLINK_READ_CHUNK);
+      if (_command(command, AT_DEFAULT_TIMEOUT, _onReceived))
+        _dataWaiting = false; // the reply says whether more is left
+      break;
+    }
+    if (!_sendEvents())
+    {
+      _sendBatch();
+    }
+    break;
+
+  case BACKOFF:
+    if (now - _stateSince >= _backoff)
+    {
+      _backoff = _backoff * 2 > UPLINK_BACKOFF_MAX ? UPLINK_BACKOFF_MAX : _backoff * 2;
+      _registered = false;
+      _enter(REGISTERING);
+    }
+    break;
+  }
+}
+
+// Feeds one received byte to the ack parser
+void Uplink::_receive(uint8_t c)
+{
+  if (_ackLength == 0 && c != 'A')
+  {
+    return; // resynchronise on the next ack marker
+  }
+  _ackBuffer[_ackLength++] = c;
+  if (_ackLength == sizeof(_ackBuffer))
+  {
+    _ack(_ackBuffer[1] | (_ackBuffer[2] << 8));
+    _ackLength = 0;
+  }
+}
+
+/**
+ * Retires every in-flight batch up to and including id, then persists the
+ * upload cursor once.
+ */
+void Uplink::_ack(uint16_t id)
+{
+  bool matched = false;
+  for (uint8_t i = 0; i < _inFlightCount; i++)
+  {
+    if (_inFlight[i].id == id)
+    {
+      matched = true;
+      break;
+    }
+  }
+  if (!matched)
+  {
+    return; // stale ack from a previous session
+  }
+
+  uint32_t endSeq = 0;
+  while (_inFlightCount > 0)
+  {
+    InFlight done = _inFlight[0];
+    for (uint8_t i = 1; i < _inFlightCount; i++)
+    {
+      _inFlight[i - 1] = _inFlight[i];
+    }
+    _inFlightCount--;
+    _stats.batchesAcked++;
+    _stats.fixesAcked += done.fixes;
+    _stats.ackTimeMs += millis() - done.sentAt;
+    _stats.eventsAcked += done.events;
+    _dropEvents(done.events);
+    endSeq = done.endSeq;
+    if (done.id == id)
+    {
+      break;
+    }
+  }
+  _log.commitCursor(endSeq);
+}
+
+bool Uplink::_sendBatch()
+{
+  if (_inFlightCount >= UPLINK_WINDOW)
+  {
+    return false;
+  }
+  if (_nextSeq < _log.oldestSeq())
+  {
+    _nextSeq = _log.oldestSeq(); // overwritten before it could be sent
+  }
+
+  uint32_t pending = _log.headSeq() - _nextSeq;
+  if (pending == 0)
+  {
+    _pendingSince = 0;
+    _flushRequested = false;
+    return false;
+  }
+  if (_pendingSince == 0)
+  {
+    _pendingSince = millis();
+  }
+  bool due = pending >= _batchSize || _flushRequested || millis() - _pendingSince >= UPLINK_BATCH_AGE;
+  if (!due)
+  {
+    return false;
+  }
+
+  uint32_t endSeq;
+  uint16_t count = _log.read(_nextSeq, _fixes, _batchSize, &endSeq);
+  if (count == 0)
+  {
+    _nextSeq = endSeq; // only unreadable records, skip them
+    return false;
+  }
+
+  uint16_t length = encodeTelemetryBatch(_fixes, count, _fieldMask, _frame + UPLINK_HEADER_SIZE,
+                                         sizeof(_frame) - UPLINK_HEADER_SIZE);
+  if (!_sendFrame(UPLINK_FRAME_FIXES, length, endSeq, count, 0))
+  {
+    return false;
+  }
+  _nextSeq = endSeq;
+  _pendingSince = 0;
+  _flushRequested = false;
+  _stats.fixesSent += count;
+  _stats.fixBytes += length;
+  return true;
+}
+
+/**
+ * Queues the payload already in _frame behind a header with AT+CIPSEND
+ * and records it as in flight. endSeq is the upload cursor to commit once
+ * it is acked. _frame stays untouched until the send completes, since
+ * poll() does nothing else while a command is pending.
+ */
+bool Uplink::_sendFrame(uint8_t type, uint16_t length, uint32_t endSeq, uint16_t fixes, uint8_t events)
+{
+  uint16_t id = _nextId;
+  _frame[0] = 'T';
+  _frame[1] = 'M';
+  _frame[2] = type;
+  _frame[3] = id & 0xFF;
+  _frame[4] = id >> 8;
+  _frame[5] = length & 0xFF;
+  _frame[6] = length >> 8;
+
+  uint16_t total = UPLINK_HEADER_SIZE + length;
+  char command[24];
+  snprintf(command, sizeof(command), "AT+CIPSEND=%u", (unsigned)total);
+  if (!_at.sendData(command, _frame, total, UPLINK_SEND_TIMEOUT, _onCommandDone, this))
+  {
+    return false; // AT queue full, sent on a later poll
+  }
+  _commandPending = true;
+  _nextId++;
+
+  InFlight &frame = _inFlight[_inFlightCount++];
+  frame.id = id;
+  frame.endSeq = endSeq;
+  frame.fixes = fixes;
+  frame.events = events;
+  frame.sentAt = millis();
+
+  _stats.batchesSent++;
+  _stats.bytesSent += total;
+  return true;
+}
+
+bool Uplink::queueEvent(const UplinkEvent &event)
+{
+  if (_eventCount >= UPLINK_EVENT_QUEUE)
+  {
+    _stats.eventsDropped++;
+    return false;
+  }
+  _events[_eventCount++] = event;
+  return true;
+}
+
+// Remove acknowledged events from the front of the queue
+void Uplink::_dropEvents(uint8_t count)
+{
+  if (count > _eventCount)
+    count = _eventCount;
+  for (uint8_t i = count; i < _eventCount; i++)
+  {
+    _events[i - count] = _events[i];
+  }
+  _eventCount -= count;
+  _eventsInFlight = _eventsInFlight > count ? _eventsInFlight - count : 0;
+}
+
+// Sends every queued event that is not in flight yet, ahead of fix batches
+bool Uplink::_sendEvents()
+{
+  if (_eventsInFlight >= _eventCount || _inFlightCount >= UPLINK_WINDOW)
+  {
+    return false;
+  }
+
+  uint8_t count = _eventCount - _eventsInFlight;
+  uint8_t *p = _frame + UPLINK_HEADER_SIZE;
+  *p++ = count;
+  for (uint8_t i = _eventsInFlight; i < _eventCount; i++)
+  {
+    const UplinkEvent &event = _events[i];
+    *p++ = event.type;
+    *p++ = event.code & 0xFF;
+    *p++ = event.code >> 8;
+    for (uint8_t b = 0; b < 32; b += 8)
+      *p++ = (event.timestamp >> b) & 0xFF;
+    for (uint8_t b = 0; b < 32; b += 8)
+      *p++ = ((uint32_t)event.latitude >> b) & 0xFF;
+    for (uint8_t b = 0; b < 32; b += 8)
+      *p++ = ((uint32_t)event.longitude >> b) & 0xFF;
+  }
+
+  // Acking this frame also acks every earlier fix batch, so it carries
+  // their cursor
+  uint32_t endSeq = _inFlightCount > 0 ? _inFlight[_inFlightCount - 1].endSeq : _log.uploadCursor();
+  if (!_sendFrame(UPLINK_FRAME_EVENTS, (uint16_t)(p - _frame - UPLINK_HEADER_SIZE), endSeq, 0, count))
+  {
+    return false;
+  }
+  _eventsInFlight = _eventCount;
+  _stats.eventsSent += count;
+  return true;
+}
+
+void Uplink::printStats(Print &out) const
+{
+  uint32_t onlineMs = _stats.onlineMs + (_state == ONLINE ? millis() - _stateSince : 0);
+  out.printf("Uplink: %s, %u connects, %u failures\n",
+             _state == ONLINE ? "online" : "offline", (unsigned)_stats.connects, (unsigned)_stats.failures);
+  out.printf("Uplink: %u/%u batches acked, %u fixes acked, %u bytes sent\n",
+             (unsigned)_stats.batchesAcked, (unsigned)_stats.batchesSent,
+             (unsigned)_stats.fixesAcked, (unsigned)_stats.bytesSent);
+  if (_stats.fixesSent > 0)
+  {
+    out.printf("Uplink: %.1f bytes/fix, %.1f bytes/s online\n",
+               (double)_stats.bytesSent / _stats.fixesSent,
+               onlineMs > 0 ? _stats.bytesSent * 1000.0 / onlineMs : 0.0);
+    out.printf("Uplink: %.1f encoded bytes/fix, %u as StoredFix\n", (double)_stats.fixBytes / _stats.fixesSent,
+               (unsigned)sizeof(StoredFix));
+  }
+  if (_stats.eventsSent > 0 || _stats.eventsDropped > 0)
+  {
+    out.printf("Uplink: %u/%u events acked, %u dropped\n",
+               (unsigned)_stats.eventsAcked, (unsigned)_stats.eventsSent, (unsigned)_stats.eventsDropped);
+  }
+  if (_stats.batchesAcked > 0)
+  {
+    out.printf("Uplink: %u ms average ack time\n", (unsigned)(_stats.ackTimeMs / _stats.batchesAcked));
+  }
+}
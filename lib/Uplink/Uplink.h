@@ -0,0 +1,213 @@
+/*
+ * GPRS uplink: drains the fix log to the tracking server over one
+ * persistent TCP session opened with the SIM808 TCP/IP commands.
+ *
+ * Fixes are sent in batches of batchSize fixes, or earlier when the oldest
+ * unsent fix has waited UPLINK_BATCH_AGE. Up to UPLINK_WINDOW batches are
+ * in flight at once, so the next batch goes out while the server is still
+ * acknowledging the previous one. The upload cursor in the log only moves
+ * when a batch is acknowledged; after a reconnect everything from the
+ * cursor on is sent again.
+ *
+ * Wire format (little endian):
+ *   batch  'T' 'M' type(1) batchId(2) length(2) payload(length)
+ *   ack    'A' batchId(2)   acknowledges every batch up to batchId
+ * The payload of a fix batch is encoded by TelemetryCodec. An event frame
+ * carries count(1) then per event type(1) code(2) timestamp(4)
+ * latitude(4) longitude(4). Events jump ahead of pending fix batches and
+ * are kept in RAM until acknowledged.
+ *
+ * Every modem exchange goes through the AT engine: AT+CREG? while
+ * registering, AT+CGATT, AT+CSTT, AT+CIICR and AT+CIFSR to attach,
+ * AT+CIPSTART to connect, AT+CIPSEND for frames and AT+CIPRXGET in hex mode
+ * for acks. poll() never waits for the modem. It queues at most one command
+ * and picks its result up on a later call, so a slow attach does not hold
+ * up the other modem jobs or the NMEA stream. poll() and queueEvent() must
+ * run on the task that polls the AT engine.
+ */
+
+#ifndef Uplink_h
+#define Uplink_h
+
+#include "Arduino.h"
+#include "ATEngine.h"
+#include "FixLog.h"
+#include "TelemetryCodec.h"
+
+#define UPLINK_MAX_BATCH 32            // largest batch, in fixes
+#define UPLINK_DEFAULT_BATCH 10        // fixes per batch
+#define UPLINK_BATCH_AGE 60000         // send a partial batch after this many ms
+#define UPLINK_WINDOW 2                // batches waiting for an ack
+#define UPLINK_ACK_TIMEOUT 30000       // reconnect when an ack takes longer
+#define UPLINK_REGISTER_TIMEOUT 60000  // give up waiting for network registration
+#define UPLINK_REGISTER_CHECK 1000     // AT+CREG? interval while registering
+#define UPLINK_ATTACH_TIMEOUT 85000    // longest AT+CGATT or AT+CIICR reply
+#define UPLINK_CONNECT_TIMEOUT 75000   // wait for CONNECT OK after AT+CIPSTART
+#define UPLINK_SEND_TIMEOUT 10000      // prompt and SEND OK of one frame
+#define UPLINK_READ_CHUNK 60           // bytes per AT+CIPRXGET, sent as hex so the line must fit AT_LINE_MAX
+#define UPLINK_BACKOFF_MIN 2000        // first reconnect delay
+#define UPLINK_BACKOFF_MAX 120000      // reconnect delay never grows past this
+#define UPLINK_HEADER_SIZE 7
+#define UPLINK_FRAME_FIXES 1           // frame type of a fix batch
+#define UPLINK_FRAME_EVENTS 2          // frame type of an event list
+#define UPLINK_EVENT_QUEUE 8           // events waiting for an ack
+#define UPLINK_EVENT_SIZE 15
+
+// High-priority event, sent ahead of the fix log
+struct UplinkEvent
+{
+  uint8_t type;       // UPLINK_EVENT_*
+  uint16_t code;      // meaning depends on type, e.g. station id
+  uint32_t timestamp; // UTC seconds
+  int32_t latitude;   // 1e-7 degrees
+  int32_t longitude;
+};
+
+#define UPLINK_EVENT_STATION_ENTER 1
+#define UPLINK_EVENT_STATION_EXIT 2
+#define UPLINK_EVENT_BATTERY 3       // code is the estimated minutes to empty
+
+struct UplinkStats
+{
+  uint32_t connects;     // TCP sessions opened
+  uint32_t failures;     // registration, attach, connect or session failures
+  uint32_t batchesSent;
+  uint32_t batchesAcked;
+  uint32_t fixesSent;    // includes resent fixes
+  uint32_t fixesAcked;
+  uint32_t bytesSent;    // headers and payload
+  uint32_t fixBytes;     // encoded fix payload, without headers
+  uint32_t ackTimeMs;    // sum of send-to-ack times of acknowledged batches
+  uint32_t onlineMs;     // time spent with the session open
+  uint32_t eventsSent;   // includes resent events
+  uint32_t eventsAcked;
+  uint32_t eventsDropped; // queue was full
+};
+
+class Uplink
+{
+public:
+  Uplink(ATEngine &at, FixLog &log);
+
+  void configure(const char *apn, const char *user, const char *pass, const char *host, uint16_t port);
+
+  // Register the modem's TCP/IP URCs and start network bring-up; the session is then kept up by poll()
+  bool begin();
+
+  // Advance the connection state machine and move data
+  void poll();
+
+  // Send whatever is pending without waiting for a full batch
+  void requestFlush() { _flushRequested = true; }
+
+  void setBatchSize(uint8_t fixes);
+  uint8_t batchSize() const { return _batchSize; }
+
+  // Queue an event for immediate delivery. Call from the task running poll().
+  bool queueEvent(const UplinkEvent &event);
+
+  // Optional TELEMETRY_HAS_* fields sent with every fix
+  void setFieldMask(uint8_t fieldMask) { _fieldMask = fieldMask; }
+
+  bool isAttached() const { return _gprsAttached; }   // GPRS context is up
+  bool isConnected() const { return _state == ONLINE; } // TCP session is up
+
+  // Time until poll() next has to talk to the modem, 0 for now, UINT32_MAX when nothing is pending
+  uint32_t msUntilWork(unsigned long now) const;
+
+  const UplinkStats &stats() const { return _stats; }
+  void printStats(Print &out) const;
+
+private:
+  enum State
+  {
+    IDLE,
+    REGISTERING,
+    ATTACHING,
+    CONNECTING,
+    ONLINE,
+    BACKOFF
+  };
+
+  struct InFlight
+  {
+    uint16_t id;
+    uint32_t endSeq; // first sequence number after the batch
+    uint16_t fixes;
+    uint8_t events;  // events carried, they lead the event queue
+    unsigned long sentAt;
+  };
+
+  enum ConnectReply
+  {
+    CONNECT_WAITING,
+    CONNECT_DONE,
+    CONNECT_FAILED
+  };
+
+  static void _onCommandDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context);
+  static void _onRegistration(const char *line, void *context);
+  static void _onReceived(const char *line, void *context);
+  static void _onURC(const char *line, void *context);
+
+  bool _command(const char *command, uint32_t timeoutMs, ATLineHandler onLine = NULL);
+  bool _attachStep(uint8_t step);
+  void _enter(State state);
+  void _fail(const char *reason);
+  void _receive(uint8_t c);
+  void _ack(uint16_t id);
+  bool _sendBatch();
+  bool _sendEvents();
+  void _dropEvents(uint8_t count);
+  bool _sendFrame(uint8_t type, uint16_t length, uint32_t endSeq, uint16_t fixes, uint8_t events);
+
+  ATEngine &_at;
+  FixLog &_log;
+
+  const char *_apn;
+  const char *_user;
+  const char *_pass;
+  const char *_host;
+  uint16_t _port;
+
+  State _state;
+  unsigned long _stateSince;
+  unsigned long _lastCheck;
+  uint32_t _backoff;
+  uint8_t _step;              // command sequence position in ATTACHING and CONNECTING
+  bool _commandPending;       // a command of ours is queued or in flight
+  bool _commandDone;          // its result is waiting for poll()
+  ATResult _commandResult;
+  bool _registered;           // +CREG reported home or roaming
+  ConnectReply _connectReply;
+  bool _closed;               // CLOSED or +PDP: DEACT arrived
+  bool _dataWaiting;          // the modem holds received bytes
+  bool _gprsAttached;
+  volatile bool _started;
+  volatile bool _flushRequested;
+
+  uint8_t _batchSize;
+  uint8_t _fieldMask;
+  uint32_t _nextSeq;          // next sequence number to send
+  unsigned long _pendingSince; // when unsent fixes first appeared
+  uint16_t _nextId;
+  InFlight _inFlight[UPLINK_WINDOW];
+  uint8_t _inFlightCount;
+
+  uint8_t _ackBuffer[3];
+  uint8_t _ackLength;
+
+  uint8_t _frame[UPLINK_HEADER_SIZE + TELEMETRY_BATCH_MAX(UPLINK_MAX_BATCH)];
+  static_assert(TELEMETRY_BATCH_MAX(UPLINK_MAX_BATCH) >= 1 + UPLINK_EVENT_QUEUE * UPLINK_EVENT_SIZE,
+                "frame buffer too small for a full event queue");
+  static_assert(2 * UPLINK_READ_CHUNK < AT_LINE_MAX, "received hex line longer than the AT engine keeps");
+  StoredFix _fixes[UPLINK_MAX_BATCH];
+
+  UplinkEvent _events[UPLINK_EVENT_QUEUE];
+  uint8_t _eventCount;
+  uint8_t _eventsInFlight;
+
+  UplinkStats _stats;
+};
+
+#endif
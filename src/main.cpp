@@ -1,10 +1,36 @@
 #include <Arduino.h>
-#include <TinyGsmClient.h>
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <esp_task_wdt.h>
 #include "Pangodream_18650_CL.h"
+#include "CGNSINFParser.h"
+#include "NMEAParser.h"
+#include "ATEngine.h"
+#include "FixLog.h"
+#include "Uplink.h"
+#include "GeoMath.h"
+#include "GPSSampler.h"
+#include "TrackSimplifier.h"
+#include "Geofence.h"
+#include "Stations.h"
+#include "FixFilter.h"
+#include "BatteryMonitor.h"
+#include "PowerGovernor.h"
+#include "DischargeEstimator.h"
+#include "PartialSSD1306.h"
+#include "UIEvents.h"
+#include "ScreenAnimator.h"
+#include "Screens.h"
+#include "BootConfig.h"
+#include "BootTimeline.h"
+#include "DeviceState.h"
+#include "DeviceEvents.h"
+#include "Scheduler.h"
+#include "TaskMonitor.h"
+#include "ModemUart.h"
+#include "ModemLink.h"
+#include "ModemPower.h"
 
 // OLED display dimensions
 #define SCREEN_WIDTH 128
@@ -17,24 +43,93 @@
 #define ADC_PIN 34
 #define CONV_FACTOR 1.8
 #define READS 20
+#define BATTERY_DIVIDER_RATIO 2.0 // two equal resistors between the cell and ADC_PIN
 //--------------------------------------------
 // Define constants for serial communication and LED indication
 #define MODEM_TX 17 // Connect to SIM808 RX
 #define MODEM_RX 16 // Connect to SIM808 TX
 #define MODEM_RST 5 // Optional, connect to SIM808 RST
+#define MODEM_DTR 25 // SIM808 DTR, high lets it sleep (AT+CSCLK=1)
+#define MODEM_RI 26  // SIM808 RI, pulled low on an incoming call, SMS or data
 #define LED_MODEM 2 // LED pin for modem status indication
 #define LED_GPRS 4  // LED pin for GPRS status indication
-#define LED_GPS 13  // LED pin for GPS status indication
+#define LED_GPS 14  // LED pin for GPS status indication, GPIO 13 is the charger input
 #define SERIAL_BAUD 115200
-#define MODEM_BAUD 9600
+#define MODEM_BAUD 9600       // first boot, before a rate has been negotiated
+#define MODEM_BAUD_MAX 460800 // fastest rate the link setup asks the modem for
 #define MAX_RETRIES 5
-#define GPS_TIME_GAP 10000 // get gps data for each # of time gap
-
-// Initialize HardwareSerial port
-HardwareSerial modemSerial(2); // Use UART2
-TinyGsm modem(modemSerial);
+#define GPS_RESPONSE_TIMEOUT 1000 // max wait for the +CGNSINF reply
+#define GNSS_PROBE_INTERVAL 1000  // poll mode: +CGNSINF rate from GNSS power-up to the first fix
+#define GPS_STREAM_MODE 1         // 1 = take fixes from the 1 Hz NMEA stream, 0 = poll AT+CGNSINF
+#define AT_STATS_INTERVAL 60000   // print AT command latency statistics every # of time
+#define FIXLOG_FLUSH_INTERVAL 30000 // max time a logged fix waits in RAM before it is written to flash
+#define POWER_CHECK_INTERVAL 5000   // how often the power governor looks at the battery
+#define MODEM_SLEEP_CHECK 50        // how often modem sleep and wake are decided
+#define MODEM_POLL_INTERVAL 10      // AT engine, GPS sampler and uplink service period
+#define WATCHDOG_FEED_INTERVAL 1000 // loop() task feeds the watchdog this often
+#define CONSOLE_POLL_INTERVAL 50    // serial diagnostic commands are read this often
+#define CONSOLE_LINE_MAX 16
+#define BATTERY_REPORT_INTERVAL 900000 // time-to-empty sent to the server this often
+// UI task frame pacing
+#define UI_MIN_FRAME_INTERVAL 100 // never draw more than 10 frames a second
+#define UI_SPINNER_INTERVAL 150   // loading animation step
+#define UI_STATUS_INTERVAL 1000   // status bar refresh
+#define UI_READY_HOLD 2000        // "Device is ready" stays up this long
+// GPRS uplink settings
+#define GPRS_APN ""                          // APN of the SIM operator
+#define GPRS_USER ""
+#define GPRS_PASS ""
+#define UPLINK_HOST "tracking.example.com"   // Tracking server (or a local stand-in for measurements)
+#define UPLINK_PORT 5000
+#define GPRS_INIT_TIMEOUT 120000             // show the GPRS error screen after this long
+#define GPRS_STATUS_INTERVAL 1000            // how often loop() checks the background GPRS attach
+
+// Modem UART, received bytes go through a lock-free ring to the modem task
+ModemUart modemSerial(UART_NUM_2);
+ModemLink modemLink(modemSerial); // Finds and raises the UART rate before the AT engine starts
+ATEngine atEngine(modemSerial); // Queued, non-blocking AT commands
 Pangodream_18650_CL BL(ADC_PIN, CONV_FACTOR, READS);                      // object in Pangodreaam_18650_CL class
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET); // Object in Adafruit_SSD1306 class
+PartialSSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);   // SSD1306 that only sends changed regions
+ScreenAnimator screenAnimator(SCREEN_WIDTH, SCREEN_HEIGHT);              // boot and welcome screens from flash
+UIQueue uiQueue;                                                          // Events for the UI task, the only task drawing once setup() is done
+CGNSINFParser gpsParser;                                                  // Streaming parser for AT+CGNSINF replies
+NMEAParser nmeaParser;                                                    // Parser for the NMEA stream (GPS_STREAM_MODE)
+PartitionFlash fixLogFlash("fixlog");                                     // Raw "fixlog" partition from partitions.csv
+FixLog fixLog(fixLogFlash);                                               // Store-and-forward log of GPS fixes
+bool fixLogReady = false;
+Uplink uplink(atEngine, fixLog);            // Batched upload of the fix log over GPRS
+GPSSampler gpsSampler;                      // Picks the GPS poll interval and GNSS power state
+TrackSimplifier trackSimplifier;            // Drops fixes that add nothing to the track shape
+GeofenceMonitor stationFences(STATION_TABLE); // Arrival and departure at stations
+FixFilter fixFilter;                          // Rejects bad fixes and smooths the track
+BatteryMonitor battery(BL, BATTERY_DIVIDER_RATIO); // Samples the battery in the background
+PowerGovernor powerGovernor;                       // Picks duty cycles from the battery state
+ModemPower modemPower;                             // SIM808 sleep between exchanges, GNSS re-acquisition times
+DischargeEstimator dischargeEstimator(BL);         // Predicts the time to empty
+BootConfig bootConfig;                             // Mode and display address kept for a fast boot
+BootTimeline bootTimeline;                         // When each boot phase finished
+DeviceStateMachine deviceState;                    // Boot and mode selection flow, run by the setup()/loop() task only
+DeviceEventQueue deviceEvents;                     // Button presses and init results for deviceState
+SubsystemStatus subsystems;                        // Ready and failed bits of the modem, GPS, GPRS and RFID
+Scheduler modemJobs;                               // Periodic jobs of the modem task
+Scheduler loopJobs;                                // Periodic jobs of the setup()/loop() task
+TaskMonitor taskMonitor;                           // Starts the tasks below and profiles CPU and stack use
+
+// Task topology: modem UART and radio work on core 0, display, battery and the Arduino loop on core 1.
+// The modem RX task only moves bytes from the UART driver into the ring. It preempts everything on
+// core 0 so the driver buffer never fills. The modem task polls the ring and must preempt the
+// one-off init tasks. The UI task preempts loop() so printing statistics never stalls a frame.
+// Stack sizes leave headroom over the watermarks in the "tasks" report.
+const TaskSpec MODEM_TASK = {"ModemTask", 6144, 3, 0};
+const TaskSpec MODEM_BRINGUP_TASK = {"ModemBringUp", 4096, 2, 0};
+const TaskSpec INIT_REGISTER_TASK = {"InitRegisterTask", 3072, 1, 0};
+const TaskSpec INIT_TRACK_TASK = {"InitTrackTask", 3072, 1, 0};
+const TaskSpec UI_TASK = {"UITask", 3072, 2, 1};
+#define MODEM_RX_TASK_PRIORITY 4 // ModemRx, MODEM_UART_TASK_STACK bytes on core 0
+#define MODEM_RX_TASK_CORE 0
+#define BATTERY_TASK_PRIORITY 1 // BatterySampler, BATTERY_TASK_STACK bytes on core 1
+#define BATTERY_TASK_CORE 1
+#define LOOP_TASK_STACK 8192    // Arduino loopTask, core 1, priority 1
 //--------------------------------------------
 const long intervalFast = 100;
 const long intervalSlow = 1000;
@@ -45,15 +140,9 @@ int ledState = LOW;
 int signalStrength = 100;  // Example value
 String networkType = "3G"; // Example value
 
-// variables to keep track of the timing of recent interrupts (button bouncing)
-unsigned long button_time = 0;
-unsigned long last_button_time = 0;
-
 //-------------------------------------------
 // Multitasking handler
-TaskHandle_t setupTaskHandle;
-TaskHandle_t initRegisterTaskHandle = NULL;
-TaskHandle_t initTrackTaskHandle = NULL;
+TaskHandle_t modemTaskHandle = NULL;
 //-------------------------------------------
 
 // Loading animation frames
@@ -64,18 +153,8 @@ const char *loadingFrames[] = {
     "\\"};
 const int numFrames = 4;
 
-volatile bool START = false;                // prevent from unexpected button inputs.
-volatile bool SELECTMODE = false;           // prevent from unexpected button inputs.
-volatile bool continueWelcomeScreen = true; // Flag to control showing welcome screen
-volatile bool selectModeOption = true;      // Flag to select the operating mode.
-volatile bool confirmMode = true;           // flag for the confirmatio of the selected mode by start button
-volatile bool displayTrackParcelsScreen = false;
-volatile bool displayRegisterParcelsScreen = false;
-volatile bool RFIDisOK = false;  // flag for RFID initialization
-volatile bool MODEMisOK = false; // flag for SIM808 initialization
-volatile bool GPRSisOK = false;  // flag for GPRS initialization
-volatile bool GPSisOK = false;   // flag for GPS initialization
-volatile bool initERROR = false; // flag for error in any module
+volatile uint32_t uiFrames = 0;       // frames drawn by the UI task
+volatile uint32_t uiRenderMicros = 0; // time the UI task spent drawing and flushing
 
 // strutures for external button interrupts
 struct Button
@@ -86,34 +165,42 @@ struct Button
 Button START_BUTTON = {32};
 Button MODE_SELECT_BUTTON = {33};
 
+// The ISRs only stamp and queue the press, deviceState debounces and decides what it means
 void IRAM_ATTR startButtonInterrupt()
 {
-  button_time = millis();
-  if (button_time - last_button_time > 250)
-  {
-    if (START && !SELECTMODE)
-    {
-      continueWelcomeScreen = false;
-    }
-    if (START && SELECTMODE)
-    {
-      confirmMode = false;
-    }
-    last_button_time = button_time;
-  }
+  deviceEvents.postFromISR(EVENT_START_BUTTON);
 }
 
 void IRAM_ATTR modeSelectButtonInterrupt()
 {
-  button_time = millis();
-  if (button_time - last_button_time > 250)
+  deviceEvents.postFromISR(EVENT_MODE_BUTTON);
+}
+
+// RI falls on an incoming call, SMS or server data; the modem task wakes the SIM808 to read it
+void IRAM_ATTR modemRingInterrupt()
+{
+  modemPower.requestWake();
+}
+
+// Runs an event through deviceState, setup()/loop() task only
+DeviceAction dispatchDeviceEvent(const DeviceEvent &event)
+{
+  DeviceStateId from = deviceState.state();
+  DeviceAction action = deviceState.handle(event);
+  if (deviceState.state() != from)
   {
-    if (START && SELECTMODE)
-    {
-      selectModeOption = !selectModeOption;
-    }
-    last_button_time = button_time;
+    Serial.printf("Device state: %s -> %s (%s)\n", DeviceStateMachine::stateName(from),
+                  DeviceStateMachine::stateName(deviceState.state()), DeviceStateMachine::eventName(event.type));
   }
+  return action;
+}
+
+DeviceAction dispatchDeviceEvent(DeviceEventType type)
+{
+  DeviceEvent event;
+  event.type = type;
+  event.at = millis();
+  return dispatchDeviceEvent(event);
 }
 
 // I2C Scanner Function
@@ -160,6 +247,13 @@ int scanI2C()
   }
 }
 
+// Checks that a device still answers at address, used instead of a full scan on a fast boot
+bool probeI2C(int address)
+{
+  Wire.beginTransmission(address);
+  return Wire.endTransmission() == 0;
+}
+
 // Function to notify user of an error in OLED display initialization process.
 void notifyUserAboutDisplayError(const char *message)
 {
@@ -212,15 +306,7 @@ void testDisplay()
 // Function for display the current operating mode
 void showOperateMode()
 {
-  String mode;
-  if (displayTrackParcelsScreen)
-  {
-    mode = "TM";
-  }
-  if (displayRegisterParcelsScreen)
-  {
-    mode = "RM";
-  }
+  String mode = deviceState.mode() == MODE_TRACK ? "TM" : "RM"; // fixed before the UI task starts
   display.setTextSize(1);
   display.setCursor(50, 2);
   display.print(mode);
@@ -229,9 +315,14 @@ void showOperateMode()
 // Function to draw the battery icon and text on the display
 void drawBatteryStatus()
 {
-  float volts = BL.getBatteryVolts();
-  int level = BL.getBatteryChargeLevel();
+  int level = battery.snapshot().percent; // cached, no ADC read on the display task
   String status = String(level) + "%";
+  if ((millis() / 3000) % 2 == 1 && dischargeEstimator.minutesToEmpty() != ESTIMATOR_UNKNOWN)
+  {
+    char left[8];
+    dischargeEstimator.format(left, sizeof(left)); // every other 3 s, there is no room for both
+    status = left;
+  }
 
   // Draw the battery icon outline
   display.drawRect(SCREEN_WIDTH - 26, 0, 24, 12, SSD1306_WHITE); // Battery rectangle
@@ -263,75 +354,33 @@ void drawSignalStatus()
   display.setTextSize(1);
   display.setCursor(33, 2);
   display.print(networkType);
-  delay(200); // Wait before updating again
 }
 
 // success
 void showBootScreen()
 {
-  display.clearDisplay();
-  // Calculate the cursor position for center alignment
-  const char *line1 = "Track-ME";
-  const char *line2 = "Powered by EIT @ UOC";
-  const char *line3 = "(20/21 Batch)";
-  int16_t x1, y1;
-  uint16_t w, h;
-  display.setTextSize(2);
-  display.getTextBounds(line1, 0, 0, &x1, &y1, &w, &h);
-  int16_t cursorX1 = (SCREEN_WIDTH - w) / 2;
-  int16_t cursorY1 = (SCREEN_HEIGHT / 2) - h - 5; // adjust as needed for vertical position
-  display.setTextSize(1);
-  display.getTextBounds(line2, 0, 0, &x1, &y1, &w, &h);
-  int16_t cursorX2 = (SCREEN_WIDTH - w) / 2;
-  int16_t cursorY2 = (SCREEN_HEIGHT / 2) + 5; // adjust as needed for vertical position
-  display.setTextSize(1);
-  display.getTextBounds(line3, 0, 0, &x1, &y1, &w, &h);
-  int16_t cursorX3 = (SCREEN_WIDTH - w) / 2;
-  int16_t cursorY3 = (SCREEN_HEIGHT / 2) + 15; // adjust as needed for vertical position
-  // Set the cursor position and print the text
-  display.setTextSize(2);
-  display.setCursor(cursorX1, cursorY1);
-  display.println(line1);
-  display.setTextSize(1);
-  display.setCursor(cursorX2, cursorY2);
-  display.println(line2);
-  display.setTextSize(1);
-  display.setCursor(cursorX3, cursorY3);
-  display.println(line3);
+  screenAnimator.show(SCREEN_BOOT); // pre-rendered by tools/gen_screens.py
   display.display();
   delay(3000);
 }
 
+// Types the prompt one character per tick until START is pressed
 void showWelcomeScreen()
 {
-  const char *line1 = "Welcome to";
-  const char *line2 = "Track-ME";
-  const char *line3 = " Press START Button      to continue...";
-  int16_t x1, y1;
-  uint16_t w1, h1, w2, h2, w3, h3, w11, h11;
-  display.setTextSize(2);
-  display.getTextBounds(line1, 0, 0, &x1, &y1, &w1, &h1);
-  display.setTextSize(2);
-  display.getTextBounds(line2, 0, 0, &x1, &y1, &w2, &h2);
-  display.setTextSize(1);
-  display.getTextBounds(line3, 0, 0, &x1, &y1, &w3, &h3);
-  display.getTextBounds(line1, 0, 0, &x1, &y1, &w11, &h11);
-  int len3 = strlen(line3);
-  for (int i = 0; i <= len3; i++)
+  screenAnimator.start(WELCOME_ANIMATION, millis());
+  display.display();
+  while (deviceState.state() == DEVICE_WELCOME)
   {
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setCursor((SCREEN_WIDTH - w11) / 2, 0); // Upper center horizontal alignment
-    display.println(line1);
-    display.setTextSize(2);
-    display.setCursor((SCREEN_WIDTH - w2) / 2, (SCREEN_HEIGHT / 2) - h2 / 2 - 2); // Center vertical position
-    display.println(line2);
-    display.setTextSize(1);
-    String part3 = String(line3).substring(0, i);
-    display.setCursor((SCREEN_WIDTH - w3) / 2, (SCREEN_HEIGHT / 2) + 16); // Lower center horizontal alignment
-    display.println(part3);
-    display.display();
-    delay(20);
+    // Sleeps until the next character is due or a button is pressed
+    DeviceEvent event;
+    if (deviceEvents.receive(event, pdMS_TO_TICKS(screenAnimator.msUntilNext(millis())) + 1))
+    {
+      dispatchDeviceEvent(event);
+    }
+    if (screenAnimator.tick(millis()))
+    {
+      display.display(); // only the revealed character goes over I2C
+    }
   }
 }
 
@@ -352,8 +401,6 @@ void displayInitializingProcess(const char *message, int &frame)
   display.display();
 
   frame = (frame + 1) % numFrames; // Update the frame
-
-  delay(50); // Delay to control animation speed
 }
 
 // function for display error in initializing process
@@ -371,6 +418,122 @@ void showInitializationError(const char *component)
   display.display();
 }
 
+// Function to display the end of the init sequence
+void showReadyScreen()
+{
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor(10, 50);
+  display.println("Device is ready..");
+  display.display();
+}
+
+// Function to draw the status bar, applying the display part of the power profile
+void showStatusBar()
+{
+  static PowerProfile shownProfile = POWER_PROFILE_COUNT;
+  PowerProfile profile = powerGovernor.profile();
+  const PowerSettings &power = PowerGovernor::settingsFor(profile);
+  if (profile != shownProfile)
+  {
+    display.ssd1306_command(power.displayOn ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF);
+    display.ssd1306_command(SSD1306_SETCONTRAST);
+    display.ssd1306_command(power.contrast);
+    shownProfile = profile;
+  }
+  if (!power.displayOn)
+  {
+    return;
+  }
+  display.clearDisplay();
+  drawBatteryStatus();
+  drawSignalStatus();
+  showOperateMode();
+  display.display();
+}
+
+/**
+ * Owns the display once the mode is picked. Sleeps on the UI queue until
+ * an event arrives or the current screen needs its next frame, so an idle
+ * screen costs one wake-up a second. Events that arrive together are
+ * drained before drawing, and frames are at least UI_MIN_FRAME_INTERVAL
+ * apart however many events come in.
+ */
+void uiTask(void *pvParameters)
+{
+  enum Screen
+  {
+    SCREEN_PROGRESS,
+    SCREEN_ERROR,
+    SCREEN_READY,
+    SCREEN_STATUS
+  };
+  Screen screen = SCREEN_PROGRESS;
+  char text[UI_TEXT_MAX] = "Starting";
+  int frame = 0;
+  bool dirty = true;
+  unsigned long lastFrame = 0;
+  unsigned long readyAt = 0;
+
+  for (;;)
+  {
+    uint32_t period = dirty ? UI_MIN_FRAME_INTERVAL : screen == SCREEN_PROGRESS ? UI_SPINNER_INTERVAL
+                                                                                : UI_STATUS_INTERVAL;
+    uint32_t since = millis() - lastFrame;
+    UIEvent event;
+    if (uiQueue.receive(event, since >= period ? 0 : pdMS_TO_TICKS(period - since)))
+    {
+      switch (event.type)
+      {
+      case UI_PROGRESS:
+        screen = SCREEN_PROGRESS;
+        break;
+      case UI_ERROR:
+        screen = SCREEN_ERROR;
+        break;
+      case UI_READY:
+        screen = SCREEN_READY;
+        readyAt = millis();
+        break;
+      case UI_STATUS:
+        break;
+      }
+      if (event.type == UI_PROGRESS || event.type == UI_ERROR)
+      {
+        strcpy(text, event.text);
+      }
+      dirty = true;
+      continue;
+    }
+
+    unsigned long start = micros();
+    if (screen == SCREEN_READY && millis() - readyAt >= UI_READY_HOLD)
+    {
+      screen = SCREEN_STATUS;
+    }
+    switch (screen)
+    {
+    case SCREEN_PROGRESS:
+      displayInitializingProcess(text, frame);
+      break;
+    case SCREEN_ERROR:
+      showInitializationError(text);
+      break;
+    case SCREEN_READY:
+      showReadyScreen();
+      break;
+    case SCREEN_STATUS:
+      showStatusBar();
+      break;
+    }
+    uiRenderMicros += micros() - start;
+    uiFrames++;
+    lastFrame = millis();
+    dirty = false;
+  }
+}
+
 // Function to indicate status with LEDs using millis for non-blocking delays
 void indicateStatus(int ledPin, int status)
 {
@@ -409,8 +572,7 @@ bool modemTest()
   Serial.println("Testing modem...");
 
   // Send basic AT command to check communication
-  modemSerial.println("AT");
-  if (modemSerial.find("OK"))
+  if (atEngine.sendAndWait("AT", AT_DEFAULT_TIMEOUT) == AT_OK)
   {
     Serial.println("Modem is responding to AT commands.");
     return true;
@@ -422,17 +584,106 @@ bool modemTest()
   }
 }
 
+void serviceGPSSampler();
+void servicePowerGovernor();
+void serviceModemSleep();
+void onNMEALine(const char *line, void *context);
+
+void atEngineJob(void *context)
+{
+  atEngine.poll();
+}
+
+void powerGovernorJob(void *context)
+{
+  servicePowerGovernor();
+}
+
+void modemSleepJob(void *context)
+{
+  serviceModemSleep();
+}
+
+void gpsSamplerJob(void *context)
+{
+  if (subsystems.isReady(SUBSYSTEM_GPS))
+  {
+    serviceGPSSampler();
+  }
+}
+
+void uplinkJob(void *context)
+{
+  if (modemPower.isAwake())
+  {
+    uplink.poll(); // queues its AT commands, a sleeping modem is woken by msUntilWork() instead
+  }
+}
+
+// Programs a partly filled batch so a logged fix never waits in RAM for longer than the interval
+void fixLogFlushJob(void *context)
+{
+  if (fixLogReady && fixLog.buffered() > 0)
+  {
+    fixLog.flush();
+  }
+}
+
+// Task that owns the modem UART and drives the AT command engine and the uplink
+void modemTask(void *pvParameters)
+{
+  // Budgets are what a job may take before it holds up the UART polling
+  modemJobs.add("AT engine", MODEM_POLL_INTERVAL, 2000, atEngineJob);
+  modemJobs.add("GPS sampler", MODEM_POLL_INTERVAL, 2000, gpsSamplerJob);
+  modemJobs.add("uplink", MODEM_POLL_INTERVAL, 2000, uplinkJob);
+  modemJobs.add("power", POWER_CHECK_INTERVAL, 5000, powerGovernorJob);
+  modemJobs.add("modem sleep", MODEM_SLEEP_CHECK, 1000, modemSleepJob);
+  modemPower.begin(millis());
+  modemJobs.add("fix log", FIXLOG_FLUSH_INTERVAL, 30000, fixLogFlushJob, NULL, FIXLOG_FLUSH_INTERVAL);
+  for (;;)
+  {
+    uint32_t wait = modemJobs.runDue();
+    vTaskDelay(wait > 0 ? pdMS_TO_TICKS(wait) : 1); // always yield a tick to lower priorities
+  }
+}
+
 // Function to initialize the modem
 bool initializeModem()
 {
   // Set modem reset, if used
   pinMode(MODEM_RST, OUTPUT);
   digitalWrite(MODEM_RST, HIGH);
+  pinMode(MODEM_DTR, OUTPUT);
+  digitalWrite(MODEM_DTR, LOW); // awake until the modem task lets it sleep
+  pinMode(MODEM_RI, INPUT_PULLUP);
+  attachInterrupt(MODEM_RI, modemRingInterrupt, FALLING);
 
   // Start communication with the modem
-  modemSerial.begin(MODEM_BAUD, SERIAL_8N1, MODEM_RX, MODEM_TX);
+  if (modemSerial.taskHandle() == NULL)
+  {
+    uint32_t baud = bootConfig.modemBaud() != 0 ? bootConfig.modemBaud() : MODEM_BAUD;
+    if (!modemSerial.begin(baud, MODEM_RX, MODEM_TX, MODEM_RX_TASK_PRIORITY, MODEM_RX_TASK_CORE))
+    {
+      return false;
+    }
+    taskMonitor.watch(modemSerial.taskHandle(), "ModemRx", MODEM_UART_TASK_STACK, MODEM_RX_TASK_CORE);
+  }
   delay(3000); // Give time for the modem to initialize
 
+  // Start the task that talks to the modem
+  if (modemTaskHandle == NULL)
+  {
+    // The link setup reads the port itself, so it runs before the modem task
+    if (modemLink.autobaud(bootConfig.modemBaud()))
+    {
+      bootConfig.saveModemBaud(modemLink.negotiate(MODEM_BAUD_MAX));
+      modemLink.printReport(Serial);
+      bootTimeline.mark("modem link");
+    }
+    atEngine.begin();
+    taskMonitor.start(MODEM_TASK, modemTask, NULL, &modemTaskHandle);
+  }
+
   for (int attempt = 1; attempt <= MAX_RETRIES; attempt++)
   {
     Serial.printf("Attempt %d of %d to initialize modem...\n", attempt, MAX_RETRIES);
@@ -454,6 +705,22 @@ bool initializeModem()
   indicateStatus(LED_MODEM, 1); // Indicate unable to connect
   return false;
 }
+
+// Powers the modem up while the boot screens and the mode question are shown
+void modemBringUpTask(void *pvParameters)
+{
+  if (initializeModem())
+  {
+    bootTimeline.mark("modem up");
+    subsystems.setReady(SUBSYSTEM_MODEM);
+  }
+  else
+  {
+    bootTimeline.mark("modem failed");
+    subsystems.setFailed(SUBSYSTEM_MODEM);
+  }
+  taskMonitor.exitTask();
+}
 // Function to configure GPS
 bool configureGPS()
 {
@@ -463,359 +730,699 @@ bool configureGPS()
   indicateStatus(LED_GPS, 0);
 
   // Power on the GPS
-  modemSerial.println("AT+CGNSPWR=1");
-  if (!modemSerial.find("OK"))
+  if (atEngine.sendAndWait("AT+CGNSPWR=1", AT_DEFAULT_TIMEOUT) != AT_OK)
   {
     Serial.println("Failed to power on GPS.");
     return false;
   }
+  modemPower.onGNSSPower(true, millis());
 
   // Configure the GPS NMEA output
-  modemSerial.println("AT+CGNSSEQ=\"RMC\"");
-  if (!modemSerial.find("OK"))
+  if (atEngine.sendAndWait("AT+CGNSSEQ=\"RMC\"", AT_DEFAULT_TIMEOUT) != AT_OK)
   {
     Serial.println("Failed to configure GPS NMEA output.");
     return false;
   }
 
+#if GPS_STREAM_MODE
+  // Stream NMEA on the modem UART, the sentences arrive as "$G..." URCs
+  atEngine.onURC("$G", onNMEALine, NULL);
+  if (atEngine.sendAndWait("AT+CGNSTST=1", AT_DEFAULT_TIMEOUT) != AT_OK)
+  {
+    Serial.println("Failed to start the GPS NMEA stream.");
+    return false;
+  }
+#endif
+
   Serial.println("GPS configured.");
+  gpsSampler.begin(millis());
+  subsystems.setReady(SUBSYSTEM_GPS); // the modem task starts sampling
   return true;
 }
 
-// Function to fetch GPS data
-void fetchGPSData()
+// Receives the intermediate lines of AT+CGNSINF
+void onGPSDataLine(const char *line, void *context)
 {
-  Serial.println("Fetching GPS data...");
-
-  // Send command to get GPS info
-  modemSerial.println("AT+CGNSINF");
+  bool *gotRecord = (bool *)context;
+  for (const char *c = line; *c != '\0'; c++)
+  {
+    gpsParser.feed(*c);
+  }
+  if (gpsParser.feed('\n'))
+  {
+    *gotRecord = true;
+  }
+}
 
-  // Read the response
-  String response = modemSerial.readString();
-  Serial.println(response);
+// Function to print a parsed GPS fix and update the GPS LED
+void reportGPSFix(const GPSFix &fix)
+{
+  static int32_t lastLatitude = 0;
+  static int32_t lastLongitude = 0;
+  static bool hadFix = false;
+  char coordinate[GEO_COORDINATE_CHARS];
 
-  // Parse the response to extract GPS info
-  if (response.indexOf("+CGNSINF:") != -1)
+  if (fix.fixStatus == 1)
   {
-    // Split the response based on commas
-    int start = response.indexOf(":") + 2; // Skip the "+CGNSINF: " part
-    String gpsInfo = response.substring(start);
-    char gpsData[gpsInfo.length() + 1];
-    gpsInfo.toCharArray(gpsData, gpsInfo.length() + 1);
+    Serial.println("GPS fix acquired.");
+    Serial.print("Latitude: ");
+    geoFormatCoordinate(fix.latitude, coordinate);
+    Serial.println(coordinate);
+    Serial.print("Longitude: ");
+    geoFormatCoordinate(fix.longitude, coordinate);
+    Serial.println(coordinate);
+    if (hadFix)
+    {
+      uint32_t movedCm = geoDistanceCm(lastLatitude, lastLongitude, fix.latitude, fix.longitude);
+      uint16_t bearing = geoBearingCdeg(lastLatitude, lastLongitude, fix.latitude, fix.longitude);
+      Serial.printf("Moved %u.%02u m, bearing %u.%02u degrees\n",
+                    (unsigned)(movedCm / 100), (unsigned)(movedCm % 100),
+                    (unsigned)(bearing / 100), (unsigned)(bearing % 100));
+    }
+    lastLatitude = fix.latitude;
+    lastLongitude = fix.longitude;
+    hadFix = true;
+    Serial.print("Altitude: ");
+    Serial.println(fix.altitude, 2);
+    Serial.print("Speed: ");
+    Serial.println(fix.speed, 2);
+    Serial.print("Course over ground (degrees): ");
+    Serial.println(fix.course, 2);
+    Serial.print("Horizontal Dilution of Precision (HDOP): ");
+    Serial.println(fix.hdop, 2);
+    Serial.print("Position Dilution of Precision (PDOP): ");
+    Serial.println(fix.pdop, 2);
+    Serial.print("Vertical Dilution of Precision (VDOP): ");
+    Serial.println(fix.vdop, 2);
+    Serial.print("Satellites in view: ");
+    Serial.println(fix.satellitesInView);
+    Serial.print("Satellites used: ");
+    Serial.println(fix.satellitesUsed);
+
+    // Indicate GPS fix acquired (solid on)
+    indicateStatus(LED_GPS, 2);
+  }
+  else
+  {
+    Serial.println("No valid GPS fix.");
+    // Indicate no valid GPS fix (slow blink)
+    indicateStatus(LED_GPS, 1);
+  }
+}
 
-    // Use strtok to parse the gpsData
-    char *token = strtok(gpsData, ",");
-    int gpsFix = 0;
-    float latitude = 0.0, longitude = 0.0, altitude = 0.0, speed = 0.0, course = 0.0;
-    float hdop = 0.0, pdop = 0.0, vdop = 0.0;
-    int satellitesInView = 0, satellitesUsed = 0;
+// Function to store a valid fix until it has been uploaded
+void logGPSFix(const GPSFix &fix)
+{
+  if (!fixLogReady || fix.fixStatus != 1)
+  {
+    return;
+  }
+  StoredFix stored, kept;
+  packFix(fix, stored);
+  bool keep = trackSimplifier.add(stored, kept);
+  if (keep && !fixLog.append(kept))
+  {
+    Serial.println("Failed to write GPS fix to the log.");
+  }
+  // Once the parcel stops, log where it stopped instead of holding it back
+  if (gpsSampler.state() == GPSSampler::STATIONARY && trackSimplifier.flush(kept) && !fixLog.append(kept))
+  {
+    Serial.println("Failed to write GPS fix to the log.");
+  }
+  // A partly filled batch is programmed by fixLogFlushJob
+}
 
-    // Iterate through tokens to find the GPS fix status, latitude, longitude, altitude, etc.
-    for (int i = 0; token != NULL; i++)
+// Function to report station arrivals and departures as soon as they happen
+void checkGeofences(const GPSFix &fix)
+{
+  if (fix.fixStatus != 1)
+  {
+    return;
+  }
+  GeofenceEvent events[2];
+  uint8_t count = stationFences.update(fix.latitude, fix.longitude, fix.timestamp, events, 2);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    const GeofenceEvent &event = events[i];
+    bool arrived = event.type == GEOFENCE_ENTER;
+    for (uint16_t s = 0; s < STATION_COUNT; s++)
     {
-      switch (i)
+      if (STATION_FENCES[s].id == event.fenceId)
       {
-      case 1: // GPS fix status
-        gpsFix = atoi(token);
-        break;
-      case 3: // Latitude
-        latitude = atof(token);
-        break;
-      case 4: // Longitude
-        longitude = atof(token);
-        break;
-      case 5: // Altitude
-        altitude = atof(token);
-        break;
-      case 6: // Speed over ground
-        speed = atof(token);
-        break;
-      case 7: // Course over ground
-        course = atof(token);
-        break;
-      case 9: // HDOP
-        hdop = atof(token);
-        break;
-      case 10: // PDOP
-        pdop = atof(token);
-        break;
-      case 11: // VDOP
-        vdop = atof(token);
-        break;
-      case 14: // Satellites in view
-        satellitesInView = atoi(token);
-        break;
-      case 15: // Satellites used
-        satellitesUsed = atoi(token);
+        Serial.printf("%s station %s.\n", arrived ? "Arrived at" : "Departed from", STATION_NAMES[s]);
         break;
       }
-      token = strtok(NULL, ",");
-    }
-
-    if (gpsFix == 1)
-    {
-      Serial.println("GPS fix acquired.");
-      Serial.print("Latitude: ");
-      Serial.println(latitude, 6);
-      Serial.print("Longitude: ");
-      Serial.println(longitude, 6);
-      Serial.print("Altitude: ");
-      Serial.println(altitude, 2);
-      Serial.print("Speed: ");
-      Serial.println(speed, 2);
-      Serial.print("Course over ground (degrees): ");
-      Serial.println(course, 2);
-      Serial.print("Horizontal Dilution of Precision (HDOP): ");
-      Serial.println(hdop, 2);
-      Serial.print("Position Dilution of Precision (PDOP): ");
-      Serial.println(pdop, 2);
-      Serial.print("Vertical Dilution of Precision (VDOP): ");
-      Serial.println(vdop, 2);
-      Serial.print("Satellites in view: ");
-      Serial.println(satellitesInView);
-      Serial.print("Satellites used: ");
-      Serial.println(satellitesUsed);
-
-      // Indicate GPS fix acquired (solid on)
-      indicateStatus(LED_GPS, 2);
     }
-    else
+    UplinkEvent uplinkEvent;
+    uplinkEvent.type = arrived ? UPLINK_EVENT_STATION_ENTER : UPLINK_EVENT_STATION_EXIT;
+    uplinkEvent.code = event.fenceId;
+    uplinkEvent.timestamp = event.timestamp;
+    uplinkEvent.latitude = event.latitude;
+    uplinkEvent.longitude = event.longitude;
+    if (!uplink.queueEvent(uplinkEvent))
     {
-      Serial.println("No valid GPS fix.");
-      // Indicate no valid GPS fix (slow blink)
-      indicateStatus(LED_GPS, 1);
+      Serial.println("Uplink event queue is full, station event dropped.");
     }
   }
+}
+
+// Sends the time-to-empty estimate along with a fix every BATTERY_REPORT_INTERVAL
+void reportBatteryEstimate(const GPSFix &fix)
+{
+  static unsigned long lastReport = 0;
+  uint16_t minutes = dischargeEstimator.minutesToEmpty();
+  if (fix.fixStatus != 1 || minutes == ESTIMATOR_UNKNOWN ||
+      (lastReport != 0 && millis() - lastReport < BATTERY_REPORT_INTERVAL))
+  {
+    return;
+  }
+  UplinkEvent event;
+  event.type = UPLINK_EVENT_BATTERY;
+  event.code = minutes;
+  event.timestamp = fix.timestamp;
+  event.latitude = fix.latitude;
+  event.longitude = fix.longitude;
+  if (uplink.queueEvent(event))
+  {
+    lastReport = millis();
+  }
+}
+
+// Function to run a new fix through the filter, sampler, geofences and log
+void handleGPSFix(const GPSFix &raw)
+{
+  GPSFix fix;
+  FixVerdict verdict = fixFilter.update(raw, millis(), fix);
+  reportGPSFix(raw);
+  if (verdict != FIX_ACCEPTED && verdict != FIX_NO_FIX)
+  {
+    Serial.printf("GPS fix rejected: %s.\n", FixFilter::verdictName(verdict));
+    fix.fixStatus = 0; // treat it like no fix at all
+  }
+  if (fix.fixStatus == 1 && bootTimeline.at("first fix") == 0)
+  {
+    bootTimeline.mark("first fix");
+    Serial.printf("Time to first fix: %u ms after power-on\n", (unsigned)bootTimeline.at("first fix"));
+    bootTimeline.print(Serial);
+  }
+  gpsSampler.onFix(fix, millis());
+  checkGeofences(fix);
+  reportBatteryEstimate(fix);
+  logGPSFix(fix);
+}
+
+// Receives the NMEA sentences of the GPS stream, runs on the modem task
+void onNMEALine(const char *line, void *context)
+{
+  bool complete = false;
+  for (const char *c = line; *c != '\0'; c++)
+  {
+    complete |= nmeaParser.feed(*c);
+  }
+  complete |= nmeaParser.feed('\n');
+  if (complete)
+  {
+    modemPower.onGNSSFix(nmeaParser.fix().fixStatus == 1, millis()); // times the re-acquisition
+  }
+  // The stream runs at 1 Hz, the sampler decides which fixes are used
+  if (complete && gpsSampler.fixDue(millis()))
+  {
+    handleGPSFix(nmeaParser.fix());
+  }
+}
+
+bool gpsRequestPending = false; // a GPS command is queued, touched on the modem task only
+
+// Completion of AT+CGNSINF, runs on the modem task
+void onGPSDataDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  bool *gotRecord = (bool *)context;
+  gpsRequestPending = false;
+  if (result == AT_OK && *gotRecord)
+  {
+    modemPower.onGNSSFix(gpsParser.fix().fixStatus == 1, millis());
+    handleGPSFix(gpsParser.fix());
+  }
   else
   {
+    gpsParser.reset();
     Serial.println("No GPS data available.");
     // Indicate no GPS data available (slow blink)
     indicateStatus(LED_GPS, 1);
+    gpsSampler.onPollFailed(millis());
   }
 }
 
-void initRegisterParcelMode(void *pvParameters)
+// Function to fetch GPS data, the result is reported by onGPSDataDone()
+void fetchGPSData()
 {
-  // Initialize RFID
-  delay(5000);       // Must be removed in production, for testing only
-  RFIDisOK = true;   // Must be removed in production, for testing only
-  initERROR = false; // Must be removed in production, for testing only
+  static bool gotRecord;
+  gotRecord = false;
+  Serial.println("Fetching GPS data...");
 
-  // Initialize modem
-  if (!initializeModem())
+  // Queue the command to get GPS info
+  if (atEngine.send("AT+CGNSINF", GPS_RESPONSE_TIMEOUT, onGPSDataDone, &gotRecord, onGPSDataLine))
   {
-    Serial.println("Modem initialization failed. Halting execution.");
-    while (true)
+    gpsRequestPending = true;
+  }
+  else
+  {
+    Serial.println("AT command queue is full, GPS request skipped.");
+  }
+}
+
+// Completion of an acquisition probe, it only times the re-acquisition and never reaches the sampler
+void onGNSSProbeDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  bool *gotRecord = (bool *)context;
+  gpsRequestPending = false;
+  if (result == AT_OK && *gotRecord)
+  {
+    modemPower.onGNSSFix(gpsParser.fix().fixStatus == 1, millis());
+  }
+  else
+  {
+    gpsParser.reset();
+  }
+}
+
+// Poll mode only sees fixes when it asks; between power-up and the first fix ask every
+// GNSS_PROBE_INTERVAL, or the measured re-acquisition time could never drop below the lead
+void probeGNSS()
+{
+  static bool gotRecord;
+  gotRecord = false;
+  if (atEngine.send("AT+CGNSINF", GPS_RESPONSE_TIMEOUT, onGNSSProbeDone, &gotRecord, onGPSDataLine))
+  {
+    gpsRequestPending = true;
+  }
+}
+
+// Completion of AT+CGNSPWR, runs on the modem task
+void onGNSSPowerDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  bool on = *(bool *)context;
+  gpsRequestPending = false;
+  if (result == AT_OK)
+  {
+    gpsSampler.setPowered(on, millis());
+    modemPower.onGNSSPower(on, millis());
+    Serial.println(on ? "GNSS powered up." : "GNSS powered down until the next fix.");
+#if GPS_STREAM_MODE
+    if (on)
     {
-      indicateStatus(LED_MODEM, 1); // Indicate unable to connect
-      MODEMisOK = false;
-      initERROR = true;
+      atEngine.send("AT+CGNSTST=1", AT_DEFAULT_TIMEOUT, NULL, NULL); // restart the NMEA stream
     }
+#endif
   }
-  MODEMisOK = true;
-  initERROR = false;
+}
 
-  // Initialize GPRS
-  delay(5000);       // Must be removed in production, for testing only
-  GPRSisOK = true;   // Must be removed in production, for testing only
-  initERROR = false; // Must be removed in production, for testing only
+// Polls the GPS and switches the GNSS engine on and off as the sampler asks, runs on the modem task
+void serviceGPSSampler()
+{
+  if (gpsRequestPending)
+  {
+    return;
+  }
+  static bool powerTarget;
+  static unsigned long lastProbe = 0;
+  unsigned long now = millis();
+  gpsSampler.setWarmup(modemPower.warmup(gpsSampler.nextDue())); // lead for a hot, warm or cold start
+  bool wantOn = gpsSampler.wantsPower(now);
+  if (wantOn != gpsSampler.isPowered())
+  {
+    powerTarget = wantOn;
+    if (atEngine.send(wantOn ? "AT+CGNSPWR=1" : "AT+CGNSPWR=0", AT_DEFAULT_TIMEOUT,
+                      onGNSSPowerDone, &powerTarget))
+    {
+      gpsRequestPending = true;
+    }
+  }
+  else if (!GPS_STREAM_MODE && gpsSampler.fixDue(now))
+  {
+    fetchGPSData();
+  }
+  else if (!GPS_STREAM_MODE && modemPower.isAcquiring() && now - lastProbe >= GNSS_PROBE_INTERVAL)
+  {
+    lastProbe = now;
+    probeGNSS();
+  }
+}
 
-  // Notify the display task that initialization is complete
-  if (initRegisterTaskHandle != NULL)
+// AT+CSCLK state, touched on the modem task only
+bool modemSleepTarget = false;  // asked for by the power profile
+bool modemSleepApplied = false; // confirmed by the modem
+bool modemSleepSent = false;    // value of the command in flight
+bool modemSleepPending = false; // a command is in flight
+
+// Completion of AT+CSCLK, context points at the value sent
+void onModemSleepDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  modemSleepPending = false;
+  if (result == AT_OK)
+  {
+    modemSleepApplied = *(bool *)context;
+    modemPower.setEnabled(modemSleepApplied); // DTR now decides when the modem sleeps
+  }
+  else
   {
-    xTaskNotifyGive(initRegisterTaskHandle);
+    Serial.printf("AT+CSCLK failed (%d), retrying on the next power check.\n", (int)result);
   }
-  vTaskDelete(NULL); // Delete the task once done
 }
 
-void showRegisterParcelsScreen(void *pvParameters)
+// Applies the power profile picked from the battery state, runs on the modem task every POWER_CHECK_INTERVAL
+void servicePowerGovernor()
 {
-  int frame = 0;
-  //------------RFID-----------------
-  while (!RFIDisOK && !initERROR)
+  unsigned long now = millis();
+
+  BatterySnapshot cell = battery.snapshot();
+  bool charging = digitalRead(CHARGING_PIN) == LOW; // CHRG is open drain, low while charging
+  static unsigned long lastEstimate = 0;
+  if (charging)
   {
-    displayInitializingProcess("Initializing RFID", frame);
+    dischargeEstimator.reset();
   }
-  while (!MODEMisOK && initERROR)
+  else if (now - lastEstimate >= ESTIMATOR_SAMPLE_INTERVAL || lastEstimate == 0)
   {
-    showInitializationError("RFID");
+    uint8_t load = (gpsSampler.isPowered() ? 1 : 0) + (uplink.isConnected() ? 1 : 0);
+    dischargeEstimator.add(cell.millivolts, load, now);
+    lastEstimate = now;
   }
-  //-------------Modem---------------
-  while (!MODEMisOK && !initERROR)
+
+  if (powerGovernor.update(cell.percent, charging, now))
   {
-    displayInitializingProcess("Initializing MODEM", frame);
+    const PowerSettings &power = powerGovernor.settings();
+    uint32_t minutes = PowerGovernor::projectedMinutes(cell.percent);
+    Serial.printf("Power profile: %s at %u%%%s, about %u h %02u min left\n", power.name, (unsigned)cell.percent,
+                  charging ? " (charging)" : "", (unsigned)(minutes / 60), (unsigned)(minutes % 60));
+    gpsSampler.setMinInterval(power.gpsMinInterval);
+    uplink.setBatchSize(power.uplinkBatch);
+    modemSleepTarget = power.modemSleep;
+    uiQueue.post(UI_STATUS); // apply the display part now
   }
-  while (!MODEMisOK && initERROR)
+
+  // Retried on every check until the modem answers OK
+  if (modemSleepTarget != modemSleepApplied && !modemSleepPending)
   {
-    showInitializationError("MODEM");
+    modemSleepSent = modemSleepTarget;
+    modemSleepPending = atEngine.send(modemSleepSent ? "AT+CSCLK=1" : "AT+CSCLK=0", AT_DEFAULT_TIMEOUT,
+                                      onModemSleepDone, &modemSleepSent);
   }
-  //--------------GPRS----------------
-  while (!GPRSisOK && !initERROR)
+}
+
+// Time until the modem task next needs the SIM808, 0 for now
+uint32_t modemWorkIn(unsigned long now)
+{
+  // Bring-up, a command in flight or the GNSS engine on (NMEA stream or +CGNSINF polls)
+  if (!subsystems.isReady(SUBSYSTEM_GPS) || !atEngine.isIdle() || gpsRequestPending || gpsSampler.isPowered())
   {
-    displayInitializingProcess("Initializing GPRS", frame);
+    return 0;
   }
-  while (!GPRSisOK && initERROR)
+  uint32_t work = uplink.msUntilWork(now);
+  long gnss = (long)(gpsSampler.nextDue() - gpsSampler.warmup() - now); // next GNSS power-up
+  uint32_t gnssIn = gnss <= 0 ? 0 : (uint32_t)gnss;
+  return gnssIn < work ? gnssIn : work;
+}
+
+// Lets the SIM808 sleep between exchanges and wakes it for scheduled work or events, runs on the modem task
+void serviceModemSleep()
+{
+  unsigned long now = millis();
+  if (atEngine.queued() > 0)
   {
-    showInitializationError("GPRS");
+    modemPower.requestWake(); // a command from another task is waiting
   }
+  switch (modemPower.update(now, modemWorkIn(now)))
+  {
+  case MODEM_POWER_SLEEP:
+    atEngine.hold(true);
+    digitalWrite(MODEM_DTR, HIGH);
+    break;
+  case MODEM_POWER_WAKE:
+    digitalWrite(MODEM_DTR, LOW);
+    break;
+  case MODEM_POWER_READY:
+    atEngine.hold(false);
+    break;
+  default:
+    break;
+  }
+}
 
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.setCursor(10, 50);
-  display.println("Device is ready..");
-  display.display();
+unsigned long gprsStartedAt = 0; // set once by the init task, then read by gprsStatusJob
 
-  // Notify the setup function that the display task is complete
-  if (setupTaskHandle != NULL)
+// Function to start GPRS and the uplink session. Returns at once: without coverage the uplink keeps
+// retrying in the background and fixes wait in the log, gprsStatusJob reports when it comes up.
+void initializeGPRS()
+{
+  Serial.println("Initializing GPRS...");
+  indicateStatus(LED_GPRS, 0);
+  uplink.configure(GPRS_APN, GPRS_USER, GPRS_PASS, UPLINK_HOST, UPLINK_PORT);
+  gprsStartedAt = millis();
+  if (!uplink.begin())
   {
-    xTaskNotifyGive(setupTaskHandle);
+    Serial.println("No room for the uplink URC handlers.");
   }
-  vTaskDelete(NULL); // Delete the task once done
+}
+
+// Reports the GPRS attach started by initializeGPRS(), a job of the loop() task
+void gprsStatusJob(void *context)
+{
+  static bool attached = false;
+  static bool reported = false;
+  if (gprsStartedAt == 0 || attached)
+  {
+    return;
+  }
+  if (uplink.isAttached())
+  {
+    attached = true;
+    Serial.println("GPRS attached.");
+    indicateStatus(LED_GPRS, 2);
+    subsystems.setReady(SUBSYSTEM_GPRS);
+    bootTimeline.mark("gprs attached");
+    if (reported)
+    {
+      uiQueue.post(UI_READY); // leave the error screen
+    }
+  }
+  else if (!reported && millis() - gprsStartedAt >= GPRS_INIT_TIMEOUT)
+  {
+    Serial.println("GPRS is not up yet, still retrying in the background.");
+    indicateStatus(LED_GPRS, 1);
+    uiQueue.post(UI_ERROR, "GPRS"); // error screen until it comes up
+    reported = true;
+  }
+}
+
+void initRegisterParcelMode(void *pvParameters)
+{
+  // Initialize RFID
+  uiQueue.post(UI_PROGRESS, "Initializing RFID");
+  delay(5000); // Must be removed in production, for testing only
+  subsystems.setReady(SUBSYSTEM_RFID);
+
+  // Initialize modem
+  uiQueue.post(UI_PROGRESS, "Initializing MODEM");
+  if (!subsystems.waitFor(SUBSYSTEM_MODEM))
+  {
+    Serial.println("Modem initialization failed. Halting execution.");
+    uiQueue.post(UI_ERROR, "MODEM");
+    deviceEvents.post(EVENT_INIT_FAILED);
+    while (true)
+    {
+      indicateStatus(LED_MODEM, 1); // Indicate unable to connect
+      vTaskDelay(pdMS_TO_TICKS(100));
+    }
+  }
+
+  // Initialize GPRS
+  uiQueue.post(UI_PROGRESS, "Initializing GPRS");
+  initializeGPRS();
+
+  // Tell the setup function that initialization is complete
+  uiQueue.post(UI_READY);
+  deviceEvents.post(EVENT_INIT_DONE);
+  taskMonitor.exitTask(); // Delete the task once done
 }
 
 void initTrackParcelMode(void *pvParameters)
 {
   // Initialize modem
-  if (!initializeModem())
+  uiQueue.post(UI_PROGRESS, "Initializing MODEM");
+  if (!subsystems.waitFor(SUBSYSTEM_MODEM))
   {
     Serial.println("Modem initialization failed. Halting execution.");
+    uiQueue.post(UI_ERROR, "MODEM");
+    deviceEvents.post(EVENT_INIT_FAILED);
     while (true)
     {
       indicateStatus(LED_MODEM, 1); // Indicate unable to connect
-      MODEMisOK = false;
-      initERROR = true;
+      vTaskDelay(pdMS_TO_TICKS(100));
     }
   }
-  MODEMisOK = true;
-  initERROR = false;
 
   // Configure GPS
+  uiQueue.post(UI_PROGRESS, "Initializing GPS");
   if (!configureGPS())
   {
     Serial.println("GPS configuration failed. Halting execution.");
+    uiQueue.post(UI_ERROR, "GPS");
+    subsystems.setFailed(SUBSYSTEM_GPS);
+    deviceEvents.post(EVENT_INIT_FAILED);
     while (true)
     {
       indicateStatus(LED_GPS, 1); // Indicate unable to connect
-      GPSisOK = false;
-      initERROR = true;
+      vTaskDelay(pdMS_TO_TICKS(100));
     }
   }
-  GPSisOK = true;
-  initERROR = false;
+  bootTimeline.mark("gps configured");
 
   // Initialize GPRS
-  delay(5000);     // Must be removed in production, for testing only
-  GPRSisOK = true; // Must be removed in production, for testing only
-  initERROR = false;
+  uiQueue.post(UI_PROGRESS, "Initializing GPRS");
+  initializeGPRS();
 
-  // Notify the display task that initialization is complete
-  if (initTrackTaskHandle != NULL)
-  {
-    xTaskNotifyGive(initTrackTaskHandle);
-  }
-  vTaskDelete(NULL); // Delete the task once done
+  // Tell the setup function that initialization is complete
+  uiQueue.post(UI_READY);
+  deviceEvents.post(EVENT_INIT_DONE);
+  taskMonitor.exitTask(); // Delete the task once done
 }
 
-void showTrackParcelsScreen(void *pvParameters)
+void drawModeSelection()
 {
-  int frame = 0;
-  //----------Modem----------
-  while (!MODEMisOK && !initERROR)
-  {
-    displayInitializingProcess("Initializing MODEM", frame);
-  }
-  while (!MODEMisOK && initERROR)
-  {
-    showInitializationError("MODEM");
-  }
-  //-----------GPS--------------
-  while (!GPSisOK && !initERROR)
+  const char *line1 = "Please select mode";
+  const char *mode1 = "1. Register Parcels";
+  const char *mode2 = "2. Track Parcels";
+  const char *confirmMessage = "Press START to confirm";
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor((SCREEN_WIDTH - display.width()) / 2, 0);
+  display.println(line1);
+  // Display modes with indication of selection
+  if (deviceState.mode() == MODE_REGISTER)
   {
-    displayInitializingProcess("Initializing GPS", frame);
+    display.setCursor((SCREEN_WIDTH - display.width()) / 2, 20);
+    display.println("> " + String(mode1)); // Indicate selection
+    display.setCursor((SCREEN_WIDTH - display.width()) / 2, 36);
+    display.println("  " + String(mode2));
   }
-  while (!GPSisOK && initERROR)
+  else
   {
-    showInitializationError("GPS");
+    display.setCursor((SCREEN_WIDTH - display.width()) / 2, 20);
+    display.println("  " + String(mode1));
+    display.setCursor((SCREEN_WIDTH - display.width()) / 2, 36);
+    display.println("> " + String(mode2)); // Indicate selection
   }
-  //----------GPRS--------------
-  while (!GPRSisOK && !initERROR)
+  // Display confirmation message
+  display.setCursor((SCREEN_WIDTH - display.width()) / 2, 56);
+  display.println(confirmMessage);
+  display.display();
+}
+
+// Blocks on the button events until START confirms the mode
+void showModeSelectionScreen()
+{
+  drawModeSelection();
+  while (deviceState.state() == DEVICE_SELECT_MODE)
   {
-    displayInitializingProcess("Initializing GPRS", frame);
+    DeviceEvent event;
+    if (deviceEvents.receive(event, portMAX_DELAY) && dispatchDeviceEvent(event) == ACTION_TOGGLE_MODE)
+    {
+      drawModeSelection();
+    }
   }
-  while (!GPRSisOK && initERROR)
+}
+
+// Prints the statistics of every module, a job of the loop() task
+void printStatsJob(void *context)
+{
+  modemSerial.printStats(Serial);
+  atEngine.printStats(Serial);
+  if (fixLogReady)
   {
-    showInitializationError("GPRS");
+    Serial.printf("Fix log: %u pending, %u dropped, %u sectors erased, %u CRC errors\n",
+                  (unsigned)fixLog.pending(), (unsigned)fixLog.droppedRecords(),
+                  (unsigned)fixLog.sectorsErased(), (unsigned)fixLog.crcErrors());
   }
-
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.setCursor(10, 50);
-  display.println("Device is ready..");
-  display.display();
-
-  // Notify the setup function that the display task is complete
-  if (setupTaskHandle != NULL)
+  uplink.printStats(Serial);
+  modemPower.printStats(Serial, millis());
+  BatterySnapshot cell = battery.snapshot();
+  Serial.printf("Battery: %u mV, %u%%, %d mV/h over %u samples\n", (unsigned)cell.millivolts,
+                (unsigned)cell.percent, (int)cell.trendMvPerHour, (unsigned)cell.samples);
+  powerGovernor.printStats(Serial, millis());
+  dischargeEstimator.printStats(Serial);
+  display.printStats(Serial);
+  Serial.printf("Device: %s, %u button bounces, %u events ignored, %u dropped\n",
+                DeviceStateMachine::stateName(deviceState.state()), (unsigned)deviceState.bounces(),
+                (unsigned)deviceState.ignored(), (unsigned)deviceEvents.dropped());
+  Serial.printf("UI: %u frames, %u ms drawing, %u events, %u dropped\n", (unsigned)uiFrames,
+                (unsigned)(uiRenderMicros / 1000), (unsigned)uiQueue.posted(), (unsigned)uiQueue.dropped());
+  if (gpsSampler.isStarted())
   {
-    xTaskNotifyGive(setupTaskHandle);
+#if GPS_STREAM_MODE
+    Serial.printf("NMEA stream: %u sentences, %u fixes, %u checksum errors\n",
+                  (unsigned)nmeaParser.sentenceCount(), (unsigned)nmeaParser.fixCount(),
+                  (unsigned)nmeaParser.checksumErrors());
+#endif
+    gpsSampler.printStats(Serial, millis());
+    trackSimplifier.printStats(Serial);
+    fixFilter.printStats(Serial);
   }
-  vTaskDelete(NULL); // Delete the task once done
+  modemJobs.printStats(Serial);
+  loopJobs.printStats(Serial);
+  taskMonitor.report(Serial);
 }
 
-void showModeSelectionScreen()
+// Diagnostic commands typed on the serial monitor, one per line
+void consoleJob(void *context)
 {
-  display.clearDisplay();
-  const char *line1 = "Please select mode";
-  const char *mode1 = "1. Register Parcels";
-  const char *mode2 = "2. Track Parcels";
-  const char *confirmMessage = "Press START to confirm";
-  while (confirmMode)
+  static char line[CONSOLE_LINE_MAX];
+  static uint8_t length = 0;
+  while (Serial.available() > 0)
   {
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
-    display.setCursor((SCREEN_WIDTH - display.width()) / 2, 0);
-    display.println(line1);
-    // Display modes with indication of selection
-    if (selectModeOption)
-    {
-      display.setCursor((SCREEN_WIDTH - display.width()) / 2, 20);
-      display.println("> " + String(mode1)); // Indicate selection
-      display.setCursor((SCREEN_WIDTH - display.width()) / 2, 36);
-      display.println("  " + String(mode2));
+    char c = (char)Serial.read();
+    if (c != '\n' && c != '\r')
+    {
+      if (length < CONSOLE_LINE_MAX - 1)
+      {
+        line[length++] = c;
+      }
+      continue;
+    }
+    if (length == 0)
+    {
+      continue; // second half of a CR LF
+    }
+    line[length] = '\0';
+    length = 0;
+    if (strcmp(line, "tasks") == 0)
+    {
+      taskMonitor.report(Serial);
+    }
+    else if (strcmp(line, "stats") == 0)
+    {
+      printStatsJob(NULL);
+    }
+    else if (strcmp(line, "boot") == 0)
+    {
+      bootTimeline.print(Serial);
     }
     else
     {
-      display.setCursor((SCREEN_WIDTH - display.width()) / 2, 20);
-      display.println("  " + String(mode1));
-      display.setCursor((SCREEN_WIDTH - display.width()) / 2, 36);
-      display.println("> " + String(mode2)); // Indicate selection
+      Serial.println("Commands: tasks (CPU, stack and heap), stats (all modules), boot (boot timeline)");
     }
-    // Display confirmation message
-    display.setCursor((SCREEN_WIDTH - display.width()) / 2, 56);
-    display.println(confirmMessage);
-    display.display();
-    delay(100); // Add a small delay for debouncing
-  }
-  // Set the screen flag based on the selected mode
-  if (selectModeOption)
-  {
-    displayRegisterParcelsScreen = true;
-    displayTrackParcelsScreen = false;
   }
-  else
-  {
-    displayTrackParcelsScreen = true;
-    displayRegisterParcelsScreen = false;
-  }
-  // Reset flags for next operations
-  confirmMode = true;
-  selectModeOption = true;
+}
+
+void watchdogJob(void *context)
+{
+  esp_task_wdt_reset();
 }
 
 void setup()
 {
+  bootTimeline.mark("setup");
   // Initialize the button
   pinMode(START_BUTTON.PIN, INPUT_PULLUP);
   pinMode(MODE_SELECT_BUTTON.PIN, INPUT_PULLUP);
@@ -826,6 +1433,7 @@ void setup()
   digitalWrite(LED_GPRS, LOW);
   pinMode(LED_GPS, OUTPUT);
   digitalWrite(LED_GPS, LOW);
+  pinMode(CHARGING_PIN, INPUT_PULLUP);
   // Initialize the serial communication at 115200 baud rate
   Serial.begin(115200); // Initialize the serial communication at 115200 baud rate
   while (!Serial)       // Wait for the serial port to connect (useful for some boards)
@@ -834,7 +1442,15 @@ void setup()
   }
   Serial.println("Serial Monitor Test is successed: Hello, World!");
 
+  // A stored mode and display skip the I2C scan, the boot screens and the mode question.
+  // Holding START while powering on asks for the mode again.
+  bootConfig.begin();
+  bool fastBoot = bootConfig.canFastBoot() && digitalRead(START_BUTTON.PIN) == HIGH;
+  bootTimeline.mark("nvs");
+
   //-------------------------------------------------------------------------------------------
+  deviceEvents.begin(); // the button ISRs post here
+  subsystems.begin();
   attachInterrupt(START_BUTTON.PIN, startButtonInterrupt, FALLING);            // Attach interrupt to START_BUTTON pin
   attachInterrupt(MODE_SELECT_BUTTON.PIN, modeSelectButtonInterrupt, FALLING); // Attach interrupt to MODE_SELECT_BUTTON pin
 
@@ -842,9 +1458,38 @@ void setup()
   esp_task_wdt_init(300, true); // 60 seconds timeout
   esp_task_wdt_add(NULL);       // Add current thread to WDT
 
+  // Mount the GPS fix log before any task can write to it
+  fixLogReady = fixLogFlash.begin() && fixLog.begin();
+  if (fixLogReady)
+  {
+    Serial.printf("Fix log: %u of %u records pending upload\n", (unsigned)fixLog.pending(), (unsigned)fixLog.capacity());
+  }
+  else
+  {
+    Serial.println("Fix log partition not found, fixes will not be stored.");
+  }
+
+  // Profile every task from the start, the sampling interrupt lands on this core
+  taskMonitor.begin();
+  taskMonitor.watch(xTaskGetCurrentTaskHandle(), "loopTask", LOOP_TASK_STACK, xPortGetCoreID());
+
+  // Start sampling the battery before anything draws it
+  if (battery.begin(BATTERY_TASK_PRIORITY, BATTERY_TASK_CORE))
+  {
+    taskMonitor.watch(battery.taskHandle(), "BatterySampler", BATTERY_TASK_STACK, BATTERY_TASK_CORE);
+  }
+  else
+  {
+    Serial.println("Battery sampler task could not be started.");
+  }
+
+  // The modem takes seconds to answer, bring it up while the display is set up
+  uiQueue.begin();
+  taskMonitor.start(MODEM_BRINGUP_TASK, modemBringUpTask);
+
   // Serial communication
   Wire.begin();
-  int screenAddress = scanI2C();
+  int screenAddress = fastBoot && probeI2C(bootConfig.displayAddress()) ? bootConfig.displayAddress() : scanI2C();
   if (screenAddress == -1 || !initDisplay(screenAddress))
   {
     Serial.println("Initialization failed, entering error loop...");
@@ -855,113 +1500,89 @@ void setup()
       esp_task_wdt_reset();                                                                                // Reset watchdog to prevent system reset
     }
   }
+  screenAnimator.begin(display.getBuffer());
+  bootConfig.saveDisplayAddress(screenAddress);
+  bootTimeline.mark("display");
 
-  display.display();
-  delay(2000); // Pause for 2 seconds
-  display.clearDisplay();
-  testDisplay(); // Run the display function to test
-  showBootScreen();
-  display.clearDisplay();
-  START = true; // Allow button inputs
-  while (continueWelcomeScreen)
+  deviceState.selectMode(bootConfig.mode() == BOOT_MODE_TRACK ? MODE_TRACK : MODE_REGISTER); // last choice
+  if (fastBoot)
+  {
+    dispatchDeviceEvent(EVENT_FAST_BOOT);
+    Serial.printf("Fast boot: %s mode, display at 0x%02X. Hold START at power-on to change the mode.\n",
+                  deviceState.mode() == MODE_TRACK ? "track" : "register", (unsigned)screenAddress);
+  }
+  else
   {
+    display.display();
+    delay(2000); // Pause for 2 seconds
+    display.clearDisplay();
+    testDisplay(); // Run the display function to test
+    showBootScreen();
+    display.clearDisplay();
+    DeviceEvent event;
+    while (deviceEvents.receive(event, 0))
+    {
+      dispatchDeviceEvent(event); // presses during the boot screens have no row in DEVICE_BOOT
+    }
+    dispatchDeviceEvent(EVENT_BOOT_SCREENS_DONE); // buttons count from here on
     showWelcomeScreen();
+    showModeSelectionScreen();
+    bootConfig.saveMode(deviceState.mode() == MODE_TRACK ? BOOT_MODE_TRACK : BOOT_MODE_REGISTER);
   }
-  SELECTMODE = true; // Allow mode selection
-  showModeSelectionScreen();
+  bootTimeline.mark("mode");
 
   display.clearDisplay();
 
-  // Get current task handle for notification
-  setupTaskHandle = xTaskGetCurrentTaskHandle();
+  // From here on only the UI task draws, everything else posts UI events
+  taskMonitor.start(UI_TASK, uiTask);
 
   // Process based on selected mode
-  if (displayRegisterParcelsScreen)
-  {
-    // Create display task for register parcels screen
-    xTaskCreate(
-        showRegisterParcelsScreen,
-        "RegisterDisplayTask",
-        2048,
-        NULL,
-        1,
-        &initRegisterTaskHandle);
-
-    // Initialize register parcels mode
-    xTaskCreate(
-        initRegisterParcelMode,
-        "InitRegisterTask",
-        2048,
-        NULL,
-        1,
-        NULL);
-
-    // Wait for register parcels display task to complete
-    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-  }
-
-  if (displayTrackParcelsScreen)
-  {
-    // Create display task for track parcels screen
-    xTaskCreate(
-        showTrackParcelsScreen,
-        "TrackDisplayTask",
-        2048,
-        NULL,
-        1,
-        &initTrackTaskHandle);
-
-    // Initialize track parcels mode
-    xTaskCreate(
-        initTrackParcelMode,
-        "InitTrackTask",
-        2048,
-        NULL,
-        1,
-        NULL);
-
-    // Wait for track parcels display task to complete
-    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  if (deviceState.mode() == MODE_REGISTER)
+  {
+    taskMonitor.start(INIT_REGISTER_TASK, initRegisterParcelMode);
+  }
+  else
+  {
+    taskMonitor.start(INIT_TRACK_TASK, initTrackParcelMode);
   }
 
-  display.display();
-  delay(2000); // Pause for 2 seconds
-  display.clearDisplay();
-
-  xTaskCreatePinnedToCore(
-      [](void *arg)
-      {
-        for (;;)
-        {
-          display.clearDisplay();
-          drawBatteryStatus();
-          drawSignalStatus();
-          showOperateMode();
-          display.display();
-          vTaskDelay(pdMS_TO_TICKS(1000));
-        }
-      },
-      "BatteryDisplayTask",
-      2048,
-      NULL,
-      1,
-      NULL,
-      1);
+  // Wait for the init task to bring the device up, button presses are ignored meanwhile
+  while (deviceState.state() == DEVICE_INITIALIZING)
+  {
+    DeviceEvent event;
+    if (deviceEvents.receive(event, pdMS_TO_TICKS(WATCHDOG_FEED_INTERVAL)))
+    {
+      dispatchDeviceEvent(event);
+    }
+    esp_task_wdt_reset(); // a slow bring-up is not a hang
+  }
+  loopJobs.add("watchdog", WATCHDOG_FEED_INTERVAL, 100, watchdogJob);
+  loopJobs.add("gprs", GPRS_STATUS_INTERVAL, 1000, gprsStatusJob);
+  loopJobs.add("console", CONSOLE_POLL_INTERVAL, 200000, consoleJob);
+  loopJobs.add("stats", AT_STATS_INTERVAL, 200000, printStatsJob, NULL, AT_STATS_INTERVAL); // about 2 KB at 115200 baud
+  bootTimeline.mark(deviceState.state() == DEVICE_RUNNING ? "ready" : "init failed");
+  bootTimeline.print(Serial);
+  if (deviceState.state() == DEVICE_FAILED)
+  {
+    // The init task shows the error, the watchdog restarts the device for another try
+    Serial.printf("Initialization failed (subsystems 0x%02X), waiting for the watchdog to restart.\n",
+                  (unsigned)subsystems.failed());
+    for (;;)
+    {
+      vTaskDelay(portMAX_DELAY);
+    }
+  }
 }
 
 void loop()
 {
-  // Fetch and print GPS data every 10 seconds
-  static unsigned long lastFetchTime = 0;
-  if (millis() - lastFetchTime >= GPS_TIME_GAP)
+  // GPS data is fetched by the modem task at the rate picked by gpsSampler
+  uint32_t wait = loopJobs.runDue();
+
+  // Sleep until the next job is due, buttons have no meaning while running but are still drained
+  DeviceEvent event;
+  if (deviceEvents.receive(event, pdMS_TO_TICKS(wait)))
   {
-    fetchGPSData();
-    lastFetchTime = millis();
+    dispatchDeviceEvent(event);
   }
-
-  // Add any other operations needed for your specific use case
-
-  esp_task_wdt_reset(); // Reset the watchdog timer periodically
-  testDisplay();        // Run the display function to test
-  delay(2000);          // Wait before running the next test
 }
@@ -0,0 +1,121 @@
+/*
+ * Host stand-in for the parts of Adafruit_SSD1306 that PartialSSD1306
+ * builds on: the frame buffer, the protected bus members and an I2C-only
+ * begin() and display(). Drawing is limited to drawPixel() and
+ * clearDisplay(), which is all the tests need to change the buffer.
+ *
+ * begin() sends a short command list like the real driver so a test sees
+ * the panel set up, and display() sends the whole frame in Wire-sized
+ * chunks the way the library does.
+ */
+
+#ifndef _Adafruit_SSD1306_H_
+#define _Adafruit_SSD1306_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_DISPLAYON 0xAF
+#define SSD1306_MEMORYMODE 0x20
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+
+class Adafruit_SSD1306
+{
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin = -1,
+                   uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL)
+      : WIDTH(w), HEIGHT(h), wire(twi), buffer(NULL), i2caddr(0), wireClk(clkDuring), restoreClk(clkAfter)
+  {
+  }
+
+  virtual ~Adafruit_SSD1306()
+  {
+    free(buffer);
+  }
+
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t addr = 0, bool reset = true, bool periphBegin = true)
+  {
+    if (buffer == NULL && (buffer = (uint8_t *)malloc(WIDTH * ((HEIGHT + 7) / 8))) == NULL)
+    {
+      return false;
+    }
+    clearDisplay();
+    i2caddr = addr ? addr : ((HEIGHT == 32) ? 0x3C : 0x3D);
+    if (periphBegin)
+    {
+      wire->begin();
+    }
+    static const uint8_t init[] = {0x00, SSD1306_MEMORYMODE, 0x00, SSD1306_DISPLAYON};
+    wire->setClock(wireClk);
+    wire->beginTransmission(i2caddr);
+    wire->write(init, sizeof(init));
+    wire->endTransmission();
+    wire->setClock(restoreClk);
+    return true;
+  }
+
+  void display()
+  {
+    static const uint8_t addressing[] = {0x00, SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0};
+    wire->setClock(wireClk);
+    wire->beginTransmission(i2caddr);
+    wire->write(addressing, sizeof(addressing));
+    wire->write(WIDTH - 1);
+    wire->endTransmission();
+    uint16_t count = WIDTH * ((HEIGHT + 7) / 8);
+    const uint8_t *data = buffer;
+    while (count > 0)
+    {
+      uint16_t chunk = count < I2C_BUFFER_LENGTH - 1 ? count : I2C_BUFFER_LENGTH - 1;
+      wire->beginTransmission(i2caddr);
+      wire->write((uint8_t)0x40);
+      wire->write(data, chunk);
+      wire->endTransmission();
+      data += chunk;
+      count -= chunk;
+    }
+    wire->setClock(restoreClk);
+  }
+
+  void clearDisplay()
+  {
+    memset(buffer, 0, WIDTH * ((HEIGHT + 7) / 8));
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color)
+  {
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+    {
+      return;
+    }
+    uint8_t *cell = &buffer[x + (y / 8) * WIDTH];
+    uint8_t bit = 1 << (y & 7);
+    if (color == SSD1306_WHITE)
+      *cell |= bit;
+    else if (color == SSD1306_BLACK)
+      *cell &= ~bit;
+    else
+      *cell ^= bit;
+  }
+
+  uint8_t *getBuffer() { return buffer; }
+  int16_t width() const { return WIDTH; }
+  int16_t height() const { return HEIGHT; }
+
+protected:
+  const int16_t WIDTH;
+  const int16_t HEIGHT;
+  TwoWire *wire;
+  uint8_t *buffer;
+  int8_t i2caddr;
+  uint32_t wireClk;
+  uint32_t restoreClk;
+};
+
+#endif
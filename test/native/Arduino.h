@@ -0,0 +1,104 @@
+/*
+ * Host stand-in for the few parts of the Arduino core that the libraries
+ * under test use, for the native test environment (see platformio.ini).
+ *
+ * Most libraries take the time as a parameter; millis() and micros()
+ * only return what a test put in hostMillis(), which every translation
+ * unit shares. Print collects its output in a string so tests can look at
+ * printStats() reports, and Serial is one of them. HostRTOS.h stands in
+ * for FreeRTOS.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include "HostRTOS.h"
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define PROGMEM
+
+// A function-local static, so the library sources see the test's clock
+inline unsigned long &hostMillis()
+{
+  static unsigned long ms = 0;
+  return ms;
+}
+
+inline unsigned long millis() { return hostMillis(); }
+inline unsigned long micros() { return hostMillis() * 1000; }
+inline void delay(unsigned long ms) { hostMillis() += ms; }
+inline void vTaskDelay(TickType_t ticks) { hostMillis() += ticks * portTICK_PERIOD_MS; }
+inline int analogRead(uint8_t pin) { return 0; } // no ADC on the host
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+
+  size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t println(const char *text = "") { return print(text) + print("\r\n"); }
+
+  __attribute__((format(printf, 2, 3))) size_t printf(const char *format, ...)
+  {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0)
+      return 0;
+    return write((const uint8_t *)line, (size_t)length < sizeof(line) ? length : sizeof(line) - 1);
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
+
+// Print that keeps everything written to it
+class StringPrint : public Print
+{
+public:
+  size_t write(uint8_t c) override
+  {
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
+
+// Console output of the libraries, kept so a test can read their messages
+inline StringPrint &hostSerial()
+{
+  static StringPrint out;
+  return out;
+}
+#define Serial hostSerial()
+
+#endif
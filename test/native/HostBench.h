@@ -0,0 +1,40 @@
+/*
+ * Timing for the host benchmarks in the test suites.
+ *
+ * The numbers come from the build machine, not the ESP32: they compare
+ * two implementations run side by side and show the order of magnitude,
+ * they are not device timings. benchReport() prints through TEST_MESSAGE,
+ * so `pio test -e native -v` shows them next to the results.
+ */
+
+#ifndef HostBench_h
+#define HostBench_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <unity.h>
+
+// Monotonic time in nanoseconds
+inline uint64_t benchNanos()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Keep the compiler from dropping a result nobody reads
+template <typename T>
+inline void benchKeep(const T &value)
+{
+  __asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+// One line of the report: what was measured, the figure and its unit
+inline void benchReport(const char *what, double value, const char *unit)
+{
+  char line[128];
+  snprintf(line, sizeof(line), "%s: %.1f %s", what, value, unit);
+  TEST_MESSAGE(line);
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Host stand-in for the FreeRTOS queue and task notification calls the
+ * libraries make, pulled in by Arduino.h like the ESP32 core does.
+ *
+ * A queue is a fixed-size item deque under a mutex and never blocks: the
+ * libraries only use it with a zero wait. Each thread is a task; its
+ * handle is a per-thread notification counter, so xTaskNotifyGive() from
+ * one thread wakes ulTaskNotifyTake() in another. vTaskDelay() advances
+ * the host clock by one millisecond per tick instead of sleeping.
+ */
+
+#ifndef HostRTOS_h
+#define HostRTOS_h
+
+#include <stdint.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct HostQueue
+{
+  std::mutex lock;
+  std::deque<std::vector<uint8_t> > items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+typedef HostQueue *QueueHandle_t;
+
+struct HostTask
+{
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notifications;
+};
+typedef HostTask *TaskHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  QueueHandle_t queue = new HostQueue;
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue)
+{
+  delete queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+  std::lock_guard<std::mutex> guard(queue->lock);
+  if (queue->items.size() >= queue->length)
+  {
+    return pdFALSE;
+  }
+  const uint8_t *bytes = (const uint8_t *)item;
+  queue->items.push_back(std::vector<uint8_t>(bytes, bytes + queue->itemSize));
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+  std::lock_guard<std::mutex> guard(queue->lock);
+  if (queue->items.empty())
+  {
+    return pdFALSE;
+  }
+  memcpy(item, &queue->items.front()[0], queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->items.size();
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  static thread_local HostTask task;
+  return &task;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task)
+{
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->wake.notify_one();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  while (task->notifications == 0)
+  {
+    task->wake.wait(guard);
+  }
+  uint32_t count = task->notifications;
+  task->notifications = clear ? 0 : count - 1;
+  return count;
+}
+
+#endif
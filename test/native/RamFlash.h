@@ -0,0 +1,136 @@
+/*
+ * RAM-backed FlashDevice for the host tests.
+ *
+ * Behaves like NOR flash: erase sets a sector to 0xFF and a write can only
+ * clear bits, so programming a bit back to 1 is counted as a violation
+ * instead of silently succeeding. cutPowerAfter() makes the writes stop
+ * after a number of bytes, the way a reset tears a program operation, and
+ * fails every later write and erase until restorePower(). The read counters
+ * let a test check how the code under test walks the flash.
+ */
+
+#ifndef RamFlash_h
+#define RamFlash_h
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "FlashDevice.h"
+
+class RamFlash : public FlashDevice
+{
+public:
+  RamFlash(uint32_t sectorSize, uint32_t sectorCount)
+      : _sectorSize(sectorSize), _sectorCount(sectorCount), _memory(sectorSize * sectorCount, 0xFF)
+  {
+    _powered = true;
+    _budget = 0;
+    _limited = false;
+    resetCounters();
+  }
+
+  uint32_t sectorSize() const { return _sectorSize; }
+  uint32_t sectorCount() const { return _sectorCount; }
+
+  bool read(uint32_t offset, void *data, uint32_t length)
+  {
+    if (offset + length > _memory.size())
+    {
+      return false;
+    }
+    memcpy(data, &_memory[offset], length);
+    reads++;
+    if (length > largestRead)
+      largestRead = length;
+    if (length > 0 && offset / _sectorSize != (offset + length - 1) / _sectorSize)
+      readsAcrossSectors++;
+    return true;
+  }
+
+  bool write(uint32_t offset, const void *data, uint32_t length)
+  {
+    if (!_powered || offset + length > _memory.size())
+    {
+      return false;
+    }
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t programmed = length;
+    if (_limited && _budget < length)
+    {
+      programmed = _budget;
+    }
+    for (uint32_t i = 0; i < programmed; i++)
+    {
+      if (bytes[i] & ~_memory[offset + i])
+        violations++;
+      _memory[offset + i] &= bytes[i];
+    }
+    writes++;
+    if (_limited)
+    {
+      _budget -= programmed;
+      if (programmed < length)
+      {
+        _powered = false;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool eraseSector(uint32_t sector)
+  {
+    if (!_powered || sector >= _sectorCount)
+    {
+      return false;
+    }
+    memset(&_memory[sector * _sectorSize], 0xFF, _sectorSize);
+    erases++;
+    return true;
+  }
+
+  // Let only the next bytes written reach the array, then lose power
+  void cutPowerAfter(uint32_t bytes)
+  {
+    _limited = true;
+    _budget = bytes;
+  }
+
+  void restorePower()
+  {
+    _limited = false;
+    _powered = true;
+  }
+
+  bool powered() const { return _powered; }
+
+  // Direct access, e.g. to flip a bit the way a worn cell does
+  uint8_t *memory() { return &_memory[0]; }
+
+  void resetCounters()
+  {
+    reads = 0;
+    writes = 0;
+    erases = 0;
+    largestRead = 0;
+    readsAcrossSectors = 0;
+    violations = 0;
+  }
+
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t erases;
+  uint32_t largestRead;
+  uint32_t readsAcrossSectors;
+  uint32_t violations; // writes that tried to set a bit
+
+private:
+  uint32_t _sectorSize;
+  uint32_t _sectorCount;
+  std::vector<uint8_t> _memory;
+  bool _powered;
+  bool _limited;
+  uint32_t _budget;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Stream that plays a modem for the host tests: the test feeds what the
+ * modem says with reply() and reads what the code under test wrote from
+ * sent. Nothing is answered on its own, so a test decides exactly when
+ * each line arrives relative to the commands and the clock.
+ */
+
+#ifndef ScriptedStream_h
+#define ScriptedStream_h
+
+#include <deque>
+#include <string>
+#include "Arduino.h"
+
+class ScriptedStream : public Stream
+{
+public:
+  using Print::write;
+
+  size_t write(uint8_t c) override
+  {
+    sent += (char)c;
+    return 1;
+  }
+
+  int available() override { return (int)_incoming.size(); }
+
+  int read() override
+  {
+    if (_incoming.empty())
+    {
+      return -1;
+    }
+    int c = (uint8_t)_incoming.front();
+    _incoming.pop_front();
+    return c;
+  }
+
+  int peek() override { return _incoming.empty() ? -1 : (uint8_t)_incoming.front(); }
+
+  // Queue bytes for the reader, as they would arrive from the modem
+  void reply(const std::string &bytes)
+  {
+    _incoming.insert(_incoming.end(), bytes.begin(), bytes.end());
+  }
+
+  // Queue one response line with the modem's CR/LF
+  void replyLine(const std::string &line) { reply(line + "\r\n"); }
+
+  // Everything written since the last call
+  std::string takeSent()
+  {
+    std::string text = sent;
+    sent.clear();
+    return text;
+  }
+
+  std::string sent;
+
+private:
+  std::deque<char> _incoming;
+};
+
+#endif
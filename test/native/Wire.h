@@ -0,0 +1,107 @@
+/*
+ * Host stand-in for the Arduino Wire library that records every I2C write
+ * instead of driving a bus, so a test can check what a driver sent.
+ *
+ * Each beginTransmission() .. endTransmission() pair becomes one
+ * transaction holding the bytes after the address. Like the ESP32 core,
+ * write() refuses bytes beyond I2C_BUFFER_LENGTH; those are counted in
+ * overflows so a test can insist there were none.
+ */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define I2C_BUFFER_LENGTH 128 // as in the ESP32 Arduino core
+
+class TwoWire
+{
+public:
+  struct Transaction
+  {
+    uint8_t address;
+    std::vector<uint8_t> bytes;
+  };
+
+  TwoWire()
+  {
+    clock = 100000;
+    clockChanges = 0;
+    overflows = 0;
+    _open = false;
+  }
+
+  bool begin() { return true; }
+
+  void setClock(uint32_t frequency)
+  {
+    clock = frequency;
+    clockChanges++;
+  }
+
+  void beginTransmission(uint8_t address)
+  {
+    Transaction transaction;
+    transaction.address = address;
+    transactions.push_back(transaction);
+    _open = true;
+  }
+
+  size_t write(uint8_t data)
+  {
+    if (!_open || transactions.back().bytes.size() >= I2C_BUFFER_LENGTH)
+    {
+      overflows++;
+      return 0;
+    }
+    transactions.back().bytes.push_back(data);
+    return 1;
+  }
+
+  size_t write(const uint8_t *data, size_t length)
+  {
+    size_t written = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+      written += write(data[i]);
+    }
+    return written;
+  }
+
+  uint8_t endTransmission(bool stop = true)
+  {
+    _open = false;
+    return 0;
+  }
+
+  // Bytes on the bus: each transaction's address byte and payload
+  size_t busBytes() const
+  {
+    size_t total = 0;
+    for (size_t i = 0; i < transactions.size(); i++)
+    {
+      total += 1 + transactions[i].bytes.size();
+    }
+    return total;
+  }
+
+  void clear()
+  {
+    transactions.clear();
+    clockChanges = 0;
+    overflows = 0;
+  }
+
+  std::vector<Transaction> transactions;
+  uint32_t clock;
+  uint32_t clockChanges;
+  uint32_t overflows;
+
+private:
+  bool _open;
+};
+
+#endif
@@ -0,0 +1,385 @@
+#include <unity.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ATEngine.h"
+#include "ScriptedStream.h"
+
+struct Completion
+{
+  int calls;
+  ATResult result;
+  std::string finalLine;
+  bool hadFinalLine;
+  uint32_t latencyMs;
+  std::vector<std::string> lines;
+};
+
+static ScriptedStream *modem;
+static ATEngine *engine;
+static std::vector<std::string> urcs;
+
+void setUp(void)
+{
+  hostMillis() = 1000;
+  modem = new ScriptedStream();
+  engine = new ATEngine(*modem);
+  engine->begin();
+  urcs.clear();
+}
+
+void tearDown(void)
+{
+  delete engine;
+  delete modem;
+}
+
+static void onDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  Completion *done = (Completion *)context;
+  done->calls++;
+  done->result = result;
+  done->hadFinalLine = finalLine != NULL;
+  done->finalLine = finalLine != NULL ? finalLine : "";
+  done->latencyMs = latencyMs;
+}
+
+static void onLine(const char *line, void *context)
+{
+  ((Completion *)context)->lines.push_back(line);
+}
+
+static void onURCLine(const char *line, void *context)
+{
+  urcs.push_back(line);
+}
+
+static Completion *newCompletion()
+{
+  static Completion completions[AT_QUEUE_LENGTH + 2];
+  static int next = 0;
+  Completion *done = &completions[next++ % (AT_QUEUE_LENGTH + 2)];
+  *done = Completion();
+  return done;
+}
+
+// Advance the clock in steps of 10 ms, polling after each
+static void runFor(unsigned long ms)
+{
+  for (unsigned long end = hostMillis() + ms; hostMillis() < end;)
+  {
+    hostMillis() += 10;
+    engine->poll();
+  }
+}
+
+static void test_ok_completes_with_the_lines(void)
+{
+  Completion *done = newCompletion();
+  TEST_ASSERT_TRUE(engine->send("AT+CSQ", 1000, onDone, done, onLine));
+  engine->poll();
+  TEST_ASSERT_EQUAL_STRING("AT+CSQ\r\n", modem->takeSent().c_str());
+  TEST_ASSERT_FALSE(engine->isIdle());
+
+  runFor(120);
+  modem->replyLine("AT+CSQ"); // echo
+  modem->replyLine("+CSQ: 20,0");
+  modem->replyLine("");
+  modem->replyLine("OK");
+  engine->poll();
+
+  TEST_ASSERT_EQUAL(1, done->calls);
+  TEST_ASSERT_EQUAL(AT_OK, done->result);
+  TEST_ASSERT_EQUAL_STRING("OK", done->finalLine.c_str());
+  TEST_ASSERT_EQUAL_UINT32(120, done->latencyMs);
+  TEST_ASSERT_EQUAL(1, (int)done->lines.size());
+  TEST_ASSERT_EQUAL_STRING("+CSQ: 20,0", done->lines[0].c_str());
+  TEST_ASSERT_TRUE(engine->isIdle());
+}
+
+static void test_error_results_complete(void)
+{
+  Completion *error = newCompletion();
+  Completion *cme = newCompletion();
+  Completion *cms = newCompletion();
+  engine->send("AT+CGATT=1", 1000, onDone, error);
+  engine->send("AT+CPIN?", 1000, onDone, cme);
+  engine->send("AT+CMGS=\"1\"", 1000, onDone, cms);
+
+  engine->poll();
+  modem->takeSent();
+  modem->replyLine("ERROR");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_ERROR, error->result);
+  TEST_ASSERT_EQUAL_STRING("AT+CPIN?\r\n", modem->takeSent().c_str());
+
+  modem->replyLine("+CME ERROR: 10");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_CME_ERROR, cme->result);
+  TEST_ASSERT_EQUAL_STRING("+CME ERROR: 10", cme->finalLine.c_str());
+
+  modem->replyLine("+CMS ERROR: 500");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_CMS_ERROR, cms->result);
+  TEST_ASSERT_EQUAL(1, error->calls);
+  TEST_ASSERT_EQUAL(1, cme->calls);
+  TEST_ASSERT_EQUAL(1, cms->calls);
+
+  TEST_ASSERT_EQUAL(3, engine->statsCount());
+  TEST_ASSERT_EQUAL_STRING("AT+CGATT", engine->stats()[0].name);
+  TEST_ASSERT_EQUAL_UINT32(1, engine->stats()[0].errors);
+  TEST_ASSERT_EQUAL_STRING("AT+CPIN", engine->stats()[1].name);
+}
+
+static void test_commands_run_one_at_a_time(void)
+{
+  Completion *first = newCompletion();
+  Completion *second = newCompletion();
+  engine->send("AT", 1000, onDone, first);
+  engine->send("AT+CGNSPWR=1", 1000, onDone, second);
+
+  runFor(200);
+  TEST_ASSERT_EQUAL_STRING("AT\r\n", modem->takeSent().c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, engine->queued());
+
+  modem->replyLine("OK");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_OK, first->result);
+  TEST_ASSERT_EQUAL_STRING("AT+CGNSPWR=1\r\n", modem->takeSent().c_str());
+  TEST_ASSERT_EQUAL(0, second->calls);
+}
+
+static void test_command_times_out(void)
+{
+  Completion *done = newCompletion();
+  engine->send("AT+COPS?", 300, onDone, done);
+  engine->poll();
+
+  runFor(290);
+  TEST_ASSERT_EQUAL(0, done->calls);
+  runFor(10);
+  TEST_ASSERT_EQUAL(1, done->calls);
+  TEST_ASSERT_EQUAL(AT_TIMEOUT, done->result);
+  TEST_ASSERT_FALSE(done->hadFinalLine);
+  TEST_ASSERT_EQUAL_UINT32(300, done->latencyMs);
+  TEST_ASSERT_EQUAL_UINT32(1, engine->stats()[0].timeouts);
+  TEST_ASSERT_TRUE(engine->isIdle());
+
+  runFor(1000);
+  TEST_ASSERT_EQUAL(1, done->calls);
+}
+
+static void test_urc_is_dispatched_while_a_command_is_pending(void)
+{
+  TEST_ASSERT_TRUE(engine->onURC("+UGNSINF:", onURCLine, NULL));
+  TEST_ASSERT_TRUE(engine->onURC("+CPIN:", onURCLine, NULL));
+  Completion *done = newCompletion();
+  engine->send("AT+CSQ", 1000, onDone, done, onLine);
+  engine->poll();
+
+  modem->replyLine("+CSQ: 18,0");
+  modem->replyLine("+UGNSINF: 1,1,20240315081530.000,6.927100,79.861200");
+  modem->replyLine("+CPIN: READY");
+  TEST_ASSERT_FALSE(engine->isIdle());
+  modem->reply("O"); // the final result split across reads
+  engine->poll();
+  TEST_ASSERT_EQUAL(2, (int)urcs.size());
+  TEST_ASSERT_EQUAL(0, done->calls);
+  modem->reply("K\r\n");
+  engine->poll();
+
+  TEST_ASSERT_EQUAL(AT_OK, done->result);
+  TEST_ASSERT_EQUAL(1, (int)done->lines.size());
+  TEST_ASSERT_EQUAL_STRING("+CSQ: 18,0", done->lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("+UGNSINF: 1,1,20240315081530.000,6.927100,79.861200", urcs[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("+CPIN: READY", urcs[1].c_str());
+}
+
+static void test_unclaimed_lines_are_counted(void)
+{
+  engine->onURC("RING", onURCLine, NULL);
+  modem->replyLine("RING");
+  modem->replyLine("+CREG: 1");
+  modem->replyLine("OK");
+  engine->poll();
+  TEST_ASSERT_EQUAL(1, (int)urcs.size());
+  TEST_ASSERT_EQUAL_UINT32(2, engine->droppedLines());
+}
+
+/*
+ * The first command times out and its OK turns up late. The next command
+ * must not be sent until the guard has passed, and the late OK must not
+ * complete it.
+ */
+static void test_late_reply_does_not_complete_the_next_command(void)
+{
+  Completion *slow = newCompletion();
+  Completion *next = newCompletion();
+  engine->send("AT+CGATT=1", 200, onDone, slow);
+  engine->send("AT+CSQ", 1000, onDone, next);
+  engine->poll();
+  modem->takeSent();
+
+  runFor(200);
+  TEST_ASSERT_EQUAL(AT_TIMEOUT, slow->result);
+  TEST_ASSERT_EQUAL_STRING("", modem->takeSent().c_str());
+
+  runFor(100);
+  modem->replyLine("OK"); // the late reply of AT+CGATT
+  runFor(AT_TIMEOUT_GUARD - 110);
+  TEST_ASSERT_EQUAL(0, next->calls);
+  TEST_ASSERT_EQUAL_STRING("", modem->takeSent().c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, engine->droppedLines());
+
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("AT+CSQ\r\n", modem->takeSent().c_str());
+  TEST_ASSERT_EQUAL(0, next->calls);
+  modem->replyLine("+CME ERROR: 3");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_CME_ERROR, next->result);
+  TEST_ASSERT_EQUAL(1, slow->calls);
+}
+
+static void test_hold_keeps_commands_queued(void)
+{
+  Completion *done = newCompletion();
+  engine->hold(true);
+  engine->send("AT", 100, onDone, done);
+  runFor(500);
+  TEST_ASSERT_EQUAL_STRING("", modem->takeSent().c_str());
+  TEST_ASSERT_EQUAL(0, done->calls);
+
+  engine->hold(false);
+  engine->poll();
+  TEST_ASSERT_EQUAL_STRING("AT\r\n", modem->takeSent().c_str());
+}
+
+static void test_queue_limits(void)
+{
+  for (int i = 0; i < AT_QUEUE_LENGTH; i++)
+  {
+    TEST_ASSERT_TRUE(engine->send("AT", 1000, NULL, NULL));
+  }
+  TEST_ASSERT_FALSE(engine->send("AT", 1000, NULL, NULL));
+  TEST_ASSERT_EQUAL_UINT32(AT_QUEUE_LENGTH, engine->queued());
+
+  std::string tooLong = "AT+" + std::string(AT_COMMAND_MAX, 'X');
+  ATEngine fresh(*modem);
+  fresh.begin();
+  TEST_ASSERT_FALSE(fresh.send(tooLong.c_str(), 1000, NULL, NULL));
+}
+
+static void test_send_and_wait_on_the_polling_task(void)
+{
+  engine->poll(); // this thread is now the polling task
+  unsigned long start = hostMillis();
+  TEST_ASSERT_EQUAL(AT_TIMEOUT, engine->sendAndWait("AT+CBC", 50));
+  TEST_ASSERT_TRUE(hostMillis() - start >= 50);
+  TEST_ASSERT_EQUAL_STRING("AT+CBC\r\n", modem->takeSent().c_str());
+}
+
+static void test_send_and_wait_from_another_task(void)
+{
+  engine->poll();
+  Completion lines = Completion();
+  ATResult result = AT_QUEUE_FULL;
+  std::thread waiter([&]() { result = engine->sendAndWait("AT+CBC", 1000, onLine, &lines); });
+
+  while (modem->sent.empty())
+  {
+    engine->poll();
+    std::this_thread::yield();
+  }
+  modem->replyLine("+CBC: 0,85,4012");
+  modem->replyLine("OK");
+  engine->poll();
+  waiter.join();
+
+  TEST_ASSERT_EQUAL(AT_OK, result);
+  TEST_ASSERT_EQUAL(1, (int)lines.lines.size());
+  TEST_ASSERT_EQUAL_STRING("+CBC: 0,85,4012", lines.lines[0].c_str());
+}
+
+static void test_payload_goes_out_at_the_prompt(void)
+{
+  static const uint8_t frame[] = {'T', 'M', 1, 0, 0, 2, 0, 0x0D, 0x0A};
+  Completion *done = newCompletion();
+  TEST_ASSERT_TRUE(engine->sendData("AT+CIPSEND=9", frame, sizeof(frame), 5000, onDone, done));
+  engine->poll();
+  TEST_ASSERT_EQUAL_STRING("AT+CIPSEND=9\r\n", modem->takeSent().c_str());
+
+  modem->reply("> ");
+  engine->poll();
+  std::string sent = modem->takeSent();
+  TEST_ASSERT_EQUAL(sizeof(frame), sent.size());
+  TEST_ASSERT_EQUAL_MEMORY(frame, sent.data(), sizeof(frame));
+
+  modem->replyLine("");
+  modem->replyLine("SEND OK");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_OK, done->result);
+  TEST_ASSERT_EQUAL_STRING("SEND OK", done->finalLine.c_str());
+
+  Completion *failed = newCompletion();
+  engine->sendData("AT+CIPSEND=9", frame, sizeof(frame), 5000, onDone, failed);
+  engine->poll();
+  modem->reply("> ");
+  engine->poll();
+  modem->replyLine("SEND FAIL");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_ERROR, failed->result);
+  TEST_ASSERT_EQUAL_UINT32(0, engine->droppedLines());
+}
+
+static void test_first_line_can_end_a_command(void)
+{
+  Completion *address = newCompletion();
+  Completion *shut = newCompletion();
+  TEST_ASSERT_TRUE(engine->sendForLine("AT+CIFSR", 1000, onDone, address));
+  engine->send("AT+CIPSHUT", 1000, onDone, shut);
+  engine->poll();
+  modem->replyLine("AT+CIFSR"); // echo is still skipped
+  modem->replyLine("10.64.12.7");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_OK, address->result);
+  TEST_ASSERT_EQUAL_STRING("10.64.12.7", address->finalLine.c_str());
+
+  modem->replyLine("SHUT OK");
+  engine->poll();
+  TEST_ASSERT_EQUAL(AT_OK, shut->result);
+}
+
+static void test_print_stats(void)
+{
+  Completion *done = newCompletion();
+  engine->send("AT+CSQ", 1000, onDone, done);
+  engine->poll();
+  runFor(40);
+  modem->replyLine("OK");
+  engine->poll();
+
+  StringPrint out;
+  engine->printStats(out);
+  TEST_ASSERT_TRUE(out.text.find("AT+CSQ              1    0    0   40   40   40") != std::string::npos);
+  TEST_ASSERT_TRUE(out.text.find("Unclaimed lines: 0") != std::string::npos);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ok_completes_with_the_lines);
+  RUN_TEST(test_error_results_complete);
+  RUN_TEST(test_commands_run_one_at_a_time);
+  RUN_TEST(test_command_times_out);
+  RUN_TEST(test_urc_is_dispatched_while_a_command_is_pending);
+  RUN_TEST(test_unclaimed_lines_are_counted);
+  RUN_TEST(test_late_reply_does_not_complete_the_next_command);
+  RUN_TEST(test_hold_keeps_commands_queued);
+  RUN_TEST(test_queue_limits);
+  RUN_TEST(test_send_and_wait_on_the_polling_task);
+  RUN_TEST(test_send_and_wait_from_another_task);
+  RUN_TEST(test_payload_goes_out_at_the_prompt);
+  RUN_TEST(test_first_line_can_end_a_command);
+  RUN_TEST(test_print_stats);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <thread>
+#include "ByteRing.h"
+
+#define STRESS_BYTES 1000000
+
+static ByteRing<16> ring;
+
+void setUp(void)
+{
+  ring = ByteRing<16>();
+}
+
+void tearDown(void)
+{
+}
+
+static void test_starts_empty(void)
+{
+  size_t length;
+  ring.readSpan(length);
+  TEST_ASSERT_EQUAL(0, length);
+  TEST_ASSERT_EQUAL(-1, ring.pop());
+  TEST_ASSERT_EQUAL(-1, ring.peek());
+  ring.writeSpan(length);
+  TEST_ASSERT_EQUAL(16, length);
+}
+
+static void test_bytes_come_out_in_order(void)
+{
+  const uint8_t in[] = "OK\r\n";
+  TEST_ASSERT_EQUAL(4, ring.push(in, 4));
+  TEST_ASSERT_EQUAL(4, ring.size());
+  TEST_ASSERT_EQUAL('O', ring.peek());
+  TEST_ASSERT_EQUAL('O', ring.pop());
+  TEST_ASSERT_EQUAL('K', ring.pop());
+  TEST_ASSERT_EQUAL('\r', ring.pop());
+  TEST_ASSERT_EQUAL('\n', ring.pop());
+  TEST_ASSERT_EQUAL(-1, ring.pop());
+}
+
+static void test_overflow_keeps_the_prefix(void)
+{
+  uint8_t in[20];
+  for (int i = 0; i < 20; i++)
+  {
+    in[i] = i;
+  }
+  TEST_ASSERT_EQUAL(16, ring.push(in, 20));
+  TEST_ASSERT_EQUAL_UINT32(4, ring.overflow());
+  TEST_ASSERT_EQUAL(16, ring.highWater());
+  size_t length;
+  ring.writeSpan(length);
+  TEST_ASSERT_EQUAL(0, length);
+  for (int i = 0; i < 16; i++)
+  {
+    TEST_ASSERT_EQUAL(i, ring.pop());
+  }
+  ring.dropped(3);
+  TEST_ASSERT_EQUAL_UINT32(7, ring.overflow());
+}
+
+static void test_spans_split_at_the_end(void)
+{
+  uint8_t in[12] = {0};
+  ring.push(in, 12);
+  for (int i = 0; i < 12; i++)
+  {
+    ring.pop();
+  }
+  // Head and tail at 12: the next 8 bytes wrap after 4
+  const uint8_t wrap[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  TEST_ASSERT_EQUAL(8, ring.push(wrap, 8));
+  size_t length;
+  const uint8_t *span = ring.readSpan(length);
+  TEST_ASSERT_EQUAL(4, length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(wrap, span, 4);
+  ring.consume(4);
+  span = ring.readSpan(length);
+  TEST_ASSERT_EQUAL(4, length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(wrap + 4, span, 4);
+
+  ring.writeSpan(length);
+  TEST_ASSERT_EQUAL(12, length); // from offset 4 to the end, the unread bytes are at 0 to 3
+}
+
+static void test_many_laps(void)
+{
+  ByteRing<2> small;
+  uint8_t c = 0;
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    small.push(&c, 1);
+    TEST_ASSERT_EQUAL(c, small.pop());
+    c++;
+  }
+  TEST_ASSERT_EQUAL(0, small.size());
+  TEST_ASSERT_EQUAL_UINT32(0, small.overflow());
+}
+
+static ByteRing<256> shared;
+
+static void producer()
+{
+  uint32_t sent = 0;
+  while (sent < STRESS_BYTES)
+  {
+    size_t length;
+    uint8_t *to = shared.writeSpan(length);
+    if (length > STRESS_BYTES - sent)
+    {
+      length = STRESS_BYTES - sent;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+      to[i] = (uint8_t)(sent + i);
+    }
+    shared.commit(length);
+    sent += length;
+  }
+}
+
+static void test_two_threads(void)
+{
+  shared = ByteRing<256>();
+  std::thread thread(producer);
+  uint32_t received = 0;
+  uint32_t wrong = 0;
+  while (received < STRESS_BYTES)
+  {
+    size_t length;
+    const uint8_t *from = shared.readSpan(length);
+    for (size_t i = 0; i < length; i++)
+    {
+      wrong += from[i] != (uint8_t)(received + i);
+    }
+    shared.consume(length);
+    received += length;
+  }
+  thread.join();
+  TEST_ASSERT_EQUAL_UINT32(0, wrong);
+  TEST_ASSERT_EQUAL_UINT32(0, shared.overflow());
+  TEST_ASSERT_LESS_OR_EQUAL(256, shared.highWater());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_starts_empty);
+  RUN_TEST(test_bytes_come_out_in_order);
+  RUN_TEST(test_overflow_keeps_the_prefix);
+  RUN_TEST(test_spans_split_at_the_end);
+  RUN_TEST(test_many_laps);
+  RUN_TEST(test_two_threads);
+  return UNITY_END();
+}
@@ -0,0 +1,227 @@
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include "CGNSINFParser.h"
+#include "HostBench.h"
+
+#define GARBAGE_LINES 2000
+#define BENCH_RECORDS 100000
+
+static const char FULL[] = "+CGNSINF: 1,1,20240315123045.000,6.927100,79.861200,12.3,0.50,180.0,1,,1.2,1.5,0.9,,10,7,,,38,,\r\n";
+
+static CGNSINFParser parser;
+
+void setUp(void)
+{
+  parser = CGNSINFParser();
+}
+
+void tearDown(void)
+{
+}
+
+// Feed a whole string, count the records it completed
+static int feed(const char *text)
+{
+  int records = 0;
+  while (*text)
+  {
+    if (parser.feed(*text++))
+    {
+      records++;
+    }
+  }
+  return records;
+}
+
+static void test_full_record(void)
+{
+  TEST_ASSERT_EQUAL(1, feed(FULL));
+  const GPSFix &fix = parser.fix();
+  TEST_ASSERT_EQUAL(1, fix.runStatus);
+  TEST_ASSERT_EQUAL(1, fix.fixStatus);
+  TEST_ASSERT_EQUAL_UINT32(1710505845UL, fix.timestamp);
+  TEST_ASSERT_EQUAL_INT32(69271000, fix.latitude);
+  TEST_ASSERT_EQUAL_INT32(798612000, fix.longitude);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.3f, fix.altitude);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, fix.speed);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 180.0f, fix.course);
+  TEST_ASSERT_EQUAL(1, fix.fixMode);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.2f, fix.hdop);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.5f, fix.pdop);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.9f, fix.vdop);
+  TEST_ASSERT_EQUAL(10, fix.satellitesInView);
+  TEST_ASSERT_EQUAL(7, fix.satellitesUsed);
+  TEST_ASSERT_EQUAL_UINT32(1, parser.recordCount());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.errorCount());
+}
+
+static void test_empty_fields_keep_their_position(void)
+{
+  // No fix yet: everything after the run status is empty
+  TEST_ASSERT_EQUAL(1, feed("+CGNSINF: 1,0,,,,,,,,,,,,,,,,,,,\r\n"));
+  const GPSFix &fix = parser.fix();
+  TEST_ASSERT_EQUAL(1, fix.runStatus);
+  TEST_ASSERT_EQUAL(0, fix.fixStatus);
+  TEST_ASSERT_EQUAL_UINT32(0, fix.timestamp);
+  TEST_ASSERT_EQUAL_INT32(0, fix.latitude);
+  TEST_ASSERT_FLOAT_WITHIN(0.0f, 0.0f, fix.hdop);
+  TEST_ASSERT_EQUAL(0, fix.satellitesUsed);
+}
+
+static void test_southern_and_western_coordinates(void)
+{
+  TEST_ASSERT_EQUAL(1, feed("+CGNSINF: 1,1,20240315123045.000,-33.8688197,-151.2092955,58,0,0,1,,0.9,1.2,0.8,,12,9,,,40,,\r\n"));
+  TEST_ASSERT_EQUAL_INT32(-338688197, parser.fix().latitude);
+  TEST_ASSERT_EQUAL_INT32(-1512092955, parser.fix().longitude);
+}
+
+static void test_extra_decimals_are_rounded(void)
+{
+  TEST_ASSERT_EQUAL(1, feed("+CGNSINF: 1,1,20240315123045.000,6.927100049,-79.86120005,0,0,0,1,,1,1,1,,5,5,,,,,\r\n"));
+  TEST_ASSERT_EQUAL_INT32(69271000, parser.fix().latitude);
+  TEST_ASSERT_EQUAL_INT32(-798612001, parser.fix().longitude);
+}
+
+static void test_utc_counts_whole_second_digits_only(void)
+{
+  // 12 digits before the dot are not a complete time, however many decimals follow
+  TEST_ASSERT_EQUAL(1, feed("+CGNSINF: 1,1,202403151230.123456,6.9271,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(0, parser.fix().timestamp);
+  TEST_ASSERT_EQUAL(1, feed("+CGNSINF: 1,1,20240315123045.1234567890123,6.9271,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(1710505845UL, parser.fix().timestamp);
+}
+
+static void test_other_lines_are_ignored(void)
+{
+  TEST_ASSERT_EQUAL(0, feed("AT+CGNSINF\r\nOK\r\n+CGNSPWR: 1\r\n"));
+  TEST_ASSERT_EQUAL(1, feed(FULL));
+  TEST_ASSERT_EQUAL(0, feed("\r\nOK\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(1, parser.recordCount());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.errorCount());
+}
+
+static void test_malformed_records_are_dropped(void)
+{
+  TEST_ASSERT_EQUAL(0, feed("+CGNSINF: 1,1,20240315123045.000,6.9271\r\n"));          // too short
+  TEST_ASSERT_EQUAL(0, feed("+CGNSINF: 1,1,20240315123045.000,6.9x71,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,\r\n"));
+  TEST_ASSERT_EQUAL(0, feed("+CGNSINF: 1,1,20240315123045.000,600.0,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(0, parser.recordCount());
+  TEST_ASSERT_EQUAL_UINT32(3, parser.errorCount());
+
+  // The parser is back at a line start after each of them
+  TEST_ASSERT_EQUAL(1, feed(FULL));
+}
+
+// Feed a line that must not produce a record, then check a good one still parses
+static void assertRejected(const std::string &line)
+{
+  uint32_t records = parser.recordCount();
+  for (size_t i = 0; i < line.size(); i++)
+  {
+    TEST_ASSERT_FALSE(parser.feed(line[i]));
+  }
+  TEST_ASSERT_FALSE(parser.feed('\n'));
+  TEST_ASSERT_EQUAL_UINT32(records, parser.recordCount());
+  TEST_ASSERT_EQUAL(1, feed(FULL));
+}
+
+static void test_truncated_lines(void)
+{
+  // FULL cut before its 16th field, at every byte
+  const char *sixteenth = FULL;
+  for (int commas = 0; commas < CGNSINF_MIN_FIELDS - 1; sixteenth++)
+  {
+    commas += *sixteenth == ',';
+  }
+  for (size_t length = 0; length < (size_t)(sixteenth - FULL); length++)
+  {
+    assertRejected(std::string(FULL, length));
+  }
+}
+
+static void test_overlong_lines(void)
+{
+  std::string record(FULL, strlen(FULL) - 2);
+  assertRejected(record + std::string(CGNSINF_MAX_FIELDS, ','));
+  assertRejected("+CGNSINF: " + std::string(300, ','));   // 256 more fields wrap a byte index
+  assertRejected("+CGNSINF: 1,1," + std::string(270, '7') + ",6.9271,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,");
+  assertRejected("+CGNSINF: 1,1,20240315123045.000,6.9271,79.8612," + std::string(5000, '9') + ",0,0,1,,1,1,1,,5,5,,,,,");
+  assertRejected("+CGNSINF: 1,1,20240315123045.000," + std::string(40, '0') + "181.0,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,");
+  // A long fraction is only precision we do not keep
+  TEST_ASSERT_EQUAL(1, feed(("+CGNSINF: 1,1,20240315123045.000,6.9271,79.8612,12." + std::string(3000, '5') +
+                             ",0,0,1,,1,1,1,,5,5,,,,,\r\n").c_str()));
+}
+
+static void test_garbage_lines(void)
+{
+  uint32_t state = 2463534242UL;
+  uint32_t records = 0;
+  for (int line = 0; line < GARBAGE_LINES; line++)
+  {
+    // Random bytes, half of the lines behind a real prefix and first fields
+    std::string text = line % 2 ? "+CGNSINF: 1,1," : "";
+    size_t length = 1 + line % 200;
+    for (size_t i = 0; i < length; i++)
+    {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      char c = (char)(state >> 24);
+      text += c == '\r' || c == '\n' ? '\0' : c;
+    }
+    for (size_t i = 0; i < text.size(); i++)
+    {
+      records += parser.feed(text[i]);
+    }
+    records += parser.feed('\r');
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, records);
+  TEST_ASSERT_EQUAL_UINT32(0, parser.recordCount());
+  assertRejected("+CGNSINF: +CGNSINF: 1,1,20240315123045.000,6.9271,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,");
+  assertRejected("+CGNSINF: 1,1,2024-03-15 12:30:45,6.9271,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,");
+  assertRejected(std::string("+CGNSINF: 1,1,\0\xff,6.9271,79.8612,0,0,0,1,,1,1,1,,5,5,,,,,", 56));
+}
+
+static void test_benchmark_records_per_second(void)
+{
+  size_t length = strlen(FULL);
+  uint64_t start = benchNanos();
+  for (int i = 0; i < BENCH_RECORDS; i++)
+  {
+    for (size_t k = 0; k < length; k++)
+    {
+      parser.feed(FULL[k]);
+    }
+  }
+  double seconds = (benchNanos() - start) / 1e9;
+  TEST_ASSERT_EQUAL_UINT32(BENCH_RECORDS, parser.recordCount());
+  benchReport("CGNSINF throughput", BENCH_RECORDS / seconds, "records/s");
+  benchReport("CGNSINF parse cost", seconds * 1e9 / ((double)BENCH_RECORDS * length), "ns/byte");
+}
+
+static void test_reset_drops_a_partial_line(void)
+{
+  feed("+CGNSINF: 1,1,2024");
+  parser.reset();
+  TEST_ASSERT_EQUAL(1, feed(FULL));
+  TEST_ASSERT_EQUAL_UINT32(1710505845UL, parser.fix().timestamp);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_record);
+  RUN_TEST(test_empty_fields_keep_their_position);
+  RUN_TEST(test_southern_and_western_coordinates);
+  RUN_TEST(test_extra_decimals_are_rounded);
+  RUN_TEST(test_utc_counts_whole_second_digits_only);
+  RUN_TEST(test_other_lines_are_ignored);
+  RUN_TEST(test_malformed_records_are_dropped);
+  RUN_TEST(test_reset_drops_a_partial_line);
+  RUN_TEST(test_truncated_lines);
+  RUN_TEST(test_overlong_lines);
+  RUN_TEST(test_garbage_lines);
+  RUN_TEST(test_benchmark_records_per_second);
+  return UNITY_END();
+}
@@ -0,0 +1,187 @@
+#include <unity.h>
+#include <stdlib.h>
+#include "Pangodream_18650_CL.h"
+#include "HostBench.h"
+
+#define BENCH_SWEEPS 2000
+
+// Three-point curve of another cell, picked at compile time
+struct TestCurve
+{
+  static constexpr uint8_t POINTS = 3;
+  static constexpr uint16_t MILLIVOLTS[POINTS] = {3000, 3600, 4000};
+};
+constexpr uint16_t TestCurve::MILLIVOLTS[];
+static_assert(curveRises<TestCurve>(), "test curve must rise");
+
+static Pangodream_18650_CL battery;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Straightforward linear scan, what the binary search has to agree with
+static int referenceTenths(const uint16_t *curve, uint8_t points, uint16_t millivolts)
+{
+  if (millivolts <= curve[0])
+    return 0;
+  if (millivolts >= curve[points - 1])
+    return 1000;
+  uint8_t i = 0;
+  while (curve[i + 1] <= millivolts)
+    i++;
+  return (int)((i * 1000 + (uint32_t)(millivolts - curve[i]) * 1000 / (curve[i + 1] - curve[i])) / (points - 1));
+}
+
+// The lookup this replaced: a halving walk over a 101-entry double table
+// in RAM, without interpolation
+static double oldVolts[101];
+
+static int oldHalvingLevel(double volts)
+{
+  int idx = 50;
+  int prev = 0;
+  int half = 0;
+  if (volts >= 4.2)
+    return 100;
+  if (volts <= 3.2)
+    return 0;
+  while (true)
+  {
+    half = abs(idx - prev) / 2;
+    prev = idx;
+    if (volts >= oldVolts[idx])
+      idx = idx + half;
+    else
+      idx = idx - half;
+    if (prev == idx)
+      break;
+  }
+  return idx;
+}
+
+static void test_limits(void)
+{
+  TEST_ASSERT_EQUAL(0, battery.getChargeTenthsForMillivolts(0));
+  TEST_ASSERT_EQUAL(0, battery.getChargeTenthsForMillivolts(3200));
+  TEST_ASSERT_EQUAL(1000, battery.getChargeTenthsForMillivolts(4200));
+  TEST_ASSERT_EQUAL(1000, battery.getChargeTenthsForMillivolts(65535));
+}
+
+static void test_every_curve_point_is_its_percentage(void)
+{
+  for (uint8_t i = 0; i < Pangodream_18650_Curve::POINTS; i++)
+  {
+    TEST_ASSERT_EQUAL(i * 10, battery.getChargeTenthsForMillivolts(Pangodream_18650_Curve::MILLIVOLTS[i]));
+  }
+}
+
+static void test_matches_a_linear_scan(void)
+{
+  for (uint32_t mv = 3000; mv <= 4400; mv++)
+  {
+    TEST_ASSERT_EQUAL(referenceTenths(Pangodream_18650_Curve::MILLIVOLTS, Pangodream_18650_Curve::POINTS, mv),
+                      battery.getChargeTenthsForMillivolts(mv));
+  }
+}
+
+static void test_benchmark_against_the_halving_search(void)
+{
+  for (uint8_t i = 0; i < Pangodream_18650_Curve::POINTS; i++)
+  {
+    oldVolts[i] = Pangodream_18650_Curve::MILLIVOLTS[i] / 1000.0;
+  }
+  // How often the old walk missed the table, which the new lookup never does
+  uint32_t oldMisses = 0;
+  for (uint32_t mv = 3200; mv <= 4200; mv++)
+  {
+    int floorPercent = referenceTenths(Pangodream_18650_Curve::MILLIVOLTS, Pangodream_18650_Curve::POINTS, mv) / 10;
+    oldMisses += oldHalvingLevel(mv / 1000.0) != floorPercent;
+    TEST_ASSERT_EQUAL(floorPercent, battery.getChargeTenthsForMillivolts(mv) / 10);
+  }
+  TEST_ASSERT_GREATER_THAN(0, oldMisses);
+
+  uint32_t lookups = BENCH_SWEEPS * 1401;
+  uint64_t start = benchNanos();
+  for (int sweep = 0; sweep < BENCH_SWEEPS; sweep++)
+  {
+    for (uint32_t mv = 3000; mv <= 4400; mv++)
+    {
+      benchKeep(oldHalvingLevel(mv / 1000.0));
+    }
+  }
+  double oldNs = (double)(benchNanos() - start) / lookups;
+  start = benchNanos();
+  for (int sweep = 0; sweep < BENCH_SWEEPS; sweep++)
+  {
+    for (uint32_t mv = 3000; mv <= 4400; mv++)
+    {
+      benchKeep(battery.getChargeTenthsForMillivolts(mv));
+    }
+  }
+  double newNs = (double)(benchNanos() - start) / lookups;
+  benchReport("Charge lookup, old halving search", oldNs, "ns");
+  benchReport("Charge lookup, interpolated search", newNs, "ns");
+  benchReport("Old halving search off the table", oldMisses, "of 1001 mV steps");
+}
+
+static void test_rises_with_the_voltage(void)
+{
+  int previous = 0;
+  for (uint32_t mv = 3200; mv <= 4200; mv++)
+  {
+    int tenths = battery.getChargeTenthsForMillivolts(mv);
+    TEST_ASSERT_GREATER_OR_EQUAL(previous, tenths);
+    previous = tenths;
+  }
+}
+
+static void test_interpolates_between_points(void)
+{
+  // Three fifths of the way from 3800 mV (41%) to 3805 mV (42%)
+  TEST_ASSERT_EQUAL(416, battery.getChargeTenthsForMillivolts(3803));
+  // Halfway from 3200 mV (0%) to 3250 mV (1%)
+  TEST_ASSERT_EQUAL(5, battery.getChargeTenthsForMillivolts(3225));
+}
+
+static void test_volts_round_to_the_nearest_millivolt(void)
+{
+  TEST_ASSERT_EQUAL(41, battery.getChargeLevelForVolts(3.8));
+  TEST_ASSERT_EQUAL(41, battery.getChargeLevelForVolts(3.7996));
+  TEST_ASSERT_EQUAL(40, battery.getChargeLevelForVolts(3.7994));
+  TEST_ASSERT_EQUAL(0, battery.getChargeLevelForVolts(-1.0));
+  TEST_ASSERT_EQUAL(100, battery.getChargeLevelForVolts(100.0));
+}
+
+static void test_curve_chosen_at_compile_time(void)
+{
+  Pangodream_18650_CL_T<TestCurve> cell;
+  TEST_ASSERT_EQUAL(0, cell.getChargeTenthsForMillivolts(3000));
+  TEST_ASSERT_EQUAL(250, cell.getChargeTenthsForMillivolts(3300));
+  TEST_ASSERT_EQUAL(500, cell.getChargeTenthsForMillivolts(3600));
+  TEST_ASSERT_EQUAL(750, cell.getChargeTenthsForMillivolts(3800));
+  TEST_ASSERT_EQUAL(1000, cell.getChargeTenthsForMillivolts(4000));
+  for (uint32_t mv = 2900; mv <= 4100; mv++)
+  {
+    TEST_ASSERT_EQUAL(referenceTenths(TestCurve::MILLIVOLTS, TestCurve::POINTS, mv),
+                      cell.getChargeTenthsForMillivolts(mv));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_limits);
+  RUN_TEST(test_every_curve_point_is_its_percentage);
+  RUN_TEST(test_matches_a_linear_scan);
+  RUN_TEST(test_benchmark_against_the_halving_search);
+  RUN_TEST(test_rises_with_the_voltage);
+  RUN_TEST(test_interpolates_between_points);
+  RUN_TEST(test_volts_round_to_the_nearest_millivolt);
+  RUN_TEST(test_curve_chosen_at_compile_time);
+  return UNITY_END();
+}
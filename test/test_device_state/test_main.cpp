@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <string.h>
+#include "DeviceState.h"
+
+static DeviceStateMachine machine;
+static uint32_t now;
+
+void setUp(void)
+{
+  machine = DeviceStateMachine();
+  now = 1000;
+}
+
+void tearDown(void)
+{
+}
+
+// Event a second after the previous one, well clear of the debounce
+static DeviceAction send(DeviceEventType type)
+{
+  now += 1000;
+  DeviceEvent event = {type, now};
+  return machine.handle(event);
+}
+
+static void test_boot_to_running(void)
+{
+  TEST_ASSERT_EQUAL(DEVICE_BOOT, machine.state());
+  TEST_ASSERT_EQUAL(ACTION_NONE, send(EVENT_BOOT_SCREENS_DONE));
+  TEST_ASSERT_EQUAL(DEVICE_WELCOME, machine.state());
+  TEST_ASSERT_EQUAL(ACTION_SHOW_MODES, send(EVENT_START_BUTTON));
+  TEST_ASSERT_EQUAL(DEVICE_SELECT_MODE, machine.state());
+  TEST_ASSERT_EQUAL(ACTION_START_INIT, send(EVENT_START_BUTTON));
+  TEST_ASSERT_EQUAL(DEVICE_INITIALIZING, machine.state());
+  TEST_ASSERT_EQUAL(MODE_REGISTER, machine.mode());
+  TEST_ASSERT_EQUAL(ACTION_NONE, send(EVENT_INIT_DONE));
+  TEST_ASSERT_EQUAL(DEVICE_RUNNING, machine.state());
+  TEST_ASSERT_EQUAL_UINT32(0, machine.ignored());
+}
+
+static void test_mode_button_toggles_the_selection(void)
+{
+  send(EVENT_BOOT_SCREENS_DONE);
+  send(EVENT_START_BUTTON);
+  TEST_ASSERT_EQUAL(ACTION_TOGGLE_MODE, send(EVENT_MODE_BUTTON));
+  TEST_ASSERT_EQUAL(MODE_TRACK, machine.mode());
+  TEST_ASSERT_EQUAL(ACTION_TOGGLE_MODE, send(EVENT_MODE_BUTTON));
+  TEST_ASSERT_EQUAL(MODE_REGISTER, machine.mode());
+  send(EVENT_MODE_BUTTON);
+  send(EVENT_START_BUTTON);
+  TEST_ASSERT_EQUAL(DEVICE_INITIALIZING, machine.state());
+  TEST_ASSERT_EQUAL(MODE_TRACK, machine.mode());
+}
+
+static void test_fast_boot_keeps_the_preselected_mode(void)
+{
+  machine.selectMode(MODE_TRACK);
+  TEST_ASSERT_EQUAL(ACTION_START_INIT, send(EVENT_FAST_BOOT));
+  TEST_ASSERT_EQUAL(DEVICE_INITIALIZING, machine.state());
+  TEST_ASSERT_EQUAL(MODE_TRACK, machine.mode());
+}
+
+static void test_init_failure(void)
+{
+  send(EVENT_FAST_BOOT);
+  send(EVENT_INIT_FAILED);
+  TEST_ASSERT_EQUAL(DEVICE_FAILED, machine.state());
+  TEST_ASSERT_EQUAL(ACTION_NONE, send(EVENT_START_BUTTON));
+  TEST_ASSERT_EQUAL(DEVICE_FAILED, machine.state());
+}
+
+static void test_buttons_do_nothing_while_running(void)
+{
+  send(EVENT_FAST_BOOT);
+  send(EVENT_INIT_DONE);
+  TEST_ASSERT_EQUAL(ACTION_NONE, send(EVENT_START_BUTTON));
+  TEST_ASSERT_EQUAL(ACTION_NONE, send(EVENT_MODE_BUTTON));
+  TEST_ASSERT_EQUAL(DEVICE_RUNNING, machine.state());
+  TEST_ASSERT_EQUAL(MODE_REGISTER, machine.mode());
+  TEST_ASSERT_EQUAL_UINT32(2, machine.ignored());
+}
+
+static void test_bounces_are_dropped(void)
+{
+  send(EVENT_BOOT_SCREENS_DONE);
+  send(EVENT_START_BUTTON);
+  DeviceEvent bounce = {EVENT_START_BUTTON, now + DEVICE_DEBOUNCE_MS};
+  TEST_ASSERT_EQUAL(ACTION_NONE, machine.handle(bounce));
+  // MODE shares the window with START
+  DeviceEvent mode = {EVENT_MODE_BUTTON, now + 10};
+  TEST_ASSERT_EQUAL(ACTION_NONE, machine.handle(mode));
+  TEST_ASSERT_EQUAL(DEVICE_SELECT_MODE, machine.state());
+  TEST_ASSERT_EQUAL(MODE_REGISTER, machine.mode());
+  TEST_ASSERT_EQUAL_UINT32(2, machine.bounces());
+
+  DeviceEvent press = {EVENT_MODE_BUTTON, now + DEVICE_DEBOUNCE_MS + 1};
+  TEST_ASSERT_EQUAL(ACTION_TOGGLE_MODE, machine.handle(press));
+}
+
+static void test_debounce_across_the_millis_wrap(void)
+{
+  send(EVENT_BOOT_SCREENS_DONE);
+  DeviceEvent first = {EVENT_START_BUTTON, 0xFFFFFFC0UL};
+  TEST_ASSERT_EQUAL(ACTION_SHOW_MODES, machine.handle(first));
+  DeviceEvent bounce = {EVENT_MODE_BUTTON, 0x00000010UL};
+  TEST_ASSERT_EQUAL(ACTION_NONE, machine.handle(bounce));
+  TEST_ASSERT_EQUAL_UINT32(1, machine.bounces());
+  DeviceEvent press = {EVENT_MODE_BUTTON, 0x00000100UL};
+  TEST_ASSERT_EQUAL(ACTION_TOGGLE_MODE, machine.handle(press));
+}
+
+static void test_other_events_are_not_debounced(void)
+{
+  send(EVENT_FAST_BOOT);
+  DeviceEvent done = {EVENT_INIT_DONE, now + 1};
+  machine.handle(done);
+  TEST_ASSERT_EQUAL(DEVICE_RUNNING, machine.state());
+  TEST_ASSERT_EQUAL_UINT32(0, machine.bounces());
+}
+
+static void test_table_is_deterministic(void)
+{
+  for (size_t i = 0; i < DeviceStateMachine::TABLE_SIZE; i++)
+  {
+    for (size_t j = i + 1; j < DeviceStateMachine::TABLE_SIZE; j++)
+    {
+      const DeviceTransition &a = DeviceStateMachine::TABLE[i];
+      const DeviceTransition &b = DeviceStateMachine::TABLE[j];
+      TEST_ASSERT_FALSE(a.from == b.from && a.event == b.event);
+    }
+  }
+}
+
+static void test_every_state_and_event_has_a_name(void)
+{
+  for (int s = DEVICE_BOOT; s <= DEVICE_FAILED; s++)
+  {
+    TEST_ASSERT_TRUE(strcmp("?", DeviceStateMachine::stateName((DeviceStateId)s)) != 0);
+  }
+  for (int e = EVENT_START_BUTTON; e <= EVENT_INIT_FAILED; e++)
+  {
+    TEST_ASSERT_TRUE(strcmp("?", DeviceStateMachine::eventName((DeviceEventType)e)) != 0);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_to_running);
+  RUN_TEST(test_mode_button_toggles_the_selection);
+  RUN_TEST(test_fast_boot_keeps_the_preselected_mode);
+  RUN_TEST(test_init_failure);
+  RUN_TEST(test_buttons_do_nothing_while_running);
+  RUN_TEST(test_bounces_are_dropped);
+  RUN_TEST(test_debounce_across_the_millis_wrap);
+  RUN_TEST(test_other_events_are_not_debounced);
+  RUN_TEST(test_table_is_deterministic);
+  RUN_TEST(test_every_state_and_event_has_a_name);
+  return UNITY_END();
+}
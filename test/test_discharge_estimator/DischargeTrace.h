@@ -0,0 +1,99 @@
+/*
+ * Fixture for the estimator: one discharge of a 2500 mAh NMC 18650 cell
+ * powering the tracker, from full to the 0 % point of the Pangodream curve
+ * (3200 mV with only the base load on the cell), one sample every
+ * ESTIMATOR_SAMPLE_INTERVAL as servicePowerGovernor() feeds the estimator.
+ *
+ * Synthesized rather than logged: a cell whose open circuit voltage
+ * follows Pangodream_18650_Curve, as the firmware assumes, 110 to 200 mOhm
+ * internal resistance rising towards empty, 85 mA base load, 40 mA with
+ * the GNSS engine on and 180 mA with a modem session open, the duty
+ * cycles dropping below 30 % as in the saver profile, and about 3 mV of
+ * correlated noise left after the BatteryMonitor filter. Each sample is the filtered millivolts and
+ * the load count passed to add(). Swap in a logged discharge when one is
+ * available; the tests only rely on DISCHARGE_TRACE_COUNT and on the trace
+ * ending at empty.
+ */
+
+#ifndef DischargeTrace_h
+#define DischargeTrace_h
+
+#include <stdint.h>
+
+struct TraceSample
+{
+  uint16_t millivolts;
+  uint8_t load;
+};
+
+static const TraceSample DISCHARGE_TRACE[] = {
+    {4174, 1}, {4177, 1}, {4173, 1}, {4174, 0}, {4174, 0}, {4171, 1}, {4167, 1}, {4145, 2},
+    {4146, 1}, {4164, 0}, {4157, 1}, {4154, 1}, {4149, 1}, {4152, 0}, {4130, 1}, {4140, 1},
+    {4118, 2}, {4115, 2}, {4132, 0}, {4134, 0}, {4131, 1}, {4123, 1}, {4124, 1}, {4130, 0},
+    {4105, 1}, {4119, 1}, {4100, 2}, {4088, 2}, {4090, 1}, {4087, 1}, {4096, 1}, {4099, 1},
+    {4095, 1}, {4101, 0}, {4096, 0}, {4068, 2}, {4085, 1}, {4089, 1}, {4091, 0}, {4090, 0},
+    {4066, 2}, {4063, 2}, {4078, 1}, {4084, 0}, {4060, 1}, {4073, 1}, {4072, 1}, {4047, 2},
+    {4047, 1}, {4049, 1}, {4059, 1}, {4055, 1}, {4057, 1}, {4061, 0}, {4045, 1}, {4034, 2},
+    {4052, 1}, {4027, 2}, {4049, 0}, {4049, 0}, {4042, 1}, {4041, 1}, {4041, 1}, {4042, 0},
+    {4019, 1}, {4009, 2}, {4031, 1}, {4034, 1}, {4034, 0}, {4033, 0}, {4006, 2}, {4025, 1},
+    {4025, 1}, {4030, 0}, {4025, 0}, {4021, 1}, {4022, 1}, {4002, 2}, {4023, 0}, {4000, 1},
+    {4015, 1}, {4014, 1}, {3996, 2}, {3994, 1}, {4008, 0}, {4005, 1}, {3979, 2}, {4000, 1},
+    {4006, 0}, {4005, 0}, {3975, 2}, {3990, 1}, {3989, 1}, {3992, 0}, {3986, 0}, {3984, 1},
+    {3987, 1}, {3987, 1}, {3989, 0}, {3992, 0}, {3967, 2}, {3985, 1}, {3983, 1}, {3983, 0},
+    {3981, 0}, {3979, 1}, {3980, 1}, {3975, 1}, {3963, 1}, {3961, 1}, {3976, 1}, {3971, 1},
+    {3950, 2}, {3972, 0}, {3954, 1}, {3965, 1}, {3962, 1}, {3966, 1}, {3949, 1}, {3962, 0},
+    {3937, 2}, {3940, 2}, {3955, 1}, {3938, 1}, {3954, 0}, {3947, 1}, {3946, 1}, {3947, 1},
+    {3951, 0}, {3949, 0}, {3927, 2}, {3921, 2}, {3935, 1}, {3938, 0}, {3940, 0}, {3937, 1},
+    {3935, 1}, {3935, 1}, {3922, 1}, {3941, 0}, {3914, 2}, {3933, 1}, {3930, 1}, {3913, 1},
+    {3912, 1}, {3907, 2}, {3901, 2}, {3925, 1}, {3928, 0}, {3927, 0}, {3902, 2}, {3919, 1},
+    {3917, 1}, {3902, 1}, {3925, 0}, {3914, 1}, {3911, 1}, {3912, 1}, {3920, 0}, {3916, 0},
+    {3891, 2}, {3904, 1}, {3886, 2}, {3889, 1}, {3905, 0}, {3899, 1}, {3897, 1}, {3875, 2},
+    {3897, 0}, {3874, 1}, {3892, 1}, {3892, 1}, {3867, 2}, {3891, 0}, {3892, 0}, {3869, 2},
+    {3886, 1}, {3867, 2}, {3890, 0}, {3886, 0}, {3882, 1}, {3878, 1}, {3856, 2}, {3884, 0},
+    {3885, 0}, {3881, 1}, {3877, 1}, {3876, 1}, {3861, 1}, {3876, 0}, {3846, 2}, {3844, 2},
+    {3840, 2}, {3868, 0}, {3869, 0}, {3865, 1}, {3865, 1}, {3862, 1}, {3867, 0}, {3842, 1},
+    {3862, 1}, {3864, 1}, {3833, 2}, {3858, 0}, {3860, 0}, {3853, 1}, {3856, 1}, {3838, 2},
+    {3856, 0}, {3853, 0}, {3850, 1}, {3830, 2}, {3848, 1}, {3857, 0}, {3829, 1}, {3843, 1},
+    {3840, 1}, {3816, 2}, {3820, 1}, {3820, 1}, {3835, 1}, {3830, 1}, {3832, 1}, {3840, 0},
+    {3836, 0}, {3826, 1}, {3827, 1}, {3803, 2}, {3828, 0}, {3827, 0}, {3825, 1}, {3805, 2},
+    {3822, 1}, {3799, 1}, {3822, 0}, {3821, 1}, {3797, 2}, {3816, 1}, {3816, 0}, {3814, 0},
+    {3814, 1}, {3813, 1}, {3814, 1}, {3817, 0}, {3814, 0}, {3810, 1}, {3808, 1}, {3804, 1},
+    {3812, 0}, {3813, 0}, {3809, 1}, {3807, 1}, {3781, 2}, {3808, 0}, {3811, 0}, {3804, 1},
+    {3802, 1}, {3799, 1}, {3806, 0}, {3801, 0}, {3766, 2}, {3791, 1}, {3770, 2}, {3774, 1},
+    {3800, 0}, {3797, 1}, {3769, 2}, {3788, 1}, {3795, 0}, {3794, 0}, {3785, 1}, {3785, 1},
+    {3779, 1}, {3783, 0}, {3764, 1}, {3762, 2}, {3761, 2}, {3760, 2}, {3787, 0}, {3784, 0},
+    {3781, 1}, {3756, 2}, {3775, 1}, {3779, 0}, {3774, 0}, {3770, 1}, {3768, 1}, {3774, 1},
+    {3779, 0}, {3759, 1}, {3777, 1}, {3781, 1}, {3775, 1}, {3758, 1}, {3757, 1}, {3769, 1},
+    {3768, 1}, {3770, 1}, {3771, 0}, {3772, 0}, {3765, 1}, {3767, 1}, {3737, 2}, {3771, 0},
+    {3769, 0}, {3760, 1}, {3760, 1}, {3757, 1}, {3764, 0}, {3735, 1}, {3756, 1}, {3756, 1},
+    {3759, 1}, {3759, 0}, {3735, 1}, {3727, 2}, {3720, 2}, {3746, 1}, {3756, 0}, {3757, 0},
+    {3751, 1}, {3751, 1}, {3750, 1}, {3757, 0}, {3759, 0}, {3753, 1}, {3756, 0}, {3755, 0},
+    {3756, 0}, {3756, 0}, {3719, 2}, {3745, 0}, {3718, 1}, {3715, 1}, {3719, 1}, {3712, 2},
+    {3715, 1}, {3746, 0}, {3745, 0}, {3744, 0}, {3740, 1}, {3744, 0}, {3738, 0}, {3736, 0},
+    {3735, 0}, {3729, 1}, {3711, 1}, {3738, 0}, {3736, 0}, {3732, 0}, {3730, 1}, {3739, 0},
+    {3739, 0}, {3740, 0}, {3733, 0}, {3727, 1}, {3734, 0}, {3733, 0}, {3732, 0}, {3706, 1},
+    {3728, 1}, {3732, 0}, {3732, 0}, {3733, 0}, {3731, 0}, {3728, 1}, {3731, 0}, {3729, 0},
+    {3730, 0}, {3734, 0}, {3728, 1}, {3728, 0}, {3728, 0}, {3728, 0}, {3728, 0}, {3717, 1},
+    {3722, 0}, {3725, 0}, {3694, 1}, {3718, 0}, {3716, 1}, {3717, 0}, {3721, 0}, {3720, 0},
+    {3691, 1}, {3712, 1}, {3721, 0}, {3721, 0}, {3719, 0}, {3719, 0}, {3711, 1}, {3720, 0},
+    {3719, 0}, {3717, 0}, {3715, 0}, {3710, 1}, {3718, 0}, {3721, 0}, {3718, 0}, {3719, 0},
+    {3710, 1}, {3715, 0}, {3717, 0}, {3715, 0}, {3683, 1}, {3705, 1}, {3712, 0}, {3684, 1},
+    {3711, 0}, {3709, 0}, {3701, 1}, {3671, 1}, {3702, 0}, {3702, 0}, {3703, 0}, {3699, 1},
+    {3705, 0}, {3709, 0}, {3709, 0}, {3707, 0}, {3696, 1}, {3704, 0}, {3704, 0}, {3702, 0},
+    {3704, 0}, {3694, 1}, {3674, 1}, {3698, 0}, {3700, 0}, {3702, 0}, {3693, 1}, {3702, 0},
+    {3667, 1}, {3694, 0}, {3692, 0}, {3690, 1}, {3697, 0}, {3692, 0}, {3696, 0}, {3664, 1},
+    {3686, 1}, {3692, 0}, {3689, 0}, {3661, 1}, {3691, 0}, {3678, 1}, {3690, 0}, {3692, 0},
+    {3659, 1}, {3686, 0}, {3682, 1}, {3687, 0}, {3646, 1}, {3659, 0}, {3651, 0}, {3641, 1},
+    {3639, 0}, {3635, 0}, {3628, 0}, {3624, 0}, {3611, 1}, {3612, 0}, {3602, 0}, {3600, 0},
+    {3588, 0}, {3550, 2}, {3567, 0}, {3567, 0}, {3561, 0}, {3549, 0}, {3497, 2}, {3521, 0},
+    {3510, 0}, {3508, 0}, {3502, 0}, {3489, 1}, {3487, 0}, {3485, 0}, {3444, 1}, {3461, 0},
+    {3449, 1}, {3450, 0}, {3445, 0}, {3438, 0}, {3431, 0}, {3421, 1}, {3384, 1}, {3401, 0},
+    {3395, 0}, {3389, 0}, {3376, 1}, {3373, 0}, {3368, 0}, {3356, 0}, {3350, 0}, {3340, 1},
+    {3346, 0}, {3339, 0}, {3332, 0}, {3290, 1}, {3305, 1}, {3305, 0}, {3263, 1}, {3280, 0},
+    {3274, 0}, {3224, 2}, {3244, 0}, {3241, 0}, {3232, 0}, {3222, 0}, {3212, 1}, {3210, 0},
+    {3205, 0}, {3203, 0}
+};
+
+#define DISCHARGE_TRACE_COUNT (sizeof(DISCHARGE_TRACE) / sizeof(DISCHARGE_TRACE[0]))
+
+#endif
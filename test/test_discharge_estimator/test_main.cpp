@@ -0,0 +1,176 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "DischargeEstimator.h"
+#include "DischargeTrace.h"
+
+// Straight line from 3000 to 4000 mV: one millivolt is one tenth of a percent
+struct LinearCurve
+{
+  static constexpr uint8_t POINTS = 2;
+  static constexpr uint16_t MILLIVOLTS[POINTS] = {3000, 4000};
+};
+constexpr uint16_t LinearCurve::MILLIVOLTS[];
+
+static Pangodream_18650_CL_T<LinearCurve> cell;
+static DischargeEstimator estimator(cell);
+static unsigned long now;
+
+void setUp(void)
+{
+  estimator.reset();
+  now = 1000;
+}
+
+void tearDown(void)
+{
+}
+
+// One sample per interval, falling mvPerSample; loaded samples sag by sagMv
+static uint16_t discharge(uint16_t startMv, int count, int mvPerSample, int sagMv)
+{
+  uint16_t millivolts = startMv;
+  for (int i = 0; i < count; i++)
+  {
+    millivolts = startMv - i * mvPerSample;
+    uint8_t load = i % 3 == 0;
+    estimator.add(millivolts - load * sagMv, load, now);
+    now += ESTIMATOR_SAMPLE_INTERVAL;
+  }
+  return millivolts;
+}
+
+static void test_learns_before_estimating(void)
+{
+  char text[8];
+  discharge(3800, ESTIMATOR_MIN_SAMPLES - 1, 2, 0);
+  TEST_ASSERT_EQUAL_UINT16(ESTIMATOR_UNKNOWN, estimator.minutesToEmpty());
+  estimator.format(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("--", text);
+
+  StringPrint out;
+  estimator.printStats(out);
+  TEST_ASSERT_TRUE(out.text.find("learning, 14 of 90") != std::string::npos);
+}
+
+static void test_steady_discharge(void)
+{
+  // 2 mV every 2 minutes is 6% an hour
+  uint16_t last = discharge(3800, 30, 2, 0);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 60.0f, estimator.ratePerHour());
+  TEST_ASSERT_UINT32_WITHIN(2, (last - 3000), estimator.minutesToEmpty()); // tenths left at 60 an hour
+
+  char text[8];
+  estimator.format(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("12h", text);
+}
+
+static void test_load_sag_is_taken_out(void)
+{
+  uint16_t last = discharge(3800, 45, 2, 40);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 60.0f, estimator.ratePerHour());
+  TEST_ASSERT_UINT32_WITHIN(2, (last - 3000), estimator.minutesToEmpty());
+
+  StringPrint out;
+  estimator.printStats(out);
+  TEST_ASSERT_TRUE(out.text.find("6.0%/h, -40 mV sag per load") != std::string::npos);
+}
+
+static void test_window_follows_a_new_rate(void)
+{
+  uint16_t last = discharge(3900, ESTIMATOR_SLOTS, 1, 0);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 30.0f, estimator.ratePerHour());
+  // Twice the drain for a whole window, the old samples have dropped out
+  discharge(last, ESTIMATOR_SLOTS, 2, 0);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 60.0f, estimator.ratePerHour());
+}
+
+static void test_charging_has_no_estimate(void)
+{
+  discharge(3500, 30, -2, 0);
+  TEST_ASSERT_LESS_THAN(0.0f, estimator.ratePerHour());
+  TEST_ASSERT_EQUAL_UINT16(ESTIMATOR_UNKNOWN, estimator.minutesToEmpty());
+}
+
+static void test_flat_empty_cell(void)
+{
+  discharge(2900, 30, 0, 0);
+  TEST_ASSERT_EQUAL_UINT16(0, estimator.minutesToEmpty());
+  char text[8];
+  estimator.format(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("0m", text);
+}
+
+static void test_slow_drain_is_capped(void)
+{
+  // One millivolt over the whole window
+  for (int i = 0; i < 30; i++)
+  {
+    estimator.add(i < 15 ? 3901 : 3900, 0, now);
+    now += ESTIMATOR_SAMPLE_INTERVAL;
+  }
+  TEST_ASSERT_GREATER_THAN(6000, estimator.minutesToEmpty());
+  TEST_ASSERT_LESS_THAN(ESTIMATOR_UNKNOWN, estimator.minutesToEmpty());
+  char text[8];
+  estimator.format(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("99h+", text);
+}
+
+static void test_reset_forgets_the_window(void)
+{
+  discharge(3800, 30, 2, 0);
+  estimator.reset();
+  TEST_ASSERT_EQUAL_UINT16(ESTIMATOR_UNKNOWN, estimator.minutesToEmpty());
+  discharge(3800, ESTIMATOR_MIN_SAMPLES - 1, 2, 0);
+  TEST_ASSERT_EQUAL_UINT16(ESTIMATOR_UNKNOWN, estimator.minutesToEmpty());
+}
+
+// Replays the trace on the real curve and checks the estimate against the
+// time the trace actually had left at a few points along it. Early on the
+// estimate runs short: it projects the drain of the full duty cycle, and
+// the saver profile draws less once the cell is below 30 %
+static void test_recorded_discharge_on_18650_curve(void)
+{
+  static Pangodream_18650_CL realCell;
+  static DischargeEstimator traced(realCell);
+  // sample, allowed error in minutes
+  static const int CHECKS[][2] = {{60, 240}, {180, 200}, {300, 140}, {420, 30}, {480, 50}, {500, 45}};
+  const int checks = sizeof(CHECKS) / sizeof(CHECKS[0]);
+  const int minutesPerSample = ESTIMATOR_SAMPLE_INTERVAL / 60000;
+  char message[80];
+  int next = 0;
+
+  traced.reset();
+  for (int i = 0; i < (int)DISCHARGE_TRACE_COUNT && next < checks; i++)
+  {
+    traced.add(DISCHARGE_TRACE[i].millivolts, DISCHARGE_TRACE[i].load, now);
+    now += ESTIMATOR_SAMPLE_INTERVAL;
+    if (i != CHECKS[next][0])
+      continue;
+
+    int actual = ((int)DISCHARGE_TRACE_COUNT - 1 - i) * minutesPerSample;
+    int estimate = traced.minutesToEmpty();
+    snprintf(message, sizeof(message), "%.1f h in: %d min left, estimate %d min, error %+d",
+             (i + 1) * minutesPerSample / 60.0, actual, estimate, estimate - actual);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_NOT_EQUAL(ESTIMATOR_UNKNOWN, estimate);
+    TEST_ASSERT_INT_WITHIN(CHECKS[next][1], actual, estimate);
+    next++;
+  }
+  TEST_ASSERT_EQUAL(checks, next);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_learns_before_estimating);
+  RUN_TEST(test_steady_discharge);
+  RUN_TEST(test_load_sag_is_taken_out);
+  RUN_TEST(test_window_follows_a_new_rate);
+  RUN_TEST(test_charging_has_no_estimate);
+  RUN_TEST(test_flat_empty_cell);
+  RUN_TEST(test_slow_drain_is_capped);
+  RUN_TEST(test_reset_forgets_the_window);
+  RUN_TEST(test_recorded_discharge_on_18650_curve);
+  return UNITY_END();
+}
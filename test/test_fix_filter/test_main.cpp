@@ -0,0 +1,172 @@
+#include <unity.h>
+#include <math.h>
+#include "FixFilter.h"
+#include "GeoMath.h"
+
+#define ORIGIN_LATITUDE 69271000 // 1e-7 degrees
+#define ORIGIN_LONGITUDE 798612000
+
+static FixFilter filter;
+static GPSFix smoothed;
+static uint32_t noiseState;
+
+void setUp(void)
+{
+  filter = FixFilter();
+  noiseState = 12345;
+}
+
+void tearDown(void)
+{
+}
+
+// Repeatable noise, uniform in [-1, 1]
+static float noise()
+{
+  noiseState = noiseState * 1103515245UL + 12345UL;
+  return ((noiseState >> 8) & 0xFFFF) / 32767.5f - 1.0f;
+}
+
+// Good fix at an offset from the origin, moving north at speedMs
+static GPSFix fixAt(int32_t eastCm, int32_t northCm, float speedMs)
+{
+  GPSFix fix;
+  clearGPSFix(fix);
+  fix.runStatus = 1;
+  fix.fixStatus = 1;
+  fix.fixMode = 3;
+  fix.hdop = 1.0f;
+  fix.pdop = 1.8f;
+  fix.vdop = 1.5f;
+  fix.satellitesUsed = 8;
+  fix.satellitesInView = 12;
+  fix.speed = speedMs * 3.6f;
+  fix.course = 0.0f;
+  geoMoveCm(ORIGIN_LATITUDE, ORIGIN_LONGITUDE, eastCm, northCm, &fix.latitude, &fix.longitude);
+  return fix;
+}
+
+static float errorCm(const GPSFix &fix, int32_t eastCm, int32_t northCm)
+{
+  int32_t e, n;
+  geoOffsetCm(ORIGIN_LATITUDE, ORIGIN_LONGITUDE, fix.latitude, fix.longitude, &e, &n);
+  return sqrtf((float)(e - eastCm) * (e - eastCm) + (float)(n - northCm) * (n - northCm));
+}
+
+static void test_gate_rejects_bad_fixes(void)
+{
+  GPSFix fix = fixAt(0, 0, 0);
+  fix.fixStatus = 0;
+  TEST_ASSERT_EQUAL(FIX_NO_FIX, filter.update(fix, 0, smoothed));
+
+  fix = fixAt(0, 0, 0);
+  fix.hdop = FILTER_MAX_HDOP + 0.1f;
+  TEST_ASSERT_EQUAL(FIX_POOR_GEOMETRY, filter.update(fix, 0, smoothed));
+  fix = fixAt(0, 0, 0);
+  fix.pdop = FILTER_MAX_PDOP + 0.1f;
+  TEST_ASSERT_EQUAL(FIX_POOR_GEOMETRY, filter.update(fix, 0, smoothed));
+
+  fix = fixAt(0, 0, 0);
+  fix.satellitesUsed = FILTER_MIN_SATELLITES - 1;
+  TEST_ASSERT_EQUAL(FIX_FEW_SATELLITES, filter.update(fix, 0, smoothed));
+
+  TEST_ASSERT_EQUAL_UINT32(1, filter.stats().noFix);
+  TEST_ASSERT_EQUAL_UINT32(2, filter.stats().poorGeometry);
+  TEST_ASSERT_EQUAL_UINT32(1, filter.stats().fewSatellites);
+  TEST_ASSERT_EQUAL_UINT32(0, filter.stats().accepted);
+}
+
+static void test_missing_dop_is_poor_geometry(void)
+{
+  // The parsers leave 0 for an empty DOP field
+  GPSFix fix = fixAt(0, 0, 0);
+  fix.hdop = 0.0f;
+  TEST_ASSERT_EQUAL(FIX_POOR_GEOMETRY, filter.update(fix, 0, smoothed));
+  fix = fixAt(0, 0, 0);
+  fix.pdop = 0.0f;
+  TEST_ASSERT_EQUAL(FIX_POOR_GEOMETRY, filter.update(fix, 0, smoothed));
+}
+
+static void test_first_fix_passes_through(void)
+{
+  GPSFix fix = fixAt(0, 0, 0);
+  TEST_ASSERT_EQUAL(FIX_ACCEPTED, filter.update(fix, 1000, smoothed));
+  TEST_ASSERT_EQUAL_INT32(fix.latitude, smoothed.latitude);
+  TEST_ASSERT_EQUAL_INT32(fix.longitude, smoothed.longitude);
+  TEST_ASSERT_EQUAL_UINT32(1, filter.stats().restarts);
+}
+
+static void test_smoothing_reduces_noise(void)
+{
+  // 20 m/s due north, 3 m of noise on each axis, one fix a second
+  float rawError = 0.0f;
+  float smoothError = 0.0f;
+  for (int i = 0; i < 120; i++)
+  {
+    int32_t north = i * 2000;
+    GPSFix fix = fixAt((int32_t)(noise() * 300), north + (int32_t)(noise() * 300), 20.0f);
+    TEST_ASSERT_EQUAL(FIX_ACCEPTED, filter.update(fix, i * 1000UL, smoothed));
+    if (i >= 20) // once the filter has settled
+    {
+      rawError += errorCm(fix, 0, north);
+      smoothError += errorCm(smoothed, 0, north);
+    }
+  }
+  TEST_ASSERT_TRUE(smoothError < rawError * 0.7f);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 72.0f, smoothed.speed);
+  TEST_ASSERT_TRUE(smoothed.course < 5.0f || smoothed.course > 355.0f);
+}
+
+static void test_jump_is_an_outlier_until_it_persists(void)
+{
+  for (int i = 0; i < 10; i++)
+  {
+    TEST_ASSERT_EQUAL(FIX_ACCEPTED, filter.update(fixAt(0, i * 1000, 10.0f), i * 1000UL, smoothed));
+  }
+  // Multipath: 300 m off to the side
+  for (int i = 10; i < 10 + FILTER_MAX_REJECTS - 1; i++)
+  {
+    TEST_ASSERT_EQUAL(FIX_OUTLIER, filter.update(fixAt(30000, i * 1000, 10.0f), i * 1000UL, smoothed));
+  }
+  TEST_ASSERT_EQUAL_UINT32(FILTER_MAX_REJECTS - 1, filter.stats().outliers);
+
+  // The receiver insists, the filter restarts from it
+  int i = 10 + FILTER_MAX_REJECTS - 1;
+  GPSFix fix = fixAt(30000, i * 1000, 10.0f);
+  TEST_ASSERT_EQUAL(FIX_ACCEPTED, filter.update(fix, i * 1000UL, smoothed));
+  TEST_ASSERT_EQUAL_INT32(fix.latitude, smoothed.latitude);
+  TEST_ASSERT_EQUAL_UINT32(2, filter.stats().restarts);
+}
+
+static void test_single_outlier_does_not_move_the_track(void)
+{
+  for (int i = 0; i < 10; i++)
+  {
+    filter.update(fixAt(0, i * 1000, 10.0f), i * 1000UL, smoothed);
+  }
+  TEST_ASSERT_EQUAL(FIX_OUTLIER, filter.update(fixAt(30000, 10000, 10.0f), 10000, smoothed));
+  TEST_ASSERT_EQUAL(FIX_ACCEPTED, filter.update(fixAt(0, 11000, 10.0f), 11000, smoothed));
+  TEST_ASSERT_TRUE(errorCm(smoothed, 0, 11000) < 200.0f);
+}
+
+static void test_long_gap_restarts_the_track(void)
+{
+  filter.update(fixAt(0, 0, 0), 0, smoothed);
+  GPSFix fix = fixAt(500000, 0, 0); // 5 km away after the gap
+  TEST_ASSERT_EQUAL(FIX_ACCEPTED, filter.update(fix, FILTER_RESET_GAP, smoothed));
+  TEST_ASSERT_EQUAL_INT32(fix.longitude, smoothed.longitude);
+  TEST_ASSERT_EQUAL_UINT32(2, filter.stats().restarts);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_gate_rejects_bad_fixes);
+  RUN_TEST(test_missing_dop_is_poor_geometry);
+  RUN_TEST(test_first_fix_passes_through);
+  RUN_TEST(test_smoothing_reduces_noise);
+  RUN_TEST(test_jump_is_an_outlier_until_it_persists);
+  RUN_TEST(test_single_outlier_does_not_move_the_track);
+  RUN_TEST(test_long_gap_restarts_the_track);
+  return UNITY_END();
+}
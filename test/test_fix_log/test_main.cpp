@@ -0,0 +1,301 @@
+#include <unity.h>
+#include <string.h>
+#include "FixLog.h"
+#include "RamFlash.h"
+
+#define SECTOR_SIZE 4096
+#define SECTORS 5                                     // two journal sectors, three data sectors
+#define PER_SECTOR (SECTOR_SIZE / FIXLOG_RECORD_SIZE - 1) // 127, slot 0 is the header
+#define CAPACITY (3 * PER_SECTOR)
+#define ENTRIES_PER_SECTOR (SECTOR_SIZE / 8)
+
+static RamFlash *flash;
+static FixLog *fixLog;
+static StoredFix out[CAPACITY + 16];
+
+// The record for a sequence number carries it in its timestamp
+static StoredFix fixFor(uint32_t seq)
+{
+  StoredFix fix;
+  memset(&fix, 0, sizeof(fix));
+  fix.timestamp = 1700000000UL + seq;
+  fix.latitude = 69271000 + (int32_t)seq;
+  fix.longitude = 798612000 - (int32_t)seq;
+  fix.flags = FIXLOG_FLAG_VALID;
+  return fix;
+}
+
+// Drop the FixLog and mount the same flash again, as after a reset
+static void remount()
+{
+  delete fixLog;
+  flash->restorePower();
+  fixLog = new FixLog(*flash);
+  TEST_ASSERT_TRUE(fixLog->begin());
+}
+
+static void appendRange(uint32_t from, uint32_t to)
+{
+  for (uint32_t seq = from; seq < to; seq++)
+  {
+    TEST_ASSERT_TRUE(fixLog->append(fixFor(seq)));
+  }
+}
+
+// Read everything from fromSeq and check each fix is the one for its place
+static uint32_t readAll(uint32_t fromSeq, uint32_t *firstSeq)
+{
+  uint32_t next;
+  uint32_t count = fixLog->read(fromSeq, out, sizeof(out) / sizeof(out[0]), &next);
+  if (firstSeq != NULL)
+  {
+    *firstSeq = count > 0 ? out[0].timestamp - 1700000000UL : next;
+  }
+  return count;
+}
+
+void setUp(void)
+{
+  flash = new RamFlash(SECTOR_SIZE, SECTORS);
+  fixLog = new FixLog(*flash);
+  TEST_ASSERT_TRUE(fixLog->begin());
+}
+
+void tearDown(void)
+{
+  uint32_t violations = flash->violations;
+  delete fixLog;
+  delete flash;
+  TEST_ASSERT_EQUAL_UINT32(0, violations); // nothing programmed over unerased bits
+}
+
+static void test_fresh_flash(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->headSeq());
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->oldestSeq());
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->uploadCursor());
+  TEST_ASSERT_EQUAL_UINT32(CAPACITY, fixLog->capacity());
+  TEST_ASSERT_EQUAL_UINT32(0, readAll(0, NULL));
+
+  RamFlash tiny(SECTOR_SIZE, FIXLOG_CURSOR_SECTORS + 1);
+  FixLog tooSmall(tiny);
+  TEST_ASSERT_FALSE(tooSmall.begin());
+}
+
+static void test_batches_reach_flash_when_full(void)
+{
+  appendRange(0, FIXLOG_WRITE_BATCH - 1);
+  TEST_ASSERT_EQUAL_UINT32(0, flash->writes);
+  TEST_ASSERT_EQUAL_UINT32(FIXLOG_WRITE_BATCH - 1, fixLog->buffered());
+  // Buffered records can already be read
+  TEST_ASSERT_EQUAL_UINT32(FIXLOG_WRITE_BATCH - 1, readAll(0, NULL));
+  appendRange(FIXLOG_WRITE_BATCH - 1, FIXLOG_WRITE_BATCH);
+  TEST_ASSERT_EQUAL_UINT32(2, flash->writes); // sector header, then the batch in one write
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->buffered());
+}
+
+static void test_head_is_found_by_binary_search(void)
+{
+  appendRange(0, PER_SECTOR + 45);
+  TEST_ASSERT_TRUE(fixLog->flush());
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(PER_SECTOR + 45, fixLog->headSeq());
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->oldestSeq());
+
+  // Mount reads the three data headers, the first (erased) entry of each
+  // journal sector and log2(128) slots, not the whole sector
+  flash->resetCounters();
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(3 + FIXLOG_CURSOR_SECTORS + 7, flash->reads);
+
+  uint32_t first;
+  TEST_ASSERT_EQUAL_UINT32(PER_SECTOR + 45, readAll(0, &first));
+  TEST_ASSERT_EQUAL_UINT32(0, first);
+  for (uint32_t i = 0; i < PER_SECTOR + 45; i++)
+  {
+    TEST_ASSERT_EQUAL_UINT32(1700000000UL + i, out[i].timestamp);
+  }
+}
+
+static void test_head_at_every_position_of_a_sector(void)
+{
+  for (uint32_t seq = 0; seq < PER_SECTOR + 2; seq++)
+  {
+    TEST_ASSERT_TRUE(fixLog->append(fixFor(seq)));
+    TEST_ASSERT_TRUE(fixLog->flush());
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(seq + 1, fixLog->headSeq());
+  }
+}
+
+static void test_wrap_drops_the_oldest_sector(void)
+{
+  uint32_t total = 3 * CAPACITY + 10;
+  appendRange(0, total);
+  fixLog->flush();
+
+  // The sector holding the head was reopened, so only two full sectors and the head remain
+  uint32_t headGeneration = total / PER_SECTOR;
+  TEST_ASSERT_EQUAL_UINT32(total, fixLog->headSeq());
+  TEST_ASSERT_EQUAL_UINT32((headGeneration - 2) * PER_SECTOR, fixLog->oldestSeq());
+  TEST_ASSERT_EQUAL_UINT32(fixLog->oldestSeq(), fixLog->uploadCursor());
+  TEST_ASSERT_EQUAL_UINT32(fixLog->oldestSeq(), fixLog->droppedRecords());
+
+  uint32_t first;
+  uint32_t count = readAll(0, &first);
+  TEST_ASSERT_EQUAL_UINT32(fixLog->oldestSeq(), first);
+  TEST_ASSERT_EQUAL_UINT32(total - fixLog->oldestSeq(), count);
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL + total - 1, out[count - 1].timestamp);
+
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(total, fixLog->headSeq());
+  TEST_ASSERT_EQUAL_UINT32((headGeneration - 2) * PER_SECTOR, fixLog->oldestSeq());
+}
+
+static void test_wrap_keeps_unsent_records_until_it_must(void)
+{
+  appendRange(0, CAPACITY - 10);
+  fixLog->flush();
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->droppedRecords());
+  TEST_ASSERT_EQUAL_UINT32(CAPACITY - 10, fixLog->pending());
+  TEST_ASSERT_TRUE(fixLog->commitCursor(100));
+  appendRange(CAPACITY - 10, CAPACITY + 1);
+  fixLog->flush();
+  // Sector 0 was reopened: the 27 records from 100 to 126 were never sent
+  TEST_ASSERT_EQUAL_UINT32(PER_SECTOR - 100, fixLog->droppedRecords());
+  TEST_ASSERT_EQUAL_UINT32(PER_SECTOR, fixLog->uploadCursor());
+}
+
+static void test_torn_record_is_skipped(void)
+{
+  appendRange(0, 2 * FIXLOG_WRITE_BATCH);
+  // Power fails 40 bytes into the next batch: one whole record and a torn one
+  appendRange(2 * FIXLOG_WRITE_BATCH, 3 * FIXLOG_WRITE_BATCH - 1);
+  flash->cutPowerAfter(FIXLOG_RECORD_SIZE + 8);
+  TEST_ASSERT_FALSE(fixLog->append(fixFor(3 * FIXLOG_WRITE_BATCH - 1)));
+  remount();
+
+  uint32_t torn = 2 * FIXLOG_WRITE_BATCH + 1;
+  TEST_ASSERT_EQUAL_UINT32(torn + 1, fixLog->headSeq());
+  TEST_ASSERT_EQUAL_UINT32(torn, readAll(0, NULL));
+  TEST_ASSERT_EQUAL_UINT32(1, fixLog->crcErrors());
+
+  // The log carries on after the torn slot
+  appendRange(torn + 1, torn + 1 + FIXLOG_WRITE_BATCH);
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(torn + 1 + FIXLOG_WRITE_BATCH, fixLog->headSeq());
+  TEST_ASSERT_EQUAL_UINT32(torn + FIXLOG_WRITE_BATCH, readAll(0, NULL));
+}
+
+static void test_bad_crc_is_skipped(void)
+{
+  appendRange(0, 2 * FIXLOG_WRITE_BATCH);
+  // A worn cell drops one bit of record 5's latitude (slot 6 of data sector 0)
+  flash->memory()[FIXLOG_CURSOR_SECTORS * SECTOR_SIZE + 6 * FIXLOG_RECORD_SIZE + 8] &= 0xFE;
+  uint32_t next;
+  uint32_t count = fixLog->read(0, out, 100, &next);
+  TEST_ASSERT_EQUAL_UINT32(2 * FIXLOG_WRITE_BATCH - 1, count);
+  TEST_ASSERT_EQUAL_UINT32(2 * FIXLOG_WRITE_BATCH, next);
+  TEST_ASSERT_EQUAL_UINT32(1, fixLog->crcErrors());
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL + 4, out[4].timestamp);
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL + 6, out[5].timestamp);
+}
+
+static void test_cursor_survives_a_remount(void)
+{
+  appendRange(0, 200);
+  fixLog->flush();
+  TEST_ASSERT_TRUE(fixLog->commitCursor(50));
+  TEST_ASSERT_TRUE(fixLog->commitCursor(120));
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(120, fixLog->uploadCursor());
+  TEST_ASSERT_EQUAL_UINT32(80, fixLog->pending());
+
+  // Never past the head
+  TEST_ASSERT_TRUE(fixLog->commitCursor(5000));
+  TEST_ASSERT_EQUAL_UINT32(200, fixLog->uploadCursor());
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(200, fixLog->uploadCursor());
+}
+
+static void test_cursor_journal_switches_sectors(void)
+{
+  appendRange(0, 300);
+  fixLog->flush();
+  flash->resetCounters();
+  for (uint32_t i = 1; i <= ENTRIES_PER_SECTOR + 10; i++)
+  {
+    TEST_ASSERT_TRUE(fixLog->commitCursor(i / 2));
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, flash->erases); // the first commit opens a journal sector, then the switch
+  remount();
+  TEST_ASSERT_EQUAL_UINT32((ENTRIES_PER_SECTOR + 10) / 2, fixLog->uploadCursor());
+  TEST_ASSERT_TRUE(fixLog->commitCursor(299));
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(299, fixLog->uploadCursor());
+}
+
+static void test_torn_cursor_entry(void)
+{
+  appendRange(0, 100);
+  fixLog->flush();
+  TEST_ASSERT_TRUE(fixLog->commitCursor(10));
+  flash->cutPowerAfter(3); // the entry for 20 is torn
+  TEST_ASSERT_FALSE(fixLog->commitCursor(20));
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(10, fixLog->uploadCursor());
+
+  // The next entry must not land on the torn one
+  TEST_ASSERT_TRUE(fixLog->commitCursor(30));
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(30, fixLog->uploadCursor());
+}
+
+static void test_reads_are_chunked_inside_a_sector(void)
+{
+  appendRange(0, 2 * PER_SECTOR + 30);
+  fixLog->flush();
+  flash->resetCounters();
+
+  uint32_t next;
+  uint32_t count = fixLog->read(PER_SECTOR - 5, out, 50, &next);
+  TEST_ASSERT_EQUAL_UINT32(50, count);
+  TEST_ASSERT_EQUAL_UINT32(PER_SECTOR + 45, next);
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL + PER_SECTOR - 5, out[0].timestamp);
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL + PER_SECTOR + 44, out[49].timestamp);
+  TEST_ASSERT_EQUAL_UINT32(FIXLOG_READ_CHUNK * FIXLOG_RECORD_SIZE, flash->largestRead);
+  TEST_ASSERT_EQUAL_UINT32(0, flash->readsAcrossSectors);
+  // 5 records to the sector end, then 45 in chunks of FIXLOG_READ_CHUNK
+  TEST_ASSERT_EQUAL_UINT32(1 + (45 + FIXLOG_READ_CHUNK - 1) / FIXLOG_READ_CHUNK, flash->reads);
+
+  // Reading from before the oldest record starts at the oldest one
+  uint32_t first;
+  readAll(0, &first);
+  TEST_ASSERT_EQUAL_UINT32(0, first);
+}
+
+static void test_unflushed_records_are_lost_on_reset(void)
+{
+  appendRange(0, FIXLOG_WRITE_BATCH + 3);
+  remount();
+  TEST_ASSERT_EQUAL_UINT32(FIXLOG_WRITE_BATCH, fixLog->headSeq());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fresh_flash);
+  RUN_TEST(test_batches_reach_flash_when_full);
+  RUN_TEST(test_head_is_found_by_binary_search);
+  RUN_TEST(test_head_at_every_position_of_a_sector);
+  RUN_TEST(test_wrap_drops_the_oldest_sector);
+  RUN_TEST(test_wrap_keeps_unsent_records_until_it_must);
+  RUN_TEST(test_torn_record_is_skipped);
+  RUN_TEST(test_bad_crc_is_skipped);
+  RUN_TEST(test_cursor_survives_a_remount);
+  RUN_TEST(test_cursor_journal_switches_sectors);
+  RUN_TEST(test_torn_cursor_entry);
+  RUN_TEST(test_reads_are_chunked_inside_a_sector);
+  RUN_TEST(test_unflushed_records_are_lost_on_reset);
+  return UNITY_END();
+}
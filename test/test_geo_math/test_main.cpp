@@ -0,0 +1,422 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GeoMath.h"
+#include "CGNSINFParser.h"
+#include "HostBench.h"
+
+#define EARTH_RADIUS_CM 637100000.0 // the sphere GeoMath uses
+#define DEG (3.14159265358979323846 / 180.0)
+#define RANDOM_VALUES 20000
+#define BENCH_CALLS 1000000
+
+static uint32_t randomState;
+
+static uint32_t nextRandom()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static int32_t randomBetween(int32_t low, int32_t high)
+{
+  return (int32_t)(low + (int64_t)(nextRandom() % (uint32_t)((int64_t)high - low + 1)));
+}
+
+// Coordinates the way the modem sends them, through the real parser
+static bool parseCoordinates(const char *latitude, const char *longitude, int32_t *outLatitude, int32_t *outLongitude)
+{
+  char line[128];
+  snprintf(line, sizeof(line), "+CGNSINF: 1,1,20240315123045.000,%s,%s,0,0,0,1,,1,1,1,,5,5,,,,,\r\n", latitude,
+           longitude);
+  CGNSINFParser parser;
+  bool parsed = false;
+  for (const char *c = line; *c; c++)
+  {
+    parsed |= parser.feed(*c);
+  }
+  *outLatitude = parser.fix().latitude;
+  *outLongitude = parser.fix().longitude;
+  return parsed;
+}
+
+static int32_t parseOne(const char *text)
+{
+  int32_t latitude, longitude;
+  TEST_ASSERT_TRUE_MESSAGE(parseCoordinates("0", text, &latitude, &longitude), text);
+  return longitude;
+}
+
+// Reference great-circle distance and initial bearing in double precision
+static double haversineCm(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude)
+{
+  double phi1 = fromLatitude / 1e7 * DEG;
+  double phi2 = toLatitude / 1e7 * DEG;
+  double dPhi = phi2 - phi1;
+  double dLambda = ((double)toLongitude - fromLongitude) / 1e7 * DEG;
+  double a = sin(dPhi / 2) * sin(dPhi / 2) + cos(phi1) * cos(phi2) * sin(dLambda / 2) * sin(dLambda / 2);
+  return 2 * EARTH_RADIUS_CM * asin(sqrt(a));
+}
+
+static double bearingDeg(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude)
+{
+  double phi1 = fromLatitude / 1e7 * DEG;
+  double phi2 = toLatitude / 1e7 * DEG;
+  double dLambda = ((double)toLongitude - fromLongitude) / 1e7 * DEG;
+  double bearing = atan2(sin(dLambda) * cos(phi2), cos(phi1) * sin(phi2) - sin(phi1) * cos(phi2) * cos(dLambda)) / DEG;
+  return bearing < 0 ? bearing + 360 : bearing;
+}
+
+// Point at a distance and bearing on the sphere, rounded to 1e-7 degree
+static void destination(int32_t latitude, int32_t longitude, double bearing, double distanceCm,
+                        int32_t *toLatitude, int32_t *toLongitude)
+{
+  double phi1 = latitude / 1e7 * DEG;
+  double lambda1 = longitude / 1e7 * DEG;
+  double delta = distanceCm / EARTH_RADIUS_CM;
+  double theta = bearing * DEG;
+  double phi2 = asin(sin(phi1) * cos(delta) + cos(phi1) * sin(delta) * cos(theta));
+  double lambda2 = lambda1 + atan2(sin(theta) * sin(delta) * cos(phi1), cos(delta) - sin(phi1) * sin(phi2));
+  double lon = lambda2 / DEG;
+  if (lon >= 180)
+    lon -= 360;
+  else if (lon < -180)
+    lon += 360;
+  *toLatitude = (int32_t)llround(phi2 / DEG * 1e7);
+  *toLongitude = (int32_t)llround(lon * 1e7);
+}
+
+static double angleBetween(double a, double b)
+{
+  double d = fabs(a - b);
+  return d > 180 ? 360 - d : d;
+}
+
+void setUp(void)
+{
+  randomState = 2463534242UL;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_decimal_strings_parse_exactly(void)
+{
+  TEST_ASSERT_EQUAL_INT32(798612440, parseOne("79.861244"));
+  TEST_ASSERT_EQUAL_INT32(798612447, parseOne("79.8612447"));
+  TEST_ASSERT_EQUAL_INT32(69000000, parseOne("6.9"));
+  TEST_ASSERT_EQUAL_INT32(70000000, parseOne("7"));
+  TEST_ASSERT_EQUAL_INT32(1, parseOne("0.0000001"));
+  TEST_ASSERT_EQUAL_INT32(-1, parseOne("-0.0000001"));
+  TEST_ASSERT_EQUAL_INT32(-5000000, parseOne("-.5"));
+  TEST_ASSERT_EQUAL_INT32(1800000000, parseOne("180.0000000"));
+  TEST_ASSERT_EQUAL_INT32(-1799999999, parseOne("-179.9999999"));
+}
+
+static void test_eighth_decimal_rounds(void)
+{
+  TEST_ASSERT_EQUAL_INT32(0, parseOne("0.00000004"));
+  TEST_ASSERT_EQUAL_INT32(1, parseOne("0.00000005"));
+  TEST_ASSERT_EQUAL_INT32(-1, parseOne("-0.00000005"));
+  TEST_ASSERT_EQUAL_INT32(0, parseOne("-0.000000049999"));
+  TEST_ASSERT_EQUAL_INT32(798612448, parseOne("79.86124475"));
+  TEST_ASSERT_EQUAL_INT32(1800000000, parseOne("179.99999995"));
+  TEST_ASSERT_EQUAL_INT32(-1800000000, parseOne("-179.99999995"));
+
+  // Random 9-decimal strings against integer rounding half away from zero
+  for (uint32_t i = 0; i < RANDOM_VALUES; i++)
+  {
+    int64_t nanoDegrees = (int64_t)randomBetween(-1800000000, 1800000000) * 100 + randomBetween(0, 99);
+    char text[24];
+    uint64_t magnitude = nanoDegrees < 0 ? -nanoDegrees : nanoDegrees;
+    snprintf(text, sizeof(text), "%s%llu.%09llu", nanoDegrees < 0 ? "-" : "", (unsigned long long)(magnitude / 1000000000),
+             (unsigned long long)(magnitude % 1000000000));
+    int32_t expected = (int32_t)((magnitude + 50) / 100);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(nanoDegrees < 0 ? -expected : expected, parseOne(text), text);
+  }
+}
+
+static void test_distance_and_bearing_against_haversine(void)
+{
+  // Hops of 10 m to 20 km in 24 directions at every 10 degrees of latitude
+  // and 30 of longitude
+  const double hopsCm[] = {1000, 10000, 100000, 2000000};
+  double worstRelative = 0;
+  double worstBearing = 0;
+  for (int32_t lat = -70; lat <= 70; lat += 10)
+  {
+    for (int32_t lon = -180; lon < 180; lon += 30)
+    {
+      int32_t fromLatitude = lat * GEO_SCALE + 1234567;
+      int32_t fromLongitude = lon * GEO_SCALE + 7654321;
+      for (size_t h = 0; h < sizeof(hopsCm) / sizeof(hopsCm[0]); h++)
+      {
+        for (int32_t bearing = 0; bearing < 360; bearing += 15)
+        {
+          int32_t toLatitude, toLongitude;
+          destination(fromLatitude, fromLongitude, bearing + 0.5, hopsCm[h], &toLatitude, &toLongitude);
+          double reference = haversineCm(fromLatitude, fromLongitude, toLatitude, toLongitude);
+          double distance = geoDistanceCm(fromLatitude, fromLongitude, toLatitude, toLongitude);
+          // 0.2% of the hop, plus the 1e-7 degree rounding of the end point
+          TEST_ASSERT_TRUE(fabs(distance - reference) <= reference * 0.002 + 2);
+          if (reference > 50000)
+          {
+            double relative = fabs(distance - reference) / reference;
+            worstRelative = relative > worstRelative ? relative : worstRelative;
+          }
+
+          // The equirectangular bearing is the one halfway along the hop,
+          // between the great circle's initial and final bearings
+          double initial = bearingDeg(fromLatitude, fromLongitude, toLatitude, toLongitude);
+          double final = bearingDeg(toLatitude, toLongitude, fromLatitude, fromLongitude) + 180;
+          double turn = fmod(final - initial + 540, 360) - 180;
+          double error = angleBetween(geoBearingCdeg(fromLatitude, fromLongitude, toLatitude, toLongitude) / 100.0,
+                                      fmod(initial + turn / 2 + 360, 360));
+          TEST_ASSERT_TRUE(error <= 0.05 + atan(2 / hopsCm[h]) / DEG);
+          if (hopsCm[h] >= 100000)
+          {
+            worstBearing = error > worstBearing ? error : worstBearing;
+          }
+        }
+      }
+    }
+  }
+  benchReport("GeoMath worst distance error, 1 km and up", worstRelative * 1e6, "ppm");
+  benchReport("GeoMath worst bearing error, 1 km and up", worstBearing * 1000, "millidegree");
+}
+
+static void test_across_the_antimeridian(void)
+{
+  // 0.02 degree apart on the equator, the short way is east across 180
+  int32_t west = 1799900000;
+  int32_t east = -1799900000;
+  double reference = haversineCm(0, 0, 0, 200000);
+  TEST_ASSERT_UINT32_WITHIN(3, (uint32_t)lround(reference), geoDistanceCm(0, west, 0, east));
+  TEST_ASSERT_UINT32_WITHIN(3, (uint32_t)lround(reference), geoDistanceCm(0, east, 0, west));
+  TEST_ASSERT_EQUAL_UINT16(9000, geoBearingCdeg(0, west, 0, east));
+  TEST_ASSERT_EQUAL_UINT16(27000, geoBearingCdeg(0, east, 0, west));
+
+  int32_t east2, north2;
+  geoOffsetCm(600000000, 1799999000, 600000000, -1799999000, &east2, &north2);
+  TEST_ASSERT_INT32_WITHIN(2, (int32_t)lround(haversineCm(600000000, 0, 600000000, 2000)), east2);
+  TEST_ASSERT_EQUAL_INT32(0, north2);
+
+  // Moving east from 179.99 lands at -179.99, and back
+  int32_t latitude, longitude;
+  geoMoveCm(0, west, (int32_t)lround(reference), 0, &latitude, &longitude);
+  TEST_ASSERT_EQUAL_INT32(0, latitude);
+  TEST_ASSERT_INT32_WITHIN(2, east, longitude);
+  geoMoveCm(0, east, -(int32_t)lround(reference), 0, &latitude, &longitude);
+  TEST_ASSERT_INT32_WITHIN(2, west, longitude);
+}
+
+static void test_move_inverts_offset(void)
+{
+  for (uint32_t i = 0; i < RANDOM_VALUES; i++)
+  {
+    int32_t latitude = randomBetween(-800000000, 800000000);
+    int32_t longitude = randomBetween(-1800000000, 1799999999);
+    int32_t eastCm = randomBetween(-2000000, 2000000);
+    int32_t northCm = randomBetween(-2000000, 2000000);
+    int32_t toLatitude, toLongitude, backEast, backNorth;
+    geoMoveCm(latitude, longitude, eastCm, northCm, &toLatitude, &toLongitude);
+    geoOffsetCm(latitude, longitude, toLatitude, toLongitude, &backEast, &backNorth);
+    int32_t tolerance = 3 + (abs(eastCm) + abs(northCm)) / 1000; // 0.1% from the mean-latitude cosine
+    TEST_ASSERT_INT32_WITHIN(tolerance, eastCm, backEast);
+    TEST_ASSERT_INT32_WITHIN(3, northCm, backNorth);
+  }
+}
+
+static void test_bounding_boxes(void)
+{
+  const int32_t latitudes[] = {0, 69271000, -450000000, 700000000};
+  const uint32_t radii[] = {2000, 25000, 1000000};
+  for (size_t l = 0; l < sizeof(latitudes) / sizeof(latitudes[0]); l++)
+  {
+    for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++)
+    {
+      int32_t latitude = latitudes[l];
+      int32_t longitude = 798612000;
+      GeoBox box = geoBoxAround(latitude, longitude, radii[r]);
+      // Every point a circle fence contains is in the box: sample a box 2%
+      // larger and check the ones within the radius
+      int32_t marginLatitude = (box.maxLatitude - box.minLatitude) / 100;
+      int32_t marginLongitude = (box.maxLongitude - box.minLongitude) / 100;
+      uint32_t within = 0;
+      for (uint32_t i = 0; i < RANDOM_VALUES; i++)
+      {
+        int32_t toLatitude = randomBetween(box.minLatitude - marginLatitude, box.maxLatitude + marginLatitude);
+        int32_t toLongitude = randomBetween(box.minLongitude - marginLongitude, box.maxLongitude + marginLongitude);
+        if (geoDistanceCm(latitude, longitude, toLatitude, toLongitude) <= radii[r])
+        {
+          within++;
+          TEST_ASSERT_TRUE(geoBoxContains(box, toLatitude, toLongitude));
+        }
+      }
+      TEST_ASSERT_GREATER_THAN(RANDOM_VALUES / 2, within);
+      // The extremes of the circle, and nothing much beyond them
+      const int32_t compass[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+      for (int k = 0; k < 4; k++)
+      {
+        int32_t toLatitude, toLongitude;
+        geoMoveCm(latitude, longitude, compass[k][0] * (int32_t)radii[r], compass[k][1] * (int32_t)radii[r], &toLatitude,
+                  &toLongitude);
+        TEST_ASSERT_TRUE(geoBoxContains(box, toLatitude, toLongitude));
+      }
+      double heightCm = (box.maxLatitude - box.minLatitude) * 1.11195;
+      TEST_ASSERT_TRUE(heightCm <= 2 * radii[r] * 1.001 + 4);
+      double widthCm = haversineCm(latitude, box.minLongitude, latitude, box.maxLongitude);
+      TEST_ASSERT_TRUE(widthCm <= 2 * radii[r] * 1.001 + 4);
+    }
+  }
+
+  // Near a pole the box takes every longitude and stops at 90 degrees
+  GeoBox polar = geoBoxAround(899999000, 0, 100000);
+  TEST_ASSERT_EQUAL_INT32(900000000, polar.maxLatitude);
+  TEST_ASSERT_EQUAL_INT32(-1800000000, polar.minLongitude);
+  TEST_ASSERT_EQUAL_INT32(1800000000, polar.maxLongitude);
+
+  GeoBox box = {10, 20, 10, 20};
+  geoBoxExtend(box, -5, 30);
+  geoBoxExtend(box, 15, 25);
+  TEST_ASSERT_EQUAL_INT32(-5, box.minLatitude);
+  TEST_ASSERT_EQUAL_INT32(15, box.maxLatitude);
+  TEST_ASSERT_EQUAL_INT32(20, box.minLongitude);
+  TEST_ASSERT_EQUAL_INT32(30, box.maxLongitude);
+  TEST_ASSERT_TRUE(geoBoxContains(box, 15, 30)); // inclusive bounds
+  TEST_ASSERT_FALSE(geoBoxContains(box, 16, 30));
+}
+
+static void test_format_round_trips(void)
+{
+  char text[GEO_COORDINATE_CHARS];
+  geoFormatCoordinate(69344120, text);
+  TEST_ASSERT_EQUAL_STRING("6.9344120", text);
+  geoFormatCoordinate(-1, text);
+  TEST_ASSERT_EQUAL_STRING("-0.0000001", text);
+  geoFormatCoordinate(-1799999999, text);
+  TEST_ASSERT_EQUAL_STRING("-179.9999999", text);
+  TEST_ASSERT_EQUAL(GEO_COORDINATE_CHARS - 1, strlen(text));
+  geoFormatCoordinate(0, text);
+  TEST_ASSERT_EQUAL_STRING("0.0000000", text);
+
+  for (uint32_t i = 0; i < RANDOM_VALUES; i++)
+  {
+    int32_t latitude = randomBetween(-900000000, 900000000);
+    int32_t longitude = randomBetween(-1800000000, 1800000000);
+    char latitudeText[GEO_COORDINATE_CHARS];
+    char longitudeText[GEO_COORDINATE_CHARS];
+    geoFormatCoordinate(latitude, latitudeText);
+    geoFormatCoordinate(longitude, longitudeText);
+    int32_t backLatitude, backLongitude;
+    TEST_ASSERT_TRUE(parseCoordinates(latitudeText, longitudeText, &backLatitude, &backLongitude));
+    TEST_ASSERT_EQUAL_INT32(latitude, backLatitude);
+    TEST_ASSERT_EQUAL_INT32(longitude, backLongitude);
+  }
+}
+
+// The float path this replaced: atof into float, then float haversine
+static float floatHaversineM(float fromLatitude, float fromLongitude, float toLatitude, float toLongitude)
+{
+  const float rad = 3.14159265f / 180.0f;
+  float dPhi = (toLatitude - fromLatitude) * rad;
+  float dLambda = (toLongitude - fromLongitude) * rad;
+  float a = sinf(dPhi / 2) * sinf(dPhi / 2) +
+            cosf(fromLatitude * rad) * cosf(toLatitude * rad) * sinf(dLambda / 2) * sinf(dLambda / 2);
+  return 2 * 6371000.0f * asinf(sqrtf(a));
+}
+
+static void test_benchmark_float_against_integer(void)
+{
+  // Parsing: what float keeps of a 7-decimal longitude
+  double worstFloatCm = 0;
+  for (uint32_t i = 0; i < RANDOM_VALUES; i++)
+  {
+    int32_t value = randomBetween(-1800000000, 1800000000);
+    char text[GEO_COORDINATE_CHARS];
+    geoFormatCoordinate(value, text);
+    float parsed = (float)atof(text);
+    double errorCm = fabs((double)parsed * 1e7 - value) * 1.11195;
+    worstFloatCm = errorCm > worstFloatCm ? errorCm : worstFloatCm;
+    TEST_ASSERT_EQUAL_INT32(value, parseOne(text));
+  }
+  TEST_ASSERT_TRUE(worstFloatCm > 20); // float is off by tens of centimeters
+  benchReport("Coordinate parse error, float", worstFloatCm, "cm");
+  benchReport("Coordinate parse error, 1e-7 integer", 0, "cm");
+
+  // Distance between consecutive fixes, 10 to 200 m apart near Colombo
+  const uint32_t count = 1024;
+  int32_t latitudes[count];
+  int32_t longitudes[count];
+  float latitudesF[count];
+  float longitudesF[count];
+  latitudes[0] = 69271000;
+  longitudes[0] = 798612000;
+  for (uint32_t i = 1; i < count; i++)
+  {
+    destination(latitudes[i - 1], longitudes[i - 1], randomBetween(0, 359), randomBetween(1000, 20000), &latitudes[i],
+                &longitudes[i]);
+  }
+  double worstFloat = 0;
+  double worstInteger = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    char text[GEO_COORDINATE_CHARS];
+    geoFormatCoordinate(latitudes[i], text);
+    latitudesF[i] = (float)atof(text);
+    geoFormatCoordinate(longitudes[i], text);
+    longitudesF[i] = (float)atof(text);
+    if (i > 0)
+    {
+      double reference = haversineCm(latitudes[i - 1], longitudes[i - 1], latitudes[i], longitudes[i]);
+      double floatError = fabs(floatHaversineM(latitudesF[i - 1], longitudesF[i - 1], latitudesF[i], longitudesF[i]) * 100 - reference);
+      double integerError = fabs(geoDistanceCm(latitudes[i - 1], longitudes[i - 1], latitudes[i], longitudes[i]) - reference);
+      worstFloat = floatError > worstFloat ? floatError : worstFloat;
+      worstInteger = integerError > worstInteger ? integerError : worstInteger;
+    }
+  }
+  TEST_ASSERT_TRUE(worstInteger < worstFloat);
+  benchReport("Hop distance error, float haversine", worstFloat, "cm");
+  benchReport("Hop distance error, integer", worstInteger, "cm");
+
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < BENCH_CALLS; i++)
+  {
+    uint32_t k = i % (count - 1);
+    benchKeep(floatHaversineM(latitudesF[k], longitudesF[k], latitudesF[k + 1], longitudesF[k + 1]));
+  }
+  benchReport("Hop distance, float haversine", (double)(benchNanos() - start) / BENCH_CALLS, "ns");
+  start = benchNanos();
+  for (uint32_t i = 0; i < BENCH_CALLS; i++)
+  {
+    uint32_t k = i % (count - 1);
+    benchKeep(geoDistanceCm(latitudes[k], longitudes[k], latitudes[k + 1], longitudes[k + 1]));
+  }
+  benchReport("Hop distance, integer", (double)(benchNanos() - start) / BENCH_CALLS, "ns");
+  start = benchNanos();
+  for (uint32_t i = 0; i < BENCH_CALLS; i++)
+  {
+    uint32_t k = i % (count - 1);
+    benchKeep(geoBearingCdeg(latitudes[k], longitudes[k], latitudes[k + 1], longitudes[k + 1]));
+  }
+  benchReport("Hop bearing, integer", (double)(benchNanos() - start) / BENCH_CALLS, "ns");
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_decimal_strings_parse_exactly);
+  RUN_TEST(test_eighth_decimal_rounds);
+  RUN_TEST(test_distance_and_bearing_against_haversine);
+  RUN_TEST(test_across_the_antimeridian);
+  RUN_TEST(test_move_inverts_offset);
+  RUN_TEST(test_bounding_boxes);
+  RUN_TEST(test_format_round_trips);
+  RUN_TEST(test_benchmark_float_against_integer);
+  return UNITY_END();
+}
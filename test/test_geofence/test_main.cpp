@@ -0,0 +1,435 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "Geofence.h"
+#include "Stations.h"
+#include "HostBench.h"
+
+#define RANDOM_POINTS 20000
+#define BENCH_FIXES 200000
+
+// Small deterministic generator, the same points on every run
+static uint32_t randomState;
+
+static uint32_t nextRandom()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static int32_t randomBetween(int32_t low, int32_t high)
+{
+  return low + (int32_t)(nextRandom() % (uint32_t)(high - low + 1));
+}
+
+/*
+ * Fence set built at run time, with the grid index laid out the way
+ * tools/gen_geofences.py writes it into include/Stations.h.
+ */
+struct FenceSet
+{
+  std::vector<GeoFence> fences;
+  std::vector<GeoVertex> vertices;
+  std::vector<uint16_t> starts;
+  std::vector<uint16_t> flat;
+  GeofenceTable table;
+
+  void addCircle(uint16_t id, int32_t latitude, int32_t longitude, uint32_t radiusCm)
+  {
+    GeoFence fence = {id, 0, 0, latitude, longitude, radiusCm, geoBoxAround(latitude, longitude, radiusCm)};
+    fences.push_back(fence);
+  }
+
+  void addPolygon(uint16_t id, const GeoVertex *points, uint8_t count)
+  {
+    GeoFence fence = {id, count, (uint16_t)vertices.size(), points[0].latitude, points[0].longitude, 0,
+                      {points[0].latitude, points[0].longitude, points[0].latitude, points[0].longitude}};
+    for (uint8_t i = 0; i < count; i++)
+    {
+      geoBoxExtend(fence.box, points[i].latitude, points[i].longitude);
+      vertices.push_back(points[i]);
+    }
+    fences.push_back(fence);
+  }
+
+  // Same rules as build_grid(): at most 128 cells per side
+  void index(int32_t cell)
+  {
+    GeoBox all = fences[0].box;
+    for (size_t i = 0; i < fences.size(); i++)
+    {
+      geoBoxExtend(all, fences[i].box.minLatitude, fences[i].box.minLongitude);
+      geoBoxExtend(all, fences[i].box.maxLatitude, fences[i].box.maxLongitude);
+    }
+    int32_t cellLatitude = std::max(cell, (all.maxLatitude - all.minLatitude) / 128 + 1);
+    int32_t cellLongitude = std::max(cell, (all.maxLongitude - all.minLongitude) / 128 + 1);
+    uint16_t rows = (all.maxLatitude - all.minLatitude) / cellLatitude + 1;
+    uint16_t cols = (all.maxLongitude - all.minLongitude) / cellLongitude + 1;
+
+    std::vector<std::vector<uint16_t> > cells(rows * cols);
+    for (size_t i = 0; i < fences.size(); i++)
+    {
+      const GeoBox &box = fences[i].box;
+      for (int32_t r = (box.minLatitude - all.minLatitude) / cellLatitude;
+           r <= (box.maxLatitude - all.minLatitude) / cellLatitude; r++)
+      {
+        for (int32_t c = (box.minLongitude - all.minLongitude) / cellLongitude;
+             c <= (box.maxLongitude - all.minLongitude) / cellLongitude; c++)
+        {
+          cells[r * cols + c].push_back((uint16_t)i);
+        }
+      }
+    }
+    starts.assign(1, 0);
+    flat.clear();
+    for (size_t i = 0; i < cells.size(); i++)
+    {
+      flat.insert(flat.end(), cells[i].begin(), cells[i].end());
+      starts.push_back((uint16_t)flat.size());
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(65535, flat.size());
+
+    GeofenceTable built = {&fences[0], (uint16_t)fences.size(), vertices.empty() ? NULL : &vertices[0],
+                           &starts[0], &flat[0], all.minLatitude, all.minLongitude,
+                           cellLatitude, cellLongitude, rows, cols};
+    table = built;
+  }
+};
+
+// Ids of the fences the grid finds at a point, through the public API
+static std::vector<uint16_t> gridLookup(const GeofenceTable &table, int32_t latitude, int32_t longitude)
+{
+  GeofenceMonitor monitor(table);
+  GeofenceEvent events[GEOFENCE_MAX_TRACKED];
+  uint8_t count = 0;
+  for (int i = 0; i < GEOFENCE_ENTER_FIXES; i++)
+  {
+    count = monitor.update(latitude, longitude, 0, events, GEOFENCE_MAX_TRACKED);
+  }
+  std::vector<uint16_t> ids;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_EQUAL(GEOFENCE_ENTER, events[i].type);
+    ids.push_back(events[i].fenceId);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Ids of the fences containing a point, testing every fence
+static std::vector<uint16_t> bruteForce(const GeofenceTable &table, int32_t latitude, int32_t longitude)
+{
+  GeofenceMonitor monitor(table);
+  std::vector<uint16_t> ids;
+  for (uint16_t i = 0; i < table.fenceCount; i++)
+  {
+    if (monitor.contains(table.fences[i], latitude, longitude))
+    {
+      ids.push_back(table.fences[i].id);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+static void assertGridMatches(const GeofenceTable &table, const GeoBox &area, uint32_t points)
+{
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < points; i++)
+  {
+    int32_t latitude = randomBetween(area.minLatitude, area.maxLatitude);
+    int32_t longitude = randomBetween(area.minLongitude, area.maxLongitude);
+    std::vector<uint16_t> expected = bruteForce(table, latitude, longitude);
+    std::vector<uint16_t> found = gridLookup(table, latitude, longitude);
+    if (expected != found)
+    {
+      char message[64];
+      snprintf(message, sizeof(message), "point %ld, %ld", (long)latitude, (long)longitude);
+      TEST_FAIL_MESSAGE(message);
+    }
+    hits += !expected.empty();
+  }
+  TEST_ASSERT_GREATER_THAN(points / 20, hits); // the points do land in fences
+}
+
+void setUp(void)
+{
+  randomState = 2463534242UL;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_grid_matches_brute_force_on_the_stations(void)
+{
+  // Colombo Fort to Dematagoda, where the fences are dense, then the whole
+  // grid with a margin
+  GeoBox colombo = {69260000, 798480000, 69400000, 798800000};
+  assertGridMatches(STATION_TABLE, colombo, RANDOM_POINTS);
+
+  GeoBox all = {STATION_TABLE.originLatitude - 1000000, STATION_TABLE.originLongitude - 1000000,
+                STATION_TABLE.originLatitude + STATION_TABLE.rows * STATION_TABLE.cellLatitude + 1000000,
+                STATION_TABLE.originLongitude + STATION_TABLE.cols * STATION_TABLE.cellLongitude + 1000000};
+  for (uint32_t i = 0; i < RANDOM_POINTS; i++)
+  {
+    int32_t latitude = randomBetween(all.minLatitude, all.maxLatitude);
+    int32_t longitude = randomBetween(all.minLongitude, all.maxLongitude);
+    TEST_ASSERT_TRUE(bruteForce(STATION_TABLE, latitude, longitude) == gridLookup(STATION_TABLE, latitude, longitude));
+  }
+  // Every station center is found
+  for (uint16_t i = 0; i < STATION_COUNT; i++)
+  {
+    const GeoFence &fence = STATION_FENCES[i];
+    std::vector<uint16_t> found = gridLookup(STATION_TABLE, fence.latitude, fence.longitude);
+    TEST_ASSERT_TRUE(std::find(found.begin(), found.end(), fence.id) != found.end());
+  }
+}
+
+static void test_grid_matches_brute_force_on_overlapping_fences(void)
+{
+  // Circles and triangles packed so that boxes overlap and straddle cells,
+  // but no point is in more than GEOFENCE_MAX_TRACKED of them
+  FenceSet set;
+  GeoBox area = {69000000, 798000000, 69500000, 798500000};
+  for (uint16_t id = 1; id <= 150; id++)
+  {
+    int32_t latitude = randomBetween(area.minLatitude, area.maxLatitude);
+    int32_t longitude = randomBetween(area.minLongitude, area.maxLongitude);
+    if (id % 3 == 0)
+    {
+      GeoVertex triangle[3] = {{latitude, longitude},
+                               {latitude + randomBetween(-3000, 3000), longitude + randomBetween(1000, 5000)},
+                               {latitude + randomBetween(1000, 5000), longitude + randomBetween(-3000, 3000)}};
+      set.addPolygon(id, triangle, 3);
+    }
+    else
+    {
+      set.addCircle(id, latitude, longitude, randomBetween(2000, 30000));
+    }
+  }
+  set.index(5000); // about 550 m cells
+  TEST_ASSERT_GREATER_THAN(1, set.table.rows);
+  assertGridMatches(set.table, area, RANDOM_POINTS);
+}
+
+static void test_points_on_shared_edges_belong_to_one_tile(void)
+{
+  // Nine square tiles sharing edges and corners, 1000 units a side
+  FenceSet set;
+  for (int32_t r = 0; r < 3; r++)
+  {
+    for (int32_t c = 0; c < 3; c++)
+    {
+      int32_t south = 69000000 + r * 1000;
+      int32_t west = 798000000 + c * 1000;
+      GeoVertex square[4] = {{south, west}, {south + 1000, west}, {south + 1000, west + 1000}, {south, west + 1000}};
+      set.addPolygon((uint16_t)(r * 3 + c), square, 4);
+    }
+  }
+  set.index(700);
+
+  // Points on the 250-unit lattice hit edges and corners most of the time
+  for (int32_t y = 0; y < 3000; y += 250)
+  {
+    for (int32_t x = 0; x < 3000; x += 250)
+    {
+      std::vector<uint16_t> owners = bruteForce(set.table, 69000000 + y, 798000000 + x);
+      TEST_ASSERT_EQUAL(1, owners.size());
+      TEST_ASSERT_EQUAL((y / 1000) * 3 + x / 1000, owners[0]);
+      TEST_ASSERT_TRUE(owners == gridLookup(set.table, 69000000 + y, 798000000 + x));
+    }
+  }
+}
+
+static void test_ray_through_a_vertex(void)
+{
+  // Diamond: the ray from its center and from either side runs through the
+  // east and west vertices
+  FenceSet set;
+  GeoVertex diamond[4] = {{69000000, 798001000}, {69001000, 798002000}, {69000000, 798003000}, {68999000, 798002000}};
+  set.addPolygon(1, diamond, 4);
+  // U shape: the ray from the notch crosses both arms
+  GeoVertex u[8] = {{69010000, 798000000}, {69013000, 798000000}, {69013000, 798001000}, {69011000, 798001000},
+                    {69011000, 798002000}, {69013000, 798002000}, {69013000, 798003000}, {69010000, 798003000}};
+  set.addPolygon(2, u, 8);
+  set.index(100000);
+  GeofenceMonitor monitor(set.table);
+  const GeoFence &d = set.fences[0];
+  const GeoFence &shape = set.fences[1];
+
+  TEST_ASSERT_TRUE(monitor.contains(d, 69000000, 798002000));
+  TEST_ASSERT_TRUE(monitor.contains(d, 69000000, 798001000)); // west vertex
+  TEST_ASSERT_FALSE(monitor.contains(d, 69000000, 798003000)); // east vertex
+  TEST_ASSERT_FALSE(monitor.contains(d, 69000000, 798000000)); // ray through both vertices
+  TEST_ASSERT_FALSE(monitor.contains(d, 69000000, 798004000));
+  TEST_ASSERT_TRUE(monitor.contains(d, 68999001, 798002000));
+  TEST_ASSERT_FALSE(monitor.contains(d, 69001000, 798002000)); // north vertex
+  TEST_ASSERT_FALSE(monitor.contains(d, 69000600, 798001500)); // just outside the north-west edge
+
+  TEST_ASSERT_TRUE(monitor.contains(shape, 69012000, 798000500));  // left arm
+  TEST_ASSERT_FALSE(monitor.contains(shape, 69012000, 798001500)); // notch
+  TEST_ASSERT_TRUE(monitor.contains(shape, 69012000, 798002500));  // right arm
+  TEST_ASSERT_TRUE(monitor.contains(shape, 69010500, 798001500));  // base under the notch
+  TEST_ASSERT_FALSE(monitor.contains(shape, 69011000, 798001500)); // notch floor, the south edge rule
+  TEST_ASSERT_FALSE(monitor.contains(shape, 69012000, 797999000));
+}
+
+static void test_circle_fences(void)
+{
+  FenceSet set;
+  int32_t latitude = 69290000;
+  int32_t longitude = 798650000;
+  set.addCircle(7, latitude, longitude, 25000);
+  set.addCircle(8, 600000000, 100000000, 25000); // 60 degrees north, where a degree of longitude is half as long
+  set.index(500000);
+  GeofenceMonitor monitor(set.table);
+
+  for (uint8_t f = 0; f < 2; f++)
+  {
+    const GeoFence &fence = set.fences[f];
+    for (int32_t angle = 0; angle < 360; angle += 15)
+    {
+      // On the circle, 1 m inside and 1 m outside
+      double radians = angle * 3.14159265358979 / 180.0;
+      for (int32_t delta = -100; delta <= 100; delta += 200)
+      {
+        int32_t toLatitude, toLongitude;
+        int32_t radius = (int32_t)fence.radiusCm + delta;
+        geoMoveCm(fence.latitude, fence.longitude, (int32_t)(radius * sin(radians)), (int32_t)(radius * cos(radians)),
+                  &toLatitude, &toLongitude);
+        TEST_ASSERT_EQUAL(delta < 0, monitor.contains(fence, toLatitude, toLongitude));
+      }
+    }
+  }
+  TEST_ASSERT_TRUE(monitor.contains(set.fences[0], latitude, longitude));
+  TEST_ASSERT_FALSE(monitor.contains(set.fences[0], set.fences[0].box.maxLatitude, set.fences[0].box.maxLongitude));
+}
+
+static void test_enter_and_exit_are_debounced(void)
+{
+  FenceSet set;
+  set.addCircle(42, 69290000, 798650000, 25000);
+  set.index(500000);
+  GeofenceMonitor monitor(set.table);
+  GeofenceEvent events[4];
+  int32_t outLatitude, outLongitude;
+  geoMoveCm(69290000, 798650000, 0, 40000, &outLatitude, &outLongitude); // 400 m north
+
+  uint32_t time = 1000;
+  TEST_ASSERT_EQUAL(0, monitor.update(outLatitude, outLongitude, time++, events, 4));
+  // A single jump into the fence is multipath, not an arrival
+  TEST_ASSERT_EQUAL(0, monitor.update(69290000, 798650000, time++, events, 4));
+  TEST_ASSERT_EQUAL(0, monitor.update(outLatitude, outLongitude, time++, events, 4));
+  TEST_ASSERT_EQUAL(-1, monitor.currentFenceId());
+
+  uint32_t enters = 0;
+  uint32_t exits = 0;
+  uint32_t enteredAt = 0;
+  uint32_t exitedAt = 0;
+  // Arrive, dwell with one fix thrown outside, leave
+  const bool inside[] = {true, true, true, true, false, true, true, true, false, false, false, false};
+  for (size_t i = 0; i < sizeof(inside) / sizeof(inside[0]); i++)
+  {
+    uint8_t count = inside[i] ? monitor.update(69290100, 798650100, time, events, 4)
+                              : monitor.update(outLatitude, outLongitude, time, events, 4);
+    TEST_ASSERT_LESS_OR_EQUAL(1, count);
+    if (count == 1)
+    {
+      TEST_ASSERT_EQUAL(42, events[0].fenceId);
+      TEST_ASSERT_EQUAL_UINT32(time, events[0].timestamp);
+      if (events[0].type == GEOFENCE_ENTER)
+      {
+        enters++;
+        enteredAt = i;
+      }
+      else
+      {
+        exits++;
+        exitedAt = i;
+      }
+    }
+    if (i == 2)
+    {
+      TEST_ASSERT_EQUAL(42, monitor.currentFenceId());
+    }
+    time++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, enters);
+  TEST_ASSERT_EQUAL_UINT32(1, exits);
+  TEST_ASSERT_EQUAL_UINT32(GEOFENCE_ENTER_FIXES - 1, enteredAt);
+  TEST_ASSERT_EQUAL_UINT32(8 + GEOFENCE_EXIT_FIXES - 1, exitedAt);
+  TEST_ASSERT_EQUAL(-1, monitor.currentFenceId());
+  TEST_ASSERT_EQUAL_UINT32(2, monitor.stats().events);
+}
+
+static void test_benchmark_lookup_time_against_fence_count(void)
+{
+  const uint32_t counts[] = {10, 100, 1000, 10000};
+  GeoBox area = {60000000, 795000000, 80000000, 815000000}; // 2 x 2 degrees
+  for (size_t n = 0; n < sizeof(counts) / sizeof(counts[0]); n++)
+  {
+    FenceSet set;
+    for (uint32_t id = 0; id < counts[n]; id++)
+    {
+      set.addCircle((uint16_t)id, randomBetween(area.minLatitude, area.maxLatitude),
+                    randomBetween(area.minLongitude, area.maxLongitude), randomBetween(20000, 50000));
+    }
+    set.index(200000); // 0.02 degree cells, 100 a side
+    std::vector<GeoVertex> fixes(1000);
+    for (size_t i = 0; i < fixes.size(); i++)
+    {
+      fixes[i].latitude = randomBetween(area.minLatitude, area.maxLatitude);
+      fixes[i].longitude = randomBetween(area.minLongitude, area.maxLongitude);
+    }
+
+    GeofenceMonitor monitor(set.table);
+    GeofenceEvent events[GEOFENCE_MAX_TRACKED];
+    uint64_t start = benchNanos();
+    for (uint32_t i = 0; i < BENCH_FIXES; i++)
+    {
+      const GeoVertex &fix = fixes[i % fixes.size()];
+      benchKeep(monitor.update(fix.latitude, fix.longitude, i, events, GEOFENCE_MAX_TRACKED));
+    }
+    double gridNs = (double)(benchNanos() - start) / BENCH_FIXES;
+
+    uint32_t scans = BENCH_FIXES / counts[n] + 1;
+    start = benchNanos();
+    for (uint32_t i = 0; i < scans; i++)
+    {
+      const GeoVertex &fix = fixes[i % fixes.size()];
+      for (uint32_t f = 0; f < counts[n]; f++)
+      {
+        benchKeep(monitor.contains(set.fences[f], fix.latitude, fix.longitude));
+      }
+    }
+    double scanNs = (double)(benchNanos() - start) / scans;
+
+    // The grid keeps the exact tests per fix flat as the fence count grows
+    double tested = (double)monitor.stats().fencesTested / monitor.stats().lookups;
+    TEST_ASSERT_TRUE(tested < 4.0);
+    char what[64];
+    snprintf(what, sizeof(what), "Geofence grid, %lu fences", (unsigned long)counts[n]);
+    benchReport(what, gridNs, "ns/fix");
+    snprintf(what, sizeof(what), "Geofence full scan, %lu fences", (unsigned long)counts[n]);
+    benchReport(what, scanNs, "ns/fix");
+    snprintf(what, sizeof(what), "Geofence exact tests, %lu fences", (unsigned long)counts[n]);
+    benchReport(what, tested, "per fix");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_grid_matches_brute_force_on_the_stations);
+  RUN_TEST(test_grid_matches_brute_force_on_overlapping_fences);
+  RUN_TEST(test_points_on_shared_edges_belong_to_one_tile);
+  RUN_TEST(test_ray_through_a_vertex);
+  RUN_TEST(test_circle_fences);
+  RUN_TEST(test_enter_and_exit_are_debounced);
+  RUN_TEST(test_benchmark_lookup_time_against_fence_count);
+  return UNITY_END();
+}
@@ -0,0 +1,181 @@
+#include <unity.h>
+#include "GPSSampler.h"
+
+#define START_LATITUDE 69271000   // Colombo Fort, 1e-7 degrees
+#define START_LONGITUDE 798612000
+
+static GPSSampler sampler;
+static unsigned long now;
+
+void setUp(void)
+{
+  sampler = GPSSampler();
+  now = 1000;
+  sampler.begin(now);
+}
+
+void tearDown(void)
+{
+}
+
+static GPSFix fixAt(int32_t latitude, int32_t longitude, float speedKmh, float course)
+{
+  GPSFix fix;
+  clearGPSFix(fix);
+  fix.runStatus = 1;
+  fix.fixStatus = 1;
+  fix.latitude = latitude;
+  fix.longitude = longitude;
+  fix.speed = speedKmh;
+  fix.course = course;
+  return fix;
+}
+
+static GPSFix noFix()
+{
+  GPSFix fix;
+  clearGPSFix(fix);
+  fix.runStatus = 1;
+  return fix;
+}
+
+// Advance to the next due poll and answer it
+static void pollWith(const GPSFix &fix)
+{
+  now = sampler.nextDue();
+  TEST_ASSERT_TRUE(sampler.fixDue(now));
+  sampler.onFix(fix, now);
+}
+
+static void test_first_poll_is_due_at_once(void)
+{
+  TEST_ASSERT_TRUE(sampler.fixDue(now));
+  TEST_ASSERT_TRUE(sampler.wantsPower(now));
+  TEST_ASSERT_EQUAL(GPSSampler::SEARCHING, sampler.state());
+}
+
+static void test_search_backs_off_after_the_timeout(void)
+{
+  int polls = SAMPLER_SEARCH_TIMEOUT / SAMPLER_SEARCH_INTERVAL;
+  for (int i = 1; i < polls; i++)
+  {
+    pollWith(noFix());
+    TEST_ASSERT_EQUAL_UINT32(SAMPLER_SEARCH_INTERVAL, sampler.interval());
+  }
+  pollWith(noFix());
+  TEST_ASSERT_EQUAL_UINT32(SAMPLER_STATIONARY_INTERVAL, sampler.interval());
+  TEST_ASSERT_EQUAL(GPSSampler::SEARCHING, sampler.state());
+}
+
+static void test_fast_train_is_polled_often(void)
+{
+  // 100 km/h: about 28 m per second, so 30 m spacing needs about a second
+  int32_t latitude = START_LATITUDE;
+  for (int i = 0; i < 5; i++)
+  {
+    pollWith(fixAt(latitude, START_LONGITUDE, 100.0f, 0.0f));
+    latitude += 2500 * sampler.interval() / 1000;
+  }
+  TEST_ASSERT_EQUAL(GPSSampler::MOVING, sampler.state());
+  TEST_ASSERT_UINT32_WITHIN(100, 1080, sampler.interval());
+}
+
+static void test_slow_movement_is_polled_slowly(void)
+{
+  int32_t latitude = START_LATITUDE;
+  for (int i = 0; i < 5; i++)
+  {
+    pollWith(fixAt(latitude, START_LONGITUDE, 4.0f, 0.0f));
+    latitude += 100 * sampler.interval() / 1000; // about 4 km/h
+  }
+  TEST_ASSERT_EQUAL(GPSSampler::MOVING, sampler.state());
+  TEST_ASSERT_UINT32_WITHIN(3000, 27000, sampler.interval());
+  TEST_ASSERT_LESS_OR_EQUAL(SAMPLER_MOVING_MAX_INTERVAL, sampler.interval());
+}
+
+static void test_turn_forces_the_fastest_rate(void)
+{
+  pollWith(fixAt(START_LATITUDE, START_LONGITUDE, 30.0f, 0.0f));
+  pollWith(fixAt(START_LATITUDE + 2500, START_LONGITUDE, 30.0f, 0.0f));
+  TEST_ASSERT_GREATER_THAN(SAMPLER_MIN_INTERVAL, sampler.interval());
+  pollWith(fixAt(START_LATITUDE + 5000, START_LONGITUDE + 500, 30.0f, 20.0f));
+  TEST_ASSERT_EQUAL_UINT32(SAMPLER_MIN_INTERVAL, sampler.interval());
+}
+
+static void test_stationary_backs_off_and_powers_down(void)
+{
+  uint32_t expected[] = {30000, 60000, 120000, 240000, 300000, 300000};
+  // The first fix sets the anchor, the fixes after it count as still
+  for (int i = 0; i < SAMPLER_STATIONARY_FIXES; i++)
+  {
+    pollWith(fixAt(START_LATITUDE + i * 10, START_LONGITUDE, 0.0f, 0.0f));
+  }
+  for (unsigned i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+  {
+    pollWith(fixAt(START_LATITUDE, START_LONGITUDE + i * 10, 0.0f, 0.0f));
+    TEST_ASSERT_EQUAL(GPSSampler::STATIONARY, sampler.state());
+    TEST_ASSERT_EQUAL_UINT32(expected[i], sampler.interval());
+  }
+
+  // Far from the next poll the engine may sleep, the warmup before it wakes it
+  TEST_ASSERT_FALSE(sampler.wantsPower(now + 1000));
+  TEST_ASSERT_TRUE(sampler.wantsPower(sampler.nextDue() - sampler.warmup()));
+  sampler.setWarmup(40000);
+  TEST_ASSERT_TRUE(sampler.wantsPower(sampler.nextDue() - 40000));
+  TEST_ASSERT_FALSE(sampler.wantsPower(sampler.nextDue() - 40001));
+}
+
+static void test_movement_ends_the_stationary_backoff(void)
+{
+  for (int i = 0; i < SAMPLER_STATIONARY_FIXES + 2; i++)
+  {
+    pollWith(fixAt(START_LATITUDE, START_LONGITUDE, 0.0f, 0.0f));
+  }
+  TEST_ASSERT_EQUAL(GPSSampler::STATIONARY, sampler.state());
+  pollWith(fixAt(START_LATITUDE + 20000, START_LONGITUDE, 40.0f, 0.0f));
+  TEST_ASSERT_EQUAL(GPSSampler::MOVING, sampler.state());
+  TEST_ASSERT_LESS_OR_EQUAL(SAMPLER_MOVING_MAX_INTERVAL, sampler.interval());
+}
+
+static void test_min_interval_limits_the_rate(void)
+{
+  sampler.setMinInterval(10000);
+  pollWith(fixAt(START_LATITUDE, START_LONGITUDE, 100.0f, 0.0f));
+  TEST_ASSERT_EQUAL_UINT32(10000, sampler.interval());
+  sampler.setMinInterval(0);
+  pollWith(fixAt(START_LATITUDE + 25000, START_LONGITUDE, 100.0f, 0.0f));
+  TEST_ASSERT_GREATER_OR_EQUAL(SAMPLER_MIN_INTERVAL, sampler.interval());
+  TEST_ASSERT_LESS_THAN(10000, sampler.interval());
+}
+
+static void test_no_poll_while_powered_down(void)
+{
+  sampler.setPowered(false, now);
+  TEST_ASSERT_FALSE(sampler.fixDue(now + 1000000));
+  sampler.setPowered(true, now + 5000);
+  TEST_ASSERT_TRUE(sampler.fixDue(now + 5000));
+  TEST_ASSERT_EQUAL_UINT32(1, sampler.stats().powerCycles);
+}
+
+static void test_failed_poll_retries_at_the_search_rate(void)
+{
+  sampler.onPollFailed(now);
+  TEST_ASSERT_EQUAL_UINT32(SAMPLER_SEARCH_INTERVAL, sampler.interval());
+  TEST_ASSERT_EQUAL_UINT32(0, sampler.stats().polls);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_poll_is_due_at_once);
+  RUN_TEST(test_search_backs_off_after_the_timeout);
+  RUN_TEST(test_fast_train_is_polled_often);
+  RUN_TEST(test_slow_movement_is_polled_slowly);
+  RUN_TEST(test_turn_forces_the_fastest_rate);
+  RUN_TEST(test_stationary_backs_off_and_powers_down);
+  RUN_TEST(test_movement_ends_the_stationary_backoff);
+  RUN_TEST(test_min_interval_limits_the_rate);
+  RUN_TEST(test_no_poll_while_powered_down);
+  RUN_TEST(test_failed_poll_retries_at_the_search_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,324 @@
+#include <unity.h>
+#include <string.h>
+#include "ModemPower.h"
+#include "GPSSampler.h"
+
+#define STEP_MS 50
+#define START_LATITUDE 69271000 // 1e-7 degrees
+#define START_LONGITUDE 798612000
+
+static ModemPower power;
+static unsigned long now;
+
+void setUp(void)
+{
+  power = ModemPower();
+  now = 1000;
+  power.begin(now);
+  power.setEnabled(true);
+}
+
+void tearDown(void)
+{
+}
+
+// Run update() every STEP_MS for ms with the work ahead of it counting down
+static ModemPowerAction runFor(unsigned long ms, unsigned long workAt)
+{
+  ModemPowerAction last = MODEM_POWER_NONE;
+  for (unsigned long end = now + ms; now < end; now += STEP_MS)
+  {
+    ModemPowerAction action = power.update(now, workAt > now ? workAt - now : 0);
+    if (action != MODEM_POWER_NONE)
+    {
+      last = action;
+    }
+  }
+  return last;
+}
+
+static void test_nothing_before_begin(void)
+{
+  ModemPower idle;
+  idle.setEnabled(true);
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, idle.update(100000, 60000));
+}
+
+static void test_sleeps_only_when_quiet_and_enabled(void)
+{
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, power.update(now, 60000)); // not idle long enough
+  power.setEnabled(false);
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, power.update(now + MODEM_SLEEP_IDLE, 60000));
+  power.setEnabled(true);
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, power.update(now + MODEM_SLEEP_IDLE, MODEM_SLEEP_MIN - 1));
+  TEST_ASSERT_EQUAL(MODEM_POWER_SLEEP, power.update(now + MODEM_SLEEP_IDLE, MODEM_SLEEP_MIN));
+  TEST_ASSERT_EQUAL(MODEM_ASLEEP, power.state());
+  TEST_ASSERT_FALSE(power.isAwake());
+}
+
+static void test_wakes_ahead_of_scheduled_work(void)
+{
+  unsigned long workAt = now + 30000;
+  TEST_ASSERT_EQUAL(MODEM_POWER_SLEEP, runFor(5000, workAt));
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, power.update(now, workAt - now));
+  now = workAt - MODEM_WAKE_LEAD;
+  TEST_ASSERT_EQUAL(MODEM_POWER_WAKE, power.update(now, workAt - now));
+  TEST_ASSERT_EQUAL(MODEM_WAKING, power.state());
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, power.update(now + MODEM_DTR_WAKE_MS - 1, 1));
+  TEST_ASSERT_EQUAL(MODEM_POWER_READY, power.update(now + MODEM_DTR_WAKE_MS, 1));
+  TEST_ASSERT_TRUE(power.isAwake());
+  TEST_ASSERT_EQUAL_UINT32(1, power.stats().sleeps);
+  TEST_ASSERT_EQUAL_UINT32(1, power.stats().scheduledWakes);
+  TEST_ASSERT_EQUAL_UINT32(MODEM_DTR_WAKE_MS, power.stats().wakeMs);
+}
+
+static void test_request_wakes_a_sleeping_modem(void)
+{
+  runFor(5000, now + 60000);
+  TEST_ASSERT_EQUAL(MODEM_ASLEEP, power.state());
+  power.requestWake();
+  TEST_ASSERT_EQUAL(MODEM_POWER_WAKE, power.update(now, 50000));
+  TEST_ASSERT_EQUAL_UINT32(1, power.stats().eventWakes);
+  // Once ready the work that woke it has MODEM_SLEEP_IDLE to start
+  TEST_ASSERT_EQUAL(MODEM_POWER_READY, runFor(MODEM_DTR_WAKE_MS + STEP_MS, now + 50000));
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, runFor(MODEM_SLEEP_IDLE - 2 * STEP_MS, now + 50000));
+  TEST_ASSERT_EQUAL(MODEM_POWER_SLEEP, runFor(2 * STEP_MS, now + 50000));
+}
+
+static void test_request_while_awake_counts_as_work(void)
+{
+  runFor(MODEM_SLEEP_IDLE - STEP_MS, now + 60000);
+  power.requestWake();
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, power.update(now, 60000));
+  TEST_ASSERT_EQUAL(MODEM_POWER_NONE, runFor(MODEM_SLEEP_IDLE - STEP_MS, now + 60000));
+  TEST_ASSERT_EQUAL(MODEM_AWAKE, power.state());
+  TEST_ASSERT_EQUAL_UINT32(0, power.stats().eventWakes);
+}
+
+static void test_disabling_wakes_the_modem(void)
+{
+  runFor(5000, now + 60000);
+  power.setEnabled(false);
+  TEST_ASSERT_EQUAL(MODEM_POWER_WAKE, power.update(now, 50000));
+}
+
+static void test_start_classes(void)
+{
+  TEST_ASSERT_EQUAL(GNSS_COLD, power.startAt(now));
+  TEST_ASSERT_EQUAL_UINT32(GNSS_COLD_WARMUP, power.warmup(now));
+  power.onGNSSPower(true, now);
+  power.onGNSSFix(false, now + 10000);
+  TEST_ASSERT_TRUE(power.isAcquiring());
+  power.onGNSSFix(true, now + 30000);
+  TEST_ASSERT_FALSE(power.isAcquiring());
+  TEST_ASSERT_EQUAL_UINT32(1, power.stats().starts[GNSS_COLD].count);
+  TEST_ASSERT_EQUAL_UINT32(30000, power.stats().starts[GNSS_COLD].learnedMs);
+
+  unsigned long fixAt = now + 30000;
+  TEST_ASSERT_EQUAL(GNSS_HOT, power.startAt(fixAt + GNSS_HOT_WINDOW));
+  TEST_ASSERT_EQUAL_UINT32(GNSS_HOT_WARMUP, power.warmup(fixAt + 60000));
+  TEST_ASSERT_EQUAL(GNSS_WARM, power.startAt(fixAt + GNSS_HOT_WINDOW + 1));
+  TEST_ASSERT_EQUAL_UINT32(GNSS_WARM_WARMUP, power.warmup(fixAt + GNSS_HOT_WINDOW + 1));
+}
+
+// Power up after a fix, re-acquire in ms, power down
+static void hotStart(uint32_t ms)
+{
+  power.onGNSSPower(true, now);
+  now += ms;
+  power.onGNSSFix(true, now);
+  power.onGNSSPower(false, now);
+  now += 60000;
+}
+
+static void test_lead_rises_at_once_and_falls_slowly(void)
+{
+  power.onGNSSPower(true, now);
+  power.onGNSSFix(true, now + 30000);
+  power.onGNSSPower(false, now + 30000);
+  now += 90000;
+
+  hotStart(4000);
+  TEST_ASSERT_EQUAL_UINT32(4000 + GNSS_WARMUP_MARGIN, power.warmup(now));
+  hotStart(8000);
+  TEST_ASSERT_EQUAL_UINT32(8000 + GNSS_WARMUP_MARGIN, power.warmup(now));
+  hotStart(4000);
+  TEST_ASSERT_EQUAL_UINT32(7000 + GNSS_WARMUP_MARGIN, power.warmup(now));
+  for (int i = 0; i < 30; i++)
+  {
+    hotStart(100);
+  }
+  TEST_ASSERT_EQUAL_UINT32(GNSS_WARMUP_MIN, power.warmup(now));
+  hotStart(200000);
+  TEST_ASSERT_EQUAL_UINT32(GNSS_WARMUP_MAX, power.warmup(now));
+  TEST_ASSERT_EQUAL_UINT32(200000, power.stats().starts[GNSS_HOT].maxMs);
+  TEST_ASSERT_EQUAL_UINT32(35, power.stats().gnssStarts);
+}
+
+/*
+ * Emulated SIM808: the UART is only ready MODEM_DTR_WAKE_MS after DTR goes
+ * low, a hot start takes 1.5 to 4 s, a warm one 28 s and a cold one 32 s.
+ */
+struct Sim808
+{
+  bool dtrHigh;
+  unsigned long dtrLowAt;
+  bool gnssOn;
+  unsigned long gnssOnAt;
+  unsigned long ttff;
+  bool everFixed;
+  unsigned long lastFix;
+  uint32_t seed;
+  uint32_t commands;
+  uint32_t lost; // commands sent to a sleeping UART
+
+  bool uartReady(unsigned long at) const { return !dtrHigh && at - dtrLowAt >= MODEM_DTR_WAKE_MS; }
+
+  void command(unsigned long at)
+  {
+    commands++;
+    lost += !uartReady(at);
+  }
+
+  void gnssPower(bool on, unsigned long at)
+  {
+    command(at);
+    gnssOn = on;
+    if (on)
+    {
+      seed = seed * 1103515245UL + 12345UL;
+      gnssOnAt = at;
+      ttff = !everFixed ? 32000 : at - lastFix <= GNSS_HOT_WINDOW ? 1500 + (seed >> 8) % 2500 : 28000;
+    }
+  }
+
+  // +CGNSINF: valid once the engine has re-acquired
+  bool poll(unsigned long at)
+  {
+    command(at);
+    bool valid = gnssOn && at - gnssOnAt >= ttff;
+    if (valid)
+    {
+      everFixed = true;
+      lastFix = at;
+    }
+    return valid;
+  }
+};
+
+// The poll-mode loop of main.cpp: a probe every second while acquiring
+static void test_emulated_modem(void)
+{
+  Sim808 modem;
+  memset(&modem, 0, sizeof(modem));
+  modem.seed = 1;
+  GPSSampler sampler;
+  sampler.begin(now);
+  modem.gnssPower(true, now);
+  power.onGNSSPower(true, now);
+
+  GPSFix fix;
+  clearGPSFix(fix);
+  fix.runStatus = 1;
+  fix.latitude = START_LATITUDE;
+  fix.longitude = START_LONGITUDE;
+  uint32_t fixes = 0;
+  uint32_t notReady = 0;
+  unsigned long lastProbe = 0;
+  unsigned long asleepMs = 0;
+  unsigned long start = now;
+
+  // Four hours parked, then an hour on the move
+  for (; now < start + 5 * 3600000UL; now += STEP_MS)
+  {
+    bool moving = now > start + 4 * 3600000UL;
+    bool due = sampler.isPowered() && sampler.fixDue(now);
+    bool probe = power.isAcquiring() && now - lastProbe >= 1000;
+    if ((due || probe) && power.isAwake())
+    {
+      lastProbe = now;
+      bool valid = modem.poll(now);
+      power.onGNSSFix(valid, now);
+      if (due)
+      {
+        fix.fixStatus = valid;
+        fix.speed = moving ? 40.0f : 0.0f;
+        if (moving)
+        {
+          fix.latitude += 1000;
+        }
+        fixes += valid;
+        notReady += !valid && modem.everFixed;
+        sampler.onFix(fix, now);
+      }
+    }
+
+    sampler.setWarmup(power.warmup(sampler.nextDue()));
+    bool want = sampler.wantsPower(now);
+    if (want != sampler.isPowered())
+    {
+      if (power.isAwake())
+      {
+        modem.gnssPower(want, now);
+        sampler.setPowered(want, now);
+        power.onGNSSPower(want, now);
+      }
+      else
+      {
+        power.requestWake();
+      }
+    }
+
+    uint32_t work = 0;
+    if (!sampler.isPowered())
+    {
+      long untilWarmup = (long)(sampler.nextDue() - sampler.warmup() - now);
+      work = untilWarmup <= 0 ? 0 : untilWarmup;
+    }
+    else if (!power.isAcquiring())
+    {
+      long untilDue = (long)(sampler.nextDue() - now);
+      work = untilDue <= 0 ? 0 : untilDue;
+    }
+    switch (power.update(now, work))
+    {
+    case MODEM_POWER_SLEEP:
+      modem.dtrHigh = true;
+      break;
+    case MODEM_POWER_WAKE:
+      modem.dtrHigh = false;
+      modem.dtrLowAt = now;
+      break;
+    default:
+      break;
+    }
+    asleepMs += modem.dtrHigh ? STEP_MS : 0;
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, modem.lost);
+  TEST_ASSERT_GREATER_THAN(100, fixes);
+  TEST_ASSERT_EQUAL_UINT32(0, notReady);
+  TEST_ASSERT_GREATER_THAN(10, power.stats().starts[GNSS_HOT].count);
+  // Probing keeps the hot-start samples honest, so the lead does not ratchet up
+  TEST_ASSERT_LESS_THAN(10000, power.warmup(now));
+  TEST_ASSERT_GREATER_THAN(5 * 3600000UL / 2, asleepMs);
+
+  StringPrint out;
+  power.printStats(out, now);
+  TEST_ASSERT_TRUE(out.text.find("GNSS hot start:") != std::string::npos);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_before_begin);
+  RUN_TEST(test_sleeps_only_when_quiet_and_enabled);
+  RUN_TEST(test_wakes_ahead_of_scheduled_work);
+  RUN_TEST(test_request_wakes_a_sleeping_modem);
+  RUN_TEST(test_request_while_awake_counts_as_work);
+  RUN_TEST(test_disabling_wakes_the_modem);
+  RUN_TEST(test_start_classes);
+  RUN_TEST(test_lead_rises_at_once_and_falls_slowly);
+  RUN_TEST(test_emulated_modem);
+  return UNITY_END();
+}
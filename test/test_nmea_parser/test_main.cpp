@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "NMEAParser.h"
+#include "HostBench.h"
+
+#define BENCH_BURSTS 20000
+
+static NMEAParser parser;
+
+void setUp(void)
+{
+  parser = NMEAParser();
+}
+
+void tearDown(void)
+{
+}
+
+static bool feedRaw(const char *line)
+{
+  bool published = false;
+  for (const char *c = line; *c; c++)
+  {
+    published |= parser.feed(*c);
+  }
+  return published;
+}
+
+// Frame a sentence body with '$', its checksum and CR LF
+static void frame(const char *body, char *line, size_t size)
+{
+  uint8_t sum = 0;
+  for (const char *c = body; *c; c++)
+  {
+    sum ^= *c;
+  }
+  snprintf(line, size, "$%s*%02X\r\n", body, sum);
+}
+
+static bool feedSentence(const char *body)
+{
+  char line[128];
+  frame(body, line, sizeof(line));
+  return feedRaw(line);
+}
+
+// One burst as AT+CGNSSEQ="RMC" orders it, RMC last
+static const char *const BURST[] = {
+    "GPGGA,123519.000,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,",
+    "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+    "GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45",
+    "GPGSV,2,2,08,15,40,083,46,16,17,308,41,17,07,344,39,18,22,228,45",
+    "GLGSV,1,1,03,65,40,083,46,66,17,308,41,67,07,344,39",
+    "GPRMC,123519.000,A,4807.0380,N,01131.0000,E,022.4,084.4,230324,,,A",
+};
+
+static bool feedBurst()
+{
+  bool published = false;
+  for (size_t i = 0; i < sizeof(BURST) / sizeof(BURST[0]); i++)
+  {
+    published = feedSentence(BURST[i]);
+  }
+  return published;
+}
+
+static void test_full_burst(void)
+{
+  TEST_ASSERT_TRUE(feedBurst());
+  const GPSFix &fix = parser.fix();
+  TEST_ASSERT_EQUAL_UINT32(gpsEpochSeconds(2024, 3, 23, 12, 35, 19), fix.timestamp);
+  TEST_ASSERT_EQUAL_INT32(481173000, fix.latitude);
+  TEST_ASSERT_EQUAL_INT32(115166667, fix.longitude);
+  TEST_ASSERT_EQUAL(1, fix.runStatus);
+  TEST_ASSERT_EQUAL(1, fix.fixStatus);
+  TEST_ASSERT_EQUAL(3, fix.fixMode);
+  TEST_ASSERT_EQUAL(8, fix.satellitesUsed);
+  TEST_ASSERT_EQUAL(11, fix.satellitesInView); // GP and GL summed, the second GP page not counted again
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.9f, fix.hdop);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.5f, fix.pdop);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.1f, fix.vdop);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 545.4f, fix.altitude);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 22.4f * 1.852f, fix.speed);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 84.4f, fix.course);
+  TEST_ASSERT_EQUAL_UINT32(6, parser.sentenceCount());
+  TEST_ASSERT_EQUAL_UINT32(1, parser.fixCount());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.checksumErrors());
+}
+
+static void test_only_rmc_publishes(void)
+{
+  for (size_t i = 0; i + 1 < sizeof(BURST) / sizeof(BURST[0]); i++)
+  {
+    TEST_ASSERT_FALSE(feedSentence(BURST[i]));
+  }
+  TEST_ASSERT_FALSE(feedSentence("GPVTG,084.4,T,,M,022.4,N,041.5,K,A"));
+  TEST_ASSERT_EQUAL_UINT32(0, parser.fixCount());
+  TEST_ASSERT_TRUE(feedSentence(BURST[5]));
+}
+
+static void test_hemispheres(void)
+{
+  TEST_ASSERT_TRUE(feedSentence("GNRMC,000000.000,A,3356.1234,S,15112.5000,W,0.0,0.0,010120,,,A"));
+  // 33 + 56.1234 / 60 and 151 + 12.5 / 60 degrees
+  TEST_ASSERT_EQUAL_INT32(-339353900, parser.fix().latitude);
+  TEST_ASSERT_EQUAL_INT32(-1512083333, parser.fix().longitude);
+  TEST_ASSERT_TRUE(feedSentence("GNRMC,000000.000,A,0000.0001,N,17959.9999,E,0.0,0.0,010120,,,A"));
+  TEST_ASSERT_EQUAL_INT32(17, parser.fix().latitude); // 1e-4 minutes
+  TEST_ASSERT_EQUAL_INT32(1799999983, parser.fix().longitude);
+}
+
+static void test_bad_checksum_is_counted_and_ignored(void)
+{
+  TEST_ASSERT_FALSE(feedRaw("$GPRMC,123519.000,A,4807.0380,N,01131.0000,E,022.4,084.4,230324,,,A*00\r\n"));
+  TEST_ASSERT_FALSE(feedRaw("$GPRMC,123519.000,A,4807.0380,N*\r\n"));  // no checksum digits
+  TEST_ASSERT_FALSE(feedRaw("$GPRMC,123519.000,A,4807.03$GPGGA,,"));  // cut off by the next '$'
+  TEST_ASSERT_EQUAL_UINT32(3, parser.checksumErrors());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.sentenceCount());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.fixCount());
+  parser.reset();
+  TEST_ASSERT_TRUE(feedSentence(BURST[5]));
+}
+
+static void test_empty_fields_read_as_zero(void)
+{
+  TEST_ASSERT_TRUE(feedSentence("GPRMC,123519.000,V,,,,,,,,,,N"));
+  const GPSFix &fix = parser.fix();
+  TEST_ASSERT_EQUAL(0, fix.fixStatus);
+  TEST_ASSERT_EQUAL_INT32(0, fix.latitude);
+  TEST_ASSERT_EQUAL_INT32(0, fix.longitude);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, fix.speed);
+  TEST_ASSERT_EQUAL_UINT32(0, fix.timestamp); // no date
+}
+
+static void test_lost_sentences_do_not_carry_over(void)
+{
+  TEST_ASSERT_TRUE(feedBurst());
+  TEST_ASSERT_GREATER_THAN(0.0f, parser.fix().hdop);
+
+  // Next burst: GGA and GSA corrupted, RMC without a date
+  feedRaw("$GPGGA,123520.000,4807.0390,N,01131.0010,E,1,08,0.9,545.4,M,46.9,M,,*00\r\n");
+  feedRaw("$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*00\r\n");
+  TEST_ASSERT_TRUE(feedSentence("GPRMC,123520.000,A,4807.0390,N,01131.0010,E,022.4,084.4,,,,A"));
+  const GPSFix &fix = parser.fix();
+  TEST_ASSERT_EQUAL_UINT32(0, fix.timestamp);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, fix.hdop);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, fix.pdop);
+  TEST_ASSERT_EQUAL(0, fix.satellitesUsed);
+  TEST_ASSERT_EQUAL(0, fix.satellitesInView);
+  TEST_ASSERT_EQUAL(0, fix.fixMode);
+  TEST_ASSERT_EQUAL_UINT32(2, parser.checksumErrors());
+}
+
+static void test_junk_between_sentences(void)
+{
+  feedRaw("\r\nOK\r\n+CGNSTST: 1\r\n");
+  TEST_ASSERT_TRUE(feedBurst());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.checksumErrors());
+}
+
+static void test_overlong_fields_are_rejected(void)
+{
+  TEST_ASSERT_FALSE(feedSentence("GPRMC,123519.000,A,48070380000000,N,01131.0000,E,022.4,084.4,230394,,,A"));
+  TEST_ASSERT_FALSE(feedSentence("GPRMCXX,123519.000,A"));
+  TEST_ASSERT_EQUAL_UINT32(2, parser.checksumErrors());
+}
+
+static void test_benchmark_sentences_per_second(void)
+{
+  char lines[sizeof(BURST) / sizeof(BURST[0])][128];
+  size_t bytes = 0;
+  for (size_t i = 0; i < sizeof(BURST) / sizeof(BURST[0]); i++)
+  {
+    frame(BURST[i], lines[i], sizeof(lines[i]));
+    bytes += strlen(lines[i]);
+  }
+  uint64_t start = benchNanos();
+  for (int b = 0; b < BENCH_BURSTS; b++)
+  {
+    for (size_t i = 0; i < sizeof(BURST) / sizeof(BURST[0]); i++)
+    {
+      feedRaw(lines[i]);
+    }
+  }
+  double seconds = (benchNanos() - start) / 1e9;
+  TEST_ASSERT_EQUAL_UINT32(BENCH_BURSTS, parser.fixCount());
+  TEST_ASSERT_EQUAL_UINT32(0, parser.checksumErrors());
+  benchReport("NMEA throughput", BENCH_BURSTS * (sizeof(BURST) / sizeof(BURST[0])) / seconds, "sentences/s");
+  benchReport("NMEA parse cost", seconds * 1e9 / (BENCH_BURSTS * bytes), "ns/byte");
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_burst);
+  RUN_TEST(test_only_rmc_publishes);
+  RUN_TEST(test_hemispheres);
+  RUN_TEST(test_bad_checksum_is_counted_and_ignored);
+  RUN_TEST(test_empty_fields_read_as_zero);
+  RUN_TEST(test_lost_sentences_do_not_carry_over);
+  RUN_TEST(test_junk_between_sentences);
+  RUN_TEST(test_overlong_fields_are_rejected);
+  RUN_TEST(test_benchmark_sentences_per_second);
+  return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <unity.h>
+#include <string.h>
+#include "PartialSSD1306.h"
+
+#define PANEL_WIDTH 128
+#define PANEL_HEIGHT 64
+#define PANEL_PAGES (PANEL_HEIGHT / 8)
+#define PANEL_ADDRESS 0x3C
+#define WIRE_MAX I2C_BUFFER_LENGTH // what PartialSSD1306 uses as PARTIAL_WIRE_MAX here
+
+static TwoWire wire;
+static PartialSSD1306 *panel;
+
+void setUp(void)
+{
+  wire = TwoWire();
+  panel = new PartialSSD1306(PANEL_WIDTH, PANEL_HEIGHT, &wire);
+  panel->begin(SSD1306_SWITCHCAPVCC, PANEL_ADDRESS);
+  wire.clear();
+}
+
+void tearDown(void)
+{
+  delete panel;
+  panel = NULL;
+}
+
+static bool isCommands(const TwoWire::Transaction &transaction)
+{
+  return !transaction.bytes.empty() && transaction.bytes[0] == 0x00;
+}
+
+static bool isData(const TwoWire::Transaction &transaction)
+{
+  return !transaction.bytes.empty() && transaction.bytes[0] == 0x40;
+}
+
+// Check one addressing transaction: page and column range
+static void assertAddressing(const TwoWire::Transaction &transaction, uint8_t page, uint8_t first, uint8_t last)
+{
+  const uint8_t expected[] = {0x00, SSD1306_PAGEADDR, page, page, SSD1306_COLUMNADDR, first, last};
+  TEST_ASSERT_EQUAL_UINT8(PANEL_ADDRESS, transaction.address);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(expected), transaction.bytes.size());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, &transaction.bytes[0], sizeof(expected));
+}
+
+/*
+ * Walk the recorded transactions as the panel would: every addressing
+ * round sets a page and column window, the data after it fills the window.
+ * Returns the panel RAM this produces on top of shown.
+ */
+static void replay(uint8_t *shown)
+{
+  int page = -1;
+  int column = 0;
+  int last = -1;
+  for (size_t i = 0; i < wire.transactions.size(); i++)
+  {
+    const TwoWire::Transaction &transaction = wire.transactions[i];
+    if (isCommands(transaction))
+    {
+      TEST_ASSERT_EQUAL_UINT32(7, transaction.bytes.size());
+      page = transaction.bytes[2];
+      column = transaction.bytes[5];
+      last = transaction.bytes[6];
+      continue;
+    }
+    TEST_ASSERT_TRUE(isData(transaction));
+    TEST_ASSERT_TRUE(page >= 0);
+    for (size_t j = 1; j < transaction.bytes.size(); j++)
+    {
+      TEST_ASSERT_TRUE(column <= last);
+      shown[page * PANEL_WIDTH + column++] = transaction.bytes[j];
+    }
+  }
+}
+
+static void test_first_frame_is_full(void)
+{
+  uint8_t *buffer = panel->getBuffer();
+  for (int i = 0; i < PANEL_WIDTH * PANEL_PAGES; i++)
+  {
+    buffer[i] = (uint8_t)(i * 7 + 3);
+  }
+  panel->display();
+
+  uint8_t shown[PANEL_WIDTH * PANEL_PAGES];
+  memset(shown, 0, sizeof(shown));
+  replay(shown);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(buffer, shown, sizeof(shown));
+
+  int page = 0;
+  for (size_t i = 0; i < wire.transactions.size(); i++)
+  {
+    if (isCommands(wire.transactions[i]))
+    {
+      assertAddressing(wire.transactions[i], page++, 0, PANEL_WIDTH - 1);
+    }
+  }
+  TEST_ASSERT_EQUAL(PANEL_PAGES, page);
+  TEST_ASSERT_EQUAL_UINT32(1, panel->stats().fullFrames);
+  TEST_ASSERT_EQUAL_UINT32(PANEL_PAGES, panel->stats().pagesSent);
+}
+
+static void test_unchanged_frame_sends_nothing(void)
+{
+  panel->drawPixel(10, 10, SSD1306_WHITE);
+  panel->display();
+  wire.clear();
+
+  panel->display();
+  TEST_ASSERT_EQUAL_UINT32(0, wire.transactions.size());
+  TEST_ASSERT_EQUAL_UINT16(0, panel->stats().lastBytes);
+  TEST_ASSERT_EQUAL_UINT32(2, panel->stats().frames);
+  TEST_ASSERT_EQUAL_UINT32(1, panel->stats().fullFrames);
+}
+
+static void test_one_byte_change_sends_one_run(void)
+{
+  panel->display();
+  wire.clear();
+
+  panel->drawPixel(77, 3 * 8 + 5, SSD1306_WHITE); // page 3, column 77
+  panel->display();
+
+  TEST_ASSERT_EQUAL_UINT32(2, wire.transactions.size());
+  assertAddressing(wire.transactions[0], 3, 77, 77);
+  TEST_ASSERT_TRUE(isData(wire.transactions[1]));
+  TEST_ASSERT_EQUAL_UINT32(2, wire.transactions[1].bytes.size());
+  TEST_ASSERT_EQUAL_HEX8(1 << 5, wire.transactions[1].bytes[1]);
+  TEST_ASSERT_EQUAL_UINT16(wire.busBytes(), panel->stats().lastBytes);
+  TEST_ASSERT_EQUAL_UINT16(8 + 3, panel->stats().lastBytes);
+}
+
+static void test_changes_on_a_page_are_one_run(void)
+{
+  panel->display();
+  wire.clear();
+
+  panel->drawPixel(10, 1, SSD1306_WHITE);
+  panel->drawPixel(20, 6, SSD1306_WHITE);
+  panel->drawPixel(100, 7 * 8, SSD1306_WHITE);
+  panel->display();
+
+  TEST_ASSERT_EQUAL_UINT32(4, wire.transactions.size());
+  assertAddressing(wire.transactions[0], 0, 10, 20);
+  TEST_ASSERT_EQUAL_UINT32(1 + 11, wire.transactions[1].bytes.size());
+  assertAddressing(wire.transactions[2], 7, 100, 100);
+  TEST_ASSERT_EQUAL_UINT32(2, panel->stats().pagesSent - PANEL_PAGES);
+}
+
+static void test_data_is_chunked_under_the_wire_buffer(void)
+{
+  panel->display();
+
+  TEST_ASSERT_EQUAL_UINT32(0, wire.overflows);
+  size_t dataTransactions = 0;
+  for (size_t i = 0; i < wire.transactions.size(); i++)
+  {
+    TEST_ASSERT_TRUE(wire.transactions[i].bytes.size() <= WIRE_MAX);
+    if (isData(wire.transactions[i]))
+      dataTransactions++;
+  }
+  // A 128-byte page needs two writes when one holds WIRE_MAX - 1 data bytes
+  size_t perPage = (PANEL_WIDTH + WIRE_MAX - 2) / (WIRE_MAX - 1);
+  TEST_ASSERT_EQUAL_UINT32(PANEL_PAGES * perPage, dataTransactions);
+}
+
+static void test_invalidate_resends_the_frame(void)
+{
+  panel->display();
+  panel->display();
+  wire.clear();
+
+  panel->invalidate();
+  panel->display();
+  TEST_ASSERT_EQUAL_UINT32(2, panel->stats().fullFrames);
+  uint8_t shown[PANEL_WIDTH * PANEL_PAGES];
+  memset(shown, 0xA5, sizeof(shown));
+  replay(shown);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0, shown, sizeof(shown));
+}
+
+static void test_byte_count_matches_the_bus(void)
+{
+  size_t total = 0;
+  for (int frame = 0; frame < 20; frame++)
+  {
+    wire.clear();
+    panel->drawPixel((frame * 37) % PANEL_WIDTH, (frame * 11) % PANEL_HEIGHT, SSD1306_INVERSE);
+    panel->display();
+    TEST_ASSERT_EQUAL_UINT16(wire.busBytes(), panel->stats().lastBytes);
+    total += wire.busBytes();
+  }
+  TEST_ASSERT_EQUAL_UINT32(total, panel->stats().bytes);
+}
+
+static void test_clock_is_raised_and_restored(void)
+{
+  panel->drawPixel(0, 0, SSD1306_WHITE);
+  panel->display();
+  TEST_ASSERT_EQUAL_UINT32(2, wire.clockChanges);
+  TEST_ASSERT_EQUAL_UINT32(100000, wire.clock);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_frame_is_full);
+  RUN_TEST(test_unchanged_frame_sends_nothing);
+  RUN_TEST(test_one_byte_change_sends_one_run);
+  RUN_TEST(test_changes_on_a_page_are_one_run);
+  RUN_TEST(test_data_is_chunked_under_the_wire_buffer);
+  RUN_TEST(test_invalidate_resends_the_frame);
+  RUN_TEST(test_byte_count_matches_the_bus);
+  RUN_TEST(test_clock_is_raised_and_restored);
+  return UNITY_END();
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+#include "PowerGovernor.h"
+
+static PowerGovernor governor;
+
+void setUp(void)
+{
+  governor = PowerGovernor();
+}
+
+void tearDown(void)
+{
+}
+
+static void test_first_update_picks_a_profile(void)
+{
+  TEST_ASSERT_TRUE(governor.update(45, false, 0));
+  TEST_ASSERT_EQUAL(POWER_BALANCED, governor.profile());
+  TEST_ASSERT_FALSE(governor.update(45, false, 1000));
+  TEST_ASSERT_EQUAL_UINT32(0, governor.stats().switches);
+}
+
+static void test_profiles_follow_the_thresholds(void)
+{
+  governor.update(100, false, 0);
+  TEST_ASSERT_EQUAL(POWER_FULL, governor.profile());
+  governor.update(POWER_BALANCED_BELOW - 1, false, 0);
+  TEST_ASSERT_EQUAL(POWER_BALANCED, governor.profile());
+  governor.update(POWER_SAVER_BELOW - 1, false, 0);
+  TEST_ASSERT_EQUAL(POWER_SAVER, governor.profile());
+  governor.update(POWER_CRITICAL_BELOW - 1, false, 0);
+  TEST_ASSERT_EQUAL(POWER_CRITICAL, governor.profile());
+  governor.update(0, false, 0);
+  TEST_ASSERT_EQUAL(POWER_CRITICAL, governor.profile());
+}
+
+static void test_a_big_drop_skips_profiles(void)
+{
+  governor.update(90, false, 0);
+  TEST_ASSERT_TRUE(governor.update(5, false, 1000));
+  TEST_ASSERT_EQUAL(POWER_CRITICAL, governor.profile());
+}
+
+static void test_stepping_up_needs_headroom(void)
+{
+  governor.update(POWER_SAVER_BELOW - 1, false, 0);
+  TEST_ASSERT_EQUAL(POWER_SAVER, governor.profile());
+  // Sagging and recovering around the threshold does not flip profiles
+  TEST_ASSERT_FALSE(governor.update(POWER_SAVER_BELOW, false, 1000));
+  TEST_ASSERT_FALSE(governor.update(POWER_SAVER_BELOW + POWER_HYSTERESIS - 1, false, 2000));
+  TEST_ASSERT_EQUAL(POWER_SAVER, governor.profile());
+  TEST_ASSERT_TRUE(governor.update(POWER_SAVER_BELOW + POWER_HYSTERESIS, false, 3000));
+  TEST_ASSERT_EQUAL(POWER_BALANCED, governor.profile());
+}
+
+static void test_recovery_in_one_jump_lands_one_step_short(void)
+{
+  // From critical straight to just above the balanced floor: full would
+  // need the headroom, balanced does not
+  governor.update(5, false, 0);
+  governor.update(POWER_BALANCED_BELOW + 1, false, 1000);
+  TEST_ASSERT_EQUAL(POWER_BALANCED, governor.profile());
+}
+
+static void test_charging_is_full_power(void)
+{
+  governor.update(3, false, 0);
+  TEST_ASSERT_TRUE(governor.update(3, true, 1000));
+  TEST_ASSERT_EQUAL(POWER_FULL, governor.profile());
+  TEST_ASSERT_TRUE(governor.update(3, false, 2000));
+  TEST_ASSERT_EQUAL(POWER_CRITICAL, governor.profile());
+}
+
+static void test_settings_get_leaner_down_the_profiles(void)
+{
+  for (uint8_t p = POWER_FULL + 1; p < POWER_PROFILE_COUNT; p++)
+  {
+    const PowerSettings &better = PowerGovernor::settingsFor((PowerProfile)(p - 1));
+    const PowerSettings &worse = PowerGovernor::settingsFor((PowerProfile)p);
+    TEST_ASSERT_LESS_THAN(better.floorPercent, worse.floorPercent);
+    TEST_ASSERT_GREATER_OR_EQUAL(better.gpsMinInterval, worse.gpsMinInterval);
+    TEST_ASSERT_GREATER_OR_EQUAL(better.uplinkBatch, worse.uplinkBatch);
+    TEST_ASSERT_LESS_THAN(better.averageMa, worse.averageMa);
+  }
+  TEST_ASSERT_EQUAL(0, PowerGovernor::settingsFor(POWER_CRITICAL).floorPercent);
+  TEST_ASSERT_FALSE(PowerGovernor::settingsFor(POWER_CRITICAL).displayOn);
+}
+
+static void test_time_in_each_profile(void)
+{
+  governor.update(80, false, 1000);
+  governor.update(50, false, 61000);
+  governor.update(20, false, 91000);
+  TEST_ASSERT_EQUAL_UINT32(2, governor.stats().switches);
+  TEST_ASSERT_EQUAL_UINT32(60000, governor.stats().msIn[POWER_FULL]);
+  TEST_ASSERT_EQUAL_UINT32(30000, governor.stats().msIn[POWER_BALANCED]);
+  TEST_ASSERT_EQUAL_UINT32(0, governor.stats().msIn[POWER_SAVER]);
+
+  StringPrint out;
+  governor.printStats(out, 101000);
+  TEST_ASSERT_TRUE(out.text.find("saver profile, 2 switches") != std::string::npos);
+  TEST_ASSERT_TRUE(out.text.find("saver    10 s") != std::string::npos);
+}
+
+static void test_projected_minutes_walk_down_the_profiles(void)
+{
+  // 26 mAh per percent: 40% at 180 mA, 30% at 125, 20% at 70, 10% at 40
+  TEST_ASSERT_EQUAL_UINT32(346 + 374 + 445 + 390, PowerGovernor::projectedMinutes(100));
+  TEST_ASSERT_EQUAL_UINT32(PowerGovernor::projectedMinutes(100), PowerGovernor::projectedMinutes(255));
+  TEST_ASSERT_EQUAL_UINT32(195, PowerGovernor::projectedMinutes(5));
+  TEST_ASSERT_EQUAL_UINT32(0, PowerGovernor::projectedMinutes(0));
+  uint32_t previous = 0;
+  for (uint8_t p = 1; p <= 100; p++)
+  {
+    uint32_t minutes = PowerGovernor::projectedMinutes(p);
+    TEST_ASSERT_GREATER_THAN(previous, minutes);
+    previous = minutes;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_update_picks_a_profile);
+  RUN_TEST(test_profiles_follow_the_thresholds);
+  RUN_TEST(test_a_big_drop_skips_profiles);
+  RUN_TEST(test_stepping_up_needs_headroom);
+  RUN_TEST(test_recovery_in_one_jump_lands_one_step_short);
+  RUN_TEST(test_charging_is_full_power);
+  RUN_TEST(test_settings_get_leaner_down_the_profiles);
+  RUN_TEST(test_time_in_each_profile);
+  RUN_TEST(test_projected_minutes_walk_down_the_profiles);
+  return UNITY_END();
+}
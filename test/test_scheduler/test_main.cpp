@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <string.h>
+#include "Scheduler.h"
+
+// Virtual microsecond clock, each job moves it on by its run time
+static uint32_t clockUs;
+static char order[16];
+static uint8_t orderLength;
+
+static uint32_t virtualClock()
+{
+  return clockUs;
+}
+
+struct FakeJob
+{
+  char tag;
+  uint32_t runUs;
+};
+
+static void fakeJob(void *context)
+{
+  FakeJob *job = (FakeJob *)context;
+  if (orderLength < sizeof(order) - 1)
+  {
+    order[orderLength++] = job->tag;
+  }
+  clockUs += job->runUs;
+}
+
+static Scheduler scheduler(virtualClock);
+static FakeJob a = {'a', 0};
+static FakeJob b = {'b', 0};
+
+void setUp(void)
+{
+  clockUs = 1000000;
+  memset(order, 0, sizeof(order));
+  orderLength = 0;
+  a.runUs = 0;
+  b.runUs = 0;
+  scheduler = Scheduler(virtualClock);
+}
+
+void tearDown(void)
+{
+}
+
+static void test_add_rejects_bad_jobs(void)
+{
+  TEST_ASSERT_EQUAL(-1, scheduler.add("none", 10, 0, NULL));
+  TEST_ASSERT_EQUAL(-1, scheduler.add("zero", 0, 0, fakeJob, &a));
+  for (int i = 0; i < SCHEDULER_MAX_JOBS; i++)
+  {
+    TEST_ASSERT_EQUAL(i, scheduler.add("job", 10, 0, fakeJob, &a));
+  }
+  TEST_ASSERT_EQUAL(-1, scheduler.add("full", 10, 0, fakeJob, &a));
+  TEST_ASSERT_EQUAL(SCHEDULER_MAX_JOBS, scheduler.jobCount());
+}
+
+static void test_idle_without_jobs(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE_MS, scheduler.runDue());
+}
+
+static void test_first_delay_and_sleep(void)
+{
+  int id = scheduler.add("a", 100, 0, fakeJob, &a, 50);
+  TEST_ASSERT_EQUAL_UINT32(50, scheduler.runDue());
+  clockUs += 49500;
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.runDue()); // rounded up, never early
+  clockUs += 500;
+  TEST_ASSERT_EQUAL_UINT32(100, scheduler.runDue());
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats(id).runs);
+}
+
+static void test_earliest_deadline_runs_first(void)
+{
+  scheduler.add("a", 100, 0, fakeJob, &a, 30);
+  scheduler.add("b", 100, 0, fakeJob, &b, 20);
+  clockUs += 40000;
+  scheduler.runDue();
+  TEST_ASSERT_EQUAL_STRING("ba", order);
+}
+
+static void test_overrun_skips_the_periods_it_covered(void)
+{
+  a.runUs = 2000; // twice its period
+  int id = scheduler.add("a", 1, 0, fakeJob, &a);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.runDue());
+  TEST_ASSERT_EQUAL_STRING("a", order);
+  TEST_ASSERT_EQUAL_UINT32(2, scheduler.stats(id).skipped);
+}
+
+static void test_late_job_skips_to_the_grid(void)
+{
+  int id = scheduler.add("a", 10, 0, fakeJob, &a);
+  clockUs += 35000;
+  TEST_ASSERT_EQUAL_UINT32(5, scheduler.runDue());
+  TEST_ASSERT_EQUAL_UINT32(3, scheduler.stats(id).skipped);
+  TEST_ASSERT_EQUAL_UINT32(35000, scheduler.stats(id).maxLateUs);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats(id).late[10]); // 32768 to 65536 us
+}
+
+static void test_run_time_and_budget(void)
+{
+  int id = scheduler.add("a", 10, 150, fakeJob, &a);
+  a.runUs = 100;
+  scheduler.runDue();
+  clockUs += 10000;
+  a.runUs = 200;
+  scheduler.runDue();
+  const SchedulerJobStats &stats = scheduler.stats(id);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.runs);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+  TEST_ASSERT_EQUAL_UINT32(200, stats.maxRunUs);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.run[1]); // 64 to 128 us
+  TEST_ASSERT_EQUAL_UINT32(1, stats.run[2]); // 128 to 256 us
+}
+
+static void test_set_period_applies_after_the_next_run(void)
+{
+  int id = scheduler.add("a", 10, 0, fakeJob, &a);
+  scheduler.setPeriod(id, 50);
+  TEST_ASSERT_EQUAL_UINT32(50, scheduler.runDue());
+  scheduler.setPeriod(id, 0);
+  scheduler.setPeriod(7, 20);
+  clockUs += 50000;
+  TEST_ASSERT_EQUAL_UINT32(50, scheduler.runDue());
+}
+
+static void test_deadlines_survive_the_clock_wrap(void)
+{
+  clockUs = 0xFFFFFFFFUL - 25000;
+  int id = scheduler.add("a", 10, 0, fakeJob, &a);
+  for (int i = 0; i < 6; i++)
+  {
+    scheduler.runDue();
+    clockUs += 10000;
+  }
+  TEST_ASSERT_EQUAL_UINT32(6, scheduler.stats(id).runs);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats(id).skipped);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats(id).maxLateUs);
+}
+
+static void test_histograms_count_past_16_bits(void)
+{
+  int id = scheduler.add("a", 1, 0, fakeJob, &a);
+  for (uint32_t i = 0; i < 70000; i++)
+  {
+    scheduler.runDue();
+    clockUs += 1000;
+  }
+  TEST_ASSERT_EQUAL_UINT32(70000, scheduler.stats(id).runs);
+  TEST_ASSERT_EQUAL_UINT32(70000, scheduler.stats(id).late[0]);
+  TEST_ASSERT_EQUAL_UINT32(70000, scheduler.stats(id).run[0]);
+}
+
+static void test_percentiles(void)
+{
+  uint32_t histogram[SCHEDULER_BUCKETS] = {0};
+  TEST_ASSERT_EQUAL_UINT32(0, Scheduler::percentileUs(histogram, 50));
+  histogram[0] = 70000;
+  histogram[3] = 1000;
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_BUCKET_US, Scheduler::percentileUs(histogram, 50));
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_BUCKET_US << 3, Scheduler::percentileUs(histogram, 99));
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_BUCKET_US << 3, Scheduler::percentileUs(histogram, 100));
+
+  // A total that does not fit in 32 bits
+  histogram[0] = 3000000000UL;
+  histogram[1] = 3000000000UL;
+  histogram[3] = 0;
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_BUCKET_US, Scheduler::percentileUs(histogram, 50));
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_BUCKET_US << 1, Scheduler::percentileUs(histogram, 51));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_add_rejects_bad_jobs);
+  RUN_TEST(test_idle_without_jobs);
+  RUN_TEST(test_first_delay_and_sleep);
+  RUN_TEST(test_earliest_deadline_runs_first);
+  RUN_TEST(test_overrun_skips_the_periods_it_covered);
+  RUN_TEST(test_late_job_skips_to_the_grid);
+  RUN_TEST(test_run_time_and_budget);
+  RUN_TEST(test_set_period_applies_after_the_next_run);
+  RUN_TEST(test_deadlines_survive_the_clock_wrap);
+  RUN_TEST(test_histograms_count_past_16_bits);
+  RUN_TEST(test_percentiles);
+  return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <unity.h>
+#include <string.h>
+#include "TelemetryCodec.h"
+
+#define FIXES 20
+
+static StoredFix fixes[FIXES];
+static StoredFix decoded[FIXES];
+static uint8_t buffer[TELEMETRY_BATCH_MAX(FIXES)];
+
+// A train heading north-east at about 60 km/h, one fix every 5 s
+void setUp(void)
+{
+  memset(fixes, 0, sizeof(fixes));
+  memset(decoded, 0, sizeof(decoded));
+  for (int i = 0; i < FIXES; i++)
+  {
+    StoredFix &fix = fixes[i];
+    fix.timestamp = 1700000000UL + i * 5;
+    fix.latitude = 69271234 + i * 620;
+    fix.longitude = 798612345 + i * 410;
+    fix.altitude = 10 + i % 3;
+    fix.speed = 600 + i * 3;
+    fix.course = 4500 + (i % 4) * 100;
+    fix.hdop = 9 + (i % 5 == 0);
+    fix.satellitesUsed = 7;
+    fix.satellitesInView = 11;
+    fix.flags = FIXLOG_FLAG_VALID;
+  }
+}
+
+void tearDown(void)
+{
+}
+
+// Course is sent in 0.1 degree steps and satellitesInView not at all
+static void assertSame(const StoredFix &expected, const StoredFix &actual)
+{
+  TEST_ASSERT_EQUAL_UINT32(expected.timestamp, actual.timestamp);
+  TEST_ASSERT_EQUAL_INT32(expected.latitude, actual.latitude);
+  TEST_ASSERT_EQUAL_INT32(expected.longitude, actual.longitude);
+  TEST_ASSERT_EQUAL_INT16(expected.altitude, actual.altitude);
+  TEST_ASSERT_EQUAL_UINT16(expected.speed, actual.speed);
+  TEST_ASSERT_EQUAL_UINT16(expected.course / 10 * 10, actual.course);
+  TEST_ASSERT_EQUAL_UINT8(expected.hdop, actual.hdop);
+  TEST_ASSERT_EQUAL_UINT8(expected.satellitesUsed, actual.satellitesUsed);
+  TEST_ASSERT_EQUAL_UINT8(expected.flags, actual.flags);
+}
+
+static int roundTrip(uint16_t count, uint8_t fieldMask, size_t *length)
+{
+  *length = encodeTelemetryBatch(fixes, count, fieldMask, buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(*length > 0);
+  return decodeTelemetryBatch(buffer, *length, decoded, FIXES);
+}
+
+static void test_round_trip(void)
+{
+  size_t length;
+  TEST_ASSERT_EQUAL(FIXES, roundTrip(FIXES, TELEMETRY_ALL_FIELDS, &length));
+  for (int i = 0; i < FIXES; i++)
+  {
+    assertSame(fixes[i], decoded[i]);
+  }
+  // The point of the encoding: well under half of the 24-byte StoredFix
+  TEST_ASSERT_LESS_THAN(FIXES * sizeof(StoredFix) / 2, length);
+}
+
+static void test_extremes_round_trip(void)
+{
+  fixes[1].latitude = -900000000;
+  fixes[2].latitude = 900000000;
+  fixes[3].longitude = -1800000000;
+  fixes[4].longitude = 1800000000; // across the antimeridian from the previous fix
+  fixes[5].altitude = INT16_MIN;
+  fixes[6].altitude = INT16_MAX;
+  fixes[7].speed = UINT16_MAX;
+  fixes[8].speed = 0;
+  fixes[9].course = 35990;
+  fixes[10].course = 0; // short turn over north
+  fixes[11].timestamp = fixes[10].timestamp - 60; // clock step backwards
+  fixes[12].flags = 0;
+  fixes[13].hdop = 255;
+
+  size_t length;
+  TEST_ASSERT_EQUAL(FIXES, roundTrip(FIXES, TELEMETRY_ALL_FIELDS, &length));
+  for (int i = 0; i < FIXES; i++)
+  {
+    assertSame(fixes[i], decoded[i]);
+  }
+}
+
+static void test_fields_left_out_of_the_mask(void)
+{
+  size_t length;
+  TEST_ASSERT_EQUAL(FIXES, roundTrip(FIXES, 0, &length));
+  for (int i = 0; i < FIXES; i++)
+  {
+    TEST_ASSERT_EQUAL_INT32(fixes[i].latitude, decoded[i].latitude);
+    TEST_ASSERT_EQUAL_UINT16(0, decoded[i].course);
+    TEST_ASSERT_EQUAL_UINT8(0, decoded[i].hdop);
+    TEST_ASSERT_EQUAL_UINT8(FIXLOG_FLAG_VALID, decoded[i].flags);
+  }
+}
+
+static void test_empty_batch(void)
+{
+  size_t length;
+  TEST_ASSERT_EQUAL(0, roundTrip(0, TELEMETRY_ALL_FIELDS, &length));
+}
+
+static void test_encode_reports_a_short_buffer(void)
+{
+  size_t needed = encodeTelemetryBatch(fixes, FIXES, TELEMETRY_ALL_FIELDS, buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL(0, encodeTelemetryBatch(fixes, FIXES, TELEMETRY_ALL_FIELDS, buffer, needed - 1));
+}
+
+static void test_truncated_batches_are_rejected(void)
+{
+  size_t length = encodeTelemetryBatch(fixes, FIXES, TELEMETRY_ALL_FIELDS, buffer, sizeof(buffer));
+  for (size_t cut = 0; cut < length; cut++)
+  {
+    TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, cut, decoded, FIXES));
+  }
+}
+
+static void test_more_fixes_than_room_is_rejected(void)
+{
+  size_t length = encodeTelemetryBatch(fixes, FIXES, TELEMETRY_ALL_FIELDS, buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, length, decoded, FIXES - 1));
+}
+
+static void test_bad_header_is_rejected(void)
+{
+  size_t length = encodeTelemetryBatch(fixes, FIXES, TELEMETRY_ALL_FIELDS, buffer, sizeof(buffer));
+  buffer[0] = TELEMETRY_VERSION + 1;
+  TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, length, decoded, FIXES));
+  buffer[0] = TELEMETRY_VERSION;
+  buffer[1] = 0x80; // unknown field
+  TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, length, decoded, FIXES));
+}
+
+// Batch header with zero bases for count fixes, returns its length
+static size_t header(uint8_t count)
+{
+  size_t n = 0;
+  buffer[n++] = TELEMETRY_VERSION;
+  buffer[n++] = TELEMETRY_HAS_COURSE;
+  buffer[n++] = count;
+  memset(buffer + n, 0, 12);
+  return n + 12;
+}
+
+// Zigzag varint of the largest positive int32 delta
+static size_t putMaxDelta(size_t n)
+{
+  static const uint8_t MAX_DELTA[] = {0xFE, 0xFF, 0xFF, 0xFF, 0x0F};
+  memcpy(buffer + n, MAX_DELTA, sizeof(MAX_DELTA));
+  return n + sizeof(MAX_DELTA);
+}
+
+static void test_overflowing_altitude_is_rejected(void)
+{
+  // Two fixes each adding INT32_MAX to the altitude: would wrap in 32 bits
+  size_t n = header(2);
+  for (int i = 0; i < 2; i++)
+  {
+    buffer[n++] = 0; // presence
+    buffer[n++] = 0; // time
+    buffer[n++] = 0; // latitude
+    buffer[n++] = 0; // longitude
+    n = putMaxDelta(n);
+    buffer[n++] = 0; // speed
+  }
+  TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, n, decoded, FIXES));
+}
+
+static void test_negative_speed_is_rejected(void)
+{
+  size_t n = header(1);
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 1; // speed -1
+  TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, n, decoded, FIXES));
+}
+
+static void test_long_course_turn_is_rejected(void)
+{
+  size_t n = header(1);
+  buffer[n++] = TELEMETRY_HAS_COURSE;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  buffer[n++] = 0;
+  n = putMaxDelta(n);
+  TEST_ASSERT_EQUAL(-1, decodeTelemetryBatch(buffer, n, decoded, FIXES));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_extremes_round_trip);
+  RUN_TEST(test_fields_left_out_of_the_mask);
+  RUN_TEST(test_empty_batch);
+  RUN_TEST(test_encode_reports_a_short_buffer);
+  RUN_TEST(test_truncated_batches_are_rejected);
+  RUN_TEST(test_more_fixes_than_room_is_rejected);
+  RUN_TEST(test_bad_header_is_rejected);
+  RUN_TEST(test_overflowing_altitude_is_rejected);
+  RUN_TEST(test_negative_speed_is_rejected);
+  RUN_TEST(test_long_course_turn_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,930 @@
+/*
+ * Fixture for the simplifier: the fixes a parcel logs from Colombo Fort to
+ * Ragama on the Main Line, 17 km in 33 minutes.
+ *
+ * Synthesized rather than captured in the field: a spline through the
+ * station coordinates of include/Stations.h, run with station dwells,
+ * 0.5 m/s2 acceleration and up to 58 km/h, and sampled the way GPSSampler
+ * polls (30 m apart while moving, backing off towards 5 minutes when
+ * still). The fixes carry correlated GNSS noise of about 1.5 m, a few 15 m
+ * multipath jumps and a 30 s outage, and six decimals like the SIM808
+ * reports. Swap in a field log when one is available; the tests only rely
+ * on the count in RECORDED_TRACK_COUNT.
+ */
+
+#ifndef RecordedTrack_h
+#define RecordedTrack_h
+
+#include <stdint.h>
+
+#define RECORDED_TRACK_START 1710490000UL // 2024-03-15 08:06:40 UTC
+
+struct RecordedFix
+{
+  uint16_t second;   // from RECORDED_TRACK_START
+  int32_t latitude;  // 1e-7 degrees
+  int32_t longitude;
+};
+
+static const RecordedFix RECORDED_TRACK[] = {
+    {0, 69337560, 798506450},
+    {1, 69337600, 798506330},
+    {2, 69337640, 798506310},
+    {32, 69337410, 798506460},
+    {92, 69337420, 798506510},
+    {212, 69298920, 798611780},
+    {213, 69298560, 798613180},
+    {214, 69297990, 798614460},
+    {215, 69297590, 798615720},
+    {216, 69297100, 798617070},
+    {217, 69296310, 798618990},
+    {218, 69296130, 798619830},
+    {219, 69295780, 798621280},
+    {220, 69295350, 798622710},
+    {221, 69294970, 798624060},
+    {222, 69294490, 798625440},
+    {223, 69294060, 798626900},
+    {224, 69293590, 798628270},
+    {225, 69293180, 798629660},
+    {226, 69292770, 798630950},
+    {227, 69292320, 798632320},
+    {229, 69291750, 798634830},
+    {231, 69291240, 798637060},
+    {233, 69290780, 798639220},
+    {235, 69290470, 798641120},
+    {237, 69290240, 798642860},
+    {240, 69290020, 798645190},
+    {243, 69290000, 798647000},
+    {247, 69290070, 798648830},
+    {253, 69290020, 798650170},
+    {283, 69289890, 798650030},
+    {284, 69289880, 798649990},
+    {285, 69289950, 798650000},
+    {315, 69289910, 798650080},
+    {375, 69295190, 798670720},
+    {377, 69296050, 798672460},
+    {379, 69297070, 798674310},
+    {381, 69297950, 798676050},
+    {383, 69298960, 798677890},
+    {385, 69300100, 798679580},
+    {387, 69301140, 798681180},
+    {389, 69302150, 798682810},
+    {391, 69303170, 798684530},
+    {393, 69304410, 798686170},
+    {395, 69305630, 798687830},
+    {397, 69306860, 798689370},
+    {399, 69308070, 798690940},
+    {401, 69309320, 798692500},
+    {403, 69310600, 798693940},
+    {405, 69311810, 798695450},
+    {407, 69313130, 798696980},
+    {409, 69314330, 798698470},
+    {411, 69315570, 798700140},
+    {413, 69316750, 798701610},
+    {415, 69318060, 798703200},
+    {417, 69319320, 798704750},
+    {419, 69320470, 798706290},
+    {421, 69321780, 798707740},
+    {423, 69322990, 798709230},
+    {425, 69324150, 798710780},
+    {427, 69325380, 798712370},
+    {429, 69326490, 798713970},
+    {431, 69327780, 798715610},
+    {433, 69329120, 798717180},
+    {435, 69330840, 798719190},
+    {437, 69331840, 798720090},
+    {439, 69333180, 798721390},
+    {441, 69334590, 798722810},
+    {443, 69336100, 798724150},
+    {445, 69337550, 798725420},
+    {447, 69339090, 798726620},
+    {449, 69340640, 798727940},
+    {451, 69342300, 798729080},
+    {453, 69343710, 798730300},
+    {455, 69345370, 798731600},
+    {457, 69346770, 798732700},
+    {459, 69348480, 798733950},
+    {461, 69349910, 798735110},
+    {463, 69351470, 798736170},
+    {465, 69353110, 798737570},
+    {467, 69354700, 798738830},
+    {469, 69356160, 798740130},
+    {471, 69357730, 798741530},
+    {473, 69359160, 798742800},
+    {475, 69360520, 798744300},
+    {477, 69362070, 798745780},
+    {479, 69363440, 798747100},
+    {481, 69364860, 798748460},
+    {483, 69366140, 798749880},
+    {485, 69367520, 798751350},
+    {487, 69368790, 798752910},
+    {489, 69370060, 798754430},
+    {491, 69371340, 798755940},
+    {493, 69372500, 798757610},
+    {495, 69373700, 798759160},
+    {497, 69374810, 798760840},
+    {499, 69375930, 798762280},
+    {501, 69376930, 798763740},
+    {504, 69378090, 798765730},
+    {507, 69379090, 798767310},
+    {511, 69380200, 798769000},
+    {517, 69381030, 798769860},
+    {546, 69381070, 798770150},
+    {547, 69381020, 798770210},
+    {548, 69381030, 798770180},
+    {578, 69381030, 798769940},
+    {638, 69392630, 798789480},
+    {639, 69393370, 798790750},
+    {640, 69394030, 798792010},
+    {641, 69394720, 798793250},
+    {642, 69395350, 798794600},
+    {643, 69396080, 798795910},
+    {644, 69396800, 798797200},
+    {645, 69397620, 798798430},
+    {646, 69398210, 798799580},
+    {647, 69399090, 798800740},
+    {648, 69399840, 798801950},
+    {649, 69400550, 798803260},
+    {650, 69401230, 798804560},
+    {651, 69401920, 798805830},
+    {652, 69402540, 798807060},
+    {653, 69403290, 798808270},
+    {654, 69404020, 798809540},
+    {655, 69404770, 798810680},
+    {656, 69405430, 798811950},
+    {657, 69406080, 798813230},
+    {658, 69406790, 798814530},
+    {659, 69407470, 798815770},
+    {660, 69408100, 798817020},
+    {661, 69408630, 798818310},
+    {662, 69409240, 798819570},
+    {663, 69409950, 798820830},
+    {664, 69410630, 798822120},
+    {665, 69411310, 798823380},
+    {666, 69411970, 798824640},
+    {667, 69412650, 798825960},
+    {668, 69413430, 798827300},
+    {669, 69414180, 798828470},
+    {670, 69414950, 798829740},
+    {671, 69415510, 798831070},
+    {672, 69416200, 798832410},
+    {673, 69416910, 798833650},
+    {674, 69417580, 798834910},
+    {675, 69418210, 798836240},
+    {676, 69418890, 798837610},
+    {677, 69419540, 798838910},
+    {678, 69420090, 798840180},
+    {679, 69420730, 798841430},
+    {680, 69421450, 798842800},
+    {681, 69422140, 798844050},
+    {682, 69422750, 798845410},
+    {683, 69423340, 798846740},
+    {684, 69423960, 798848010},
+    {685, 69424560, 798849250},
+    {686, 69425180, 798850790},
+    {687, 69425810, 798852090},
+    {688, 69426500, 798853350},
+    {689, 69427130, 798854620},
+    {690, 69427690, 798855850},
+    {691, 69428310, 798857140},
+    {692, 69428940, 798858420},
+    {693, 69429560, 798859640},
+    {694, 69430200, 798860990},
+    {695, 69430900, 798862300},
+    {696, 69431580, 798863640},
+    {697, 69432230, 798864940},
+    {698, 69432920, 798866200},
+    {699, 69433670, 798868550},
+    {700, 69434270, 798868730},
+    {701, 69434880, 798870070},
+    {702, 69435450, 798871420},
+    {703, 69436060, 798872680},
+    {704, 69436650, 798873950},
+    {705, 69437220, 798875180},
+    {706, 69437850, 798876510},
+    {707, 69438470, 798877770},
+    {708, 69439030, 798879070},
+    {709, 69439650, 798880390},
+    {710, 69440230, 798881700},
+    {711, 69440840, 798883080},
+    {712, 69441400, 798884460},
+    {713, 69442020, 798885770},
+    {714, 69442580, 798887060},
+    {715, 69443060, 798888310},
+    {716, 69443690, 798889670},
+    {717, 69444210, 798891030},
+    {718, 69444820, 798892310},
+    {719, 69445520, 798893650},
+    {720, 69446150, 798894970},
+    {721, 69446720, 798896250},
+    {722, 69447380, 798897500},
+    {723, 69448010, 798898790},
+    {724, 69448620, 798900170},
+    {725, 69449280, 798901460},
+    {726, 69449820, 798902890},
+    {727, 69450420, 798904210},
+    {728, 69451020, 798905570},
+    {729, 69451520, 798906920},
+    {730, 69452060, 798908210},
+    {731, 69452630, 798909640},
+    {732, 69453260, 798911000},
+    {733, 69453870, 798912350},
+    {734, 69454450, 798913710},
+    {735, 69455020, 798915090},
+    {736, 69455480, 798916320},
+    {737, 69456010, 798917550},
+    {738, 69456560, 798918950},
+    {739, 69457210, 798920210},
+    {740, 69457640, 798921600},
+    {741, 69458090, 798922880},
+    {742, 69458610, 798924250},
+    {743, 69459110, 798925690},
+    {744, 69459660, 798927060},
+    {745, 69460160, 798928380},
+    {746, 69460650, 798929730},
+    {747, 69461250, 798931100},
+    {748, 69461740, 798932400},
+    {749, 69462180, 798933720},
+    {750, 69462680, 798935090},
+    {751, 69463100, 798936480},
+    {752, 69463540, 798937810},
+    {753, 69464070, 798939170},
+    {754, 69464610, 798940600},
+    {755, 69464960, 798941980},
+    {756, 69465350, 798943310},
+    {757, 69465950, 798944660},
+    {758, 69466330, 798946010},
+    {759, 69466710, 798947550},
+    {760, 69467110, 798948980},
+    {761, 69467600, 798950410},
+    {762, 69468020, 798951740},
+    {763, 69468440, 798953140},
+    {764, 69468830, 798954540},
+    {765, 69469210, 798955870},
+    {766, 69469640, 798957300},
+    {767, 69470120, 798958760},
+    {768, 69470460, 798960140},
+    {769, 69470800, 798961570},
+    {770, 69471180, 798962990},
+    {771, 69471520, 798964400},
+    {772, 69471860, 798965810},
+    {773, 69472250, 798967170},
+    {774, 69472670, 798968510},
+    {775, 69471920, 798968960},
+    {776, 69473380, 798971300},
+    {777, 69473750, 798972750},
+    {778, 69474170, 798974140},
+    {779, 69474500, 798975620},
+    {780, 69474860, 798976940},
+    {781, 69475100, 798978400},
+    {782, 69474140, 798978990},
+    {783, 69475700, 798981220},
+    {784, 69475970, 798982610},
+    {785, 69476220, 798983960},
+    {786, 69476550, 798985370},
+    {787, 69476820, 798986740},
+    {788, 69477020, 798988220},
+    {789, 69477230, 798989590},
+    {790, 69477540, 798991050},
+    {791, 69477840, 798992430},
+    {792, 69478110, 798993800},
+    {793, 69478320, 798995240},
+    {794, 69478560, 798996670},
+    {795, 69478790, 798998010},
+    {796, 69479040, 798999480},
+    {797, 69479200, 799000830},
+    {798, 69478700, 799001280},
+    {799, 69479720, 799003740},
+    {800, 69479940, 799005120},
+    {801, 69480110, 799006620},
+    {802, 69480310, 799008060},
+    {803, 69480640, 799009530},
+    {804, 69480900, 799011030},
+    {805, 69481210, 799012440},
+    {806, 69481520, 799013850},
+    {807, 69481880, 799015200},
+    {808, 69482140, 799016670},
+    {809, 69482430, 799018160},
+    {810, 69482740, 799019510},
+    {811, 69482980, 799020950},
+    {812, 69483280, 799022390},
+    {813, 69483470, 799023770},
+    {814, 69483710, 799025210},
+    {815, 69483960, 799026660},
+    {816, 69484140, 799028190},
+    {817, 69484380, 799029520},
+    {818, 69484810, 799030950},
+    {819, 69485050, 799032330},
+    {820, 69485360, 799033830},
+    {821, 69485640, 799035280},
+    {822, 69485930, 799036670},
+    {823, 69486220, 799038110},
+    {824, 69486520, 799039610},
+    {825, 69486720, 799041050},
+    {826, 69486960, 799042550},
+    {827, 69487210, 799043870},
+    {828, 69487450, 799045230},
+    {829, 69487760, 799046670},
+    {830, 69488050, 799048110},
+    {831, 69488340, 799049580},
+    {832, 69488600, 799050990},
+    {833, 69488930, 799052430},
+    {834, 69489210, 799053920},
+    {835, 69489420, 799055340},
+    {836, 69489690, 799056720},
+    {837, 69489920, 799058100},
+    {838, 69490220, 799059470},
+    {839, 69490590, 799060870},
+    {840, 69490940, 799062250},
+    {841, 69491300, 799063720},
+    {842, 69491610, 799065150},
+    {843, 69491910, 799066540},
+    {844, 69492230, 799067990},
+    {845, 69492650, 799069350},
+    {846, 69492960, 799070680},
+    {847, 69493330, 799072100},
+    {848, 69493700, 799073500},
+    {849, 69494170, 799074890},
+    {850, 69494510, 799076360},
+    {851, 69494940, 799077750},
+    {852, 69495250, 799079170},
+    {853, 69495610, 799080510},
+    {854, 69495960, 799081850},
+    {855, 69496500, 799083300},
+    {856, 69496890, 799084670},
+    {857, 69497400, 799086070},
+    {858, 69497890, 799087440},
+    {859, 69498420, 799088790},
+    {860, 69498910, 799090200},
+    {861, 69499100, 799091490},
+    {862, 69499790, 799092960},
+    {863, 69500110, 799094240},
+    {864, 69500450, 799095740},
+    {865, 69500830, 799097170},
+    {866, 69501180, 799098540},
+    {867, 69501510, 799099940},
+    {868, 69501900, 799101380},
+    {869, 69502230, 799102870},
+    {870, 69502500, 799104270},
+    {871, 69502780, 799105780},
+    {872, 69503040, 799107160},
+    {873, 69503210, 799108610},
+    {874, 69503440, 799109980},
+    {875, 69503730, 799111370},
+    {876, 69503970, 799112860},
+    {877, 69504190, 799114290},
+    {878, 69504350, 799115730},
+    {879, 69504510, 799117230},
+    {880, 69504720, 799118670},
+    {881, 69504830, 799120050},
+    {882, 69505060, 799121560},
+    {883, 69505210, 799123050},
+    {884, 69505460, 799124480},
+    {885, 69505720, 799126000},
+    {886, 69505900, 799127420},
+    {887, 69506170, 799128860},
+    {888, 69506340, 799130210},
+    {889, 69506540, 799131570},
+    {890, 69506720, 799133110},
+    {891, 69506970, 799134500},
+    {892, 69507190, 799135920},
+    {893, 69507400, 799137330},
+    {894, 69507730, 799138700},
+    {895, 69507960, 799140130},
+    {896, 69508200, 799141560},
+    {897, 69508470, 799142950},
+    {898, 69508700, 799144360},
+    {899, 69509040, 799145750},
+    {900, 69509490, 799147200},
+    {901, 69509800, 799148500},
+    {902, 69510240, 799149930},
+    {903, 69510680, 799151280},
+    {904, 69511060, 799152570},
+    {905, 69511520, 799153930},
+    {906, 69511980, 799155280},
+    {907, 69512530, 799156620},
+    {908, 69513040, 799157940},
+    {909, 69513710, 799159350},
+    {910, 69514380, 799160650},
+    {911, 69515160, 799161940},
+    {912, 69515820, 799163220},
+    {913, 69516580, 799164450},
+    {914, 69517450, 799165640},
+    {915, 69517300, 799166750},
+    {916, 69519010, 799168000},
+    {917, 69519840, 799169140},
+    {918, 69520700, 799170230},
+    {919, 69521620, 799171280},
+    {920, 69522540, 799172310},
+    {921, 69523620, 799173430},
+    {922, 69524760, 799174480},
+    {923, 69525820, 799175530},
+    {924, 69526990, 799176480},
+    {925, 69528060, 799177350},
+    {926, 69529140, 799178390},
+    {927, 69530330, 799179140},
+    {928, 69531360, 799180100},
+    {929, 69532530, 799180860},
+    {930, 69533620, 799181640},
+    {932, 69535700, 799183030},
+    {934, 69537680, 799184230},
+    {936, 69539500, 799185290},
+    {938, 69541160, 799186170},
+    {940, 69542940, 799187030},
+    {943, 69545130, 799188040},
+    {946, 69546850, 799188690},
+    {950, 69548580, 799189470},
+    {956, 69549780, 799189960},
+    {982, 69549920, 799190150},
+    {983, 69549910, 799190210},
+    {984, 69549810, 799190290},
+    {1014, 69549970, 799189950},
+    {1074, 69567370, 799195780},
+    {1076, 69569970, 799196390},
+    {1078, 69572790, 799197180},
+    {1079, 69574200, 799197520},
+    {1080, 69575510, 799197910},
+    {1081, 69576920, 799198240},
+    {1082, 69578440, 799198640},
+    {1083, 69579740, 799199080},
+    {1084, 69581040, 799199380},
+    {1085, 69582400, 799199660},
+    {1086, 69583770, 799199930},
+    {1087, 69585110, 799200260},
+    {1088, 69586470, 799200620},
+    {1089, 69587960, 799200880},
+    {1090, 69589340, 799201170},
+    {1091, 69590680, 799201490},
+    {1092, 69592080, 799201740},
+    {1093, 69593510, 799201930},
+    {1094, 69595020, 799202260},
+    {1095, 69596470, 799202510},
+    {1096, 69597940, 799202850},
+    {1097, 69599350, 799203130},
+    {1098, 69600750, 799203410},
+    {1099, 69602200, 799203700},
+    {1100, 69603630, 799203980},
+    {1101, 69605010, 799204340},
+    {1102, 69606430, 799204500},
+    {1103, 69607790, 799204720},
+    {1104, 69609200, 799204980},
+    {1105, 69610680, 799205260},
+    {1106, 69612230, 799205430},
+    {1107, 69613640, 799205700},
+    {1108, 69615120, 799205980},
+    {1109, 69616550, 799206160},
+    {1110, 69617900, 799206310},
+    {1111, 69619210, 799206470},
+    {1112, 69620670, 799206780},
+    {1113, 69622440, 799206950},
+    {1114, 69623480, 799207160},
+    {1115, 69624960, 799207380},
+    {1116, 69626290, 799207560},
+    {1117, 69627810, 799207840},
+    {1118, 69629120, 799208070},
+    {1119, 69630570, 799208230},
+    {1120, 69632010, 799208420},
+    {1121, 69633540, 799208550},
+    {1122, 69634930, 799208720},
+    {1123, 69636370, 799208910},
+    {1124, 69637820, 799209090},
+    {1125, 69639160, 799209280},
+    {1126, 69640520, 799209500},
+    {1127, 69641870, 799209790},
+    {1128, 69643330, 799210080},
+    {1129, 69644730, 799210250},
+    {1130, 69646200, 799210310},
+    {1131, 69647020, 799210600},
+    {1132, 69649060, 799210630},
+    {1133, 69650460, 799210760},
+    {1134, 69651920, 799210940},
+    {1135, 69653310, 799211140},
+    {1136, 69654750, 799211250},
+    {1137, 69656230, 799211470},
+    {1138, 69657620, 799211640},
+    {1139, 69659080, 799211780},
+    {1140, 69660570, 799211930},
+    {1141, 69661950, 799212050},
+    {1142, 69663390, 799212150},
+    {1143, 69664860, 799212170},
+    {1144, 69666310, 799212310},
+    {1145, 69667710, 799212350},
+    {1146, 69669160, 799212500},
+    {1147, 69670610, 799212600},
+    {1148, 69672050, 799212780},
+    {1149, 69673470, 799212940},
+    {1150, 69674920, 799213170},
+    {1151, 69676300, 799213300},
+    {1152, 69677730, 799213380},
+    {1153, 69679110, 799213610},
+    {1154, 69680480, 799213680},
+    {1155, 69681920, 799213700},
+    {1156, 69683320, 799213800},
+    {1157, 69684730, 799213970},
+    {1158, 69686170, 799214090},
+    {1159, 69687580, 799214190},
+    {1160, 69688350, 799215140},
+    {1161, 69690370, 799214310},
+    {1162, 69691840, 799214380},
+    {1163, 69693400, 799214470},
+    {1164, 69694900, 799214610},
+    {1165, 69696320, 799214710},
+    {1166, 69697720, 799214790},
+    {1167, 69699190, 799214800},
+    {1168, 69700570, 799215000},
+    {1169, 69701980, 799215140},
+    {1170, 69703520, 799215250},
+    {1171, 69704860, 799215430},
+    {1172, 69706400, 799215580},
+    {1173, 69707830, 799215580},
+    {1174, 69709250, 799215720},
+    {1175, 69710690, 799215790},
+    {1176, 69712130, 799215920},
+    {1177, 69713550, 799216080},
+    {1178, 69714940, 799216120},
+    {1179, 69716420, 799216230},
+    {1180, 69717970, 799216300},
+    {1181, 69719370, 799216300},
+    {1182, 69720790, 799216280},
+    {1183, 69722170, 799216230},
+    {1184, 69723550, 799216290},
+    {1185, 69725030, 799216330},
+    {1186, 69726420, 799216450},
+    {1187, 69727860, 799216520},
+    {1188, 69729320, 799216560},
+    {1189, 69730730, 799216560},
+    {1190, 69732150, 799216720},
+    {1191, 69733610, 799216820},
+    {1192, 69735130, 799216850},
+    {1193, 69736620, 799216940},
+    {1194, 69737940, 799216960},
+    {1195, 69739370, 799217020},
+    {1196, 69740860, 799217150},
+    {1197, 69742260, 799217250},
+    {1198, 69743690, 799217280},
+    {1199, 69745240, 799217300},
+    {1200, 69746740, 799217310},
+    {1201, 69748200, 799217340},
+    {1202, 69749630, 799217400},
+    {1203, 69751030, 799217440},
+    {1204, 69752560, 799217460},
+    {1205, 69753820, 799216530},
+    {1206, 69755450, 799217510},
+    {1207, 69756930, 799217440},
+    {1208, 69758340, 799217500},
+    {1209, 69759730, 799217520},
+    {1210, 69761220, 799217590},
+    {1211, 69762680, 799217700},
+    {1212, 69764140, 799217670},
+    {1213, 69765590, 799217740},
+    {1214, 69767040, 799217710},
+    {1215, 69768390, 799217710},
+    {1216, 69769710, 799217620},
+    {1217, 69771130, 799217710},
+    {1218, 69772660, 799217690},
+    {1219, 69774120, 799217780},
+    {1220, 69775500, 799217870},
+    {1221, 69776960, 799217920},
+    {1222, 69778340, 799217920},
+    {1223, 69779870, 799217850},
+    {1224, 69781350, 799217900},
+    {1225, 69782780, 799217860},
+    {1226, 69784140, 799217850},
+    {1227, 69785670, 799217940},
+    {1228, 69787120, 799217900},
+    {1229, 69788490, 799217900},
+    {1230, 69790040, 799217970},
+    {1231, 69791420, 799217820},
+    {1232, 69792730, 799217780},
+    {1233, 69794220, 799217710},
+    {1234, 69795680, 799217750},
+    {1235, 69797170, 799217710},
+    {1236, 69798560, 799217700},
+    {1237, 69800090, 799217730},
+    {1238, 69801540, 799217630},
+    {1239, 69802880, 799217610},
+    {1240, 69804380, 799217560},
+    {1241, 69805700, 799217570},
+    {1242, 69807080, 799217440},
+    {1243, 69808570, 799217400},
+    {1244, 69809910, 799217390},
+    {1245, 69811420, 799217380},
+    {1246, 69812830, 799217420},
+    {1247, 69814260, 799217430},
+    {1248, 69815740, 799217440},
+    {1249, 69817130, 799217410},
+    {1250, 69818610, 799217320},
+    {1251, 69820100, 799217290},
+    {1252, 69821550, 799217240},
+    {1253, 69823020, 799217130},
+    {1254, 69824520, 799217120},
+    {1255, 69825960, 799217000},
+    {1256, 69827480, 799216890},
+    {1257, 69828940, 799216830},
+    {1258, 69830290, 799216680},
+    {1259, 69831760, 799216540},
+    {1260, 69833140, 799216400},
+    {1261, 69834530, 799216160},
+    {1262, 69835960, 799216010},
+    {1263, 69837480, 799215950},
+    {1264, 69838870, 799215870},
+    {1265, 69840200, 799215740},
+    {1266, 69841700, 799215570},
+    {1267, 69843120, 799215440},
+    {1268, 69844590, 799215250},
+    {1269, 69846010, 799215070},
+    {1270, 69847430, 799214990},
+    {1271, 69848860, 799214880},
+    {1272, 69850300, 799214670},
+    {1273, 69851750, 799214480},
+    {1274, 69853120, 799214400},
+    {1275, 69854510, 799214220},
+    {1276, 69855980, 799214090},
+    {1277, 69857340, 799213850},
+    {1278, 69858720, 799213670},
+    {1279, 69860220, 799213510},
+    {1280, 69861700, 799213310},
+    {1281, 69863100, 799213130},
+    {1282, 69864640, 799212930},
+    {1283, 69866010, 799212690},
+    {1284, 69867420, 799212550},
+    {1285, 69868830, 799212290},
+    {1286, 69870180, 799212050},
+    {1287, 69871560, 799211800},
+    {1288, 69872900, 799211510},
+    {1289, 69874410, 799211130},
+    {1290, 69875800, 799210890},
+    {1291, 69877070, 799210670},
+    {1292, 69878500, 799210530},
+    {1293, 69879930, 799210350},
+    {1294, 69881420, 799210060},
+    {1295, 69882910, 799209850},
+    {1296, 69884360, 799209570},
+    {1297, 69885730, 799209220},
+    {1298, 69887230, 799208900},
+    {1299, 69888570, 799208600},
+    {1300, 69889950, 799208420},
+    {1301, 69891310, 799208160},
+    {1302, 69892850, 799207880},
+    {1303, 69894270, 799207680},
+    {1304, 69895660, 799207300},
+    {1305, 69897020, 799207000},
+    {1306, 69898880, 799205990},
+    {1307, 69899970, 799206380},
+    {1308, 69901320, 799206080},
+    {1309, 69902650, 799205780},
+    {1310, 69904060, 799205460},
+    {1311, 69905410, 799205140},
+    {1312, 69906840, 799204880},
+    {1313, 69908190, 799204540},
+    {1314, 69909680, 799204250},
+    {1315, 69911140, 799203970},
+    {1316, 69912490, 799203650},
+    {1317, 69913870, 799203420},
+    {1318, 69915360, 799203100},
+    {1319, 69916750, 799202760},
+    {1320, 69918150, 799202440},
+    {1321, 69919540, 799202190},
+    {1322, 69920980, 799201790},
+    {1323, 69922430, 799201490},
+    {1324, 69923890, 799201200},
+    {1325, 69925310, 799200940},
+    {1326, 69926720, 799200520},
+    {1327, 69928080, 799200220},
+    {1328, 69929470, 799199920},
+    {1329, 69930410, 799200450},
+    {1330, 69932270, 799199260},
+    {1331, 69933620, 799198970},
+    {1332, 69935100, 799198550},
+    {1333, 69936390, 799198200},
+    {1334, 69937830, 799197800},
+    {1335, 69939260, 799197370},
+    {1336, 69940690, 799197050},
+    {1337, 69942130, 799196700},
+    {1338, 69943520, 799196390},
+    {1339, 69944940, 799196070},
+    {1340, 69946340, 799195680},
+    {1341, 69947620, 799195270},
+    {1342, 69949030, 799194900},
+    {1343, 69950440, 799194560},
+    {1344, 69951930, 799194280},
+    {1345, 69952050, 799193520},
+    {1346, 69954640, 799193680},
+    {1347, 69956100, 799193330},
+    {1348, 69957440, 799192970},
+    {1349, 69958800, 799192630},
+    {1350, 69960160, 799192210},
+    {1351, 69961590, 799191900},
+    {1352, 69962920, 799191680},
+    {1353, 69964290, 799191380},
+    {1354, 69965620, 799191060},
+    {1355, 69966950, 799190760},
+    {1356, 69968310, 799190290},
+    {1357, 69969700, 799189900},
+    {1358, 69971150, 799189620},
+    {1359, 69972540, 799189320},
+    {1360, 69974020, 799189010},
+    {1361, 69975540, 799188670},
+    {1362, 69976840, 799188440},
+    {1363, 69978160, 799188080},
+    {1364, 69979600, 799187740},
+    {1365, 69981030, 799187410},
+    {1366, 69982410, 799187090},
+    {1367, 69983900, 799186760},
+    {1368, 69985260, 799186300},
+    {1369, 69986690, 799185960},
+    {1370, 69988040, 799185610},
+    {1371, 69989470, 799185340},
+    {1372, 69990890, 799185020},
+    {1373, 69992380, 799184760},
+    {1374, 69993800, 799184470},
+    {1375, 69995320, 799184170},
+    {1376, 69996700, 799183810},
+    {1377, 69998140, 799183410},
+    {1378, 69999480, 799183100},
+    {1379, 70000770, 799182830},
+    {1380, 70002180, 799182620},
+    {1381, 70003610, 799182270},
+    {1382, 70005050, 799181940},
+    {1383, 70006490, 799181580},
+    {1384, 70007930, 799181410},
+    {1385, 70009240, 799181110},
+    {1386, 70010690, 799180860},
+    {1387, 70012080, 799180560},
+    {1388, 70013500, 799180250},
+    {1389, 70014790, 799180010},
+    {1390, 70016090, 799179680},
+    {1391, 70017510, 799179480},
+    {1392, 70019010, 799179110},
+    {1393, 70020370, 799178950},
+    {1394, 70021780, 799178650},
+    {1395, 70023170, 799178400},
+    {1396, 70024630, 799178140},
+    {1397, 70026060, 799177900},
+    {1398, 70027530, 799177580},
+    {1399, 70028920, 799177310},
+    {1400, 70030350, 799177050},
+    {1401, 70031800, 799176820},
+    {1402, 70033320, 799176610},
+    {1403, 70034790, 799176360},
+    {1404, 70036200, 799176180},
+    {1405, 70037650, 799176020},
+    {1406, 70039120, 799175780},
+    {1407, 70040530, 799175570},
+    {1408, 70042020, 799175330},
+    {1409, 70043440, 799175100},
+    {1410, 70044870, 799174890},
+    {1411, 70046410, 799174620},
+    {1412, 70047850, 799174450},
+    {1413, 70049230, 799174230},
+    {1414, 70050630, 799174090},
+    {1415, 70052030, 799173950},
+    {1416, 70053470, 799173790},
+    {1417, 70054910, 799173650},
+    {1418, 70056240, 799173520},
+    {1419, 70057660, 799173300},
+    {1420, 70059210, 799173170},
+    {1421, 70060580, 799173070},
+    {1422, 70062060, 799172920},
+    {1423, 70063430, 799172840},
+    {1424, 70064850, 799172790},
+    {1425, 70066330, 799172740},
+    {1426, 70067750, 799172590},
+    {1427, 70069140, 799172430},
+    {1428, 70070570, 799172290},
+    {1429, 70071930, 799172250},
+    {1430, 70073320, 799172100},
+    {1431, 70074680, 799172050},
+    {1432, 70076090, 799171990},
+    {1433, 70077560, 799171990},
+    {1434, 70079000, 799171980},
+    {1435, 70080410, 799171910},
+    {1436, 70081810, 799171850},
+    {1437, 70083180, 799172000},
+    {1438, 70084650, 799172000},
+    {1439, 70086100, 799172080},
+    {1440, 70087510, 799172020},
+    {1441, 70088880, 799171950},
+    {1442, 70090320, 799171980},
+    {1443, 70091680, 799172050},
+    {1444, 70093150, 799172140},
+    {1445, 70094560, 799172230},
+    {1446, 70096030, 799172260},
+    {1447, 70097480, 799172300},
+    {1448, 70098920, 799172340},
+    {1449, 70100420, 799172380},
+    {1450, 70101900, 799172520},
+    {1451, 70103380, 799172580},
+    {1452, 70104720, 799172700},
+    {1453, 70106180, 799172850},
+    {1454, 70107670, 799173030},
+    {1455, 70109100, 799173230},
+    {1456, 70110430, 799173420},
+    {1457, 70111900, 799173600},
+    {1458, 70113350, 799173750},
+    {1459, 70114750, 799173960},
+    {1460, 70116250, 799174070},
+    {1461, 70117730, 799174350},
+    {1462, 70119200, 799174640},
+    {1463, 70120640, 799174810},
+    {1464, 70122010, 799175090},
+    {1465, 70123540, 799175430},
+    {1466, 70124960, 799175620},
+    {1467, 70126280, 799175850},
+    {1468, 70127710, 799176070},
+    {1469, 70129090, 799176260},
+    {1470, 70130470, 799176560},
+    {1471, 70131890, 799176770},
+    {1472, 70133330, 799177070},
+    {1473, 70134730, 799177450},
+    {1474, 70136130, 799177780},
+    {1475, 70137570, 799178100},
+    {1476, 70139020, 799178360},
+    {1477, 70140460, 799178680},
+    {1478, 70141890, 799178970},
+    {1479, 70143320, 799179320},
+    {1480, 70144780, 799179640},
+    {1481, 70146200, 799179900},
+    {1482, 70147580, 799180240},
+    {1483, 70149030, 799180540},
+    {1484, 70150440, 799180980},
+    {1485, 70151820, 799181220},
+    {1486, 70153130, 799181530},
+    {1487, 70154450, 799181900},
+    {1488, 70155910, 799182230},
+    {1489, 70157340, 799182570},
+    {1490, 70158780, 799182860},
+    {1491, 70160200, 799183340},
+    {1492, 70161610, 799183780},
+    {1493, 70162980, 799184140},
+    {1494, 70164310, 799184530},
+    {1495, 70165670, 799184940},
+    {1496, 70167020, 799185300},
+    {1497, 70168480, 799185720},
+    {1498, 70169780, 799186090},
+    {1499, 70171190, 799186450},
+    {1530, 70213250, 799200490},
+    {1531, 70214600, 799201040},
+    {1532, 70215980, 799201570},
+    {1533, 70217270, 799202120},
+    {1534, 70218700, 799202630},
+    {1535, 70220040, 799203200},
+    {1536, 70221460, 799203710},
+    {1537, 70222700, 799204270},
+    {1538, 70224030, 799204720},
+    {1539, 70225430, 799205280},
+    {1540, 70226720, 799205860},
+    {1541, 70228110, 799206330},
+    {1542, 70229500, 799206880},
+    {1543, 70230820, 799207290},
+    {1544, 70232100, 799207740},
+    {1545, 70233450, 799208310},
+    {1546, 70234730, 799208780},
+    {1547, 70236060, 799209310},
+    {1548, 70237430, 799209890},
+    {1549, 70238730, 799210330},
+    {1550, 70240180, 799211020},
+    {1551, 70241590, 799211580},
+    {1552, 70242830, 799212130},
+    {1553, 70244190, 799212570},
+    {1554, 70245620, 799213060},
+    {1555, 70246930, 799213630},
+    {1556, 70248260, 799214130},
+    {1557, 70249660, 799214640},
+    {1558, 70251000, 799215130},
+    {1559, 70252330, 799215690},
+    {1560, 70253640, 799216190},
+    {1561, 70254930, 799216750},
+    {1562, 70256250, 799217280},
+    {1563, 70257550, 799217880},
+    {1564, 70258810, 799218460},
+    {1565, 70260130, 799218970},
+    {1566, 70261460, 799219500},
+    {1567, 70262790, 799220000},
+    {1568, 70264160, 799220490},
+    {1569, 70265570, 799221120},
+    {1570, 70266940, 799221720},
+    {1571, 70268310, 799222180},
+    {1572, 70269620, 799222770},
+    {1573, 70270940, 799223190},
+    {1574, 70272220, 799223760},
+    {1576, 70274620, 799224540},
+    {1578, 70276730, 799225400},
+    {1580, 70278700, 799226190},
+    {1582, 70280640, 799226960},
+    {1584, 70282360, 799227590},
+    {1587, 70284630, 799228330},
+    {1590, 70286580, 799228880},
+    {1594, 70288600, 799229440},
+    {1600, 70290180, 799230070},
+    {1621, 70290320, 799229750},
+    {1622, 70290000, 799229680},
+    {1623, 70290000, 799229780},
+    {1653, 70290070, 799230110},
+    {1713, 70290010, 799229980},
+    {1833, 70289990, 799229990},
+};
+
+#define RECORDED_TRACK_COUNT (sizeof(RECORDED_TRACK) / sizeof(RECORDED_TRACK[0]))
+
+#endif
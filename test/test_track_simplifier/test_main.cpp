@@ -0,0 +1,277 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "TrackSimplifier.h"
+#include "GeoMath.h"
+#include "HostBench.h"
+#include "RecordedTrack.h"
+
+#define ORIGIN_LATITUDE 69271000 // 1e-7 degrees
+#define ORIGIN_LONGITUDE 798612000
+#define TRACK_MAX 1000
+#define BENCH_REPLAYS 200
+
+static TrackSimplifier simplifier;
+static StoredFix track[TRACK_MAX];
+static StoredFix kept[TRACK_MAX];
+static int keptCount;
+
+void setUp(void)
+{
+  simplifier = TrackSimplifier();
+  keptCount = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// Fix at an offset from the origin, one per second
+static StoredFix fixAt(int32_t eastCm, int32_t northCm, uint32_t second)
+{
+  StoredFix fix;
+  memset(&fix, 0, sizeof(fix));
+  fix.timestamp = 1700000000UL + second;
+  geoMoveCm(ORIGIN_LATITUDE, ORIGIN_LONGITUDE, eastCm, northCm, &fix.latitude, &fix.longitude);
+  fix.flags = FIXLOG_FLAG_VALID;
+  return fix;
+}
+
+static void run(int count)
+{
+  StoredFix out;
+  for (int i = 0; i < count; i++)
+  {
+    if (simplifier.add(track[i], out))
+    {
+      kept[keptCount++] = out;
+    }
+  }
+  if (simplifier.flush(out))
+  {
+    kept[keptCount++] = out;
+  }
+}
+
+// Distance in cm from a fix to the kept polyline, each segment measured in
+// a local projection at its start like the simplifier does
+static double distanceToKept(const StoredFix &fix)
+{
+  double best = 1e18;
+  for (int k = 0; k + 1 < keptCount; k++)
+  {
+    int32_t ax = 0, ay = 0, bx, by;
+    geoOffsetCm(kept[k].latitude, kept[k].longitude, kept[k + 1].latitude, kept[k + 1].longitude, &bx, &by);
+    int32_t px, py;
+    geoOffsetCm(kept[k].latitude, kept[k].longitude, fix.latitude, fix.longitude, &px, &py);
+    double dx = bx - ax, dy = by - ay;
+    double t = dx == 0 && dy == 0 ? 0 : ((px - ax) * dx + (py - ay) * dy) / (dx * dx + dy * dy);
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    double ex = ax + t * dx - px, ey = ay + t * dy - py;
+    double d = sqrt(ex * ex + ey * ey);
+    if (d < best)
+      best = d;
+  }
+  return best;
+}
+
+static StoredFix recordedFix(size_t i, uint32_t offset)
+{
+  StoredFix fix;
+  memset(&fix, 0, sizeof(fix));
+  fix.timestamp = RECORDED_TRACK_START + offset + RECORDED_TRACK[i].second;
+  fix.latitude = RECORDED_TRACK[i].latitude;
+  fix.longitude = RECORDED_TRACK[i].longitude;
+  fix.flags = FIXLOG_FLAG_VALID;
+  return fix;
+}
+
+// Simplify the recorded track, return the worst distance of a fix to the kept track
+static double runRecorded(uint32_t toleranceCm)
+{
+  simplifier = TrackSimplifier(toleranceCm);
+  keptCount = 0;
+  for (size_t i = 0; i < RECORDED_TRACK_COUNT; i++)
+  {
+    track[i] = recordedFix(i, 0);
+  }
+  run(RECORDED_TRACK_COUNT);
+  double worst = 0;
+  for (size_t i = 0; i < RECORDED_TRACK_COUNT; i++)
+  {
+    double d = distanceToKept(track[i]);
+    worst = d > worst ? d : worst;
+  }
+  return worst;
+}
+
+static void test_first_fix_is_kept(void)
+{
+  StoredFix out;
+  TEST_ASSERT_TRUE(simplifier.add(fixAt(0, 0, 0), out));
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL, out.timestamp);
+  TEST_ASSERT_FALSE(simplifier.flush(out));
+}
+
+static void test_straight_track_keeps_one_fix_per_window(void)
+{
+  // 28 m per second due north with 2 m of GNSS noise across the track
+  for (int i = 0; i < 100; i++)
+  {
+    track[i] = fixAt(i % 2 ? 200 : -200, i * 2800, i);
+  }
+  run(100);
+  // Every window is cut only when it is full
+  TEST_ASSERT_EQUAL(1 + (99 + SIMPLIFIER_WINDOW - 1) / SIMPLIFIER_WINDOW, keptCount);
+  TEST_ASSERT_EQUAL_UINT32(track[99].timestamp, kept[keptCount - 1].timestamp);
+  TEST_ASSERT_LESS_OR_EQUAL(SIMPLIFIER_TOLERANCE_CM, simplifier.stats().maxErrorCm);
+}
+
+static void test_curve_stays_within_the_tolerance(void)
+{
+  // Quarter circle of 500 m radius at 10 m per second
+  int count = 0;
+  for (double a = 0; a < M_PI / 2 && count < TRACK_MAX; a += 1000.0 / 50000.0)
+  {
+    track[count] = fixAt((int32_t)(50000 * (1 - cos(a))), (int32_t)(50000 * sin(a)), count);
+    count++;
+  }
+  run(count);
+  TEST_ASSERT_GREATER_THAN(2, keptCount);
+  TEST_ASSERT_LESS_THAN(count / 4, keptCount);
+  for (int i = 0; i < count; i++)
+  {
+    // One extra centimeter for the rounding of the fixed-point offsets
+    TEST_ASSERT_TRUE(distanceToKept(track[i]) <= SIMPLIFIER_TOLERANCE_CM + 1);
+  }
+  TEST_ASSERT_EQUAL_UINT32(count, simplifier.stats().pointsIn);
+  TEST_ASSERT_EQUAL_UINT32(keptCount, simplifier.stats().pointsOut);
+}
+
+static void test_sharp_corner_is_kept(void)
+{
+  for (int i = 0; i < 10; i++)
+  {
+    track[i] = fixAt(0, i * 1000, i);
+  }
+  for (int i = 10; i < 20; i++)
+  {
+    track[i] = fixAt((i - 9) * 2000, 9000, i);
+  }
+  run(20);
+  TEST_ASSERT_EQUAL(3, keptCount);
+  TEST_ASSERT_EQUAL_UINT32(track[9].timestamp, kept[1].timestamp);
+}
+
+static void test_stationary_parcel_reports_after_the_gap(void)
+{
+  StoredFix out;
+  TEST_ASSERT_TRUE(simplifier.add(fixAt(0, 0, 0), out));
+  for (uint32_t s = 10; s < SIMPLIFIER_MAX_GAP; s += 10)
+  {
+    TEST_ASSERT_FALSE(simplifier.add(fixAt(0, 0, s), out));
+  }
+  TEST_ASSERT_TRUE(simplifier.add(fixAt(0, 0, SIMPLIFIER_MAX_GAP), out));
+  TEST_ASSERT_EQUAL_UINT32(1700000000UL + SIMPLIFIER_MAX_GAP - 10, out.timestamp);
+}
+
+static void test_zero_tolerance_keeps_every_bend(void)
+{
+  simplifier.setTolerance(0);
+  for (int i = 0; i < 20; i++)
+  {
+    track[i] = fixAt(i % 2 ? 500 : 0, i * 1000, i);
+  }
+  run(20);
+  TEST_ASSERT_EQUAL(20, keptCount);
+}
+
+static void test_recorded_track(void)
+{
+  TEST_ASSERT_LESS_OR_EQUAL(TRACK_MAX, RECORDED_TRACK_COUNT);
+  double worst = runRecorded(SIMPLIFIER_TOLERANCE_CM);
+  TEST_ASSERT_TRUE(worst <= SIMPLIFIER_TOLERANCE_CM + 1);
+  TEST_ASSERT_LESS_OR_EQUAL(SIMPLIFIER_TOLERANCE_CM, simplifier.stats().maxErrorCm);
+  TEST_ASSERT_EQUAL_UINT32(RECORDED_TRACK_COUNT, simplifier.stats().pointsIn);
+  TEST_ASSERT_EQUAL_UINT32(keptCount, simplifier.stats().pointsOut);
+  // The ends of the trip are kept, and most of the fixes in between are not
+  TEST_ASSERT_EQUAL_UINT32(track[0].timestamp, kept[0].timestamp);
+  TEST_ASSERT_EQUAL_UINT32(track[RECORDED_TRACK_COUNT - 1].timestamp, kept[keptCount - 1].timestamp);
+  TEST_ASSERT_LESS_THAN((int)RECORDED_TRACK_COUNT / 4, keptCount);
+  for (int k = 1; k < keptCount; k++)
+  {
+    // No kept fix is more than the gap after the previous one
+    TEST_ASSERT_LESS_OR_EQUAL(SIMPLIFIER_MAX_GAP, kept[k].timestamp - kept[k - 1].timestamp);
+  }
+}
+
+static void test_recorded_track_report(void)
+{
+  // Reduction and worst error of the recorded track per tolerance
+  const uint32_t tolerances[] = {200, 500, 1000, 2500, 5000};
+  int previousKept = (int)RECORDED_TRACK_COUNT + 1;
+  for (size_t t = 0; t < sizeof(tolerances) / sizeof(tolerances[0]); t++)
+  {
+    double worst = runRecorded(tolerances[t]);
+    TEST_ASSERT_TRUE(worst <= tolerances[t] + 1);
+    TEST_ASSERT_LESS_OR_EQUAL(previousKept, keptCount);
+    previousKept = keptCount;
+    char what[64];
+    snprintf(what, sizeof(what), "Recorded track at %lu m, fixes in per fix kept", (unsigned long)tolerances[t] / 100);
+    benchReport(what, (double)RECORDED_TRACK_COUNT / keptCount, "x");
+    snprintf(what, sizeof(what), "Recorded track at %lu m, worst error", (unsigned long)tolerances[t] / 100);
+    benchReport(what, worst, "cm");
+  }
+}
+
+static void test_benchmark_cost_per_fix(void)
+{
+  // The recorded track replayed back to back, then a straight run that
+  // fills every window, the most work add() does per fix
+  uint32_t replayLength = RECORDED_TRACK[RECORDED_TRACK_COUNT - 1].second + SIMPLIFIER_MAX_GAP;
+  StoredFix out;
+  uint64_t start = benchNanos();
+  for (uint32_t r = 0; r < BENCH_REPLAYS; r++)
+  {
+    for (size_t i = 0; i < RECORDED_TRACK_COUNT; i++)
+    {
+      benchKeep(simplifier.add(recordedFix(i, r * replayLength), out));
+    }
+  }
+  double recordedNs = (double)(benchNanos() - start) / (BENCH_REPLAYS * RECORDED_TRACK_COUNT);
+
+  for (int i = 0; i < TRACK_MAX; i++)
+  {
+    track[i] = fixAt(i % 2 ? 200 : -200, i * 2800, i);
+  }
+  simplifier = TrackSimplifier();
+  uint32_t straightFixes = 0;
+  start = benchNanos();
+  for (uint32_t r = 0; r < BENCH_REPLAYS; r++)
+  {
+    simplifier = TrackSimplifier();
+    for (int i = 0; i < TRACK_MAX; i++)
+    {
+      benchKeep(simplifier.add(track[i], out));
+    }
+    straightFixes += TRACK_MAX;
+  }
+  double straightNs = (double)(benchNanos() - start) / straightFixes;
+  benchReport("Simplifier cost, recorded track", recordedNs, "ns/fix");
+  benchReport("Simplifier cost, straight track", straightNs, "ns/fix");
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_fix_is_kept);
+  RUN_TEST(test_straight_track_keeps_one_fix_per_window);
+  RUN_TEST(test_curve_stays_within_the_tolerance);
+  RUN_TEST(test_sharp_corner_is_kept);
+  RUN_TEST(test_stationary_parcel_reports_after_the_gap);
+  RUN_TEST(test_zero_tolerance_keeps_every_bend);
+  RUN_TEST(test_recorded_track);
+  RUN_TEST(test_recorded_track_report);
+  RUN_TEST(test_benchmark_cost_per_fix);
+  return UNITY_END();
+}
@@ -0,0 +1,568 @@
+#include <unity.h>
+#include <string.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "Uplink.h"
+#include "ATEngine.h"
+#include "FixLog.h"
+#include "TelemetryCodec.h"
+#include "RamFlash.h"
+#include "ScriptedStream.h"
+#include "HostBench.h"
+
+#define STEP_MS 10
+#define SECTOR_SIZE 4096
+#define SECTORS 8
+
+/*
+ * Plays the SIM808 behind the scripted stream: answers each command the
+ * AT engine writes the way the modem does, takes the AT+CIPSEND payload
+ * after its prompt, and stands in for the TCP server on the far side.
+ */
+struct FakeSIM808
+{
+  ScriptedStream *stream;
+  std::string pending;                // written by the engine, not yet taken apart
+  uint16_t dataLeft;                  // payload bytes still due after a prompt
+  std::vector<std::string> commands;  // every command, in order
+  std::string server;                 // what reached the server
+  std::string toDevice;               // what the server sent, waiting in the modem
+  bool registered;
+  bool connectFails;
+  std::set<std::string> failing;      // commands answered with ERROR
+  std::string slowCommand;            // answered only after slowMs
+  unsigned long slowMs;
+  unsigned long slowSince;
+  bool slowActive;
+
+  void reset(ScriptedStream *s)
+  {
+    stream = s;
+    pending.clear();
+    dataLeft = 0;
+    commands.clear();
+    server.clear();
+    toDevice.clear();
+    registered = true;
+    connectFails = false;
+    failing.clear();
+    slowCommand.clear();
+    slowMs = 0;
+    slowActive = false;
+  }
+
+  void answer(const std::string &command)
+  {
+    commands.push_back(command);
+    if (failing.count(command))
+    {
+      stream->replyLine("ERROR");
+    }
+    else if (command == "AT+CREG?")
+    {
+      stream->replyLine(registered ? "+CREG: 0,1" : "+CREG: 0,2");
+      stream->replyLine("OK");
+    }
+    else if (command == "AT+CIPSHUT")
+    {
+      stream->replyLine("SHUT OK");
+    }
+    else if (command == "AT+CIFSR")
+    {
+      stream->replyLine("10.64.12.7");
+    }
+    else if (command.compare(0, 11, "AT+CIPSTART") == 0)
+    {
+      stream->replyLine("OK");
+      stream->replyLine("");
+      stream->replyLine(connectFails ? "CONNECT FAIL" : "CONNECT OK");
+    }
+    else if (command.compare(0, 11, "AT+CIPSEND=") == 0)
+    {
+      dataLeft = atoi(command.c_str() + 11);
+      stream->reply("> ");
+    }
+    else if (command.compare(0, 13, "AT+CIPRXGET=3") == 0)
+    {
+      size_t asked = atoi(command.c_str() + 14);
+      size_t count = toDevice.size() < asked ? toDevice.size() : asked;
+      char head[48];
+      snprintf(head, sizeof(head), "+CIPRXGET: 3,%u,%u", (unsigned)count, (unsigned)(toDevice.size() - count));
+      stream->replyLine(head);
+      std::string hex;
+      for (size_t i = 0; i < count; i++)
+      {
+        char pair[3];
+        snprintf(pair, sizeof(pair), "%02X", (uint8_t)toDevice[i]);
+        hex += pair;
+      }
+      toDevice.erase(0, count);
+      stream->replyLine(hex);
+      stream->replyLine("OK");
+    }
+    else if (command == "AT+CIPCLOSE=1")
+    {
+      stream->replyLine("CLOSE OK");
+    }
+    else
+    {
+      stream->replyLine("OK");
+    }
+  }
+
+  void step()
+  {
+    pending += stream->takeSent();
+    for (;;)
+    {
+      if (slowActive)
+      {
+        if (millis() - slowSince < slowMs)
+          return;
+        slowActive = false;
+        answer(slowCommand);
+      }
+      if (dataLeft > 0)
+      {
+        size_t take = pending.size() < dataLeft ? pending.size() : dataLeft;
+        server += pending.substr(0, take);
+        pending.erase(0, take);
+        dataLeft -= take;
+        if (dataLeft > 0)
+          return;
+        stream->replyLine("");
+        stream->replyLine("SEND OK");
+      }
+      size_t end = pending.find("\r\n");
+      if (end == std::string::npos)
+        return;
+      std::string command = pending.substr(0, end);
+      pending.erase(0, end + 2);
+      if (command == slowCommand)
+      {
+        slowActive = true; // answered, and logged, once slowMs have passed
+        slowSince = millis();
+        continue;
+      }
+      answer(command);
+    }
+  }
+
+  // The server acknowledges every batch up to id
+  void ack(uint16_t id)
+  {
+    toDevice += 'A';
+    toDevice += (char)(id & 0xFF);
+    toDevice += (char)(id >> 8);
+    stream->replyLine("+CIPRXGET: 1");
+  }
+
+  size_t count(const std::string &prefix) const
+  {
+    size_t n = 0;
+    for (size_t i = 0; i < commands.size(); i++)
+      if (commands[i].compare(0, prefix.size(), prefix) == 0)
+        n++;
+    return n;
+  }
+};
+
+struct Frame
+{
+  uint8_t type;
+  uint16_t id;
+  std::string payload;
+};
+
+static ScriptedStream *stream;
+static ATEngine *engine;
+static RamFlash *flash;
+static FixLog *fixLog;
+static Uplink *uplink;
+static FakeSIM808 modem;
+
+void setUp(void)
+{
+  hostMillis() = 1000;
+  hostSerial().text.clear();
+  stream = new ScriptedStream();
+  engine = new ATEngine(*stream);
+  engine->begin();
+  flash = new RamFlash(SECTOR_SIZE, SECTORS);
+  fixLog = new FixLog(*flash);
+  fixLog->begin();
+  uplink = new Uplink(*engine, *fixLog);
+  uplink->configure("internet", "", "", "10.0.0.1", 5000);
+  modem.reset(stream);
+}
+
+void tearDown(void)
+{
+  delete uplink;
+  delete fixLog;
+  delete flash;
+  delete engine;
+  delete stream;
+}
+
+// The modem task: the AT engine and the uplink jobs every STEP_MS
+static void runFor(unsigned long ms)
+{
+  for (unsigned long end = hostMillis() + ms; hostMillis() < end;)
+  {
+    hostMillis() += STEP_MS;
+    engine->poll();
+    uplink->poll();
+    modem.step();
+  }
+}
+
+static void runUntilConnected()
+{
+  for (int i = 0; i < 1000 && !uplink->isConnected(); i++)
+  {
+    runFor(STEP_MS);
+  }
+  TEST_ASSERT_TRUE(uplink->isConnected());
+}
+
+static void appendFixes(uint32_t from, uint32_t to)
+{
+  for (uint32_t seq = from; seq < to; seq++)
+  {
+    StoredFix fix;
+    memset(&fix, 0, sizeof(fix));
+    fix.timestamp = 1710490000UL + seq;
+    fix.latitude = 69271000 + (int32_t)seq * 37;
+    fix.longitude = 798612000 + (int32_t)seq * 21;
+    fix.altitude = 12;
+    fix.speed = 300 + seq % 50;
+    fix.course = 4500;
+    fix.hdop = 9;
+    fix.satellitesUsed = 8;
+    fix.flags = FIXLOG_FLAG_VALID;
+    TEST_ASSERT_TRUE(fixLog->append(fix));
+  }
+  TEST_ASSERT_TRUE(fixLog->flush());
+}
+
+// Split what reached the server into frames
+static std::vector<Frame> serverFrames()
+{
+  std::vector<Frame> frames;
+  const std::string &data = modem.server;
+  size_t pos = 0;
+  while (pos + UPLINK_HEADER_SIZE <= data.size())
+  {
+    TEST_ASSERT_EQUAL('T', data[pos]);
+    TEST_ASSERT_EQUAL('M', data[pos + 1]);
+    Frame frame;
+    frame.type = (uint8_t)data[pos + 2];
+    frame.id = (uint8_t)data[pos + 3] | ((uint8_t)data[pos + 4] << 8);
+    uint16_t length = (uint8_t)data[pos + 5] | ((uint8_t)data[pos + 6] << 8);
+    TEST_ASSERT_TRUE(pos + UPLINK_HEADER_SIZE + length <= data.size());
+    frame.payload = data.substr(pos + UPLINK_HEADER_SIZE, length);
+    frames.push_back(frame);
+    pos += UPLINK_HEADER_SIZE + length;
+  }
+  TEST_ASSERT_EQUAL_UINT32(data.size(), pos);
+  return frames;
+}
+
+static int decodedFixes(const Frame &frame, StoredFix *out)
+{
+  return decodeTelemetryBatch((const uint8_t *)frame.payload.data(), frame.payload.size(), out, UPLINK_MAX_BATCH);
+}
+
+static void test_bring_up_goes_through_the_at_engine(void)
+{
+  modem.registered = false;
+  TEST_ASSERT_TRUE(uplink->begin());
+  runFor(3000);
+  TEST_ASSERT_FALSE(uplink->isAttached());
+  TEST_ASSERT_EQUAL_UINT32(3, modem.count("AT+CREG?")); // once a second
+
+  modem.registered = true;
+  runUntilConnected();
+  const char *expected[] = {"AT+CREG?", "AT+CIPSHUT", "AT+CGATT=1", "AT+CIPMUX=0", "AT+CIPRXGET=1",
+                            "AT+CSTT=\"internet\",\"\",\"\"", "AT+CIICR", "AT+CIFSR",
+                            "AT+CIPSTART=\"TCP\",\"10.0.0.1\",5000"};
+  size_t first = modem.commands.size() - sizeof(expected) / sizeof(expected[0]);
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+  {
+    TEST_ASSERT_EQUAL_STRING(expected[i], modem.commands[first + i].c_str());
+  }
+  TEST_ASSERT_TRUE(uplink->isAttached());
+  TEST_ASSERT_EQUAL_UINT32(1, uplink->stats().connects);
+  TEST_ASSERT_EQUAL_UINT32(0, uplink->stats().failures);
+}
+
+/*
+ * AT+CIICR takes 20 s here. The uplink only waits for its reply, so the
+ * NMEA stream keeps being dispatched, poll() keeps returning at once and
+ * a command from another job goes out between the attach steps.
+ */
+static int nmeaLines;
+
+static void onNMEA(const char *line, void *context)
+{
+  nmeaLines++;
+}
+
+static void otherJobDone(ATResult result, const char *finalLine, uint32_t latencyMs, void *context)
+{
+  *(bool *)context = result == AT_OK;
+}
+
+static void test_slow_attach_does_not_stall_the_modem_task(void)
+{
+  nmeaLines = 0;
+  TEST_ASSERT_TRUE(engine->onURC("$G", onNMEA, NULL));
+  TEST_ASSERT_TRUE(uplink->begin());
+  modem.slowCommand = "AT+CIICR";
+  modem.slowMs = 20000;
+
+  while (!modem.slowActive)
+  {
+    runFor(STEP_MS);
+  }
+  bool otherDone = false;
+  TEST_ASSERT_TRUE(engine->send("AT+CGNSINF", 1000, otherJobDone, &otherDone));
+  uint64_t worst = 0;
+  for (int second = 0; second < 19; second++)
+  {
+    stream->replyLine("$GNRMC,081530.000,A,0655.6260,N,07951.6720,E,0.00,0.0,150324,,,A*7C");
+    for (int i = 0; i < 1000 / STEP_MS; i++)
+    {
+      hostMillis() += STEP_MS;
+      engine->poll();
+      uint64_t start = benchNanos();
+      uplink->poll();
+      uint64_t took = benchNanos() - start;
+      if (took > worst)
+        worst = took;
+      modem.step();
+    }
+  }
+  TEST_ASSERT_EQUAL(19, nmeaLines);
+  TEST_ASSERT_FALSE(uplink->isAttached());
+  TEST_ASSERT_FALSE(otherDone); // queued behind AT+CIICR, the modem takes one command at a time
+
+  runUntilConnected();
+  TEST_ASSERT_TRUE(otherDone);
+  size_t cgnsinf = 0;
+  for (size_t i = 0; i < modem.commands.size(); i++)
+    if (modem.commands[i] == "AT+CGNSINF")
+      cgnsinf = i;
+  TEST_ASSERT_EQUAL_STRING("AT+CIICR", modem.commands[cgnsinf - 1].c_str());
+  TEST_ASSERT_EQUAL_STRING("AT+CIFSR", modem.commands[cgnsinf + 1].c_str());
+  benchReport("slowest uplink poll() during the attach", worst / 1000.0, "us");
+  TEST_ASSERT_TRUE(worst < 1000000); // nowhere near a blocking wait
+}
+
+static void test_batches_are_pipelined_and_acked(void)
+{
+  uplink->begin();
+  uplink->setBatchSize(10);
+  runUntilConnected();
+  appendFixes(0, 35);
+  runFor(500);
+
+  // Two batches in flight, the third waits for an ack
+  std::vector<Frame> frames = serverFrames();
+  TEST_ASSERT_EQUAL(UPLINK_WINDOW, (int)frames.size());
+  StoredFix fixes[UPLINK_MAX_BATCH];
+  TEST_ASSERT_EQUAL(10, decodedFixes(frames[0], fixes));
+  TEST_ASSERT_EQUAL_UINT32(1710490000UL, fixes[0].timestamp);
+  TEST_ASSERT_EQUAL(10, decodedFixes(frames[1], fixes));
+  TEST_ASSERT_EQUAL_UINT32(1710490010UL, fixes[0].timestamp);
+  TEST_ASSERT_EQUAL_UINT32(0, fixLog->uploadCursor());
+
+  modem.ack(frames[0].id);
+  runFor(500);
+  TEST_ASSERT_EQUAL_UINT32(10, fixLog->uploadCursor());
+  frames = serverFrames();
+  TEST_ASSERT_EQUAL(3, (int)frames.size());
+  TEST_ASSERT_EQUAL(10, decodedFixes(frames[2], fixes));
+
+  // One ack covers every batch up to its id, the last 5 fixes wait for a flush
+  modem.ack(frames[2].id);
+  runFor(500);
+  TEST_ASSERT_EQUAL_UINT32(30, fixLog->uploadCursor());
+  TEST_ASSERT_EQUAL(3, (int)serverFrames().size());
+  uplink->requestFlush();
+  runFor(500);
+  frames = serverFrames();
+  TEST_ASSERT_EQUAL(4, (int)frames.size());
+  TEST_ASSERT_EQUAL(5, decodedFixes(frames[3], fixes));
+  modem.ack(frames[3].id);
+  runFor(500);
+  TEST_ASSERT_EQUAL_UINT32(35, fixLog->uploadCursor());
+  TEST_ASSERT_EQUAL_UINT32(35, uplink->stats().fixesAcked);
+  TEST_ASSERT_EQUAL_UINT32(modem.server.size(), uplink->stats().bytesSent);
+}
+
+static void test_partial_batch_goes_out_when_it_is_old(void)
+{
+  uplink->begin();
+  runUntilConnected();
+  appendFixes(0, 3);
+  runFor(UPLINK_BATCH_AGE - 1000);
+  TEST_ASSERT_EQUAL(0, (int)serverFrames().size());
+  runFor(2000);
+  TEST_ASSERT_EQUAL(1, (int)serverFrames().size());
+}
+
+static void test_events_jump_ahead_of_fixes(void)
+{
+  uplink->begin();
+  uplink->setBatchSize(5);
+  runUntilConnected();
+  appendFixes(0, 5);
+  UplinkEvent event = {UPLINK_EVENT_STATION_ENTER, 12, 1710490003UL, 69271000, 798612000};
+  TEST_ASSERT_TRUE(uplink->queueEvent(event));
+  runFor(200);
+
+  std::vector<Frame> frames = serverFrames();
+  TEST_ASSERT_EQUAL(2, (int)frames.size());
+  TEST_ASSERT_EQUAL(UPLINK_FRAME_EVENTS, frames[0].type);
+  TEST_ASSERT_EQUAL(1 + UPLINK_EVENT_SIZE, (int)frames[0].payload.size());
+  TEST_ASSERT_EQUAL(1, frames[0].payload[0]);
+  TEST_ASSERT_EQUAL(UPLINK_EVENT_STATION_ENTER, frames[0].payload[1]);
+  TEST_ASSERT_EQUAL(UPLINK_FRAME_FIXES, frames[1].type);
+  modem.ack(frames[1].id);
+  runFor(200);
+  TEST_ASSERT_EQUAL_UINT32(1, uplink->stats().eventsAcked);
+  TEST_ASSERT_EQUAL_UINT32(5, fixLog->uploadCursor());
+}
+
+static void test_closed_session_reconnects_and_resends(void)
+{
+  uplink->begin();
+  uplink->setBatchSize(10);
+  runUntilConnected();
+  appendFixes(0, 20);
+  runFor(300);
+  TEST_ASSERT_EQUAL(2, (int)serverFrames().size());
+  modem.ack(serverFrames()[0].id);
+  runFor(300);
+
+  stream->replyLine("CLOSED");
+  runFor(STEP_MS * 3);
+  TEST_ASSERT_FALSE(uplink->isConnected());
+  TEST_ASSERT_EQUAL_UINT32(1, uplink->stats().failures);
+  TEST_ASSERT_EQUAL_UINT32(1, modem.count("AT+CIPCLOSE=1"));
+
+  modem.server.clear();
+  runFor(UPLINK_BACKOFF_MIN);
+  runUntilConnected();
+  runFor(300);
+  std::vector<Frame> frames = serverFrames();
+  TEST_ASSERT_EQUAL(1, (int)frames.size()); // only the unacknowledged batch
+  StoredFix fixes[UPLINK_MAX_BATCH];
+  TEST_ASSERT_EQUAL(10, decodedFixes(frames[0], fixes));
+  TEST_ASSERT_EQUAL_UINT32(1710490010UL, fixes[0].timestamp);
+  TEST_ASSERT_EQUAL_UINT32(2, uplink->stats().connects);
+  TEST_ASSERT_EQUAL_UINT32(30, uplink->stats().fixesSent);
+}
+
+static void test_failures_back_off_up_to_the_limit(void)
+{
+  modem.failing.insert("AT+CGATT=1");
+  uplink->begin();
+  std::vector<unsigned long> attempts;
+  size_t seen = 0;
+  while (attempts.size() < 9 && hostMillis() < 1000 + 10 * UPLINK_BACKOFF_MAX)
+  {
+    runFor(STEP_MS);
+    if (modem.count("AT+CGATT=1") > seen)
+    {
+      seen = modem.count("AT+CGATT=1");
+      attempts.push_back(hostMillis());
+    }
+  }
+  TEST_ASSERT_EQUAL(9, (int)attempts.size());
+  TEST_ASSERT_EQUAL_UINT32(8, uplink->stats().failures);
+  TEST_ASSERT_FALSE(uplink->isAttached());
+  uint32_t backoff = UPLINK_BACKOFF_MIN;
+  for (size_t i = 1; i < attempts.size(); i++)
+  {
+    unsigned long gap = attempts[i] - attempts[i - 1];
+    TEST_ASSERT_TRUE(gap >= backoff);
+    TEST_ASSERT_TRUE(gap < backoff + 500); // the attach steps before AT+CGATT take a few polls
+    backoff = backoff * 2 > UPLINK_BACKOFF_MAX ? UPLINK_BACKOFF_MAX : backoff * 2;
+  }
+  TEST_ASSERT_TRUE(hostSerial().text.find("GPRS attach failed") != std::string::npos);
+}
+
+static void test_connect_fail_and_ack_timeout(void)
+{
+  modem.connectFails = true;
+  uplink->begin();
+  runFor(2000);
+  TEST_ASSERT_EQUAL_UINT32(1, uplink->stats().failures);
+  TEST_ASSERT_TRUE(hostSerial().text.find("server connection failed") != std::string::npos);
+
+  modem.connectFails = false;
+  runUntilConnected();
+  appendFixes(0, 10);
+  runFor(UPLINK_ACK_TIMEOUT + 1000);
+  TEST_ASSERT_EQUAL_UINT32(2, uplink->stats().failures);
+  TEST_ASSERT_TRUE(hostSerial().text.find("ack timeout") != std::string::npos);
+}
+
+/*
+ * The bytes-per-fix figure that printStats() reports, checked against
+ * what reached the server, for the default batch and the largest one.
+ */
+static void test_bytes_per_fix_report(void)
+{
+  const uint8_t batches[] = {UPLINK_DEFAULT_BATCH, UPLINK_MAX_BATCH};
+  for (size_t b = 0; b < sizeof(batches); b++)
+  {
+    tearDown();
+    setUp();
+    uplink->begin();
+    uplink->setBatchSize(batches[b]);
+    runUntilConnected();
+    appendFixes(0, 320);
+    while (fixLog->uploadCursor() < 320)
+    {
+      runFor(100);
+      std::vector<Frame> frames = serverFrames();
+      if (!frames.empty())
+        modem.ack(frames.back().id);
+      TEST_ASSERT_TRUE(hostMillis() < 600000);
+    }
+    const UplinkStats &stats = uplink->stats();
+    TEST_ASSERT_EQUAL_UINT32(320, stats.fixesAcked);
+    TEST_ASSERT_EQUAL_UINT32(modem.server.size(), stats.bytesSent);
+    double perFix = (double)modem.server.size() / 320;
+    char what[64];
+    snprintf(what, sizeof(what), "bytes per fix in batches of %u", (unsigned)batches[b]);
+    benchReport(what, perFix, "B");
+    TEST_ASSERT_TRUE(perFix < sizeof(StoredFix) / 2.0);
+
+    StringPrint out;
+    uplink->printStats(out);
+    char line[64];
+    snprintf(line, sizeof(line), "%.1f bytes/fix", perFix);
+    TEST_ASSERT_TRUE(out.text.find(line) != std::string::npos);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_bring_up_goes_through_the_at_engine);
+  RUN_TEST(test_slow_attach_does_not_stall_the_modem_task);
+  RUN_TEST(test_batches_are_pipelined_and_acked);
+  RUN_TEST(test_partial_batch_goes_out_when_it_is_old);
+  RUN_TEST(test_events_jump_ahead_of_fixes);
+  RUN_TEST(test_closed_session_reconnects_and_resends);
+  RUN_TEST(test_failures_back_off_up_to_the_limit);
+  RUN_TEST(test_connect_fail_and_ack_timeout);
+  RUN_TEST(test_bytes_per_fix_report);
+  return UNITY_END();
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""
+Reference decoder for the telemetry uplink (see lib/Telemetry/TelemetryCodec.h
+and lib/Uplink/Uplink.h), for the server side and for checking captures.
+
+Input is either a capture of the TCP stream the device sends, a sequence of
+'T' 'M' type(1) id(2, LE) length(2, LE) payload frames, or with --batch a
+single encoded batch without a frame header. Fixes are printed as CSV, then
+a report of the bytes each fix took on the wire:
+
+    python3 tools/decode_telemetry.py capture.bin
+    python3 tools/decode_telemetry.py --batch --hex 0103...
+"""
+
+import argparse
+import struct
+import sys
+
+VERSION = 1                 # TELEMETRY_VERSION
+HAS_HDOP = 0x01             # TELEMETRY_HAS_*
+HAS_SATELLITES = 0x02
+HAS_COURSE = 0x04
+HAS_FLAGS = 0x08
+ALL_FIELDS = HAS_HDOP | HAS_SATELLITES | HAS_COURSE | HAS_FLAGS
+FLAG_VALID = 0x01           # FIXLOG_FLAG_VALID
+FRAME_HEADER = 7            # UPLINK_HEADER_SIZE
+FRAME_FIXES = 1             # UPLINK_FRAME_FIXES
+STORED_FIX_SIZE = 24        # sizeof(StoredFix), what a fix costs uncompressed
+SCALE = 10000000            # 1e-7 degree fixed point
+
+
+class Malformed(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise Malformed("truncated")
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def u32(self):
+        return self.byte() | self.byte() << 8 | self.byte() << 16 | self.byte() << 24
+
+    def varint(self):
+        value = 0
+        for shift in range(0, 35, 7):
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value & 0xFFFFFFFF
+        raise Malformed("varint longer than 5 bytes")
+
+    def zigzag(self):
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+
+def signed32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def decode_batch(data):
+    """Same checks as decodeTelemetryBatch(), returns a list of fix dicts."""
+    r = Reader(data)
+    if r.byte() != VERSION:
+        raise Malformed("unknown version")
+    mask = r.byte()
+    count = r.varint()
+    time, lat, lon = r.u32(), r.u32(), r.u32()
+    if mask & ~ALL_FIELDS:
+        raise Malformed("unknown fields 0x%02x" % mask)
+
+    altitude = speed = course = hdop = satellites = 0
+    flags = FLAG_VALID
+    fixes = []
+    for _ in range(count):
+        presence = r.byte()
+        if presence & ~mask:
+            raise Malformed("field not in the batch mask")
+        time = (time + r.zigzag()) & 0xFFFFFFFF
+        lat = (lat + r.zigzag()) & 0xFFFFFFFF
+        lon = (lon + r.zigzag()) & 0xFFFFFFFF
+        altitude += r.zigzag()
+        speed += r.zigzag()
+        if not -32768 <= altitude <= 32767 or not 0 <= speed <= 65535:
+            raise Malformed("altitude or speed out of range")
+        if presence & HAS_COURSE:
+            turn = r.zigzag()
+            if not -1800 <= turn < 1800:
+                raise Malformed("course turn out of range")
+            course = (course + turn) % 3600
+        if presence & HAS_HDOP:
+            hdop = r.byte()
+        if presence & HAS_SATELLITES:
+            satellites = r.byte()
+        if presence & HAS_FLAGS:
+            flags = r.byte()
+        fixes.append({"time": time, "latitude": signed32(lat) / SCALE, "longitude": signed32(lon) / SCALE,
+                      "altitude": altitude, "speed": speed / 10, "course": course / 10, "hdop": hdop / 10,
+                      "satellites": satellites, "flags": flags})
+    return fixes
+
+
+def frames(data):
+    """(type, id, payload) of every frame in a captured stream."""
+    pos = 0
+    while pos < len(data):
+        if len(data) - pos < FRAME_HEADER or data[pos:pos + 2] != b"TM":
+            raise Malformed("no frame header at offset %d" % pos)
+        kind, ident, length = struct.unpack_from("<BHH", data, pos + 2)
+        payload = data[pos + FRAME_HEADER:pos + FRAME_HEADER + length]
+        if len(payload) != length:
+            raise Malformed("frame %d truncated" % ident)
+        yield kind, ident, payload
+        pos += FRAME_HEADER + length
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("input", nargs="?", help="capture file, stdin when omitted")
+    parser.add_argument("--batch", action="store_true", help="input is one batch without a frame header")
+    parser.add_argument("--hex", help="input as hex digits instead of a file")
+    args = parser.parse_args()
+
+    if args.hex is not None:
+        data = bytes.fromhex(args.hex)
+    elif args.input:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    batches = [data] if args.batch else [p for kind, _, p in frames(data) if kind == FRAME_FIXES]
+    headers = 0 if args.batch else FRAME_HEADER * len(batches)
+
+    print("time,latitude,longitude,altitude,speed,course,hdop,satellites,flags")
+    total = 0
+    for batch in batches:
+        for fix in decode_batch(batch):
+            print("%(time)u,%(latitude).7f,%(longitude).7f,%(altitude)d,%(speed).1f,%(course).1f,"
+                  "%(hdop).1f,%(satellites)u,%(flags)u" % fix)
+            total += 1
+
+    payload = sum(len(b) for b in batches)
+    if total > 0:
+        print("%d fixes in %d batches: %.1f bytes/fix encoded, %.1f with frame headers, %d as StoredFix (%.0f%%)"
+              % (total, len(batches), payload / total, (payload + headers) / total, STORED_FIX_SIZE,
+                 100.0 * payload / (total * STORED_FIX_SIZE)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except Malformed as e:
+        raise SystemExit("malformed telemetry: %s" % e)
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+Generate include/Stations.h from a station list.
+
+Input CSV columns:
+    id,name,shape,latitude,longitude,radius_m,vertices
+shape is "circle" (latitude/longitude/radius_m) or "polygon" (vertices as
+"lat lon;lat lon;..."). The output holds the fences, polygon vertices and a
+uniform grid index as const tables, so they stay in flash on the ESP32.
+
+    python3 tools/gen_geofences.py tools/stations.csv include/Stations.h
+"""
+
+import argparse
+import csv
+import math
+
+SCALE = 10000000            # 1e-7 degree fixed point, see GeoMath.h
+CM_PER_UNIT = 1.11195       # meridian arc of 1e-7 degree
+MAX_GRID = 128              # cells per side
+
+
+def fixed(value):
+    return int(round(float(value) * SCALE))
+
+
+def load(path):
+    fences = []
+    vertices = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            fence = {"id": int(row["id"]), "name": row["name"].strip()}
+            if row["shape"].strip() == "circle":
+                lat, lon = fixed(row["latitude"]), fixed(row["longitude"])
+                radius_cm = int(round(float(row["radius_m"]) * 100))
+                dlat = int(radius_cm / CM_PER_UNIT) + 1
+                dlon = int(dlat / math.cos(math.radians(lat / SCALE))) + 1
+                fence.update(lat=lat, lon=lon, radius=radius_cm, first=0, count=0,
+                             box=(lat - dlat, lon - dlon, lat + dlat, lon + dlon))
+            else:
+                points = [tuple(fixed(v) for v in p.split()) for p in row["vertices"].split(";") if p.strip()]
+                if not 3 <= len(points) <= 255:
+                    raise SystemExit("fence %d: polygons need 3 to 255 vertices" % fence["id"])
+                lats = [p[0] for p in points]
+                lons = [p[1] for p in points]
+                fence.update(lat=sum(lats) // len(lats), lon=sum(lons) // len(lons), radius=0,
+                             first=len(vertices), count=len(points),
+                             box=(min(lats), min(lons), max(lats), max(lons)))
+                vertices.extend(points)
+            fences.append(fence)
+    if not fences:
+        raise SystemExit("no stations in %s" % path)
+    return fences, vertices
+
+
+def build_grid(fences, cell_deg):
+    south = min(f["box"][0] for f in fences)
+    west = min(f["box"][1] for f in fences)
+    north = max(f["box"][2] for f in fences)
+    east = max(f["box"][3] for f in fences)
+
+    cell_lat = cell_lon = max(1, int(cell_deg * SCALE))
+    cell_lat = max(cell_lat, (north - south) // MAX_GRID + 1)
+    cell_lon = max(cell_lon, (east - west) // MAX_GRID + 1)
+    rows = (north - south) // cell_lat + 1
+    cols = (east - west) // cell_lon + 1
+
+    cells = [[] for _ in range(rows * cols)]
+    for index, f in enumerate(fences):
+        s, w, n, e = f["box"]
+        for r in range((s - south) // cell_lat, (n - south) // cell_lat + 1):
+            for c in range((w - west) // cell_lon, (e - west) // cell_lon + 1):
+                cells[r * cols + c].append(index)
+
+    starts = [0]
+    flat = []
+    for cell in cells:
+        flat.extend(cell)
+        starts.append(len(flat))
+    return dict(south=south, west=west, cell_lat=cell_lat, cell_lon=cell_lon,
+                rows=rows, cols=cols, starts=starts, flat=flat,
+                busiest=max(len(c) for c in cells))
+
+
+def wrap(values, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines) if lines else "    0,"
+
+
+def write_header(path, source, fences, vertices, grid):
+    out = []
+    out.append("/*")
+    out.append(" * Station geofences, generated by tools/gen_geofences.py from %s." % source)
+    out.append(" * Do not edit; regenerate after changing the station list.")
+    out.append(" *")
+    out.append(" * %d fences, %d polygon vertices, %dx%d grid, at most %d fences per cell."
+               % (len(fences), len(vertices), grid["rows"], grid["cols"], grid["busiest"]))
+    out.append(" * Defines tables, include from one source file only.")
+    out.append(" */")
+    out.append("")
+    out.append("#ifndef Stations_h")
+    out.append("#define Stations_h")
+    out.append("")
+    out.append('#include "Geofence.h"')
+    out.append("")
+    out.append("#define STATION_COUNT %d" % len(fences))
+    out.append("")
+    out.append("static const GeoFence STATION_FENCES[STATION_COUNT] = {")
+    for f in fences:
+        s, w, n, e = f["box"]
+        out.append("    {%d, %d, %d, %d, %d, %d, {%d, %d, %d, %d}}, // %s"
+                   % (f["id"], f["count"], f["first"], f["lat"], f["lon"], f["radius"], s, w, n, e, f["name"]))
+    out.append("};")
+    out.append("")
+    out.append("static const GeoVertex STATION_VERTICES[] = {")
+    if vertices:
+        for lat, lon in vertices:
+            out.append("    {%d, %d}," % (lat, lon))
+    else:
+        out.append("    {0, 0}, // no polygons")
+    out.append("};")
+    out.append("")
+    out.append("static const char *const STATION_NAMES[STATION_COUNT] = {")
+    for f in fences:
+        out.append('    "%s",' % f["name"].replace('"', "'"))
+    out.append("};")
+    out.append("")
+    out.append("static const uint16_t STATION_CELL_START[] = {")
+    out.append(wrap(grid["starts"]))
+    out.append("};")
+    out.append("")
+    out.append("static const uint16_t STATION_CELL_FENCES[] = {")
+    out.append(wrap(grid["flat"]))
+    out.append("};")
+    out.append("")
+    out.append("static const GeofenceTable STATION_TABLE = {")
+    out.append("    STATION_FENCES, STATION_COUNT, STATION_VERTICES,")
+    out.append("    STATION_CELL_START, STATION_CELL_FENCES,")
+    out.append("    %d, %d, // grid origin" % (grid["south"], grid["west"]))
+    out.append("    %d, %d, // cell size" % (grid["cell_lat"], grid["cell_lon"]))
+    out.append("    %d, %d};" % (grid["rows"], grid["cols"]))
+    out.append("")
+    out.append("#endif")
+    with open(path, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("stations", help="station CSV")
+    parser.add_argument("header", help="generated header")
+    parser.add_argument("--cell", type=float, default=0.05, help="grid cell size in degrees (default 0.05)")
+    args = parser.parse_args()
+
+    fences, vertices = load(args.stations)
+    if len(fences) > 65535 or len(vertices) > 65535:
+        raise SystemExit("too many fences or vertices for 16-bit indexes")
+    grid = build_grid(fences, args.cell)
+    if len(grid["flat"]) > 65535:
+        raise SystemExit("grid too fine, use a larger --cell")
+    write_header(args.header, args.stations.replace("\\", "/"), fences, vertices, grid)
+    print("%d fences, %dx%d grid, at most %d fences per cell"
+          % (len(fences), grid["rows"], grid["cols"], grid["busiest"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+Generate include/Screens.h: the boot and welcome screens pre-rendered into
+SSD1306 page-layout bitmaps, plus the reveal steps of the welcome screen's
+typewriter line (see lib/ScreenAnimator).
+
+Text is laid out exactly as Adafruit_GFX does with its built-in 5x7 font
+(cursor, wrapping and getTextBounds centering), reading the glyphs from the
+library's glcdfont.c. PlatformIO runs this before main.cpp is compiled, once
+lib_deps are installed (extra_scripts in platformio.ini). By hand:
+
+    python3 tools/gen_screens.py ".pio/libdeps/esp32doit-devkit-v1/Adafruit GFX Library/glcdfont.c" include/Screens.h
+"""
+
+import argparse
+import os
+import re
+
+WIDTH = 128                 # SCREEN_WIDTH in main.cpp
+HEIGHT = 64                 # SCREEN_HEIGHT
+TYPE_TICK_MS = 45           # one character of the welcome line
+TYPE_HOLD_MS = 500          # full line stays up before typing again
+
+
+def load_font(path):
+    with open(path) as f:
+        text = f.read()
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"//[^\n]*", "", text)
+    body = text[text.index("{") + 1:text.index("}")]
+    font = [int(v, 0) for v in re.findall(r"0x[0-9A-Fa-f]+|\d+", body)]
+    if len(font) < 128 * 5:
+        raise SystemExit("%s does not look like the GFX classic font" % path)
+    return font
+
+
+class Canvas:
+    """The parts of Adafruit_GFX text drawing the screens use."""
+
+    def __init__(self, font):
+        self.font = font
+        self.buffer = bytearray(WIDTH * HEIGHT // 8)
+        self.x = self.y = 0
+        self.size = 1
+
+    def pixel(self, x, y):
+        if 0 <= x < WIDTH and 0 <= y < HEIGHT:
+            self.buffer[x + (y // 8) * WIDTH] |= 1 << (y & 7)
+
+    def glyph(self, x, y, c):
+        for i in range(5):
+            line = self.font[ord(c) * 5 + i]
+            for j in range(8):
+                if line & (1 << j):
+                    for dx in range(self.size):
+                        for dy in range(self.size):
+                            self.pixel(x + i * self.size + dx, y + j * self.size + dy)
+
+    def _advance(self, c, draw):
+        """Moves the cursor over one character, returns where it was drawn."""
+        if c == "\n":
+            self.x = 0
+            self.y += self.size * 8
+            return None
+        if c == "\r":
+            return None
+        if self.x + self.size * 6 > WIDTH:  # wrap is on by default
+            self.x = 0
+            self.y += self.size * 8
+        at = (self.x, self.y)
+        if draw:
+            self.glyph(self.x, self.y, c)
+        self.x += self.size * 6
+        return at
+
+    def bounds(self, text):
+        """getTextBounds(text, 0, 0, ...) -> (w, h)"""
+        saved = (self.x, self.y)
+        self.x = self.y = 0
+        minx, miny, maxx, maxy = WIDTH, HEIGHT, -1, -1
+        for c in text:
+            at = self._advance(c, False)
+            if at is None:
+                continue
+            minx, miny = min(minx, at[0]), min(miny, at[1])
+            maxx = max(maxx, at[0] + self.size * 6 - 1)
+            maxy = max(maxy, at[1] + self.size * 8 - 1)
+        self.x, self.y = saved
+        return (maxx - minx + 1 if maxx >= minx else 0, maxy - miny + 1 if maxy >= miny else 0)
+
+    def println(self, text, draw=True):
+        placed = [(c, self._advance(c, draw)) for c in text]
+        self._advance("\n", False)
+        return placed
+
+
+def boot_screen(font):
+    # Layout of the old showBootScreen()
+    canvas = Canvas(font)
+    lines = [("Track-ME", 2), ("Powered by EIT @ UOC", 1), ("(20/21 Batch)", 1)]
+    canvas.size = 2
+    w1, h1 = canvas.bounds(lines[0][0])
+    canvas.size = 1
+    w2, _ = canvas.bounds(lines[1][0])
+    w3, _ = canvas.bounds(lines[2][0])
+    places = [((WIDTH - w1) // 2, HEIGHT // 2 - h1 - 5),
+              ((WIDTH - w2) // 2, HEIGHT // 2 + 5),
+              ((WIDTH - w3) // 2, HEIGHT // 2 + 15)]
+    for (text, size), (x, y) in zip(lines, places):
+        canvas.size = size
+        canvas.x, canvas.y = x, y
+        canvas.println(text)
+    return canvas.buffer
+
+
+def welcome_screen(font):
+    # Layout of the old showWelcomeScreen(), with the last line fully typed
+    canvas = Canvas(font)
+    line1, line2, line3 = "Welcome to", "Track-ME", " Press START Button      to continue..."
+    canvas.size = 2
+    w2, h2 = canvas.bounds(line2)
+    canvas.size = 1
+    w3, _ = canvas.bounds(line3)
+    w11, _ = canvas.bounds(line1)
+
+    canvas.size = 1
+    canvas.x, canvas.y = (WIDTH - w11) // 2, 0
+    canvas.println(line1)
+    canvas.size = 2
+    canvas.x, canvas.y = (WIDTH - w2) // 2, HEIGHT // 2 - h2 // 2 - 2
+    canvas.println(line2)
+    canvas.size = 1
+    canvas.x, canvas.y = (WIDTH - w3) // 2, HEIGHT // 2 + 16
+    steps = []
+    for c, (x, y) in canvas.println(line3):
+        if y % 8:
+            raise SystemExit("typed line must sit on a page boundary")
+        width = 0 if c == " " or x >= WIDTH else min(6, WIDTH - x)
+        steps.append((y // 8, min(x, WIDTH - 1), width))
+    return canvas.buffer, steps
+
+
+def c_bytes(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(rows)
+
+
+def render(font):
+    boot = boot_screen(font)
+    welcome, steps = welcome_screen(font)
+    out = []
+    out.append("// Generated by tools/gen_screens.py from the Adafruit GFX classic font, do not edit.")
+    out.append("// Frames are in SSD1306 page layout: byte x + page * %d holds 8 pixels of column x." % WIDTH)
+    out.append("// The ESP32 maps flash into the data space, so the tables are read in place.")
+    out.append("")
+    out.append("#ifndef Screens_h")
+    out.append("#define Screens_h")
+    out.append("")
+    out.append("#include <Arduino.h>")
+    out.append('#include "ScreenAnimator.h"')
+    out.append("")
+    out.append("#define SCREEN_BYTES %d" % len(boot))
+    out.append("")
+    out.append("constexpr uint8_t SCREEN_BOOT[SCREEN_BYTES] PROGMEM = {")
+    out.append(c_bytes(boot))
+    out.append("};")
+    out.append("")
+    out.append("constexpr uint8_t SCREEN_WELCOME[SCREEN_BYTES] PROGMEM = {")
+    out.append(c_bytes(welcome))
+    out.append("};")
+    out.append("")
+    out.append("// One character of \"Press START Button to continue...\" per tick")
+    out.append("constexpr AnimationStep WELCOME_STEPS[] PROGMEM = {")
+    for i in range(0, len(steps), 6):
+        out.append("    " + " ".join("{%d, %d, %d}," % s for s in steps[i:i + 6]))
+    out.append("};")
+    out.append("")
+    out.append("constexpr Animation WELCOME_ANIMATION = {SCREEN_WELCOME, WELCOME_STEPS, %d, %d, %d};"
+               % (len(steps), TYPE_TICK_MS, TYPE_HOLD_MS))
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return False
+    with open(path, "w") as f:
+        f.write(text)
+    return True
+
+
+def generate(font_path, out_path):
+    if write_if_changed(out_path, render(load_font(font_path))):
+        print("gen_screens: wrote %s" % out_path)
+
+
+def find_font(root):
+    for folder, _, files in os.walk(root):
+        if "glcdfont.c" in files:
+            return os.path.join(folder, "glcdfont.c")
+    raise SystemExit("gen_screens: glcdfont.c not found under %s, is Adafruit GFX in lib_deps?" % root)
+
+
+try:
+    Import("env")  # noqa: F821, defined when PlatformIO runs this as an extra script
+except NameError:
+    env = None
+
+if env is not None:
+    def _pre_build(target, source, env):
+        generate(find_font(env.subst("$PROJECT_LIBDEPS_DIR/$PIOENV")),
+                 os.path.join(env.subst("$PROJECT_INCLUDE_DIR"), "Screens.h"))
+
+    env.AddPreAction("$BUILD_DIR/src/main.cpp.o", _pre_build)
+else:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("font", help="glcdfont.c from Adafruit GFX")
+    parser.add_argument("output", help="header to write, e.g. include/Screens.h")
+    args = parser.parse_args()
+    generate(args.font, args.output)
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Stand-in tracking server for measuring the telemetry uplink (see
+lib/Uplink/Uplink.h). Point UPLINK_HOST and UPLINK_PORT in src/main.cpp at
+the machine running it.
+
+Every 'T' 'M' frame is acknowledged with 'A' id(2, LE), optionally after a
+delay or only every few frames, so the batching window and the ack time
+show up as they would against the real server. Each session and a running
+total report the throughput and the bytes each fix took on the wire:
+
+    python3 tools/uplink_server.py --port 5000 --capture capture.bin
+    python3 tools/uplink_server.py --ack-delay 800 --close-after 50
+
+The capture is the raw TCP stream, readable by tools/decode_telemetry.py.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+from decode_telemetry import FRAME_FIXES, FRAME_HEADER, STORED_FIX_SIZE, Malformed, decode_batch
+
+FRAME_EVENTS = 2            # UPLINK_FRAME_EVENTS
+
+
+class Totals:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.bytes = 0
+        self.payload = 0    # encoded fix payload, without headers
+        self.frames = 0
+        self.fixes = 0
+        self.events = 0
+        self.seconds = 0.0  # time with a session open
+
+    def add(self, other):
+        with self.lock:
+            for name in ("bytes", "payload", "frames", "fixes", "events", "seconds"):
+                setattr(self, name, getattr(self, name) + getattr(other, name))
+
+    def report(self, label):
+        line = "%s: %d frames, %d fixes, %d events, %d bytes in %.0f s" % (
+            label, self.frames, self.fixes, self.events, self.bytes, self.seconds)
+        if self.seconds > 0:
+            line += ", %.1f bytes/s" % (self.bytes / self.seconds)
+        if self.fixes > 0:
+            line += ", %.1f bytes/fix (%.1f encoded, %d as StoredFix)" % (
+                self.bytes / self.fixes, self.payload / self.fixes, STORED_FIX_SIZE)
+        print(line, flush=True)
+
+
+def serve(conn, peer, args, totals, capture):
+    session = Totals()
+    started = time.monotonic()
+    buffer = b""
+    unacked = []
+    print("%s:%d connected" % peer, flush=True)
+    try:
+        while args.close_after == 0 or session.frames < args.close_after:
+            data = conn.recv(4096)
+            if not data:
+                break
+            session.bytes += len(data)
+            if capture is not None:
+                with totals.lock:
+                    capture.write(data)
+                    capture.flush()
+            buffer += data
+            while len(buffer) >= FRAME_HEADER:
+                if buffer[:2] != b"TM":
+                    raise Malformed("no frame header")
+                kind, ident, length = struct.unpack_from("<BHH", buffer, 2)
+                if len(buffer) < FRAME_HEADER + length:
+                    break
+                payload = buffer[FRAME_HEADER:FRAME_HEADER + length]
+                buffer = buffer[FRAME_HEADER + length:]
+                session.frames += 1
+                if kind == FRAME_FIXES:
+                    session.fixes += len(decode_batch(payload))
+                    session.payload += length
+                elif kind == FRAME_EVENTS and length > 0:
+                    session.events += payload[0]
+                unacked.append(ident)
+            # One ack covers every frame up to its id
+            if unacked and len(unacked) >= args.ack_every:
+                if args.ack_delay > 0:
+                    time.sleep(args.ack_delay / 1000.0)
+                conn.sendall(b"A" + struct.pack("<H", unacked[-1]))
+                unacked = []
+    except (Malformed, OSError) as e:
+        print("%s:%d %s" % (peer[0], peer[1], e), file=sys.stderr, flush=True)
+    finally:
+        conn.close()
+        session.seconds = time.monotonic() - started
+        totals.add(session)
+        session.report("%s:%d closed" % peer)
+        totals.report("total")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--host", default="0.0.0.0", help="address to listen on")
+    parser.add_argument("--port", type=int, default=5000, help="UPLINK_PORT")
+    parser.add_argument("--ack-delay", type=int, default=0, help="ms before each ack is sent")
+    parser.add_argument("--ack-every", type=int, default=1, help="ack only every N frames")
+    parser.add_argument("--close-after", type=int, default=0, help="drop the session after N frames")
+    parser.add_argument("--capture", help="append the raw stream to this file")
+    args = parser.parse_args()
+
+    capture = open(args.capture, "ab") if args.capture else None
+    totals = Totals()
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind((args.host, args.port))
+    listener.listen(4)
+    print("listening on %s:%d" % (args.host, args.port), flush=True)
+    try:
+        while True:
+            conn, peer = listener.accept()
+            threading.Thread(target=serve, args=(conn, peer, args, totals, capture), daemon=True).start()
+    except KeyboardInterrupt:
+        totals.report("total")
+    finally:
+        listener.close()
+        if capture is not None:
+            capture.close()
+
+
+if __name__ == "__main__":
+    main()